@@ -0,0 +1,42 @@
+#ifndef BENCH_UTIL_HPP
+#define BENCH_UTIL_HPP
+
+// helpers shared by the octree benchmarks
+
+#include "CpuOctreeTracer.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// bit for bit, including the traversal iterations
+inline bool hit_equal(const CpuOctreeTracer::Hit &l, const CpuOctreeTracer::Hit &r) {
+	return memcmp(&l.position, &r.position, sizeof(glm::vec3)) == 0 &&
+	       memcmp(&l.color, &r.color, sizeof(glm::vec3)) == 0 &&
+	       memcmp(&l.normal, &r.normal, sizeof(glm::vec3)) == 0 && l.iteration == r.iteration;
+}
+
+// fragments (as VoxDataAdapter::CreateFragmentData) of a rolling heightfield at level, one per column, colored by
+// their position or, with color_by_height, by their height so that neighbors mostly have similar colors
+inline std::vector<uint32_t> rolling_heightfield(uint32_t level, bool color_by_height = false) {
+	std::vector<uint32_t> fragment_data;
+	uint32_t resolution = 1u << level;
+	fragment_data.reserve((size_t)resolution * resolution * 2);
+	for (uint32_t z = 0; z < resolution; ++z)
+		for (uint32_t x = 0; x < resolution; ++x) {
+			float u = (float)x / (float)resolution, v = (float)z / (float)resolution;
+			float height =
+			    0.35f + 0.15f * std::sin(u * 9.0f) * std::cos(v * 7.0f) + 0.05f * std::sin(u * 31.0f + v * 23.0f);
+			uint32_t y = (uint32_t)(height * (float)resolution);
+			uint32_t color = (x & 0xffu) | (y & 0xffu) << 8u | (z & 0xffu) << 16u;
+			if (color_by_height) {
+				uint32_t shade = (uint32_t)(height * 400.0f) & 0xffu, blue = x * 255u / resolution;
+				color = shade | (255u - shade) << 8u | blue << 16u;
+			}
+			fragment_data.push_back(x | (y << 12u) | ((z & 0xffu) << 24u));
+			fragment_data.push_back(((z >> 8u) << 28u) | color);
+		}
+	return fragment_data;
+}
+
+#endif
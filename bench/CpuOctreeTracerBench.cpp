@@ -0,0 +1,179 @@
+// CPU octree tracer benchmark
+// Usage: CpuOctreeTracerBench [-tree64] [file.vox] [octree_level]
+// Without a file argument (or with "-") a heightfield at level 10 is used. Traces a 1024x1024 pinhole view of the
+// octree with the single-ray reference on one thread and with the batch API (AVX2 packets where available) on all
+// threads, and checks that both agree bit for bit. The batch API also runs over the CompactOctree encoding, which has to give the same hits.
+// -tree64 also traces a Tree64 of the same octree with CpuTree64Tracer, which has to give the same hits.
+#include "BenchUtil.hpp"
+#include "CompactOctree.hpp"
+#include "CpuOctreeBuilder.hpp"
+#include "CpuOctreeTracer.hpp"
+#include "CpuTree64Tracer.hpp"
+#include "Tree64.hpp"
+#include "VoxDataAdapter.hpp"
+#include "VoxLoader.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+constexpr uint32_t kWidth = 1024, kHeight = 1024;
+
+int main(int argc, char **argv) {
+	spdlog::set_level(spdlog::level::warn);
+
+	// -tree64 may appear anywhere, the other arguments are positional
+	bool tree64 = false;
+	std::vector<const char *> args;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-tree64") == 0)
+			tree64 = true;
+		else
+			args.push_back(argv[i]);
+	}
+	const char *filename = !args.empty() && strcmp(args[0], "-") != 0 ? args[0] : nullptr;
+	uint32_t level = args.size() > 1 ? std::clamp(atoi(args[1]), 1, 12) : 10;
+
+	std::vector<uint32_t> fragment_data;
+	if (filename) {
+		auto vox_data = VoxLoader::LoadVox(filename);
+		if (!vox_data) {
+			spdlog::error("Failed to load {}", filename);
+			return EXIT_FAILURE;
+		}
+		fragment_data = VoxDataAdapter::CreateFragmentData(*vox_data, level);
+	} else
+		fragment_data = rolling_heightfield(level);
+
+	std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create();
+	std::shared_ptr<CpuOctreeBuilder> builder = CpuOctreeBuilder::Create(thread_pool, level);
+	builder->Build((const glm::uvec2 *)fragment_data.data(), fragment_data.size() / 2);
+	std::shared_ptr<CpuOctreeTracer> tracer = CpuOctreeTracer::Create(thread_pool, builder->GetOctree());
+
+	// pinhole camera outside the [1, 2]^3 cube looking down at the middle of the terrain
+	const glm::vec3 position{2.8f, 2.4f, 0.3f};
+	const glm::vec3 look = glm::normalize(glm::vec3(1.5f, 1.35f, 1.5f) - position);
+	const glm::vec3 side = glm::normalize(glm::cross(look, glm::vec3(0.0f, 1.0f, 0.0f)));
+	const glm::vec3 up = glm::cross(side, look);
+	std::vector<glm::vec3> origins(kWidth * kHeight, position), directions(kWidth * kHeight);
+	for (uint32_t y = 0; y < kHeight; ++y)
+		for (uint32_t x = 0; x < kWidth; ++x) {
+			glm::vec2 uv = (glm::vec2(x, y) + 0.5f) / glm::vec2(kWidth, kHeight) * 2.0f - 1.0f;
+			directions[y * kWidth + x] = glm::normalize(look + 0.5f * (uv.x * side - uv.y * up));
+		}
+	const size_t count = origins.size();
+	printf("%zu rays, level %u, range %.1f MB, %u threads\n", count, level, builder->GetOctreeRange() / 1000000.0,
+	       thread_pool->GetThreadCount());
+
+	std::shared_ptr<CompactOctree> compact_octree =
+	    CompactOctree::Convert(thread_pool, builder->GetOctree().data(), builder->GetOctreeRange());
+	if (!compact_octree) {
+		spdlog::error("Failed to convert the octree to the compact encoding");
+		return EXIT_FAILURE;
+	}
+	std::shared_ptr<CpuOctreeTracer> compact_tracer =
+	    CpuOctreeTracer::Create(thread_pool, compact_octree->GetWords(), true);
+	printf("compact range %.1f MB (%.2fx smaller)\n", compact_octree->GetRange() / 1000000.0,
+	       (double)builder->GetOctreeRange() / (double)compact_octree->GetRange());
+
+	std::vector<CpuOctreeTracer::Hit> scalar_hits(count), batch_hits(count), compact_hits(count);
+	std::vector<bool> scalar_results(count);
+	std::unique_ptr<bool[]> batch_results{new bool[count]}, compact_results{new bool[count]};
+
+	auto begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < count; ++i)
+		scalar_results[i] = tracer->RayMarchLeaf(origins[i], directions[i], &scalar_hits[i]);
+	double scalar_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	double batch_time = 1e30;
+	for (uint32_t i = 0; i < 3; ++i) {
+		begin = std::chrono::steady_clock::now();
+		tracer->RayMarchLeaf(origins.data(), directions.data(), count, batch_hits.data(), batch_results.get());
+		batch_time =
+		    std::min(batch_time, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+	}
+
+	double compact_time = 1e30;
+	for (uint32_t i = 0; i < 3; ++i) {
+		begin = std::chrono::steady_clock::now();
+		compact_tracer->RayMarchLeaf(origins.data(), directions.data(), count, compact_hits.data(),
+		                             compact_results.get());
+		compact_time =
+		    std::min(compact_time, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+	}
+
+	size_t hit_count = 0, mismatch_count = 0, compact_mismatch_count = 0;
+	uint64_t iteration_count = 0;
+	for (size_t i = 0; i < count; ++i) {
+		hit_count += scalar_results[i];
+		iteration_count += scalar_hits[i].iteration;
+		if (scalar_results[i] != batch_results[i] || !hit_equal(scalar_hits[i], batch_hits[i]))
+			++mismatch_count;
+		// the color of a miss is taken from whatever word the traversal read last, which differs between the encodings
+		if (batch_results[i] != compact_results[i] ||
+		    (batch_results[i] && !hit_equal(batch_hits[i], compact_hits[i])))
+			++compact_mismatch_count;
+	}
+
+	printf("%.1f%% hit, %.1f iterations/ray\n", 100.0 * hit_count / count, (double)iteration_count / count);
+	printf("single-ray %9.3f ms  %7.2f M rays/s\n", scalar_time * 1000.0, count / scalar_time / 1000000.0);
+	printf("batch      %9.3f ms  %7.2f M rays/s\n", batch_time * 1000.0, count / batch_time / 1000000.0);
+	printf("compact    %9.3f ms  %7.2f M rays/s\n", compact_time * 1000.0, count / compact_time / 1000000.0);
+
+	if (mismatch_count) {
+		spdlog::error("{} rays differ between the single-ray tracer and the batch API", mismatch_count);
+		return EXIT_FAILURE;
+	}
+	if (compact_mismatch_count) {
+		spdlog::error("{} rays differ between the octree and its compact encoding", compact_mismatch_count);
+		return EXIT_FAILURE;
+	}
+	if (!tree64)
+		return EXIT_SUCCESS;
+
+	begin = std::chrono::steady_clock::now();
+	std::shared_ptr<Tree64> tree = Tree64::Build(builder->GetOctree().data(), builder->GetOctreeRange());
+	double tree64_build_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	if (!tree) {
+		spdlog::error("Failed to build the 64-tree");
+		return EXIT_FAILURE;
+	}
+	std::shared_ptr<CpuTree64Tracer> tree64_tracer = CpuTree64Tracer::Create(thread_pool, tree->GetWords());
+	printf("64-tree: depth %u, %u nodes, range %.1f MB, built in %.3f ms\n", tree->GetDepth(), tree->GetNodeCount(),
+	       tree->GetRange() / 1000000.0, tree64_build_time * 1000.0);
+
+	std::vector<CpuOctreeTracer::Hit> tree64_hits(count);
+	std::unique_ptr<bool[]> tree64_results{new bool[count]};
+	begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < count; ++i)
+		tree64_results[i] = tree64_tracer->RayMarchLeaf(origins[i], directions[i], &tree64_hits[i]);
+	double tree64_scalar_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	double tree64_time = 1e30;
+	for (uint32_t i = 0; i < 3; ++i) {
+		begin = std::chrono::steady_clock::now();
+		tree64_tracer->RayMarchLeaf(origins.data(), directions.data(), count, tree64_hits.data(),
+		                            tree64_results.get());
+		tree64_time =
+		    std::min(tree64_time, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+	}
+
+	// as for the compact encoding, the color of a miss depends on the encoding
+	size_t tree64_mismatch_count = 0;
+	for (size_t i = 0; i < count; ++i)
+		if (scalar_results[i] != tree64_results[i] ||
+		    (scalar_results[i] && !hit_equal(scalar_hits[i], tree64_hits[i])))
+			++tree64_mismatch_count;
+	printf("64-tree single-ray %9.3f ms  %7.2f M rays/s\n", tree64_scalar_time * 1000.0,
+	       count / tree64_scalar_time / 1000000.0);
+	printf("64-tree threads    %9.3f ms  %7.2f M rays/s\n", tree64_time * 1000.0, count / tree64_time / 1000000.0);
+
+	if (tree64_mismatch_count) {
+		spdlog::error("{} rays differ between the octree and the 64-tree", tree64_mismatch_count);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
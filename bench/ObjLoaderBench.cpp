@@ -0,0 +1,131 @@
+// Parse-throughput benchmark for ObjLoader, compared against tinyobj with the corner expansion Scene used to do
+// Usage: ObjLoaderBench [file.obj] [iterations]
+// Without a file argument a synthetic 1024x1024 quad grid with texcoords and 4 materials is generated.
+#include "ObjLoader.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <tiny_obj_loader.h>
+#include <vector>
+
+static bool generate_obj(const std::filesystem::path &obj_path, uint32_t grid_size) {
+	std::filesystem::path mtl_path = obj_path;
+	mtl_path.replace_extension(".mtl");
+	FILE *fp = fopen(mtl_path.string().c_str(), "w");
+	if (!fp)
+		return false;
+	for (uint32_t m = 0; m < 4; ++m)
+		fprintf(fp, "newmtl mat%u\nKd %f %f %f\n\n", m, 0.2f * m, 0.5f, 1.0f - 0.2f * m);
+	fclose(fp);
+
+	fp = fopen(obj_path.string().c_str(), "w");
+	if (!fp)
+		return false;
+	std::mt19937 rng{0};
+	std::uniform_real_distribution<float> height{-0.05f, 0.05f};
+	fprintf(fp, "mtllib %s\n", mtl_path.filename().string().c_str());
+	uint32_t row = grid_size + 1;
+	for (uint32_t y = 0; y < row; ++y)
+		for (uint32_t x = 0; x < row; ++x) {
+			fprintf(fp, "v %f %f %f\n", (float)x / grid_size, height(rng), (float)y / grid_size);
+			fprintf(fp, "vt %f %f\n", (float)x / grid_size, (float)y / grid_size);
+		}
+	// quads by material stripes, every other row uses negative indices
+	for (uint32_t y = 0; y < grid_size; ++y) {
+		fprintf(fp, "usemtl mat%u\n", (y * 4) / grid_size);
+		for (uint32_t x = 0; x < grid_size; ++x) {
+			uint32_t i = y * row + x + 1;
+			if (y & 1u) {
+				int32_t base = (int32_t)i - 1 - (int32_t)(row * row);
+				fprintf(fp, "f %d/%d %d/%d %d/%d %d/%d\n", base, base, base + 1, base + 1, base + 1 + (int32_t)row,
+				        base + 1 + (int32_t)row, base + (int32_t)row, base + (int32_t)row);
+			} else
+				fprintf(fp, "f %u/%u %u/%u %u/%u %u/%u\n", i, i, i + 1, i + 1, i + 1 + row, i + 1 + row, i + row,
+				        i + row);
+		}
+	}
+	fclose(fp);
+	return true;
+}
+
+static void run(const char *name, size_t bytes, uint32_t iterations, const std::function<size_t()> &func) {
+	size_t corners = func(); // warm up page cache
+	double best = 1e30;
+	for (uint32_t i = 0; i < iterations; ++i) {
+		auto begin = std::chrono::steady_clock::now();
+		func();
+		double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		best = std::min(best, sec);
+	}
+	printf("%-10s %10zu corners  %9.3f ms  %9.1f MB/s\n", name, corners, best * 1000.0, bytes / best / 1000000.0);
+}
+
+static size_t load_tinyobj(const std::string &filename, const std::string &base_dir) {
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::material_t> materials;
+	std::vector<tinyobj::shape_t> shapes;
+	std::string warnings, errors;
+	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warnings, &errors, filename.c_str(), base_dir.c_str()))
+		return 0;
+	std::vector<std::vector<glm::vec3>> corners(materials.size() + 1);
+	for (const auto &shape : shapes)
+		for (size_t i = 0; i < shape.mesh.indices.size(); ++i) {
+			const tinyobj::index_t &index = shape.mesh.indices[i];
+			corners[shape.mesh.material_ids[i / 3] + 1].emplace_back(attrib.vertices[3 * index.vertex_index + 0],
+			                                                         attrib.vertices[3 * index.vertex_index + 1],
+			                                                         attrib.vertices[3 * index.vertex_index + 2]);
+		}
+	size_t count = 0;
+	for (const auto &material_corners : corners)
+		count += material_corners.size();
+	return count;
+}
+
+int main(int argc, char **argv) {
+	spdlog::set_level(spdlog::level::warn);
+
+	std::filesystem::path path;
+	bool generated = false;
+	if (argc > 1)
+		path = argv[1];
+	else {
+		path = std::filesystem::temp_directory_path() / "svo_bench.obj";
+		if (!generate_obj(path, 1024)) {
+			spdlog::error("Failed to write {}", path.string());
+			return EXIT_FAILURE;
+		}
+		generated = true;
+	}
+	uint32_t iterations = argc > 2 ? (uint32_t)std::max(1, atoi(argv[2])) : 3;
+	std::string filename = path.string(), base_dir = path.parent_path().string() + "/";
+
+	size_t bytes = std::filesystem::file_size(path);
+	printf("%s: %.1f MB, best of %u\n", filename.c_str(), bytes / 1000000.0, iterations);
+
+	auto obj_data = ObjLoader::LoadObj(filename.c_str(), base_dir.c_str());
+	size_t reference_corners = load_tinyobj(filename, base_dir);
+	if (!obj_data || obj_data->vertices.size() != reference_corners) {
+		spdlog::error("Corner count mismatch ({} vs tinyobj {})", obj_data ? obj_data->vertices.size() : 0,
+		              reference_corners);
+		return EXIT_FAILURE;
+	}
+	obj_data = nullptr;
+
+	run("tinyobj", bytes, iterations, [&]() -> size_t { return load_tinyobj(filename, base_dir); });
+	run("ObjLoader", bytes, iterations, [&]() -> size_t {
+		auto data = ObjLoader::LoadObj(filename.c_str(), base_dir.c_str());
+		return data ? data->vertices.size() : 0;
+	});
+
+	if (generated) {
+		std::filesystem::remove(path);
+		std::filesystem::remove(path.replace_extension(".mtl"));
+	}
+	return EXIT_SUCCESS;
+}
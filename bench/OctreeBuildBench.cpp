@@ -0,0 +1,79 @@
+// CPU octree build benchmark
+// Usage: OctreeBuildBench [file.vox] [octree_level] [-cache]
+// Without a file argument ~4M random fragments at level 10 are used. With -cache the result is written to the
+// octree cache, so the viewer picks it up without building on the GPU when loading in the sort-based build mode (which
+// writes the same words on the GPU) without fragment deduplication.
+#include "CpuOctreeBuilder.hpp"
+#include "OctreeBuilder.hpp"
+#include "OctreeCache.hpp"
+#include "VoxDataAdapter.hpp"
+#include "VoxLoader.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+int main(int argc, char **argv) {
+	spdlog::set_level(spdlog::level::warn);
+
+	const char *filename = nullptr;
+	uint32_t level = 10;
+	bool write_cache = false;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-cache") == 0)
+			write_cache = true;
+		else if (!filename)
+			filename = argv[i];
+		else
+			level = std::clamp(atoi(argv[i]), 1, 12);
+	}
+
+	std::vector<uint32_t> fragment_data;
+	if (filename) {
+		auto vox_data = VoxLoader::LoadVox(filename);
+		if (!vox_data) {
+			spdlog::error("Failed to load {}", filename);
+			return EXIT_FAILURE;
+		}
+		fragment_data = VoxDataAdapter::CreateFragmentData(*vox_data, level);
+	} else {
+		std::mt19937 rng{0};
+		uint32_t mask = (1u << level) - 1u;
+		for (uint32_t i = 0; i < 4000000; ++i) {
+			uint32_t x = rng() & mask, y = rng() & mask, z = rng() & mask;
+			fragment_data.push_back(x | (y << 12u) | ((z & 0xffu) << 24u));
+			fragment_data.push_back(((z >> 8u) << 28u) | (rng() & 0xffffffu));
+		}
+	}
+	uint32_t fragment_count = fragment_data.size() / 2;
+
+	std::shared_ptr<CpuOctreeBuilder> builder = CpuOctreeBuilder::Create(ThreadPool::Create(), level);
+	printf("%u fragments, level %u\n", fragment_count, level);
+
+	double best = 1e30;
+	for (uint32_t i = 0; i < 3; ++i) {
+		auto begin = std::chrono::steady_clock::now();
+		builder->Build((const glm::uvec2 *)fragment_data.data(), fragment_count);
+		best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+	}
+	printf("build %9.3f ms  %9.1f M fragments/s  range %.1f MB\n", best * 1000.0, fragment_count / best / 1000000.0,
+	       builder->GetOctreeRange() / 1000000.0);
+
+	// the CPU layout is already in slot order
+	const std::vector<uint32_t> &octree = builder->GetOctree();
+	if (CpuOctreeBuilder::Canonicalize(octree.data(), builder->GetOctreeRange()) != octree) {
+		spdlog::error("Octree is not in canonical slot order");
+		return EXIT_FAILURE;
+	}
+
+	OctreeCacheOptions cache_options{};
+	cache_options.build_mode = (uint32_t)OctreeBuildMode::kSortBased;
+	if (write_cache && filename &&
+	    !OctreeCache::Write(filename, level, cache_options, octree.data(), builder->GetOctreeRange()))
+		return EXIT_FAILURE;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+// Octree DAG benchmark
+// Usage: OctreeDAGBench [file.vox] [octree_level]
+// Without a file argument (or with "-") a heightfield at level 10 is used. Builds the DAG of the octree and reports the
+// compression and the build time. Checks that a 1024x1024 view of the DAG traced with CpuOctreeTracer hits the same
+// voxels as the octree (the DAG leaves carry no color), and that every leaf of the octree finds its color in the
+// attribute stream through the leaf offsets.
+#include "BenchUtil.hpp"
+#include "CpuOctreeBuilder.hpp"
+#include "CpuOctreeTracer.hpp"
+#include "OctreeDAG.hpp"
+#include "VoxDataAdapter.hpp"
+#include "VoxLoader.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+constexpr uint32_t kWidth = 1024, kHeight = 1024;
+
+// walks every leaf of the octree and looks its color up in the DAG along the same slot path
+static size_t check_attributes(const std::vector<uint32_t> &octree, const OctreeDAG &dag) {
+	const std::vector<uint32_t> &nodes = dag.GetNodes(), &offsets = dag.GetLeafOffsets(),
+	                            &attributes = dag.GetAttributes();
+	struct Entry {
+		uint32_t node, dag_node, leaf_base, slot;
+	};
+	size_t mismatch_count = 0;
+	std::vector<Entry> stack = {{0, 0, 0, 0}};
+	while (!stack.empty()) {
+		Entry &e = stack.back();
+		if (e.slot == 8) {
+			stack.pop_back();
+			continue;
+		}
+		uint32_t slot = e.slot++;
+		uint32_t word = octree[e.node + slot], dag_word = nodes[e.dag_node + slot];
+		uint32_t leaf_index = e.leaf_base + offsets[e.dag_node + slot];
+		if ((word & 0xC0000000u) == 0xC0000000u)
+			mismatch_count += dag_word != 0xC0000000u || leaf_index >= attributes.size() ||
+			                  attributes[leaf_index] != (word & 0xffffffu);
+		else if (word & 0x80000000u)
+			stack.push_back({word & 0x3fffffffu, dag_word & 0x3fffffffu, leaf_index, 0});
+	}
+	return mismatch_count;
+}
+
+int main(int argc, char **argv) {
+	spdlog::set_level(spdlog::level::warn);
+
+	const char *filename = argc > 1 && strcmp(argv[1], "-") != 0 ? argv[1] : nullptr;
+	uint32_t level = argc > 2 ? std::clamp(atoi(argv[2]), 1, 12) : 10;
+
+	std::vector<uint32_t> fragment_data;
+	if (filename) {
+		auto vox_data = VoxLoader::LoadVox(filename);
+		if (!vox_data) {
+			spdlog::error("Failed to load {}", filename);
+			return EXIT_FAILURE;
+		}
+		fragment_data = VoxDataAdapter::CreateFragmentData(*vox_data, level);
+	} else
+		fragment_data = rolling_heightfield(level);
+
+	std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create();
+	std::shared_ptr<CpuOctreeBuilder> builder = CpuOctreeBuilder::Create(thread_pool, level);
+	builder->Build((const glm::uvec2 *)fragment_data.data(), fragment_data.size() / 2);
+	const std::vector<uint32_t> &octree = builder->GetOctree();
+	printf("level %u, %zu nodes, range %.1f MB, %u threads\n", level, octree.size() / 8,
+	       builder->GetOctreeRange() / 1000000.0, thread_pool->GetThreadCount());
+
+	std::shared_ptr<OctreeDAG> dag;
+	{
+		double time = 1e30;
+		for (uint32_t i = 0; i < 3; ++i) {
+			auto begin = std::chrono::steady_clock::now();
+			dag = OctreeDAG::Build(thread_pool, octree.data(), builder->GetOctreeRange());
+			time = std::min(time, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+		}
+		if (!dag) {
+			spdlog::error("Failed to build the DAG");
+			return EXIT_FAILURE;
+		}
+		size_t bytes =
+		    dag->GetRange() + (dag->GetLeafOffsets().size() + dag->GetAttributes().size()) * sizeof(uint32_t);
+		printf("DAG      %9zu nodes  %8.1f MB (%5.1f%%)  %9.3f ms\n", dag->GetNodeCount(), bytes / 1000000.0,
+		       100.0 * bytes / builder->GetOctreeRange(), time * 1000.0);
+	}
+
+	// pinhole camera outside the [1, 2]^3 cube looking down at the middle of the terrain
+	const glm::vec3 position{2.8f, 2.4f, 0.3f};
+	const glm::vec3 look = glm::normalize(glm::vec3(1.5f, 1.35f, 1.5f) - position);
+	const glm::vec3 side = glm::normalize(glm::cross(look, glm::vec3(0.0f, 1.0f, 0.0f)));
+	const glm::vec3 up = glm::cross(side, look);
+	std::vector<glm::vec3> origins(kWidth * kHeight, position), directions(kWidth * kHeight);
+	for (uint32_t y = 0; y < kHeight; ++y)
+		for (uint32_t x = 0; x < kWidth; ++x) {
+			glm::vec2 uv = (glm::vec2(x, y) + 0.5f) / glm::vec2(kWidth, kHeight) * 2.0f - 1.0f;
+			directions[y * kWidth + x] = glm::normalize(look + 0.5f * (uv.x * side - uv.y * up));
+		}
+	const size_t count = origins.size();
+
+	std::shared_ptr<CpuOctreeTracer> tracers[2] = {CpuOctreeTracer::Create(thread_pool, octree),
+	                                               CpuOctreeTracer::Create(thread_pool, dag->GetNodes())};
+	std::vector<CpuOctreeTracer::Hit> hits[2] = {std::vector<CpuOctreeTracer::Hit>(count),
+	                                             std::vector<CpuOctreeTracer::Hit>(count)};
+	std::unique_ptr<bool[]> results[2] = {std::unique_ptr<bool[]>{new bool[count]},
+	                                      std::unique_ptr<bool[]>{new bool[count]}};
+	constexpr const char *kTracerNames[] = {"octree", "DAG"};
+	for (uint32_t t = 0; t < 2; ++t) {
+		double time = 1e30;
+		for (uint32_t i = 0; i < 3; ++i) {
+			auto begin = std::chrono::steady_clock::now();
+			tracers[t]->RayMarchLeaf(origins.data(), directions.data(), count, hits[t].data(), results[t].get());
+			time = std::min(time, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+		}
+		printf("%-8s %9.3f ms  %7.2f M rays/s\n", kTracerNames[t], time * 1000.0, count / time / 1000000.0);
+	}
+
+	size_t mismatch_count = 0;
+	for (size_t i = 0; i < count; ++i) {
+		hits[1][i].color = hits[0][i].color; // black leaves in the DAG
+		if (results[0][i] != results[1][i] || (results[0][i] && !hit_equal(hits[0][i], hits[1][i])))
+			++mismatch_count;
+	}
+	if (mismatch_count) {
+		spdlog::error("{} rays differ between the octree and the DAG", mismatch_count);
+		return EXIT_FAILURE;
+	}
+	if ((mismatch_count = check_attributes(octree, *dag))) {
+		spdlog::error("{} leaves of the DAG have wrong attributes", mismatch_count);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+// Octree LOD benchmark
+// Usage: OctreeLODBench [file.vox] [octree_level]
+// Without a file argument (or with "-") a heightfield at level 10 is used. Builds the OctreeLOD colors, then follows
+// camera paths for two diffuse bounces and traces the rays of the second bounce, the ones Octree_RayMarchLOD is meant
+// for, once to the leaves and once per footprint spread with CpuOctreeTracer::RayMarchLOD. Reports the speedup and
+// the bias: the change of the hit rate and the mean color difference of the rays that hit in both. A spread of 0 has
+// to give the leaf hits exactly.
+#include "BenchUtil.hpp"
+#include "CpuOctreeBuilder.hpp"
+#include "CpuOctreeTracer.hpp"
+#include "OctreeLOD.hpp"
+#include "VoxDataAdapter.hpp"
+#include "VoxLoader.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+constexpr uint32_t kWidth = 512, kHeight = 512;
+constexpr float kSpreads[] = {0.0f, 0.01f, 0.03f, 0.1f, 0.3f};
+
+// cosine-weighted direction around normal from two numbers in [0, 1), as Diffuse_Sample of shader/diffuse.glsl
+static glm::vec3 sample_diffuse(const glm::vec3 &normal, float u, float v) {
+	float r = std::sqrt(u), phi = 6.2831853f * v;
+	glm::vec3 tangent = glm::normalize(glm::cross(std::abs(normal.x) > 0.5f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0),
+	                                              normal));
+	glm::vec3 bitangent = glm::cross(normal, tangent);
+	return glm::normalize(r * std::cos(phi) * tangent + r * std::sin(phi) * bitangent +
+	                      std::sqrt(std::max(0.0f, 1.0f - u)) * normal);
+}
+static float hash_float(uint32_t x) {
+	x ^= x >> 16u, x *= 0x7feb352du, x ^= x >> 15u, x *= 0x846ca68bu, x ^= x >> 16u;
+	return (float)(x >> 8u) / 16777216.0f;
+}
+
+int main(int argc, char **argv) {
+	spdlog::set_level(spdlog::level::warn);
+
+	const char *filename = argc > 1 && strcmp(argv[1], "-") != 0 ? argv[1] : nullptr;
+	uint32_t level = argc > 2 ? std::clamp(atoi(argv[2]), 1, 12) : 10;
+
+	std::vector<uint32_t> fragment_data;
+	if (filename) {
+		auto vox_data = VoxLoader::LoadVox(filename);
+		if (!vox_data) {
+			spdlog::error("Failed to load {}", filename);
+			return EXIT_FAILURE;
+		}
+		fragment_data = VoxDataAdapter::CreateFragmentData(*vox_data, level);
+	} else
+		fragment_data = rolling_heightfield(level, true);
+
+	std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create();
+	std::shared_ptr<CpuOctreeBuilder> builder = CpuOctreeBuilder::Create(thread_pool, level);
+	builder->Build((const glm::uvec2 *)fragment_data.data(), fragment_data.size() / 2);
+
+	auto begin = std::chrono::steady_clock::now();
+	std::vector<uint32_t> lod = OctreeLOD::Build(thread_pool, builder->GetOctree().data(), builder->GetOctreeRange());
+	double lod_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	if (lod.empty()) {
+		spdlog::error("Failed to build the octree LOD");
+		return EXIT_FAILURE;
+	}
+	printf("level %u, range %.1f MB, LOD %.1f MB built in %.3f ms, %u threads\n", level,
+	       builder->GetOctreeRange() / 1000000.0, lod.size() * sizeof(uint32_t) / 1000000.0, lod_time * 1000.0,
+	       thread_pool->GetThreadCount());
+
+	std::shared_ptr<CpuOctreeTracer> tracer = CpuOctreeTracer::Create(thread_pool, builder->GetOctree());
+
+	// camera rays, then two diffuse bounces, keeping the rays of the second
+	const glm::vec3 position{1.5f + 1.4f, 2.4f, 1.5f};
+	const glm::vec3 look = glm::normalize(glm::vec3(1.5f, 1.35f, 1.5f) - position);
+	const glm::vec3 side = glm::normalize(glm::cross(look, glm::vec3(0.0f, 1.0f, 0.0f)));
+	const glm::vec3 up = glm::cross(side, look);
+	std::vector<glm::vec3> origins, directions;
+	for (uint32_t i = 0; i < kWidth * kHeight; ++i) {
+		glm::vec2 uv = (glm::vec2(i % kWidth, i / kWidth) + 0.5f) / glm::vec2(kWidth, kHeight) * 2.0f - 1.0f;
+		glm::vec3 o = position, d = glm::normalize(look + 0.5f * (uv.x * side - uv.y * up));
+		CpuOctreeTracer::Hit hit{};
+		uint32_t bounce = 0;
+		for (; bounce < 2 && tracer->RayMarchLeaf(o, d, &hit); ++bounce) {
+			o = hit.position;
+			d = sample_diffuse(hit.normal, hash_float(i * 4u + bounce * 2u), hash_float(i * 4u + bounce * 2u + 1u));
+		}
+		if (bounce == 2)
+			origins.push_back(o), directions.push_back(d);
+	}
+	const size_t count = origins.size();
+
+	std::vector<CpuOctreeTracer::Hit> leaf_hits(count), lod_hits(count);
+	std::unique_ptr<bool[]> leaf_results{new bool[count]}, lod_results{new bool[count]};
+	uint64_t leaf_iterations = 0;
+	begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < count; ++i)
+		leaf_results[i] = tracer->RayMarchLeaf(origins[i], directions[i], &leaf_hits[i]);
+	double leaf_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	size_t leaf_hit_count = 0;
+	for (size_t i = 0; i < count; ++i)
+		leaf_iterations += leaf_hits[i].iteration, leaf_hit_count += leaf_results[i];
+	printf("%zu second-bounce rays, %.1f%% hit\n", count, 100.0 * leaf_hit_count / std::max<size_t>(count, 1));
+	printf("leaves        %9.3f ms  %7.2f M rays/s  %5.1f iterations/ray\n", leaf_time * 1000.0,
+	       count / leaf_time / 1000000.0, (double)leaf_iterations / std::max<size_t>(count, 1));
+
+	for (float spread : kSpreads) {
+		uint64_t lod_iterations = 0;
+		begin = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < count; ++i)
+			lod_results[i] = tracer->RayMarchLOD(origins[i], directions[i], 0.0f, spread, lod.data(), &lod_hits[i]);
+		double lod_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+		size_t lod_hit_count = 0, both_count = 0, mismatch_count = 0;
+		double color_error = 0.0;
+		for (size_t i = 0; i < count; ++i) {
+			lod_iterations += lod_hits[i].iteration, lod_hit_count += lod_results[i];
+			if (leaf_results[i] && lod_results[i]) {
+				++both_count;
+				glm::vec3 diff = glm::abs(leaf_hits[i].color - lod_hits[i].color);
+				color_error += (diff.x + diff.y + diff.z) / 3.0f;
+			}
+			if (leaf_results[i] != lod_results[i] ||
+			    (leaf_results[i] && memcmp(&leaf_hits[i], &lod_hits[i], sizeof(CpuOctreeTracer::Hit)) != 0))
+				++mismatch_count;
+		}
+		printf("spread %5.3f  %9.3f ms  %7.2f M rays/s  %5.1f iterations/ray  hit rate %+.2f%%  color error %.4f\n",
+		       spread, lod_time * 1000.0, count / lod_time / 1000000.0,
+		       (double)lod_iterations / std::max<size_t>(count, 1),
+		       100.0 * ((double)lod_hit_count - (double)leaf_hit_count) / std::max<size_t>(count, 1),
+		       color_error / std::max<size_t>(both_count, 1));
+		if (spread == 0.0f && mismatch_count) {
+			spdlog::error("{} rays differ between the leaves and the LOD traversal without a footprint",
+			              mismatch_count);
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+// Octree node reorder benchmark
+// Usage: OctreeReorderBench [file.vox] [octree_level]
+// Without a file argument (or with "-") a heightfield at level 10 is used. Lays the octree out in every
+// OctreeNodeOrder, traces the same camera path (kFrames 512x512 views orbiting the terrain) through each layout with
+// the single-ray tracer and with the batch API, and checks that all layouts give the same hits.
+#include "BenchUtil.hpp"
+#include "CpuOctreeBuilder.hpp"
+#include "CpuOctreeTracer.hpp"
+#include "OctreeReorder.hpp"
+#include "VoxDataAdapter.hpp"
+#include "VoxLoader.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+constexpr uint32_t kWidth = 512, kHeight = 512, kFrames = 8;
+
+int main(int argc, char **argv) {
+	spdlog::set_level(spdlog::level::warn);
+
+	const char *filename = argc > 1 && strcmp(argv[1], "-") != 0 ? argv[1] : nullptr;
+	uint32_t level = argc > 2 ? std::clamp(atoi(argv[2]), 1, 12) : 10;
+
+	std::vector<uint32_t> fragment_data;
+	if (filename) {
+		auto vox_data = VoxLoader::LoadVox(filename);
+		if (!vox_data) {
+			spdlog::error("Failed to load {}", filename);
+			return EXIT_FAILURE;
+		}
+		fragment_data = VoxDataAdapter::CreateFragmentData(*vox_data, level);
+	} else
+		fragment_data = rolling_heightfield(level);
+
+	std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create();
+	std::shared_ptr<CpuOctreeBuilder> builder = CpuOctreeBuilder::Create(thread_pool, level);
+	builder->Build((const glm::uvec2 *)fragment_data.data(), fragment_data.size() / 2);
+
+	// pinhole cameras on a circle outside the [1, 2]^3 cube, all looking down at the middle of the terrain
+	std::vector<glm::vec3> origins(kWidth * kHeight * kFrames), directions(kWidth * kHeight * kFrames);
+	for (uint32_t f = 0; f < kFrames; ++f) {
+		float angle = 6.2831853f * (float)f / (float)kFrames;
+		const glm::vec3 position{1.5f + 1.4f * std::cos(angle), 2.4f, 1.5f + 1.4f * std::sin(angle)};
+		const glm::vec3 look = glm::normalize(glm::vec3(1.5f, 1.35f, 1.5f) - position);
+		const glm::vec3 side = glm::normalize(glm::cross(look, glm::vec3(0.0f, 1.0f, 0.0f)));
+		const glm::vec3 up = glm::cross(side, look);
+		for (uint32_t y = 0; y < kHeight; ++y)
+			for (uint32_t x = 0; x < kWidth; ++x) {
+				glm::vec2 uv = (glm::vec2(x, y) + 0.5f) / glm::vec2(kWidth, kHeight) * 2.0f - 1.0f;
+				size_t i = (f * kHeight + y) * kWidth + x;
+				origins[i] = position;
+				directions[i] = glm::normalize(look + 0.5f * (uv.x * side - uv.y * up));
+			}
+	}
+	const size_t count = origins.size();
+	printf("%zu rays (%u frames), level %u, range %.1f MB, %u threads\n", count, kFrames, level,
+	       builder->GetOctreeRange() / 1000000.0, thread_pool->GetThreadCount());
+
+	constexpr uint32_t kOrderCount = std::size(kOctreeNodeOrderNames);
+	std::vector<CpuOctreeTracer::Hit> hits[kOrderCount];
+	std::unique_ptr<bool[]> results[kOrderCount];
+	for (uint32_t o = 0; o < kOrderCount; ++o) {
+		auto begin = std::chrono::steady_clock::now();
+		std::vector<uint32_t> octree = OctreeReorder::Reorder(thread_pool, builder->GetOctree().data(),
+		                                                      builder->GetOctreeRange(), (OctreeNodeOrder)o);
+		double reorder_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		if (octree.empty()) {
+			spdlog::error("Failed to reorder the octree ({})", kOctreeNodeOrderNames[o]);
+			return EXIT_FAILURE;
+		}
+		std::shared_ptr<CpuOctreeTracer> tracer = CpuOctreeTracer::Create(thread_pool, std::move(octree));
+
+		hits[o].resize(count);
+		results[o].reset(new bool[count]);
+		begin = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < count; ++i)
+			results[o][i] = tracer->RayMarchLeaf(origins[i], directions[i], &hits[o][i]);
+		double scalar_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+		double batch_time = 1e30;
+		for (uint32_t i = 0; i < 3; ++i) {
+			begin = std::chrono::steady_clock::now();
+			tracer->RayMarchLeaf(origins.data(), directions.data(), count, hits[o].data(), results[o].get());
+			batch_time =
+			    std::min(batch_time, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+		}
+		printf("%-22s reorder %8.3f ms  single-ray %7.2f M rays/s  threads %7.2f M rays/s\n",
+		       kOctreeNodeOrderNames[o], reorder_time * 1000.0, count / scalar_time / 1000000.0,
+		       count / batch_time / 1000000.0);
+	}
+
+	for (uint32_t o = 1; o < kOrderCount; ++o) {
+		size_t mismatch_count = 0;
+		// the color of a miss is taken from whatever word the traversal read last, which moves with the nodes
+		for (size_t i = 0; i < count; ++i)
+			if (results[0][i] != results[o][i] || (results[0][i] && !hit_equal(hits[0][i], hits[o][i])))
+				++mismatch_count;
+		if (mismatch_count) {
+			spdlog::error("{} rays differ between the build order and {}", mismatch_count, kOctreeNodeOrderNames[o]);
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
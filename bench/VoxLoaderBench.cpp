@@ -0,0 +1,162 @@
+// Parse-throughput benchmark for VoxLoader
+// Usage: VoxLoaderBench [file.vox] [iterations]
+// Without a file argument a synthetic scene of 8 256^3 models with 1M voxels each is generated.
+#include "VoxLoader.hpp"
+#include "MappedFile.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <string>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+static void write_u32(std::vector<uint8_t> *out, uint32_t v) {
+	const uint8_t *p = (const uint8_t *)&v;
+	out->insert(out->end(), p, p + 4);
+}
+
+static void write_chunk_header(std::vector<uint8_t> *out, const char *id, uint32_t content_size, uint32_t child_size) {
+	out->insert(out->end(), id, id + 4);
+	write_u32(out, content_size);
+	write_u32(out, child_size);
+}
+
+static void write_string(std::vector<uint8_t> *out, const std::string &str) {
+	write_u32(out, str.size());
+	out->insert(out->end(), str.begin(), str.end());
+}
+
+static void write_chunk(std::vector<uint8_t> *out, const char *id, const std::vector<uint8_t> &content) {
+	write_chunk_header(out, id, content.size(), 0);
+	out->insert(out->end(), content.begin(), content.end());
+}
+
+// model_count 256^3 models laid out on a 4-wide grid through nTRN/nGRP/nSHP nodes, every other one rotated
+static bool generate_vox(const char *filename, uint32_t model_count, uint32_t voxels_per_model) {
+	std::vector<uint8_t> body, content;
+	std::mt19937 rng{0};
+	for (uint32_t m = 0; m < model_count; ++m) {
+		write_chunk_header(&body, "SIZE", 12, 0);
+		write_u32(&body, 256);
+		write_u32(&body, 256);
+		write_u32(&body, 256);
+
+		write_chunk_header(&body, "XYZI", 4 + voxels_per_model * 4, 0);
+		write_u32(&body, voxels_per_model);
+		for (uint32_t i = 0; i < voxels_per_model; ++i)
+			write_u32(&body, rng() | 0x01000000u); // color index never 0
+	}
+
+	// root transform (0) -> group (1) -> transform (2 + 2m) -> shape (3 + 2m)
+	content.clear();
+	write_u32(&content, 0), write_u32(&content, 0);
+	write_u32(&content, 1), write_u32(&content, -1), write_u32(&content, 0), write_u32(&content, 1);
+	write_u32(&content, 0);
+	write_chunk(&body, "nTRN", content);
+
+	content.clear();
+	write_u32(&content, 1), write_u32(&content, 0), write_u32(&content, model_count);
+	for (uint32_t m = 0; m < model_count; ++m)
+		write_u32(&content, 2 + 2 * m);
+	write_chunk(&body, "nGRP", content);
+
+	for (uint32_t m = 0; m < model_count; ++m) {
+		content.clear();
+		write_u32(&content, 2 + 2 * m), write_u32(&content, 0);
+		write_u32(&content, 3 + 2 * m), write_u32(&content, -1), write_u32(&content, 0), write_u32(&content, 1);
+		bool rotated = m & 1u;
+		write_u32(&content, rotated ? 2 : 1);
+		write_string(&content, "_t");
+		write_string(&content, std::to_string((int)(m % 4) * 256 - 384) + " " + std::to_string((int)(m / 4) * 256) +
+		                           " 128");
+		if (rotated) {
+			write_string(&content, "_r");
+			write_string(&content, "17"); // 0b0010001: x' = -y, y' = x, z' = z
+		}
+		write_chunk(&body, "nTRN", content);
+
+		content.clear();
+		write_u32(&content, 3 + 2 * m), write_u32(&content, 0), write_u32(&content, 1);
+		write_u32(&content, m), write_u32(&content, 0);
+		write_chunk(&body, "nSHP", content);
+	}
+
+	write_chunk_header(&body, "RGBA", 1024, 0);
+	for (uint32_t i = 0; i < 256; ++i)
+		write_u32(&body, rng() | 0xff000000u);
+
+	std::vector<uint8_t> file;
+	file.insert(file.end(), {'V', 'O', 'X', ' '});
+	write_u32(&file, 150);
+	write_chunk_header(&file, "MAIN", 0, body.size());
+	file.insert(file.end(), body.begin(), body.end());
+
+	FILE *fp = fopen(filename, "wb");
+	if (!fp)
+		return false;
+	bool ok = fwrite(file.data(), 1, file.size(), fp) == file.size();
+	fclose(fp);
+	return ok;
+}
+
+static void run(const char *name, size_t bytes, uint32_t iterations, const std::function<size_t()> &func) {
+	size_t voxels = func(); // warm up page cache
+	double best = 1e30;
+	for (uint32_t i = 0; i < iterations; ++i) {
+		auto begin = std::chrono::steady_clock::now();
+		func();
+		double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		best = std::min(best, sec);
+	}
+	printf("%-10s %10zu voxels  %9.3f ms  %9.1f MB/s\n", name, voxels, best * 1000.0, bytes / best / 1000000.0);
+}
+
+int main(int argc, char **argv) {
+	spdlog::set_level(spdlog::level::warn);
+
+	std::string filename;
+	bool generated = false;
+	if (argc > 1)
+		filename = argv[1];
+	else {
+		filename = (std::filesystem::temp_directory_path() / "svo_bench.vox").string();
+		if (!generate_vox(filename.c_str(), 8, 1000000)) {
+			spdlog::error("Failed to write {}", filename);
+			return EXIT_FAILURE;
+		}
+		generated = true;
+	}
+	uint32_t iterations = argc > 2 ? (uint32_t)std::max(1, atoi(argv[2])) : 5;
+
+	size_t bytes = std::filesystem::file_size(filename);
+	printf("%s: %.1f MB, best of %u\n", filename.c_str(), bytes / 1000000.0, iterations);
+	if (auto data = VoxLoader::LoadVox(filename.c_str())) {
+		printf("%zu models, %u instances, world size %dx%dx%d\n", data->models.size(), data->instance_count,
+		       data->dimensions.x, data->dimensions.y, data->dimensions.z);
+	}
+
+	run("stream", bytes, iterations, [&]() -> size_t {
+		auto data = VoxLoader::LoadVox(filename.c_str(), VoxLoader::LoadMode::kStream);
+		return data ? data->GetVoxelCount() : 0;
+	});
+	run("mapped", bytes, iterations, [&]() -> size_t {
+		auto data = VoxLoader::LoadVox(filename.c_str(), VoxLoader::LoadMode::kMapped);
+		return data ? data->GetVoxelCount() : 0;
+	});
+	auto mapped_file = MappedFile::Create(filename.c_str());
+	if (mapped_file) {
+		run("memory", bytes, iterations, [&]() -> size_t {
+			auto data = VoxLoader::LoadVoxFromMemory(mapped_file->GetData(), mapped_file->GetSize());
+			return data ? data->GetVoxelCount() : 0;
+		});
+	}
+	mapped_file = nullptr;
+
+	if (generated)
+		std::filesystem::remove(filename);
+	return EXIT_SUCCESS;
+}
@@ -12,6 +12,7 @@
 #include "QueryPool.hpp"
 #include "RenderPass.hpp"
 #include "Semaphore.hpp"
+#include "TimelineSemaphore.hpp"
 
 #include "volk.h"
 #include <map>
@@ -36,6 +37,8 @@ public:
 	                const SemaphoreGroup &signal_semaphores = SemaphoreGroup(),
 	                const Ptr<Fence> &fence = nullptr) const;
 	VkResult Submit(const Ptr<Fence> &fence = nullptr) const;
+	// signals signal_value on the timeline semaphore when the command buffer completes
+	VkResult Submit(const Ptr<TimelineSemaphore> &signal_semaphore, uint64_t signal_value) const;
 
 	VkResult Reset(VkCommandBufferResetFlags flags = 0) const;
 
@@ -149,6 +152,10 @@ public:
 
 	void CmdDispatch(uint32_t group_x, uint32_t group_y, uint32_t group_z) const;
 
+	// the pipeline needs VK_PIPELINE_CREATE_DISPATCH_BASE_BIT
+	void CmdDispatchBase(uint32_t base_x, uint32_t base_y, uint32_t base_z, uint32_t group_x, uint32_t group_y,
+	                     uint32_t group_z) const;
+
 	void CmdDispatchIndirect(const Ptr<BufferBase> &buffer, VkDeviceSize offset = 0) const;
 
 	void CmdResetQueryPool(const Ptr<QueryPool> &query_pool, uint32_t first_query, uint32_t query_count) const;
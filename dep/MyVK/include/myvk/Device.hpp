@@ -8,6 +8,7 @@
 #include "vk_mem_alloc.h"
 #include "volk.h"
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace myvk {
@@ -18,6 +19,8 @@ private:
 	PhysicalDeviceFeatures m_features;
 	VkDevice m_device{VK_NULL_HANDLE};
 	VkPipelineCache m_pipeline_cache{VK_NULL_HANDLE};
+	std::string m_pipeline_cache_filename;
+	bool m_pipeline_cache_loaded{false};
 	VmaAllocator m_allocator{VK_NULL_HANDLE};
 
 	VkResult create_allocator();
@@ -26,13 +29,19 @@ private:
 	                       const std::vector<const char *> &extensions, const PhysicalDeviceFeatures &features);
 
 	VkResult create_pipeline_cache();
+	std::vector<uint8_t> load_pipeline_cache_data() const;
 
 public:
+	// With a pipeline_cache_filename, the pipeline cache starts from the data saved by an earlier run on the same
+	// device and driver (checked by their UUIDs) and is saved back on destruction.
 	static Ptr<Device> Create(const Ptr<PhysicalDevice> &physical_device, const QueueSelectorFunc &queue_selector_func,
-	                          const PhysicalDeviceFeatures &features, const std::vector<const char *> &extensions);
+	                          const PhysicalDeviceFeatures &features, const std::vector<const char *> &extensions,
+	                          const std::string &pipeline_cache_filename = {});
 
 	inline VmaAllocator GetAllocatorHandle() const { return m_allocator; }
 	inline VkPipelineCache GetPipelineCacheHandle() const { return m_pipeline_cache; }
+	inline bool IsPipelineCacheLoaded() const { return m_pipeline_cache_loaded; }
+	bool SavePipelineCache() const;
 	inline const Ptr<PhysicalDevice> &GetPhysicalDevicePtr() const { return m_physical_device_ptr; }
 	inline VkDevice GetHandle() const { return m_device; }
 	inline const PhysicalDeviceFeatures &GetEnabledFeatures() const { return m_features; }
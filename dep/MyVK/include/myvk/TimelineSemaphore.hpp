@@ -0,0 +1,33 @@
+#ifndef MYVK_TIMELINE_SEMAPHORE_HPP
+#define MYVK_TIMELINE_SEMAPHORE_HPP
+
+#include "DeviceObjectBase.hpp"
+#include "volk.h"
+#include <cstdint>
+#include <memory>
+
+namespace myvk {
+// needs the timelineSemaphore feature of Vulkan 1.2
+class TimelineSemaphore : public DeviceObjectBase {
+private:
+	Ptr<Device> m_device_ptr;
+	VkSemaphore m_semaphore{VK_NULL_HANDLE};
+
+public:
+	static Ptr<TimelineSemaphore> Create(const Ptr<Device> &device, uint64_t initial_value = 0);
+
+	VkSemaphore GetHandle() const { return m_semaphore; }
+
+	const Ptr<Device> &GetDevicePtr() const override { return m_device_ptr; }
+
+	uint64_t GetValue() const;
+
+	VkResult Wait(uint64_t value, uint64_t timeout = UINT64_MAX) const;
+
+	VkResult Signal(uint64_t value) const;
+
+	~TimelineSemaphore() override;
+};
+} // namespace myvk
+
+#endif
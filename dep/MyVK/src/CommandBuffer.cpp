@@ -85,6 +85,28 @@ VkResult CommandBuffer::Submit(const Ptr<Fence> &fence) const {
 	                     fence ? fence->GetHandle() : VK_NULL_HANDLE);
 }
 
+VkResult CommandBuffer::Submit(const Ptr<TimelineSemaphore> &signal_semaphore, uint64_t signal_value) const {
+	VkSemaphore semaphore = signal_semaphore->GetHandle();
+
+	VkTimelineSemaphoreSubmitInfo timeline_info = {};
+	timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timeline_info.signalSemaphoreValueCount = 1;
+	timeline_info.pSignalSemaphoreValues = &signal_value;
+
+	VkSubmitInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	info.pNext = &timeline_info;
+
+	info.commandBufferCount = 1;
+	info.pCommandBuffers = &m_command_buffer;
+
+	info.signalSemaphoreCount = 1;
+	info.pSignalSemaphores = &semaphore;
+
+	std::lock_guard<std::mutex> lock_guard{m_command_pool_ptr->GetQueuePtr()->GetMutex()};
+	return vkQueueSubmit(m_command_pool_ptr->GetQueuePtr()->GetHandle(), 1, &info, VK_NULL_HANDLE);
+}
+
 VkResult CommandBuffer::Begin(VkCommandBufferUsageFlags usage) const {
 	VkCommandBufferBeginInfo begin_info = {};
 	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -407,6 +429,11 @@ void CommandBuffer::CmdDispatch(uint32_t group_x, uint32_t group_y, uint32_t gro
 	vkCmdDispatch(m_command_buffer, group_x, group_y, group_z);
 }
 
+void CommandBuffer::CmdDispatchBase(uint32_t base_x, uint32_t base_y, uint32_t base_z, uint32_t group_x,
+                                    uint32_t group_y, uint32_t group_z) const {
+	vkCmdDispatchBase(m_command_buffer, base_x, base_y, base_z, group_x, group_y, group_z);
+}
+
 void CommandBuffer::CmdDispatchIndirect(const Ptr<BufferBase> &buffer, VkDeviceSize offset) const {
 	vkCmdDispatchIndirect(m_command_buffer, buffer->GetHandle(), offset);
 }
@@ -1,5 +1,8 @@
 #include "myvk/Device.hpp"
 #include "myvk/Queue.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <set>
 
 namespace myvk {
@@ -18,8 +21,11 @@ public:
 };
 
 Device::~Device() {
-	if (m_pipeline_cache)
+	if (m_pipeline_cache) {
+		if (!m_pipeline_cache_filename.empty())
+			SavePipelineCache();
 		vkDestroyPipelineCache(m_device, m_pipeline_cache, nullptr);
+	}
 	if (m_allocator)
 		vmaDestroyAllocator(m_allocator);
 	if (m_device)
@@ -27,9 +33,11 @@ Device::~Device() {
 }
 
 Ptr<Device> Device::Create(const Ptr<PhysicalDevice> &physical_device, const QueueSelectorFunc& queue_selector_func,
-                           const PhysicalDeviceFeatures &features, const std::vector<const char *> &extensions) {
+                           const PhysicalDeviceFeatures &features, const std::vector<const char *> &extensions,
+                           const std::string &pipeline_cache_filename) {
 	auto ret = std::make_shared<Device>();
 	ret->m_physical_device_ptr = physical_device;
+	ret->m_pipeline_cache_filename = pipeline_cache_filename;
 
 	std::vector<QueueSelection> queue_selections = queue_selector_func(physical_device);
 	if (queue_selections.empty())
@@ -121,11 +129,87 @@ VkResult Device::create_allocator() {
 	return vmaCreateAllocator(&create_info, &m_allocator);
 }
 
+// header of the pipeline cache files, followed by the data of vkGetPipelineCacheData
+struct PipelineCacheFileHeader {
+	char magic[4];
+	uint32_t data_size;
+	uint8_t device_uuid[VK_UUID_SIZE], driver_uuid[VK_UUID_SIZE];
+};
+static constexpr char kPipelineCacheMagic[4] = {'M', 'V', 'P', 'C'};
+
 VkResult Device::create_pipeline_cache() {
+	std::vector<uint8_t> initial_data;
+	if (!m_pipeline_cache_filename.empty())
+		initial_data = load_pipeline_cache_data();
+
 	VkPipelineCacheCreateInfo create_info = {};
 	create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	create_info.initialDataSize = initial_data.size();
+	create_info.pInitialData = initial_data.empty() ? nullptr : initial_data.data();
+
+	VkResult result = vkCreatePipelineCache(m_device, &create_info, nullptr, &m_pipeline_cache);
+	if (result != VK_SUCCESS && !initial_data.empty()) {
+		// rejected by the driver, start empty
+		create_info.initialDataSize = 0;
+		create_info.pInitialData = nullptr;
+		result = vkCreatePipelineCache(m_device, &create_info, nullptr, &m_pipeline_cache);
+	} else
+		m_pipeline_cache_loaded = !initial_data.empty();
+	return result;
+}
+
+std::vector<uint8_t> Device::load_pipeline_cache_data() const {
+	std::ifstream fin{m_pipeline_cache_filename, std::ios::binary};
+	PipelineCacheFileHeader header{};
+	if (!fin.read((char *)&header, sizeof(header)) || memcmp(header.magic, kPipelineCacheMagic, 4) != 0)
+		return {};
+
+	// data of another device or driver version is useless at best
+	const PhysicalDeviceProperties &properties = m_physical_device_ptr->GetProperties();
+	if (memcmp(header.device_uuid, properties.vk11.deviceUUID, VK_UUID_SIZE) != 0 ||
+	    memcmp(header.driver_uuid, properties.vk11.driverUUID, VK_UUID_SIZE) != 0)
+		return {};
 
-	return vkCreatePipelineCache(m_device, &create_info, nullptr, &m_pipeline_cache);
+	std::vector<uint8_t> data(header.data_size);
+	if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne) || !fin.read((char *)data.data(), data.size()))
+		return {};
+
+	// the header of the cache data itself, see the Vulkan specification of vkGetPipelineCacheData
+	VkPipelineCacheHeaderVersionOne cache_header;
+	memcpy(&cache_header, data.data(), sizeof(cache_header));
+	if (cache_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+	    cache_header.vendorID != properties.vk10.vendorID || cache_header.deviceID != properties.vk10.deviceID ||
+	    memcmp(cache_header.pipelineCacheUUID, properties.vk10.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		return {};
+	return data;
+}
+
+bool Device::SavePipelineCache() const {
+	if (m_pipeline_cache_filename.empty())
+		return false;
+
+	size_t data_size;
+	if (vkGetPipelineCacheData(m_device, m_pipeline_cache, &data_size, nullptr) != VK_SUCCESS)
+		return false;
+	std::vector<uint8_t> data(data_size);
+	if (vkGetPipelineCacheData(m_device, m_pipeline_cache, &data_size, data.data()) != VK_SUCCESS)
+		return false;
+
+	const PhysicalDeviceProperties &properties = m_physical_device_ptr->GetProperties();
+	PipelineCacheFileHeader header{};
+	memcpy(header.magic, kPipelineCacheMagic, 4);
+	header.data_size = (uint32_t)data_size;
+	memcpy(header.device_uuid, properties.vk11.deviceUUID, VK_UUID_SIZE);
+	memcpy(header.driver_uuid, properties.vk11.driverUUID, VK_UUID_SIZE);
+
+	// write to a temporary file first, so an interrupted save does not leave a truncated cache
+	std::string tmp_filename = m_pipeline_cache_filename + ".tmp";
+	{
+		std::ofstream fout{tmp_filename, std::ios::binary};
+		if (!fout.write((const char *)&header, sizeof(header)) || !fout.write((const char *)data.data(), data_size))
+			return false;
+	}
+	return std::rename(tmp_filename.c_str(), m_pipeline_cache_filename.c_str()) == 0;
 }
 
 VkResult Device::WaitIdle() const { return vkDeviceWaitIdle(m_device); }
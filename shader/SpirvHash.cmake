@@ -0,0 +1,55 @@
+# include/spirv/<SHADER>.u32.sha256 holds the hash of the sources the committed include/spirv/<SHADER>.u32 was compiled
+# from: the SHA256 of the shader and of the headers it includes (recursively, each once, in the order of the first
+# #include). Without glslc, shader/CMakeLists.txt compares it with the current sources to find stale SPIR-V.
+#
+# Script mode writes the hash file after glslc: cmake -DSHADER=<shader> [-DSHADER_DIR=<dir>] -P SpirvHash.cmake
+if (CMAKE_SCRIPT_MODE_FILE)
+	cmake_minimum_required(VERSION 3.15)
+endif ()
+
+function(spirv_source_hash SHADER_DIR SHADER OUT_VAR)
+	set(QUEUE ${SHADER})
+	set(VISITED)
+	set(CONTENT)
+	while (QUEUE)
+		list(POP_FRONT QUEUE FILE)
+		if (FILE IN_LIST VISITED)
+			continue()
+		endif ()
+		list(APPEND VISITED ${FILE})
+		file(READ ${SHADER_DIR}/${FILE} FILE_CONTENT)
+		string(APPEND CONTENT "${FILE}\n${FILE_CONTENT}")
+		file(STRINGS ${SHADER_DIR}/${FILE} INCLUDE_LINES REGEX "^[ \t]*#[ \t]*include[ \t]+\"")
+		foreach (LINE IN LISTS INCLUDE_LINES)
+			string(REGEX REPLACE "^[ \t]*#[ \t]*include[ \t]+\"([^\"]+)\".*$" "\\1" INCLUDE ${LINE})
+			list(APPEND QUEUE ${INCLUDE})
+		endforeach ()
+	endwhile ()
+	string(SHA256 HASH "${CONTENT}")
+	set(${OUT_VAR} ${HASH} PARENT_SCOPE)
+endfunction()
+
+# TRUE if include/spirv/<SHADER>.u32 exists and was compiled from the current sources
+function(spirv_is_fresh SHADER_DIR SHADER OUT_VAR)
+	set(SPIRV ${SHADER_DIR}/include/spirv/${SHADER}.u32)
+	if (NOT EXISTS ${SPIRV} OR NOT EXISTS ${SPIRV}.sha256)
+		set(${OUT_VAR} FALSE PARENT_SCOPE)
+		return()
+	endif ()
+	file(READ ${SPIRV}.sha256 COMMITTED_HASH)
+	string(STRIP "${COMMITTED_HASH}" COMMITTED_HASH)
+	spirv_source_hash(${SHADER_DIR} ${SHADER} HASH)
+	if (HASH STREQUAL COMMITTED_HASH)
+		set(${OUT_VAR} TRUE PARENT_SCOPE)
+	else ()
+		set(${OUT_VAR} FALSE PARENT_SCOPE)
+	endif ()
+endfunction()
+
+if (CMAKE_SCRIPT_MODE_FILE AND DEFINED SHADER)
+	if (NOT DEFINED SHADER_DIR)
+		get_filename_component(SHADER_DIR ${CMAKE_SCRIPT_MODE_FILE} DIRECTORY)
+	endif ()
+	spirv_source_hash(${SHADER_DIR} ${SHADER} HASH)
+	file(WRITE ${SHADER_DIR}/include/spirv/${SHADER}.u32.sha256 "${HASH}\n")
+endif ()
@@ -0,0 +1,25 @@
+#ifndef ADAPTIVE_GLSL
+#define ADAPTIVE_GLSL
+
+// Per-pixel sample statistics of the adaptive sampling, stored in the statistics image of PathTracer:
+// x: sample count, y: mean luminance, z: mean squared luminance
+
+float Adaptive_Luminance(in const vec3 color) { return dot(color, vec3(0.2126, 0.7152, 0.0722)); }
+
+vec4 Adaptive_Update(in const vec4 stats, in const vec3 value) {
+	float n = stats.x + 1.0, l = Adaptive_Luminance(value);
+	return vec4(n, stats.y + (l - stats.y) / n, stats.z + (l * l - stats.z) / n, 0);
+}
+
+// estimated standard error of the mean luminance, relative to the mean
+float Adaptive_Error(in const vec4 stats) {
+	float mean_variance = max(stats.z - stats.y * stats.y, 0.0) / max(stats.x - 1.0, 1.0);
+	return sqrt(mean_variance) / (stats.y + 1e-3);
+}
+
+// a threshold of 0 disables adaptive sampling
+bool Adaptive_Converged(in const vec4 stats, in const float threshold, in const uint min_samples) {
+	return threshold > 0.0 && stats.x >= float(min_samples) && Adaptive_Error(stats) < threshold;
+}
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef COMPACT_GLSL
+#define COMPACT_GLSL
+
+// Traversal of a CompactOctree (src/CompactOctree.hpp) bound in place of the octree: uOctree holds its words, a node is
+// a mask word of its non-empty slots followed by the words of these slots. octree.glsl has to be included first. The
+// loop is the one of tree64.glsl (and uses the stack of octree.glsl) with the child fetch of the compact nodes, so the
+// hits are those of the octree. CpuOctreeTracer with compact = true is the CPU port.
+
+#define COMPACT_STACK_SIZE 23u
+#define COMPACT_EPS 3.552713678800501e-15
+
+uint Compact_FetchChild(uint node, uint slot) {
+	uint mask = uOctree[node];
+	return ((mask >> slot) & 1u) != 0u ? uOctree[node + 1u + bitCount(mask & ((1u << slot) - 1u))] : 0u;
+}
+
+// leaf: fill o_pos, o_color, o_normal at the first hit, otherwise stop at any voxel
+bool Compact_RayMarch(vec3 o, vec3 d, bool leaf, out vec3 o_pos, out vec3 o_color, out vec3 o_normal) {
+	d.x = abs(d.x) >= COMPACT_EPS ? d.x : (d.x >= 0 ? COMPACT_EPS : -COMPACT_EPS);
+	d.y = abs(d.y) >= COMPACT_EPS ? d.y : (d.y >= 0 ? COMPACT_EPS : -COMPACT_EPS);
+	d.z = abs(d.z) >= COMPACT_EPS ? d.z : (d.z >= 0 ? COMPACT_EPS : -COMPACT_EPS);
+
+	// Precompute the coefficients of tx(x), ty(y), and tz(z).
+	// The octree is assumed to reside at coordinates [1, 2].
+	vec3 t_coef = 1.0f / -abs(d);
+	vec3 t_bias = t_coef * o;
+
+	uint oct_mask = 0u;
+	if (d.x > 0.0f)
+		oct_mask ^= 1u, t_bias.x = 3.0f * t_coef.x - t_bias.x;
+	if (d.y > 0.0f)
+		oct_mask ^= 2u, t_bias.y = 3.0f * t_coef.y - t_bias.y;
+	if (d.z > 0.0f)
+		oct_mask ^= 4u, t_bias.z = 3.0f * t_coef.z - t_bias.z;
+
+	// Initialize the active span of t-values.
+	float t_min = max(max(2.0f * t_coef.x - t_bias.x, 2.0f * t_coef.y - t_bias.y), 2.0f * t_coef.z - t_bias.z);
+	float t_max = min(min(t_coef.x - t_bias.x, t_coef.y - t_bias.y), t_coef.z - t_bias.z);
+	t_min = max(t_min, 0.0f);
+	float h = t_max;
+
+	uint parent = 0u;
+	uint cur = 0u;
+	vec3 pos = vec3(1.0f);
+	uint idx = 0u;
+	if (1.5f * t_coef.x - t_bias.x > t_min)
+		idx ^= 1u, pos.x = 1.5f;
+	if (1.5f * t_coef.y - t_bias.y > t_min)
+		idx ^= 2u, pos.y = 1.5f;
+	if (1.5f * t_coef.z - t_bias.z > t_min)
+		idx ^= 4u, pos.z = 1.5f;
+
+	uint scale = COMPACT_STACK_SIZE - 1u;
+	float scale_exp2 = 0.5f; // exp2( scale - STACK_SIZE )
+
+	while (scale < COMPACT_STACK_SIZE) {
+		if (cur == 0u)
+			cur = Compact_FetchChild(parent, idx ^ oct_mask);
+		// Determine maximum t-value of the cube by evaluating
+		// tx(), ty(), and tz() at its corner.
+
+		vec3 t_corner = pos * t_coef - t_bias;
+		float tc_max = min(min(t_corner.x, t_corner.y), t_corner.z);
+
+		if ((cur & 0x80000000u) != 0 && t_min <= t_max) {
+			// INTERSECT
+			float half_scale_exp2 = scale_exp2 * 0.5f;
+			vec3 t_center = half_scale_exp2 * t_coef + t_corner;
+
+			if ((cur & 0x40000000u) != 0) { // leaf node
+				if (!leaf)
+					return true;
+				break;
+			}
+
+			// PUSH
+			if (tc_max < h)
+				stack[scale] = parent;
+			h = tc_max;
+
+			parent = cur & 0x3fffffffu;
+
+			idx = 0u;
+			--scale;
+			scale_exp2 = half_scale_exp2;
+			if (t_center.x > t_min)
+				idx ^= 1u, pos.x += scale_exp2;
+			if (t_center.y > t_min)
+				idx ^= 2u, pos.y += scale_exp2;
+			if (t_center.z > t_min)
+				idx ^= 4u, pos.z += scale_exp2;
+
+			cur = 0;
+
+			continue;
+		}
+
+		// ADVANCE
+		uint step_mask = 0u;
+		if (t_corner.x <= tc_max)
+			step_mask ^= 1u, pos.x -= scale_exp2;
+		if (t_corner.y <= tc_max)
+			step_mask ^= 2u, pos.y -= scale_exp2;
+		if (t_corner.z <= tc_max)
+			step_mask ^= 4u, pos.z -= scale_exp2;
+
+		// Update active t-span and flip bits of the child slot index.
+		t_min = tc_max;
+		idx ^= step_mask;
+
+		// Proceed with pop if the bit flips disagree with the ray direction.
+		if ((idx & step_mask) != 0) {
+			// POP
+			// Find the highest differing bit between the two positions.
+			uint differing_bits = 0;
+			if ((step_mask & 1u) != 0)
+				differing_bits |= floatBitsToUint(pos.x) ^ floatBitsToUint(pos.x + scale_exp2);
+			if ((step_mask & 2u) != 0)
+				differing_bits |= floatBitsToUint(pos.y) ^ floatBitsToUint(pos.y + scale_exp2);
+			if ((step_mask & 4u) != 0)
+				differing_bits |= floatBitsToUint(pos.z) ^ floatBitsToUint(pos.z + scale_exp2);
+			scale = findMSB(differing_bits);
+			if (scale >= COMPACT_STACK_SIZE)
+				break;
+			scale_exp2 = uintBitsToFloat((scale - COMPACT_STACK_SIZE + 127u) << 23u); // exp2f(scale - s_max)
+
+			// Restore parent voxel from the stack.
+			parent = stack[scale];
+
+			// Round cube position and extract child slot index.
+			uint shx = floatBitsToUint(pos.x) >> scale;
+			uint shy = floatBitsToUint(pos.y) >> scale;
+			uint shz = floatBitsToUint(pos.z) >> scale;
+			pos.x = uintBitsToFloat(shx << scale);
+			pos.y = uintBitsToFloat(shy << scale);
+			pos.z = uintBitsToFloat(shz << scale);
+			idx = (shx & 1u) | ((shy & 1u) << 1u) | ((shz & 1u) << 2u);
+
+			// Prevent same parent from being stored again and invalidate cached
+			// child descriptor.
+			h = 0.0f;
+			cur = 0;
+		}
+	}
+	if (!leaf)
+		return false;
+
+	vec3 t_corner = t_coef * (pos + scale_exp2) - t_bias;
+
+	vec3 norm = (t_corner.x > t_corner.y && t_corner.x > t_corner.z)
+	                ? vec3(-1, 0, 0)
+	                : (t_corner.y > t_corner.z ? vec3(0, -1, 0) : vec3(0, 0, -1));
+	if ((oct_mask & 1u) == 0u)
+		norm.x = -norm.x;
+	if ((oct_mask & 2u) == 0u)
+		norm.y = -norm.y;
+	if ((oct_mask & 4u) == 0u)
+		norm.z = -norm.z;
+
+	// Undo mirroring of the coordinate system.
+	if ((oct_mask & 1u) != 0u)
+		pos.x = 3.0f - scale_exp2 - pos.x;
+	if ((oct_mask & 2u) != 0u)
+		pos.y = 3.0f - scale_exp2 - pos.y;
+	if ((oct_mask & 4u) != 0u)
+		pos.z = 3.0f - scale_exp2 - pos.z;
+
+	// Output results.
+	o_pos = clamp(o + t_min * d, pos, pos + scale_exp2);
+	if (norm.x != 0)
+		o_pos.x = norm.x > 0 ? pos.x + scale_exp2 + COMPACT_EPS * 2 : pos.x - COMPACT_EPS;
+	if (norm.y != 0)
+		o_pos.y = norm.y > 0 ? pos.y + scale_exp2 + COMPACT_EPS * 2 : pos.y - COMPACT_EPS;
+	if (norm.z != 0)
+		o_pos.z = norm.z > 0 ? pos.z + scale_exp2 + COMPACT_EPS * 2 : pos.z - COMPACT_EPS;
+	o_normal = norm;
+	o_color = vec3(cur & 0xffu, (cur >> 8u) & 0xffu, (cur >> 16u) & 0xffu) * 0.00392156862745098;
+
+	return scale < COMPACT_STACK_SIZE && t_min <= t_max;
+}
+
+bool Compact_RayMarchLeaf(vec3 o, vec3 d, out vec3 o_pos, out vec3 o_color, out vec3 o_normal) {
+	return Compact_RayMarch(o, d, true, o_pos, o_color, o_normal);
+}
+bool Compact_RayMarchOcclude(vec3 o, vec3 d) {
+	vec3 pos, color, normal;
+	return Compact_RayMarch(o, d, false, pos, color, normal);
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef FRAGMENT_SORT_GLSL
+#define FRAGMENT_SORT_GLSL
+
+// Radix sort of the voxel fragment list (see FragmentDeduplicator), 4 bits per pass. The key is the voxel position of a
+// fragment: all of x and the top 4 bits of y (voxelizer.frag), digit shift 32 stands for these 4 bits. Each workgroup
+// sorts a block of kFragmentSortBlockSize fragments, every thread kFragmentSortItems consecutive ones of them.
+
+#define FRAGMENT_SORT_GROUP_SIZE 128
+const uint kFragmentSortItems = 16u, kFragmentSortBlockSize = FRAGMENT_SORT_GROUP_SIZE * kFragmentSortItems;
+const uint kFragmentSortDigits = 16u;
+
+layout(std430, binding = 1) readonly buffer uuSrcFragmentList { uvec2 uSrcFragmentList[]; };
+layout(std430, binding = 3) buffer uuHistogram { uint uHistogram[]; }; // digit-major: uHistogram[digit * blocks + block]
+
+layout(push_constant) uniform uuPushConstant { uint uFragmentCount, uShift, uBlockCount; };
+
+uint FragmentSort_Digit(in const uvec2 fragment) {
+	return uShift < 32u ? (fragment.x >> uShift) & 0xfu : fragment.y >> 28u;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef OCTREE_SORT_GLSL
+#define OCTREE_SORT_GLSL
+
+// Sort-based octree build (OctreeBuilder, OctreeBuildMode::kSortBased). octree_sort_key.comp replaces the voxel of each
+// fragment with its morton code, which fragment_sort_*.comp then sort by: code bits 0-31 in the x word, bits 32-35 in
+// the top 4 bits of the y word, the color stays in the low 24 bits. A code has 3 bits per level with x in the lowest bit
+// of each digit, so every digit is a child index of octree_tag_node.comp. Over the sorted list, digit d of the
+// histogram of fragment_sort.glsl counts the nodes of depth d a block introduces, its exclusive scan
+// (fragment_sort_scan.comp) is then the number of the first node of the depth in the block, with the nodes numbered
+// depth by depth in morton order as CpuOctreeBuilder does.
+
+#include "fragment_sort.glsl"
+
+layout(constant_id = 0) const uint kOctreeLevel = 1;
+
+bool OctreeSort_SameVoxel(in const uvec2 a, in const uvec2 b) { return a.x == b.x && (a.y >> 28u) == (b.y >> 28u); }
+
+// the first depth at which the voxel of fragment i has a node the previous fragment's voxel has not: 0 for the first
+// fragment, kOctreeLevel for a sibling of the previous voxel, kOctreeLevel + 1 for another fragment of the same voxel
+uint OctreeSort_NewDepth(in const uint i) {
+	if (i == 0u)
+		return 0u;
+	uvec2 a = uSrcFragmentList[i - 1u], b = uSrcFragmentList[i];
+	uint hi = (a.y ^ b.y) >> 28u, lo = a.x ^ b.x;
+	if (hi == 0u && lo == 0u)
+		return kOctreeLevel + 1u;
+	uint msb = hi != 0u ? 32u + uint(findMSB(hi)) : uint(findMSB(lo));
+	return kOctreeLevel - msb / 3u;
+}
+
+// child index of the node of depth d on the path to the voxel
+uint OctreeSort_Child(in const uvec2 key, in const uint d) {
+	uint shift = 3u * (kOctreeLevel - 1u - d), hi = key.y >> 28u;
+	uint lo_bits = shift < 32u ? key.x >> shift : 0u;
+	uint hi_bits = shift <= 32u ? (shift > 29u ? hi << (32u - shift) : 0u) : hi >> (shift - 32u);
+	return (lo_bits | hi_bits) & 7u;
+}
+
+#endif
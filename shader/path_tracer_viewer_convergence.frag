@@ -0,0 +1,29 @@
+#version 450
+
+#include "adaptive.glsl"
+
+layout(rgba32f, set = 0, binding = 3) uniform image2D uStatistics;
+
+layout(location = 0) out vec4 oColor;
+
+layout(push_constant) uniform uuPushConstant {
+	float uThreshold;
+	uint uMinSamples;
+};
+
+// Converged pixels are green, the others go from yellow to red with their error relative to the threshold (or to a
+// fixed reference when adaptive sampling is disabled). Brightness shows the relative sample count.
+void main() {
+	vec4 stats = imageLoad(uStatistics, ivec2(gl_FragCoord.xy));
+	if (stats.x == 0.0) {
+		oColor = vec4(0, 0, 0, 1);
+		return;
+	}
+	float brightness = 0.25 + 0.75 * clamp(log2(stats.x) / 12.0, 0.0, 1.0);
+	if (Adaptive_Converged(stats, uThreshold, uMinSamples))
+		oColor = vec4(vec3(0, 1, 0) * brightness, 1);
+	else {
+		float ratio = Adaptive_Error(stats) / (uThreshold > 0.0 ? uThreshold : 0.05);
+		oColor = vec4(vec3(1, 1.0 - clamp((ratio - 1.0) / 3.0, 0.0, 1.0), 0) * brightness, 1);
+	}
+}
@@ -0,0 +1,30 @@
+#ifndef ROULETTE_GLSL
+#define ROULETTE_GLSL
+
+#include "adaptive.glsl"
+
+// Russian roulette: the path continues with the probability of its throughput luminance and the survivors are
+// reweighted, which keeps the estimate unbiased. The random number hashes the pixel, the sample index and the bounce
+// instead of taking Sobol dimensions, so that the sample counter of the Sobol buffer stays at (bounce + 1) * 2 where
+// path_tracer.comp reads it.
+
+uint Roulette_Hash(uint x) {
+	x ^= x >> 16u;
+	x *= 0x7feb352du;
+	x ^= x >> 15u;
+	x *= 0x846ca68bu;
+	x ^= x >> 16u;
+	return x;
+}
+
+bool Roulette_Continue(in const ivec2 pixel, in const uint sample_index, in const uint bounce, inout vec3 throughput) {
+	float p = min(Adaptive_Luminance(throughput), 1.0);
+	uint h = Roulette_Hash(Roulette_Hash(Roulette_Hash(uint(pixel.x) ^ Roulette_Hash(uint(pixel.y))) ^ sample_index) ^
+	                       bounce);
+	if (float(h >> 8u) / 16777216.0 >= p)
+		return false;
+	throughput /= p;
+	return true;
+}
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef TREE64_GLSL
+#define TREE64_GLSL
+
+// Traversal of a Tree64 (src/Tree64.hpp) bound in place of the octree: uOctree holds its words, octree.glsl has to be
+// included first. The loop is the ESVO traversal of octree.glsl (and uses its stack), every 64-tree node stands in
+// for two octree levels: on an even scale the slots of a node are its 2x2x2 groups of cells, on an odd scale the cells
+// of the group the position lies in. The float operations are those of octree.glsl, so the hits are the same.
+// CpuTree64Tracer is the CPU port, keep them in sync.
+
+#define TREE64_STACK_SIZE 23u
+#define TREE64_EPS 3.552713678800501e-15
+// cells 0, 1, 4, 5, 16, 17, 20 and 21: the 2x2x2 group of cells of octant 0
+#define TREE64_GROUP_MASK 0x330033u
+
+// first cell of the 2x2x2 group of octant g
+uint Tree64_GroupCell(uint g) { return (g & 1u) * 2u + ((g >> 1u) & 1u) * 8u + ((g >> 2u) & 1u) * 32u; }
+
+// the slot word of the octree node at scale below 64-tree node: a leaf word, 0 or a pointer to the 64-tree node
+// holding the child's slots. The node of an odd scale is the octant group of node
+uint Tree64_FetchChild(uint node, uint scale, uint group, uint slot) {
+	uint mask_lo = uOctree[node], mask_hi = uOctree[node + 1u], child = uOctree[node + 2u];
+	uint cell = Tree64_GroupCell(slot);
+	if ((scale & 1u) == 0u) {
+		// the octree node is the whole 64-tree node, the slot is a 2x2x2 group of its cells
+		if ((((cell < 32u ? mask_lo >> cell : mask_hi >> (cell - 32u))) & TREE64_GROUP_MASK) == 0u)
+			return 0u;
+		if ((child & 0x40000000u) == 0u) // the cells of the group are on the next octree level
+			return 0x80000000u | node;
+	} else {
+		// the octree node is the group of the 64-tree node, the slot is one of its cells
+		cell = Tree64_GroupCell(group) + (slot & 1u) + ((slot >> 1u) & 1u) * 4u + ((slot >> 2u) & 1u) * 16u;
+		if (((cell < 32u ? mask_lo >> cell : mask_hi >> (cell - 32u)) & 1u) == 0u)
+			return 0u;
+	}
+	uint rank = cell < 32u ? bitCount(mask_lo & ((1u << cell) - 1u))
+	                       : bitCount(mask_lo) + bitCount(mask_hi & ((1u << (cell - 32u)) - 1u));
+	return (child & 0x80000000u) != 0u ? uOctree[(child & 0x3fffffffu) + rank]
+	                                   : 0x80000000u | ((child & 0x3fffffffu) + rank * 3u);
+}
+
+// leaf: fill o_pos, o_color, o_normal at the first hit, otherwise stop at any voxel
+bool Tree64_RayMarch(vec3 o, vec3 d, bool leaf, out vec3 o_pos, out vec3 o_color, out vec3 o_normal, out uint o_iter) {
+	d.x = abs(d.x) >= TREE64_EPS ? d.x : (d.x >= 0 ? TREE64_EPS : -TREE64_EPS);
+	d.y = abs(d.y) >= TREE64_EPS ? d.y : (d.y >= 0 ? TREE64_EPS : -TREE64_EPS);
+	d.z = abs(d.z) >= TREE64_EPS ? d.z : (d.z >= 0 ? TREE64_EPS : -TREE64_EPS);
+	o_iter = 0u;
+
+	// Precompute the coefficients of tx(x), ty(y), and tz(z).
+	// The octree is assumed to reside at coordinates [1, 2].
+	vec3 t_coef = 1.0f / -abs(d);
+	vec3 t_bias = t_coef * o;
+
+	uint oct_mask = 0u;
+	if (d.x > 0.0f)
+		oct_mask ^= 1u, t_bias.x = 3.0f * t_coef.x - t_bias.x;
+	if (d.y > 0.0f)
+		oct_mask ^= 2u, t_bias.y = 3.0f * t_coef.y - t_bias.y;
+	if (d.z > 0.0f)
+		oct_mask ^= 4u, t_bias.z = 3.0f * t_coef.z - t_bias.z;
+
+	// Initialize the active span of t-values.
+	float t_min = max(max(2.0f * t_coef.x - t_bias.x, 2.0f * t_coef.y - t_bias.y), 2.0f * t_coef.z - t_bias.z);
+	float t_max = min(min(t_coef.x - t_bias.x, t_coef.y - t_bias.y), t_coef.z - t_bias.z);
+	t_min = max(t_min, 0.0f);
+	float h = t_max;
+
+	uint parent = 0u;
+	uint cur = 0u;
+	vec3 pos = vec3(1.0f);
+	uint idx = 0u;
+	if (1.5f * t_coef.x - t_bias.x > t_min)
+		idx ^= 1u, pos.x = 1.5f;
+	if (1.5f * t_coef.y - t_bias.y > t_min)
+		idx ^= 2u, pos.y = 1.5f;
+	if (1.5f * t_coef.z - t_bias.z > t_min)
+		idx ^= 4u, pos.z = 1.5f;
+
+	uint scale = TREE64_STACK_SIZE - 1u;
+	float scale_exp2 = 0.5f; // exp2( scale - STACK_SIZE )
+
+	while (scale < TREE64_STACK_SIZE) {
+		++o_iter;
+		if (cur == 0u) {
+			// octant of the 64-tree node that holds the node of an odd scale, the position bits one scale up
+			uvec3 group3 = (floatBitsToUint(pos) >> (scale + 1u)) & 1u;
+			cur = Tree64_FetchChild(parent, scale, (group3.x | group3.y << 1u | group3.z << 2u) ^ oct_mask,
+			                        idx ^ oct_mask);
+		}
+		// Determine maximum t-value of the cube by evaluating
+		// tx(), ty(), and tz() at its corner.
+
+		vec3 t_corner = pos * t_coef - t_bias;
+		float tc_max = min(min(t_corner.x, t_corner.y), t_corner.z);
+
+		if ((cur & 0x80000000u) != 0 && t_min <= t_max) {
+			// INTERSECT
+			float half_scale_exp2 = scale_exp2 * 0.5f;
+			vec3 t_center = half_scale_exp2 * t_coef + t_corner;
+
+			if ((cur & 0x40000000u) != 0) { // leaf node
+				if (!leaf)
+					return true;
+				break;
+			}
+
+			// PUSH
+			if (tc_max < h)
+				stack[scale] = parent;
+			h = tc_max;
+
+			parent = cur & 0x3fffffffu;
+
+			idx = 0u;
+			--scale;
+			scale_exp2 = half_scale_exp2;
+			if (t_center.x > t_min)
+				idx ^= 1u, pos.x += scale_exp2;
+			if (t_center.y > t_min)
+				idx ^= 2u, pos.y += scale_exp2;
+			if (t_center.z > t_min)
+				idx ^= 4u, pos.z += scale_exp2;
+
+			cur = 0;
+
+			continue;
+		}
+
+		// ADVANCE
+		uint step_mask = 0u;
+		if (t_corner.x <= tc_max)
+			step_mask ^= 1u, pos.x -= scale_exp2;
+		if (t_corner.y <= tc_max)
+			step_mask ^= 2u, pos.y -= scale_exp2;
+		if (t_corner.z <= tc_max)
+			step_mask ^= 4u, pos.z -= scale_exp2;
+
+		// Update active t-span and flip bits of the child slot index.
+		t_min = tc_max;
+		idx ^= step_mask;
+
+		// Proceed with pop if the bit flips disagree with the ray direction.
+		if ((idx & step_mask) != 0) {
+			// POP
+			// Find the highest differing bit between the two positions.
+			uint differing_bits = 0;
+			if ((step_mask & 1u) != 0)
+				differing_bits |= floatBitsToUint(pos.x) ^ floatBitsToUint(pos.x + scale_exp2);
+			if ((step_mask & 2u) != 0)
+				differing_bits |= floatBitsToUint(pos.y) ^ floatBitsToUint(pos.y + scale_exp2);
+			if ((step_mask & 4u) != 0)
+				differing_bits |= floatBitsToUint(pos.z) ^ floatBitsToUint(pos.z + scale_exp2);
+			scale = findMSB(differing_bits);
+			if (scale >= TREE64_STACK_SIZE)
+				break;
+			scale_exp2 = uintBitsToFloat((scale - TREE64_STACK_SIZE + 127u) << 23u); // exp2f(scale - s_max)
+
+			// Restore parent voxel from the stack.
+			parent = stack[scale];
+
+			// Round cube position and extract child slot index.
+			uint shx = floatBitsToUint(pos.x) >> scale;
+			uint shy = floatBitsToUint(pos.y) >> scale;
+			uint shz = floatBitsToUint(pos.z) >> scale;
+			pos.x = uintBitsToFloat(shx << scale);
+			pos.y = uintBitsToFloat(shy << scale);
+			pos.z = uintBitsToFloat(shz << scale);
+			idx = (shx & 1u) | ((shy & 1u) << 1u) | ((shz & 1u) << 2u);
+
+			// Prevent same parent from being stored again and invalidate cached
+			// child descriptor.
+			h = 0.0f;
+			cur = 0;
+		}
+	}
+	if (!leaf)
+		return false;
+
+	vec3 t_corner = t_coef * (pos + scale_exp2) - t_bias;
+
+	vec3 norm = (t_corner.x > t_corner.y && t_corner.x > t_corner.z)
+	                ? vec3(-1, 0, 0)
+	                : (t_corner.y > t_corner.z ? vec3(0, -1, 0) : vec3(0, 0, -1));
+	if ((oct_mask & 1u) == 0u)
+		norm.x = -norm.x;
+	if ((oct_mask & 2u) == 0u)
+		norm.y = -norm.y;
+	if ((oct_mask & 4u) == 0u)
+		norm.z = -norm.z;
+
+	// Undo mirroring of the coordinate system.
+	if ((oct_mask & 1u) != 0u)
+		pos.x = 3.0f - scale_exp2 - pos.x;
+	if ((oct_mask & 2u) != 0u)
+		pos.y = 3.0f - scale_exp2 - pos.y;
+	if ((oct_mask & 4u) != 0u)
+		pos.z = 3.0f - scale_exp2 - pos.z;
+
+	// Output results.
+	o_pos = clamp(o + t_min * d, pos, pos + scale_exp2);
+	if (norm.x != 0)
+		o_pos.x = norm.x > 0 ? pos.x + scale_exp2 + TREE64_EPS * 2 : pos.x - TREE64_EPS;
+	if (norm.y != 0)
+		o_pos.y = norm.y > 0 ? pos.y + scale_exp2 + TREE64_EPS * 2 : pos.y - TREE64_EPS;
+	if (norm.z != 0)
+		o_pos.z = norm.z > 0 ? pos.z + scale_exp2 + TREE64_EPS * 2 : pos.z - TREE64_EPS;
+	o_normal = norm;
+	o_color = vec3(cur & 0xffu, (cur >> 8u) & 0xffu, (cur >> 16u) & 0xffu) * 0.00392156862745098;
+
+	return scale < TREE64_STACK_SIZE && t_min <= t_max;
+}
+
+bool Tree64_RayMarchLeaf(vec3 o, vec3 d, out vec3 o_pos, out vec3 o_color, out vec3 o_normal) {
+	uint iter;
+	return Tree64_RayMarch(o, d, true, o_pos, o_color, o_normal, iter);
+}
+bool Tree64_RayMarchOcclude(vec3 o, vec3 d) {
+	vec3 pos, color, normal;
+	uint iter;
+	return Tree64_RayMarch(o, d, false, pos, color, normal, iter);
+}
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef WAVEFRONT_GLSL
+#define WAVEFRONT_GLSL
+
+// Shared declarations of the wavefront path tracer kernels (wavefront_*.comp). Sets 0-5 and the first push constants
+// match path_tracer.comp, set 6 holds the path states and the ray queues.
+
+#include "adaptive.glsl"
+#include "diffuse.glsl"
+#include "mis.glsl"
+#include "roulette.glsl"
+#include "util.glsl"
+
+#define OCTREE_SET 0
+#define OCTREE_LOD
+#include "octree.glsl"
+#include "tree64.glsl"
+#include "dag.glsl"
+#include "compact.glsl"
+#define CAMERA_SET 1
+#include "camera.glsl"
+#define ENVIRONMENT_MAP_SET 2
+#define ENVIRONMENT_MAP_ENABLE_SAMPLE 1
+#include "environment_map.glsl"
+#define SOBOL_SET 3
+#include "sobol.glsl"
+
+layout(rgba32f, set = 4, binding = 0) uniform image2D uColor;
+layout(rgba8, set = 4, binding = 1) uniform image2D uAlbedo;
+layout(rgba8_snorm, set = 4, binding = 2) uniform image2D uNormal;
+layout(rgba32f, set = 4, binding = 3) uniform image2D uStatistics; // see adaptive.glsl
+
+layout(set = 5, binding = 0) uniform sampler2D uNoise;
+
+// one path per pixel, indexed by y * width + x
+struct Path {
+	vec4 origin;     // xyz: camera position or the last hit, w: pdf of the direction sampled by the last shade
+	vec4 direction;  // xyz
+	vec4 throughput; // xyz
+	vec4 radiance;   // xyz
+	vec4 normal;     // xyz: normal at the last hit
+};
+struct ShadowRay {
+	vec4 direction;    // xyz
+	vec4 contribution; // xyz: radiance added to the path when the ray is not occluded
+};
+// count and the indirect dispatch arguments of one queue at one bounce, the workgroups are laid out in rows of
+// WAVEFRONT_ROW_GROUPS to stay below the maxComputeWorkGroupCount limits
+struct QueueCounter {
+	uint count, group_x, group_y, group_z;
+};
+layout(std430, set = 6, binding = 0) buffer uuPaths { Path uPaths[]; };
+layout(std430, set = 6, binding = 1) buffer uuShadowRays { ShadowRay uShadowRays[]; };
+// three queues of capacity width * height each, in the order of the WAVEFRONT_*_QUEUE indices
+layout(std430, set = 6, binding = 2) buffer uuQueues { uint uQueues[]; };
+layout(std430, set = 6, binding = 3) buffer uuQueueCounters { QueueCounter uQueueCounters[]; };
+
+#define WAVEFRONT_EXTEND_QUEUE 0u
+#define WAVEFRONT_SHADE_QUEUE 1u
+#define WAVEFRONT_SHADOW_QUEUE 2u
+#define WAVEFRONT_QUEUE_COUNT 3u
+#define WAVEFRONT_GROUP_SIZE 64u
+#define WAVEFRONT_ROW_GROUPS 4096u
+
+layout(push_constant) uniform uuPushConstant {
+	uint uBounce, uLightType;
+	float uConstColor[3], uEnvMapRotation, uEnvMapMultiplier;
+	uint uRouletteBounce; // first bounce with Russian roulette, the bounce count to disable it
+	uint uAdaptiveMinSamples;
+	float uAdaptiveThreshold; // 0 to trace every pixel
+	float uLODSpread; // footprint spread of the rays after the first diffuse bounce (OctreeLOD), 0 to trace the leaves
+	uint uLevel; // bounce of the rays processed by the dispatch
+	uint uTileX, uTileY, uTileWidth, uTileHeight; // pixels started by wavefront_generate.comp
+};
+
+// WavefrontPathTracer specializes the pipelines for the light type and the bounce count, so the branches of the other
+// light type fold away. Without specialization they are read from the push constants.
+layout(constant_id = 0) const uint kLightType = 0xffffffffu;
+layout(constant_id = 1) const uint kBounce = 0u;
+uint Wavefront_LightType() { return kLightType == 0xffffffffu ? uLightType : kLightType; }
+uint Wavefront_Bounce() { return kBounce == 0u ? uBounce : kBounce; }
+// set 0 holds a Tree64 instead of the octree (PathTracer binds Octree::GetTree64DescriptorSet)
+layout(constant_id = 2) const bool kTree64 = false;
+// set 0 holds an OctreeDAG instead of the octree (PathTracer binds Octree::GetDAGDescriptorSet), traced with dag.glsl
+layout(constant_id = 3) const bool kDAG = false;
+// set 0 holds a CompactOctree instead of the octree (PathTracer binds Octree::GetCompactDescriptorSet)
+layout(constant_id = 4) const bool kCompact = false;
+
+bool Wavefront_RayMarchLeaf(vec3 o, vec3 d, out vec3 o_pos, out vec3 o_color, out vec3 o_normal) {
+	if (kDAG)
+		return DAG_RayMarchLeaf(o, d, o_pos, o_color, o_normal);
+	if (kCompact)
+		return Compact_RayMarchLeaf(o, d, o_pos, o_color, o_normal);
+	return kTree64 ? Tree64_RayMarchLeaf(o, d, o_pos, o_color, o_normal)
+	               : Octree_RayMarchLeaf(o, d, o_pos, o_color, o_normal);
+}
+bool Wavefront_RayMarchOcclude(vec3 o, vec3 d) {
+	if (kCompact)
+		return Compact_RayMarchOcclude(o, d);
+	return kTree64 ? Tree64_RayMarchOcclude(o, d) : Octree_RayMarchOcclude(o, d);
+}
+// the rays of bounce uLevel, from the second diffuse bounce on they stop at the nodes of their footprint size and use
+// the average color of the node, a box filter over the leaves whose bias grows with uLODSpread
+bool Wavefront_RayMarchBounce(vec3 o, vec3 d, out vec3 o_pos, out vec3 o_color, out vec3 o_normal) {
+	if (!kTree64 && !kDAG && !kCompact && uLODSpread > 0.0 && uLevel >= 2u)
+		return Octree_RayMarchLOD(o, d, 0.0, uLODSpread, o_pos, o_color, o_normal);
+	return Wavefront_RayMarchLeaf(o, d, o_pos, o_color, o_normal);
+}
+
+vec3 ConstLight() { return vec3(uConstColor[0], uConstColor[1], uConstColor[2]); }
+
+uint Wavefront_Capacity() {
+	ivec2 size = imageSize(uColor);
+	return uint(size.x * size.y);
+}
+ivec2 Wavefront_Pixel(in const uint path) {
+	uint width = uint(imageSize(uColor).x);
+	return ivec2(path % width, path / width);
+}
+
+// index of the invocation in a dispatch of rows of WAVEFRONT_ROW_GROUPS workgroups
+uint Wavefront_Index() {
+	return gl_WorkGroupID.y * WAVEFRONT_ROW_GROUPS * WAVEFRONT_GROUP_SIZE + gl_GlobalInvocationID.x;
+}
+
+uint Wavefront_QueueCount(in const uint queue, in const uint level) {
+	return uQueueCounters[level * WAVEFRONT_QUEUE_COUNT + queue].count;
+}
+uint Wavefront_QueueGet(in const uint queue, in const uint i) { return uQueues[queue * Wavefront_Capacity() + i]; }
+void Wavefront_QueuePush(in const uint queue, in const uint level, in const uint path) {
+	uint counter = level * WAVEFRONT_QUEUE_COUNT + queue;
+	uint i = atomicAdd(uQueueCounters[counter].count, 1u);
+	// the first ray of every workgroup adds the group to the indirect dispatch of the consumer
+	if ((i & (WAVEFRONT_GROUP_SIZE - 1u)) == 0u) {
+		uint group = i / WAVEFRONT_GROUP_SIZE;
+		atomicMax(uQueueCounters[counter].group_x, min(group + 1u, WAVEFRONT_ROW_GROUPS));
+		if (group % WAVEFRONT_ROW_GROUPS == 0u)
+			atomicAdd(uQueueCounters[counter].group_y, 1u);
+	}
+	uQueues[queue * Wavefront_Capacity() + i] = path;
+}
+
+// Russian roulette (roulette.glsl) at the hits from bounce uRouletteBounce on
+bool Wavefront_Roulette(in const ivec2 pixel, inout vec3 throughput) {
+	return uLevel < uRouletteBounce ||
+	       Roulette_Continue(pixel, Sobol_Current((Wavefront_Bounce() + 1u) * 2u), uLevel, throughput);
+}
+
+// running average over the samples of the pixel, which differ between pixels with adaptive sampling
+void Wavefront_AccumulateColor(in const ivec2 pixel, in const vec3 value) {
+	vec4 stats = imageLoad(uStatistics, pixel);
+	float n = stats.x;
+	imageStore(uColor, pixel, vec4((imageLoad(uColor, pixel).xyz * n + value) / (n + 1.0), 1));
+	imageStore(uStatistics, pixel, Adaptive_Update(stats, value));
+}
+// called before Wavefront_AccumulateColor of the same sample
+void Wavefront_AccumulateAlbedoNormal(in const ivec2 pixel, in const vec3 albedo, in const vec3 normal) {
+	float n = imageLoad(uStatistics, pixel).x;
+	imageStore(uAlbedo, pixel, vec4((imageLoad(uAlbedo, pixel).xyz * n + albedo) / (n + 1.0), 1));
+	imageStore(uNormal, pixel, vec4((imageLoad(uNormal, pixel).xyz * n + normal) / (n + 1.0), 1));
+}
+
+#endif
@@ -274,11 +274,13 @@ void Application::initialize_vulkan() {
 
 		auto features = physical_device->GetDefaultFeatures();
 		features.vk12.descriptorBindingPartiallyBound = VK_TRUE;
-		m_device = myvk::Device::Create(physical_device, queue_selector, features, extensions);
+		features.vk12.timelineSemaphore = VK_TRUE; // PathTracerThread
+		m_device = myvk::Device::Create(physical_device, queue_selector, features, extensions, kPipelineCacheFilename);
 		if (!m_device) {
 			spdlog::error("Failed to create logical device!");
 			exit(EXIT_FAILURE);
 		}
+		spdlog::info("Pipeline cache {}", m_device->IsPipelineCacheLoaded() ? "loaded" : "not loaded, starting empty");
 
 		spdlog::info("Present Queue: ({}){}, Main Queue: ({}){}, Loader Queue: ({}){}, PathTracer Queue: ({}){}",
 		             m_present_queue->GetFamilyIndex(), (void *)m_present_queue->GetHandle(), // present queue
@@ -346,7 +348,9 @@ Application::~Application() {
 	glfwTerminate();
 }
 
-void Application::Load(const char *filename, uint32_t octree_level) { m_loader_thread->Launch(filename, octree_level); }
+void Application::Load(const char *filename, uint32_t octree_level, const OctreeLoadOptions &options) {
+	m_loader_thread->Launch(filename, octree_level, options);
+}
 
 void Application::Run() {
 	double lst_time = glfwGetTime();
@@ -99,7 +99,7 @@ private:
 public:
 	Application();
 	~Application();
-	void Load(const char *filename, uint32_t octree_level);
+	void Load(const char *filename, uint32_t octree_level, const OctreeLoadOptions &options = {});
 	void Run();
 };
 
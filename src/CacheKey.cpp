@@ -0,0 +1,53 @@
+#include "CacheKey.hpp"
+
+#include "ObjLoader.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+// FNV-1a, stable across runs and platforms
+inline static uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= ((const uint8_t *)data)[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+constexpr uint64_t kFnv1aBasis = 0xcbf29ce484222325ull;
+
+bool CacheKey::Get(const char *source_filename, CacheKey *key) {
+	std::error_code ec;
+	std::filesystem::path path = std::filesystem::weakly_canonical(source_filename, ec);
+	if (ec)
+		return false;
+	auto mtime = std::filesystem::last_write_time(path, ec);
+	if (ec)
+		return false;
+
+	key->source_path = path.string();
+	key->source_mtime = mtime.time_since_epoch().count();
+
+	key->dependency_hash = 0;
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	if (extension == ".obj") {
+		std::string base_dir = (path.parent_path() / "").string();
+		key->dependency_hash = kFnv1aBasis;
+		for (const std::string &dependency : ObjLoader::GetDependencies(key->source_path.c_str(), base_dir.c_str())) {
+			// a missing file counts as well, so that creating it invalidates the entry
+			auto dependency_mtime = std::filesystem::last_write_time(dependency, ec);
+			int64_t dependency_mtime_count = ec ? -1 : dependency_mtime.time_since_epoch().count();
+			key->dependency_hash = fnv1a(key->dependency_hash, dependency.data(), dependency.size() + 1);
+			key->dependency_hash = fnv1a(key->dependency_hash, &dependency_mtime_count, sizeof(int64_t));
+		}
+	}
+	return true;
+}
+
+std::string CacheKey::GetFilename(const char *directory, const std::string &suffix) const {
+	uint64_t hash = fnv1a(kFnv1aBasis, source_path.data(), source_path.size());
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+	return (std::filesystem::path(directory) / (name + suffix)).string();
+}
@@ -0,0 +1,20 @@
+#ifndef CACHE_KEY_HPP
+#define CACHE_KEY_HPP
+
+#include <cinttypes>
+#include <string>
+
+// Identifies an on-disk cache entry by the canonical path and the modification time of its source file, and by the
+// modification times of the files the source references (for an OBJ file its material libraries and their textures)
+struct CacheKey {
+	std::string source_path;
+	int64_t source_mtime;
+	uint64_t dependency_hash; // of the paths and mtimes of ObjLoader::GetDependencies, 0 for other files
+
+	static bool Get(const char *source_filename, CacheKey *key);
+
+	// <directory>/<hash of the source path><suffix>
+	std::string GetFilename(const char *directory, const std::string &suffix) const;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include "CompactOctree.hpp"
+
+#include <bit>
+#include <spdlog/spdlog.h>
+
+constexpr size_t kNodeGrain = 4096;
+
+std::shared_ptr<CompactOctree> CompactOctree::Convert(const std::shared_ptr<ThreadPool> &thread_pool,
+                                                      const uint32_t *octree, size_t range) {
+	const size_t kNodeCount = range / (8 * sizeof(uint32_t));
+	if (kNodeCount == 0)
+		return nullptr;
+
+	// mask of every node, 0xffffffff marks an invalid pointer
+	std::vector<uint32_t> masks(kNodeCount);
+	thread_pool->ParallelFor(kNodeCount, kNodeGrain, [&](size_t begin, size_t end) {
+		for (size_t node = begin; node < end; ++node) {
+			uint32_t mask = 0;
+			for (uint32_t slot = 0; slot < 8; ++slot) {
+				uint32_t word = octree[node * 8 + slot];
+				if ((word & 0xC0000000u) == 0x80000000u &&
+				    ((word & 7u) || (word & 0x3fffffffu) == 0 || (word & 0x3fffffffu) >= kNodeCount * 8)) {
+					mask = 0xffffffffu;
+					break;
+				}
+				mask |= (word >> 31u) << slot;
+			}
+			masks[node] = mask;
+		}
+	});
+
+	// offsets of the mask words, nodes keep their order
+	std::vector<uint32_t> offsets(kNodeCount);
+	size_t word_count = 0;
+	for (size_t node = 0; node < kNodeCount; ++node) {
+		if (masks[node] == 0xffffffffu) {
+			spdlog::error("CompactOctree: invalid pointer in node {}", node);
+			return nullptr;
+		}
+		offsets[node] = (uint32_t)word_count;
+		word_count += 1 + std::popcount(masks[node]);
+		if (word_count > 0x3fffffffu) {
+			spdlog::error("CompactOctree: {} nodes exceed the 30-bit pointers", kNodeCount);
+			return nullptr;
+		}
+	}
+
+	std::shared_ptr<CompactOctree> ret = std::make_shared<CompactOctree>();
+	ret->m_source_range = range;
+	ret->m_words.resize(word_count);
+	thread_pool->ParallelFor(kNodeCount, kNodeGrain, [&](size_t begin, size_t end) {
+		for (size_t node = begin; node < end; ++node) {
+			uint32_t *dst = ret->m_words.data() + offsets[node];
+			*(dst++) = masks[node];
+			for (uint32_t slot = 0; slot < 8; ++slot) {
+				uint32_t word = octree[node * 8 + slot];
+				if ((word & 0xC0000000u) == 0x80000000u)
+					*(dst++) = 0x80000000u | offsets[(word & 0x3fffffffu) >> 3u];
+				else if (word & 0x80000000u)
+					*(dst++) = word;
+			}
+		}
+	});
+	return ret;
+}
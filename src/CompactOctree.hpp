@@ -0,0 +1,31 @@
+#ifndef COMPACT_OCTREE_HPP
+#define COMPACT_OCTREE_HPP
+
+#include "ThreadPool.hpp"
+
+#include <memory>
+#include <vector>
+
+// Child-mask encoding of a built octree (uOctree words, e.g. from OctreeBuilder, CpuOctreeBuilder or an OctreeDAG).
+// Instead of eight slot words, a node is a mask word with bit i set for every non-empty slot i, followed by the words
+// of these slots packed in slot order. The packed words are the ones of uOctree, pointers hold the word offset of the
+// child's mask word. The root node starts at word 0. A node of c children takes c + 1 words instead of 8, and
+// CpuOctreeTracer with compact = true and shader/compact.glsl find slot i at 1 + bitCount(mask & ((1 << i) - 1)).
+// LoaderThread builds it with OctreeLoadOptions::compact for the wavefront path tracer (Octree::GetCompactDescriptorSet).
+class CompactOctree {
+private:
+	std::vector<uint32_t> m_words;
+	size_t m_source_range{};
+
+public:
+	// octree holds range bytes of uOctree words with the root node at word 0, nullptr if a pointer is invalid or the
+	// result exceeds the 30-bit pointers
+	static std::shared_ptr<CompactOctree> Convert(const std::shared_ptr<ThreadPool> &thread_pool,
+	                                              const uint32_t *octree, size_t range);
+
+	const std::vector<uint32_t> &GetWords() const { return m_words; }
+	size_t GetRange() const { return m_words.size() * sizeof(uint32_t); }
+	size_t GetSourceRange() const { return m_source_range; }
+};
+
+#endif
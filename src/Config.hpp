@@ -7,6 +7,7 @@ constexpr const char *kAppName = "Vulkan SVO";
 constexpr uint32_t kDefaultWidth = 1280, kDefaultHeight = 720;
 constexpr uint32_t kMinWidth = 256, kMinHeight = 256;
 constexpr uint32_t kMaxWidth = 3840, kMaxHeight = 3840;
+constexpr uint32_t kMaxHeadlessWidth = 8192, kMaxHeadlessHeight = 8192; // also limited by maxImageDimension2D
 constexpr uint32_t kFrameCount = 3;
 
 constexpr float kCamNear = 1.0f / 512.0f, kCamFar = 4.0f;
@@ -20,6 +21,9 @@ constexpr uint32_t kOctreeLevelMax = 12;
 constexpr uint32_t kOctreeNodeNumMin = 1000000;
 constexpr uint32_t kOctreeNodeNumMax = 500000000;
 constexpr uint32_t kBeamSize = 8; // for beam optimization
+constexpr const char *kOctreeCacheDirectory = "octree_cache";
+constexpr const char *kMeshCacheDirectory = "mesh_cache";
+constexpr const char *kPipelineCacheFilename = "pipeline_cache.bin";
 
 constexpr uint32_t kMinBounce = 2;
 constexpr uint32_t kDefaultBounce = 4;
@@ -29,5 +33,19 @@ constexpr float kDefaultConstantColor = 5.0f;
 constexpr float kMaxConstantColor = 100.0f;
 
 constexpr uint32_t kPTResultUpdateInterval = 10;
+constexpr uint32_t kPTMaxSamplesPerSubmit = 16;
+constexpr uint32_t kPTMaxSubmissionsInFlight = 3;
+constexpr uint32_t kPTMinTileSize = 64, kPTDefaultTileSize = 256, kPTMaxTileSize = 1024;
+constexpr float kPTDefaultTileBudgetMs = 8.0f, kPTMaxTileBudgetMs = 100.0f;
+
+constexpr uint32_t kDefaultDenoiseIterations = 5, kMaxDenoiseIterations = 8;
+constexpr float kDefaultDenoiseSigmaColor = 0.5f, kDefaultDenoiseSigmaNormal = 64.0f, kDefaultDenoiseSigmaAlbedo = 0.1f;
+
+constexpr float kMaxAdaptiveThreshold = 1.0f;
+constexpr uint32_t kDefaultAdaptiveMinSamples = 16;
+constexpr uint32_t kMaxAdaptiveMinSamples = 1024;
+constexpr uint32_t kMinRouletteBounce = 1, kDefaultRouletteMinBounce = 2; // hits of the camera rays are bounce 0
+// growth of the ray footprint per unit of distance for the LOD traversal of the later diffuse bounces (OctreeLOD)
+constexpr float kDefaultLODSpread = 0.03f, kMaxLODSpread = 0.5f;
 
 #endif
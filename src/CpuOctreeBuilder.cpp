@@ -0,0 +1,259 @@
+#include "CpuOctreeBuilder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <spdlog/spdlog.h>
+
+constexpr size_t kFragmentGrain = 65536;
+
+// sort key: morton code of the voxel above the 24-bit fragment color
+constexpr uint32_t kMortonShift = 24;
+
+inline static uint64_t split_by_3(uint32_t a) {
+	uint64_t x = a & 0x1fffffu;
+	x = (x | x << 32u) & 0x1f00000000ffffull;
+	x = (x | x << 16u) & 0x1f0000ff0000ffull;
+	x = (x | x << 8u) & 0x100f00f00f00f00full;
+	x = (x | x << 4u) & 0x10c30c30c30c30c3ull;
+	x = (x | x << 2u) & 0x1249249249249249ull;
+	return x;
+}
+inline static uint32_t compact_by_3(uint64_t x) {
+	x &= 0x1249249249249249ull;
+	x = (x ^ (x >> 2u)) & 0x10c30c30c30c30c3ull;
+	x = (x ^ (x >> 4u)) & 0x100f00f00f00f00full;
+	x = (x ^ (x >> 8u)) & 0x1f0000ff0000ffull;
+	x = (x ^ (x >> 16u)) & 0x1f00000000ffffull;
+	x = (x ^ (x >> 32u)) & 0x1fffffull;
+	return (uint32_t)x;
+}
+// x in the lowest bit of each 3-bit digit, so every digit is a child index of octree_tag_node.comp
+inline static uint64_t morton_encode(uint32_t x, uint32_t y, uint32_t z) {
+	return split_by_3(x) | (split_by_3(y) << 1u) | (split_by_3(z) << 2u);
+}
+
+// LeafToUvec4 / Uvec4ToLeaf moving average of octree_tag_node.comp
+inline static uint32_t leaf_accumulate(uint32_t prev_val, uint32_t rgb) {
+	uint32_t prev_w = (prev_val >> 24u) & 0x3fu;
+	uint32_t w = prev_w + 1u;
+	uint32_t r = ((prev_val & 0xffu) * prev_w + (rgb & 0xffu)) / w;
+	uint32_t g = (((prev_val >> 8u) & 0xffu) * prev_w + ((rgb >> 8u) & 0xffu)) / w;
+	uint32_t b = (((prev_val >> 16u) & 0xffu) * prev_w + ((rgb >> 16u) & 0xffu)) / w;
+	return (std::min(w, 0x3fu) << 24u) | (r & 0xffu) | ((g & 0xffu) << 8u) | ((b & 0xffu) << 16u) | 0xC0000000u;
+}
+
+std::shared_ptr<CpuOctreeBuilder> CpuOctreeBuilder::Create(const std::shared_ptr<ThreadPool> &thread_pool,
+                                                           uint32_t level) {
+	std::shared_ptr<CpuOctreeBuilder> ret = std::make_shared<CpuOctreeBuilder>();
+	ret->m_thread_pool = thread_pool;
+	ret->m_level = level;
+	return ret;
+}
+
+void CpuOctreeBuilder::sort_keys(std::vector<uint64_t> *keys) const {
+	// stable LSD radix sort on the morton bits only, fragments of a voxel keep their input order
+	size_t count = keys->size();
+	size_t chunk_count = std::max<size_t>(1, std::min<size_t>(m_thread_pool->GetThreadCount() * 4u,
+	                                                          (count + kFragmentGrain - 1) / kFragmentGrain));
+	size_t chunk_size = (count + chunk_count - 1) / chunk_count;
+
+	std::vector<uint64_t> temp(count);
+	std::vector<std::array<size_t, 256>> histograms(chunk_count);
+
+	for (uint32_t shift = kMortonShift; shift < kMortonShift + 3u * m_level; shift += 8u) {
+		const uint64_t *src = keys->data();
+		uint64_t *dst = temp.data();
+
+		m_thread_pool->ParallelFor(chunk_count, 1, [&](size_t begin, size_t end) {
+			for (size_t c = begin; c < end; ++c) {
+				std::array<size_t, 256> &histogram = histograms[c];
+				histogram.fill(0);
+				for (size_t i = c * chunk_size, e = std::min(i + chunk_size, count); i < e; ++i)
+					++histogram[(src[i] >> shift) & 0xffu];
+			}
+		});
+		size_t offset = 0;
+		for (uint32_t digit = 0; digit < 256; ++digit)
+			for (auto &histogram : histograms) {
+				size_t num = histogram[digit];
+				histogram[digit] = offset;
+				offset += num;
+			}
+		m_thread_pool->ParallelFor(chunk_count, 1, [&](size_t begin, size_t end) {
+			for (size_t c = begin; c < end; ++c) {
+				std::array<size_t, 256> &histogram = histograms[c];
+				for (size_t i = c * chunk_size, e = std::min(i + chunk_size, count); i < e; ++i)
+					dst[histogram[(src[i] >> shift) & 0xffu]++] = src[i];
+			}
+		});
+		keys->swap(temp);
+	}
+}
+
+void CpuOctreeBuilder::merge_fragments(const glm::uvec2 *fragments, uint32_t fragment_count,
+                                       std::vector<uint64_t> *leaf_codes, std::vector<uint32_t> *leaf_values) const {
+	const uint32_t max_coord = (1u << m_level) - 1u;
+	ThreadPool &pool = *m_thread_pool;
+
+	// decode fragments (coordinates beyond the resolution end up in the last voxel, as in TraverseOctree)
+	std::vector<uint64_t> keys(fragment_count);
+	pool.ParallelFor(fragment_count, kFragmentGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			glm::uvec2 fragment = fragments[i];
+			uint32_t x = std::min(fragment.x & 0xfffu, max_coord);
+			uint32_t y = std::min((fragment.x >> 12u) & 0xfffu, max_coord);
+			uint32_t z = std::min((fragment.x >> 24u) | ((fragment.y >> 28u) << 8u), max_coord);
+			keys[i] = (morton_encode(x, y, z) << kMortonShift) | (fragment.y & 0xffffffu);
+		}
+	});
+	sort_keys(&keys);
+
+	// group equal morton codes into leaves; chunk boundaries are chosen so runs never straddle them
+	size_t chunk_count = (fragment_count + kFragmentGrain - 1) / kFragmentGrain;
+	std::vector<size_t> chunk_begins(chunk_count + 1);
+	for (size_t c = 0; c < chunk_count; ++c) {
+		size_t i = c * kFragmentGrain;
+		while (i > 0 && i < fragment_count && (keys[i] >> kMortonShift) == (keys[i - 1] >> kMortonShift))
+			++i;
+		chunk_begins[c] = std::max(i, c ? chunk_begins[c - 1] : 0);
+	}
+	chunk_begins[chunk_count] = fragment_count;
+
+	std::vector<size_t> chunk_leaf_begins(chunk_count + 1, 0);
+	pool.ParallelFor(chunk_count, 1, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; ++c) {
+			size_t num = 0;
+			for (size_t i = chunk_begins[c]; i < chunk_begins[c + 1]; ++i)
+				num += i == chunk_begins[c] || (keys[i] >> kMortonShift) != (keys[i - 1] >> kMortonShift);
+			chunk_leaf_begins[c + 1] = num;
+		}
+	});
+	for (size_t c = 0; c < chunk_count; ++c)
+		chunk_leaf_begins[c + 1] += chunk_leaf_begins[c];
+	size_t leaf_count = chunk_leaf_begins[chunk_count];
+
+	leaf_codes->resize(leaf_count);
+	leaf_values->resize(leaf_count);
+	pool.ParallelFor(chunk_count, 1, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; ++c) {
+			size_t leaf = chunk_leaf_begins[c] - 1;
+			for (size_t i = chunk_begins[c]; i < chunk_begins[c + 1]; ++i) {
+				uint64_t code = keys[i] >> kMortonShift;
+				uint32_t rgb = keys[i] & 0xffffffu;
+				if (i == chunk_begins[c] || code != (keys[i - 1] >> kMortonShift)) {
+					(*leaf_codes)[++leaf] = code;
+					(*leaf_values)[leaf] = 0xC1000000u | rgb;
+				} else
+					(*leaf_values)[leaf] = leaf_accumulate((*leaf_values)[leaf], rgb);
+			}
+		}
+	});
+}
+
+std::vector<glm::uvec2> CpuOctreeBuilder::Deduplicate(const glm::uvec2 *fragments, uint32_t fragment_count) const {
+	std::vector<uint64_t> leaf_codes;
+	std::vector<uint32_t> leaf_values;
+	if (fragment_count)
+		merge_fragments(fragments, fragment_count, &leaf_codes, &leaf_values);
+
+	std::vector<glm::uvec2> ret(leaf_codes.size());
+	m_thread_pool->ParallelFor(ret.size(), kFragmentGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			uint64_t code = leaf_codes[i];
+			uint32_t x = compact_by_3(code), y = compact_by_3(code >> 1u), z = compact_by_3(code >> 2u);
+			ret[i] = {x | (y << 12u) | ((z & 0xffu) << 24u), ((z >> 8u) << 28u) | (leaf_values[i] & 0xffffffu)};
+		}
+	});
+
+	spdlog::info("Fragments deduplicated: {} -> {} ({:.2f}x)", fragment_count, ret.size(),
+	             ret.empty() ? 1.0 : (double)fragment_count / (double)ret.size());
+	return ret;
+}
+
+void CpuOctreeBuilder::Build(const glm::uvec2 *fragments, uint32_t fragment_count) {
+	const uint32_t level = m_level;
+
+	m_octree.assign(8, 0u); // the root node always exists
+	if (fragment_count == 0)
+		return;
+
+	std::vector<uint64_t> leaf_codes;
+	std::vector<uint32_t> leaf_values;
+	merge_fragments(fragments, fragment_count, &leaf_codes, &leaf_values);
+	size_t leaf_count = leaf_codes.size();
+	ThreadPool &pool = *m_thread_pool;
+
+	// Each leaf shares its first `shared` levels of nodes with the previous leaf (the length of the common prefix of
+	// their morton codes) and introduces new nodes at all deeper levels.
+	size_t leaf_chunk_count = (leaf_count + kFragmentGrain - 1) / kFragmentGrain;
+	std::vector<int8_t> leaf_shared(leaf_count);
+	// new_nodes[c][d]: nodes of depth d introduced by the leaves of chunk c (prefix-summed into node offsets below)
+	std::vector<std::array<uint32_t, 16>> new_nodes(leaf_chunk_count + 1);
+	pool.ParallelFor(leaf_chunk_count, 1, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; ++c) {
+			new_nodes[c + 1].fill(0);
+			for (size_t j = c * kFragmentGrain, e = std::min(j + kFragmentGrain, leaf_count); j < e; ++j) {
+				int32_t shared = -1;
+				if (j)
+					shared = (int32_t)level - 1 - (std::bit_width(leaf_codes[j] ^ leaf_codes[j - 1]) - 1) / 3;
+				leaf_shared[j] = (int8_t)shared;
+				for (int32_t d = shared + 1; d < (int32_t)level; ++d)
+					++new_nodes[c + 1][d];
+			}
+		}
+	});
+	new_nodes[0].fill(0);
+	for (size_t c = 0; c < leaf_chunk_count; ++c)
+		for (uint32_t d = 0; d < level; ++d)
+			new_nodes[c + 1][d] += new_nodes[c][d];
+
+	// nodes are numbered depth by depth, sorted by morton prefix within a depth
+	std::array<uint32_t, 17> depth_bases{};
+	for (uint32_t d = 0; d < level; ++d)
+		depth_bases[d + 1] = depth_bases[d] + new_nodes[leaf_chunk_count][d];
+	uint32_t node_count = depth_bases[level];
+	m_octree.assign((size_t)node_count * 8u, 0u);
+
+	pool.ParallelFor(leaf_chunk_count, 1, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; ++c) {
+			std::array<uint32_t, 16> node_nums = new_nodes[c];
+			for (size_t j = c * kFragmentGrain, e = std::min(j + kFragmentGrain, leaf_count); j < e; ++j) {
+				int32_t shared = leaf_shared[j];
+				for (int32_t d = shared + 1; d < (int32_t)level; ++d)
+					++node_nums[d];
+				for (int32_t d = std::max(shared, 0); d < (int32_t)level; ++d) {
+					uint32_t node = depth_bases[d] + node_nums[d] - 1u;
+					uint32_t child = (leaf_codes[j] >> (3u * (level - 1u - d))) & 7u;
+					m_octree[node * 8u + child] = d + 1 < (int32_t)level
+					                                  ? ((depth_bases[d + 1] + node_nums[d + 1] - 1u) << 3u) | 0x80000000u
+					                                  : leaf_values[j];
+				}
+			}
+		}
+	});
+
+	spdlog::info("CPU octree built: {} fragments, {} leaves, {} nodes ({} MB)", fragment_count, leaf_count, node_count,
+	             GetOctreeRange() / 1000000.0);
+}
+
+std::vector<uint32_t> CpuOctreeBuilder::Canonicalize(const uint32_t *octree, size_t range) {
+	size_t node_count = range / (8 * sizeof(uint32_t));
+	std::vector<uint32_t> ret;
+	ret.reserve(node_count * 8);
+
+	std::vector<uint32_t> order = {0}; // source node of each output node
+	for (size_t i = 0; i < order.size(); ++i) {
+		const uint32_t *node = octree + (size_t)order[i] * 8u;
+		for (uint32_t s = 0; s < 8; ++s) {
+			uint32_t val = node[s];
+			uint32_t child = (val & 0x3fffffffu) >> 3u;
+			if ((val & 0xC0000000u) == 0x80000000u && child != 0 && child < node_count) {
+				order.push_back(child);
+				val = ((uint32_t)(order.size() - 1) << 3u) | 0x80000000u;
+			}
+			ret.push_back(val);
+		}
+	}
+	return ret;
+}
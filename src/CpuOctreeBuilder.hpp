@@ -0,0 +1,44 @@
+#ifndef CPU_OCTREE_BUILDER_HPP
+#define CPU_OCTREE_BUILDER_HPP
+
+#include "ThreadPool.hpp"
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+// Multithreaded CPU counterpart of OctreeBuilder, no Vulkan device required.
+// Consumes the same packed uvec2 fragment list and emits the same uOctree words: pointer slots are
+// ((node + 1) << 3) | 0x80000000, leaf slots are 0xC0000000 | count << 24 | rgb with the running average of
+// octree_tag_node.comp. Nodes are allocated level by level in slot order, which is the layout the GPU produces when
+// its subgroups reach the allocation counter in order (see Canonicalize).
+class CpuOctreeBuilder {
+private:
+	std::shared_ptr<ThreadPool> m_thread_pool;
+	uint32_t m_level{};
+	std::vector<uint32_t> m_octree;
+
+	void sort_keys(std::vector<uint64_t> *keys) const;
+	// sorts the fragments by morton code and averages the colors of each voxel (one entry per leaf)
+	void merge_fragments(const glm::uvec2 *fragments, uint32_t fragment_count, std::vector<uint64_t> *leaf_codes,
+	                     std::vector<uint32_t> *leaf_values) const;
+
+public:
+	static std::shared_ptr<CpuOctreeBuilder> Create(const std::shared_ptr<ThreadPool> &thread_pool, uint32_t level);
+
+	void Build(const glm::uvec2 *fragments, uint32_t fragment_count);
+	// One fragment per voxel in morton order, colored with the leaf average Build() would compute
+	std::vector<glm::uvec2> Deduplicate(const glm::uvec2 *fragments, uint32_t fragment_count) const;
+
+	uint32_t GetLevel() const { return m_level; }
+	const std::vector<uint32_t> &GetOctree() const { return m_octree; }
+	// same value as OctreeBuilder::GetOctreeRange()
+	size_t GetOctreeRange() const { return m_octree.size() * sizeof(uint32_t); }
+
+	// Renumbers the nodes of an octree (e.g. read back from the GPU build) into slot order, so that it can be compared
+	// word by word with GetOctree(). Leaf colors only match exactly when fragments sharing a voxel were averaged in the
+	// same order, since the GPU averages them in whatever order its atomics land.
+	static std::vector<uint32_t> Canonicalize(const uint32_t *octree, size_t range);
+};
+
+#endif
@@ -0,0 +1,544 @@
+#include "CpuOctreeTracer.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define CPU_OCTREE_TRACER_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+constexpr uint32_t kStackSize = 23;
+constexpr float kEps = 3.552713678800501e-15f;
+constexpr size_t kRayGrain = 1024;
+constexpr uint32_t kLODMinChildren = 4; // OCTREE_LOD_MIN_CHILDREN
+
+inline static uint32_t float_bits(float x) { return std::bit_cast<uint32_t>(x); }
+inline static float bits_float(uint32_t x) { return std::bit_cast<float>(x); }
+// GLSL findMSB, 0xffffffff for 0
+inline static uint32_t find_msb(uint32_t x) { return 31u - (uint32_t)std::countl_zero(x); }
+// GLSL min(x, y) is y < x ? y : x
+inline static float min_f(float x, float y) { return y < x ? y : x; }
+inline static float max_f(float x, float y) { return x < y ? y : x; }
+inline static glm::vec3 fix_direction(glm::vec3 d) {
+	d.x = std::abs(d.x) >= kEps ? d.x : (d.x >= 0 ? kEps : -kEps);
+	d.y = std::abs(d.y) >= kEps ? d.y : (d.y >= 0 ? kEps : -kEps);
+	d.z = std::abs(d.z) >= kEps ? d.z : (d.z >= 0 ? kEps : -kEps);
+	return d;
+}
+
+struct CpuOctreeTracer::State {
+	glm::vec3 t_coef, t_bias, pos;
+	float t_min, t_max, h, scale_exp2;
+	uint32_t oct_mask, scale, parent, cur, idx, iteration;
+
+	void Init(const glm::vec3 &o, const glm::vec3 &direction) {
+		glm::vec3 d = fix_direction(direction);
+
+		// Precompute the coefficients of tx(x), ty(y), and tz(z).
+		// The octree is assumed to reside at coordinates [1, 2].
+		t_coef = 1.0f / -glm::abs(d);
+		t_bias = t_coef * o;
+
+		oct_mask = 0u;
+		if (d.x > 0.0f)
+			oct_mask ^= 1u, t_bias.x = 3.0f * t_coef.x - t_bias.x;
+		if (d.y > 0.0f)
+			oct_mask ^= 2u, t_bias.y = 3.0f * t_coef.y - t_bias.y;
+		if (d.z > 0.0f)
+			oct_mask ^= 4u, t_bias.z = 3.0f * t_coef.z - t_bias.z;
+
+		// Initialize the active span of t-values.
+		t_min = max_f(max_f(2.0f * t_coef.x - t_bias.x, 2.0f * t_coef.y - t_bias.y), 2.0f * t_coef.z - t_bias.z);
+		t_max = min_f(min_f(t_coef.x - t_bias.x, t_coef.y - t_bias.y), t_coef.z - t_bias.z);
+		t_min = max_f(t_min, 0.0f);
+		h = t_max;
+
+		parent = 0u;
+		cur = 0u;
+		pos = glm::vec3(1.0f);
+		idx = 0u;
+		if (1.5f * t_coef.x - t_bias.x > t_min)
+			idx ^= 1u, pos.x = 1.5f;
+		if (1.5f * t_coef.y - t_bias.y > t_min)
+			idx ^= 2u, pos.y = 1.5f;
+		if (1.5f * t_coef.z - t_bias.z > t_min)
+			idx ^= 4u, pos.z = 1.5f;
+
+		scale = kStackSize - 1;
+		scale_exp2 = 0.5f; // exp2( scale - STACK_SIZE )
+		iteration = 0;
+	}
+
+	// POP, called when the bit flips of an ADVANCE disagree with the ray direction. Leaves scale >= kStackSize when the
+	// ray exits the octree
+	void Pop(uint32_t step_mask, const uint32_t *stack) {
+		// Find the highest differing bit between the two positions.
+		uint32_t differing_bits = 0;
+		if ((step_mask & 1u) != 0)
+			differing_bits |= float_bits(pos.x) ^ float_bits(pos.x + scale_exp2);
+		if ((step_mask & 2u) != 0)
+			differing_bits |= float_bits(pos.y) ^ float_bits(pos.y + scale_exp2);
+		if ((step_mask & 4u) != 0)
+			differing_bits |= float_bits(pos.z) ^ float_bits(pos.z + scale_exp2);
+		scale = find_msb(differing_bits);
+		if (scale >= kStackSize)
+			return;
+		scale_exp2 = bits_float((scale - kStackSize + 127u) << 23u); // exp2f(scale - s_max)
+
+		// Restore parent voxel from the stack.
+		parent = stack[scale];
+
+		// Round cube position and extract child slot index.
+		uint32_t shx = float_bits(pos.x) >> scale;
+		uint32_t shy = float_bits(pos.y) >> scale;
+		uint32_t shz = float_bits(pos.z) >> scale;
+		pos.x = bits_float(shx << scale);
+		pos.y = bits_float(shy << scale);
+		pos.z = bits_float(shz << scale);
+		idx = (shx & 1u) | ((shy & 1u) << 1u) | ((shz & 1u) << 2u);
+
+		// Prevent same parent from being stored again and invalidate cached child descriptor.
+		h = 0.0f;
+		cur = 0;
+	}
+
+	bool IsHit() const { return scale < kStackSize && t_min <= t_max; }
+};
+
+std::shared_ptr<CpuOctreeTracer> CpuOctreeTracer::Create(const std::shared_ptr<ThreadPool> &thread_pool,
+                                                         std::vector<uint32_t> octree, bool compact) {
+	std::shared_ptr<CpuOctreeTracer> ret = std::make_shared<CpuOctreeTracer>();
+	ret->m_thread_pool = thread_pool;
+	ret->m_octree = std::move(octree);
+	ret->m_compact = compact;
+	return ret;
+}
+
+template <bool kCoarse>
+bool CpuOctreeTracer::march(const glm::vec3 &o, const glm::vec3 &d, float orig_sz, float dir_sz, State *state,
+                            const uint32_t *lod) const {
+	State &s = *state;
+	s.Init(o, d);
+	uint32_t stack[kStackSize];
+
+	while (s.scale < kStackSize) {
+		++s.iteration;
+		if (s.cur == 0u)
+			s.cur = fetch_child(s.parent, s.idx ^ s.oct_mask);
+		// Determine maximum t-value of the cube by evaluating
+		// tx(), ty(), and tz() at its corner.
+
+		glm::vec3 t_corner = s.pos * s.t_coef - s.t_bias;
+		float tc_max = min_f(min_f(t_corner.x, t_corner.y), t_corner.z);
+
+		if ((s.cur & 0x80000000u) != 0 && s.t_min <= s.t_max) {
+			if constexpr (kCoarse) {
+				if (orig_sz + tc_max * dir_sz >= s.scale_exp2)
+					break;
+			}
+
+			// INTERSECT
+			float half_scale_exp2 = s.scale_exp2 * 0.5f;
+			glm::vec3 t_center = half_scale_exp2 * s.t_coef + t_corner;
+
+			if ((s.cur & 0x40000000u) != 0) // leaf node
+				break;
+			// a node of the footprint size is solid enough to stand in for its leaves
+			if (lod && orig_sz + tc_max * dir_sz >= s.scale_exp2) {
+				uint32_t word = lod[(s.cur & 0x3fffffffu) >> 3u];
+				if ((word >> 24u) >= kLODMinChildren) {
+					s.cur = word;
+					break;
+				}
+			}
+
+			// PUSH
+			if (tc_max < s.h)
+				stack[s.scale] = s.parent;
+			s.h = tc_max;
+
+			s.parent = s.cur & 0x3fffffffu;
+
+			s.idx = 0u;
+			--s.scale;
+			s.scale_exp2 = half_scale_exp2;
+			if (t_center.x > s.t_min)
+				s.idx ^= 1u, s.pos.x += s.scale_exp2;
+			if (t_center.y > s.t_min)
+				s.idx ^= 2u, s.pos.y += s.scale_exp2;
+			if (t_center.z > s.t_min)
+				s.idx ^= 4u, s.pos.z += s.scale_exp2;
+
+			s.cur = 0;
+
+			continue;
+		}
+
+		// ADVANCE
+		uint32_t step_mask = 0u;
+		if (t_corner.x <= tc_max)
+			step_mask ^= 1u, s.pos.x -= s.scale_exp2;
+		if (t_corner.y <= tc_max)
+			step_mask ^= 2u, s.pos.y -= s.scale_exp2;
+		if (t_corner.z <= tc_max)
+			step_mask ^= 4u, s.pos.z -= s.scale_exp2;
+
+		// Update active t-span and flip bits of the child slot index.
+		s.t_min = tc_max;
+		s.idx ^= step_mask;
+
+		// Proceed with pop if the bit flips disagree with the ray direction.
+		if ((s.idx & step_mask) != 0)
+			s.Pop(step_mask, stack);
+	}
+	return s.IsHit();
+}
+
+void CpuOctreeTracer::get_hit(const glm::vec3 &o, const glm::vec3 &direction, const State &s, Hit *hit) {
+	glm::vec3 d = fix_direction(direction);
+	glm::vec3 pos = s.pos;
+	float scale_exp2 = s.scale_exp2;
+
+	glm::vec3 norm, t_corner = s.t_coef * (pos + scale_exp2) - s.t_bias;
+	if (t_corner.x > t_corner.y && t_corner.x > t_corner.z)
+		norm = glm::vec3(-1, 0, 0);
+	else if (t_corner.y > t_corner.z)
+		norm = glm::vec3(0, -1, 0);
+	else
+		norm = glm::vec3(0, 0, -1);
+
+	if ((s.oct_mask & 1u) == 0u)
+		norm.x = -norm.x;
+	if ((s.oct_mask & 2u) == 0u)
+		norm.y = -norm.y;
+	if ((s.oct_mask & 4u) == 0u)
+		norm.z = -norm.z;
+
+	// Undo mirroring of the coordinate system.
+	if ((s.oct_mask & 1u) != 0u)
+		pos.x = 3.0f - scale_exp2 - pos.x;
+	if ((s.oct_mask & 2u) != 0u)
+		pos.y = 3.0f - scale_exp2 - pos.y;
+	if ((s.oct_mask & 4u) != 0u)
+		pos.z = 3.0f - scale_exp2 - pos.z;
+
+	// Output results.
+	hit->position = glm::clamp(o + s.t_min * d, pos, pos + scale_exp2);
+	if (norm.x != 0)
+		hit->position.x = norm.x > 0 ? pos.x + scale_exp2 + kEps * 2 : pos.x - kEps;
+	if (norm.y != 0)
+		hit->position.y = norm.y > 0 ? pos.y + scale_exp2 + kEps * 2 : pos.y - kEps;
+	if (norm.z != 0)
+		hit->position.z = norm.z > 0 ? pos.z + scale_exp2 + kEps * 2 : pos.z - kEps;
+	hit->normal = norm;
+	hit->color = glm::vec3(s.cur & 0xffu, (s.cur >> 8u) & 0xffu, (s.cur >> 16u) & 0xffu) *
+	             0.00392156862745098f; // (...) / 255.0f
+	hit->iteration = s.iteration;
+}
+
+bool CpuOctreeTracer::RayMarchLeaf(const glm::vec3 &o, const glm::vec3 &d, Hit *hit) const {
+	State state;
+	bool result = march<false>(o, d, 0.0f, 0.0f, &state);
+	get_hit(o, d, state, hit);
+	return result;
+}
+
+bool CpuOctreeTracer::RayMarchOcclude(const glm::vec3 &o, const glm::vec3 &d) const {
+	State state;
+	return march<false>(o, d, 0.0f, 0.0f, &state);
+}
+
+bool CpuOctreeTracer::RayMarchCoarse(const glm::vec3 &o, const glm::vec3 &d, float orig_sz, float dir_sz, float *t,
+                                     float *size) const {
+	State state;
+	bool result = march<true>(o, d, orig_sz, dir_sz, &state);
+	*t = state.t_min;
+	*size = state.scale_exp2;
+	return result;
+}
+
+bool CpuOctreeTracer::RayMarchLOD(const glm::vec3 &o, const glm::vec3 &d, float orig_sz, float dir_sz,
+                                  const uint32_t *lod, Hit *hit) const {
+	State state;
+	bool result = march<false>(o, d, orig_sz, dir_sz, &state, lod);
+	get_hit(o, d, state, hit);
+	return result;
+}
+
+#ifdef CPU_OCTREE_TRACER_AVX2
+// SoA state of kPacketSize rays, lane i of every array belongs to ray i
+struct CpuOctreeTracer::Packet {
+	alignas(32) float t_coef[3][kPacketSize], t_bias[3][kPacketSize], pos[3][kPacketSize];
+	alignas(32) float t_min[kPacketSize], t_max[kPacketSize], h[kPacketSize], scale_exp2[kPacketSize];
+	alignas(32) uint32_t oct_mask[kPacketSize], scale[kPacketSize], parent[kPacketSize], cur[kPacketSize],
+	    idx[kPacketSize], iteration[kPacketSize];
+	alignas(32) uint32_t stack[kStackSize][kPacketSize]; // lane-interleaved, so that the POP reads are one gather
+
+	void SetLane(uint32_t lane, const State &s) {
+		for (uint32_t c = 0; c < 3; ++c) {
+			t_coef[c][lane] = s.t_coef[c];
+			t_bias[c][lane] = s.t_bias[c];
+			pos[c][lane] = s.pos[c];
+		}
+		t_min[lane] = s.t_min, t_max[lane] = s.t_max, h[lane] = s.h, scale_exp2[lane] = s.scale_exp2;
+		oct_mask[lane] = s.oct_mask, scale[lane] = s.scale, parent[lane] = s.parent, cur[lane] = s.cur;
+		idx[lane] = s.idx, iteration[lane] = s.iteration;
+	}
+	State GetLane(uint32_t lane) const {
+		State s;
+		for (uint32_t c = 0; c < 3; ++c) {
+			s.t_coef[c] = t_coef[c][lane];
+			s.t_bias[c] = t_bias[c][lane];
+			s.pos[c] = pos[c][lane];
+		}
+		s.t_min = t_min[lane], s.t_max = t_max[lane], s.h = h[lane], s.scale_exp2 = scale_exp2[lane];
+		s.oct_mask = oct_mask[lane], s.scale = scale[lane], s.parent = parent[lane], s.cur = cur[lane];
+		s.idx = idx[lane], s.iteration = iteration[lane];
+		return s;
+	}
+};
+
+CPU_OCTREE_TRACER_AVX2 inline static __m256i lane_mask(uint32_t bits) {
+	return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)bits), _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128)),
+	                          _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128));
+}
+CPU_OCTREE_TRACER_AVX2 inline static uint32_t lane_bits(__m256i mask) {
+	return _mm256_movemask_ps(_mm256_castsi256_ps(mask));
+}
+CPU_OCTREE_TRACER_AVX2 inline static __m256 select(__m256i mask, __m256 a, __m256 b) {
+	return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(mask));
+}
+CPU_OCTREE_TRACER_AVX2 inline static __m256i select(__m256i mask, __m256i a, __m256i b) {
+	return _mm256_blendv_epi8(b, a, mask);
+}
+CPU_OCTREE_TRACER_AVX2 inline static __m256i compare(__m256 mask) { return _mm256_castps_si256(mask); }
+// child slot bits (1, 2, 4) of the axis masks
+CPU_OCTREE_TRACER_AVX2 inline static __m256i slot_bits(__m256i x, __m256i y, __m256i z) {
+	return _mm256_or_si256(
+	    _mm256_or_si256(_mm256_and_si256(x, _mm256_set1_epi32(1)), _mm256_and_si256(y, _mm256_set1_epi32(2))),
+	    _mm256_and_si256(z, _mm256_set1_epi32(4)));
+}
+// per lane findMSB (-1 for 0) of values below 2^31: clearing the bit below the highest one keeps the float conversion
+// from rounding up to the next power of two
+CPU_OCTREE_TRACER_AVX2 inline static __m256i find_msb(__m256i x) {
+	x = _mm256_andnot_si256(_mm256_srli_epi32(x, 1), x);
+	__m256i msb = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(x)), 23),
+	                               _mm256_set1_epi32(127));
+	return select(_mm256_cmpeq_epi32(x, _mm256_setzero_si256()), _mm256_set1_epi32(-1), msb);
+}
+
+// The same state machine as march<false>, one iteration of every active lane per loop, with the branches of a lane
+// turned into blends. Returns the lanes still active as soon as any of them finished, so that the caller can refill
+// it with a new ray.
+CPU_OCTREE_TRACER_AVX2 uint32_t CpuOctreeTracer::march_packet(Packet *packet, uint32_t active) const {
+	Packet &p = *packet;
+	const int *octree = (const int *)m_octree.data();
+
+	const __m256 t_coef_x = _mm256_load_ps(p.t_coef[0]), t_coef_y = _mm256_load_ps(p.t_coef[1]),
+	             t_coef_z = _mm256_load_ps(p.t_coef[2]);
+	const __m256 t_bias_x = _mm256_load_ps(p.t_bias[0]), t_bias_y = _mm256_load_ps(p.t_bias[1]),
+	             t_bias_z = _mm256_load_ps(p.t_bias[2]);
+	const __m256 t_max = _mm256_load_ps(p.t_max);
+	const __m256i oct_mask = _mm256_load_si256((const __m256i *)p.oct_mask);
+	const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi32(1);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	__m256 pos_x = _mm256_load_ps(p.pos[0]), pos_y = _mm256_load_ps(p.pos[1]), pos_z = _mm256_load_ps(p.pos[2]);
+	__m256 t_min = _mm256_load_ps(p.t_min), h = _mm256_load_ps(p.h), scale_exp2 = _mm256_load_ps(p.scale_exp2);
+	__m256i scale = _mm256_load_si256((const __m256i *)p.scale),
+	        parent = _mm256_load_si256((const __m256i *)p.parent), cur = _mm256_load_si256((const __m256i *)p.cur),
+	        idx = _mm256_load_si256((const __m256i *)p.idx),
+	        iteration = _mm256_load_si256((const __m256i *)p.iteration);
+	alignas(32) uint32_t lane_values[2][kPacketSize];
+
+	for (uint32_t finished = 0; !finished;) {
+		const __m256i active_mask = lane_mask(active);
+		iteration = _mm256_add_epi32(iteration, _mm256_and_si256(active_mask, one));
+
+		// fetch the child descriptors of the active lanes that have none cached
+		__m256i fetch = _mm256_and_si256(active_mask, _mm256_cmpeq_epi32(cur, zero));
+		if (lane_bits(fetch))
+			cur = _mm256_mask_i32gather_epi32(cur, octree, _mm256_add_epi32(parent, _mm256_xor_si256(idx, oct_mask)),
+			                                  fetch, 4);
+
+		__m256 t_corner_x = _mm256_sub_ps(_mm256_mul_ps(pos_x, t_coef_x), t_bias_x);
+		__m256 t_corner_y = _mm256_sub_ps(_mm256_mul_ps(pos_y, t_coef_y), t_bias_y);
+		__m256 t_corner_z = _mm256_sub_ps(_mm256_mul_ps(pos_z, t_coef_z), t_bias_z);
+		__m256 tc_max = _mm256_min_ps(t_corner_z, _mm256_min_ps(t_corner_y, t_corner_x));
+
+		__m256i intersect = _mm256_and_si256(_mm256_and_si256(active_mask, _mm256_srai_epi32(cur, 31)),
+		                                     compare(_mm256_cmp_ps(t_min, t_max, _CMP_LE_OQ)));
+		__m256i leaf = _mm256_srai_epi32(_mm256_slli_epi32(cur, 1), 31);
+		__m256i push = _mm256_andnot_si256(leaf, intersect), advance = _mm256_andnot_si256(intersect, active_mask);
+		finished = lane_bits(_mm256_and_si256(intersect, leaf));
+
+		// INTERSECT + PUSH
+		if (lane_bits(push)) {
+			__m256 half_scale_exp2 = _mm256_mul_ps(scale_exp2, _mm256_set1_ps(0.5f));
+			__m256 t_center_x = _mm256_add_ps(_mm256_mul_ps(half_scale_exp2, t_coef_x), t_corner_x);
+			__m256 t_center_y = _mm256_add_ps(_mm256_mul_ps(half_scale_exp2, t_coef_y), t_corner_y);
+			__m256 t_center_z = _mm256_add_ps(_mm256_mul_ps(half_scale_exp2, t_coef_z), t_corner_z);
+
+			// AVX2 has no scatter
+			if (uint32_t store = lane_bits(_mm256_and_si256(push, compare(_mm256_cmp_ps(tc_max, h, _CMP_LT_OQ))))) {
+				_mm256_store_si256((__m256i *)lane_values[0], scale);
+				_mm256_store_si256((__m256i *)lane_values[1], parent);
+				for (; store; store &= store - 1) {
+					uint32_t l = std::countr_zero(store);
+					p.stack[lane_values[0][l]][l] = lane_values[1][l];
+				}
+			}
+			h = select(push, tc_max, h);
+			parent = select(push, _mm256_and_si256(cur, _mm256_set1_epi32(0x3fffffff)), parent);
+			scale = _mm256_sub_epi32(scale, _mm256_and_si256(push, one));
+			scale_exp2 = select(push, half_scale_exp2, scale_exp2);
+
+			__m256i step_x = _mm256_and_si256(push, compare(_mm256_cmp_ps(t_center_x, t_min, _CMP_GT_OQ)));
+			__m256i step_y = _mm256_and_si256(push, compare(_mm256_cmp_ps(t_center_y, t_min, _CMP_GT_OQ)));
+			__m256i step_z = _mm256_and_si256(push, compare(_mm256_cmp_ps(t_center_z, t_min, _CMP_GT_OQ)));
+			pos_x = select(step_x, _mm256_add_ps(pos_x, scale_exp2), pos_x);
+			pos_y = select(step_y, _mm256_add_ps(pos_y, scale_exp2), pos_y);
+			pos_z = select(step_z, _mm256_add_ps(pos_z, scale_exp2), pos_z);
+			idx = select(push, slot_bits(step_x, step_y, step_z), idx);
+			cur = _mm256_andnot_si256(push, cur);
+		}
+
+		// ADVANCE
+		if (!lane_bits(advance)) {
+			active &= ~finished;
+			continue;
+		}
+		__m256i step_x = _mm256_and_si256(advance, compare(_mm256_cmp_ps(t_corner_x, tc_max, _CMP_LE_OQ)));
+		__m256i step_y = _mm256_and_si256(advance, compare(_mm256_cmp_ps(t_corner_y, tc_max, _CMP_LE_OQ)));
+		__m256i step_z = _mm256_and_si256(advance, compare(_mm256_cmp_ps(t_corner_z, tc_max, _CMP_LE_OQ)));
+		pos_x = select(step_x, _mm256_sub_ps(pos_x, scale_exp2), pos_x);
+		pos_y = select(step_y, _mm256_sub_ps(pos_y, scale_exp2), pos_y);
+		pos_z = select(step_z, _mm256_sub_ps(pos_z, scale_exp2), pos_z);
+		t_min = select(advance, tc_max, t_min);
+		__m256i step_mask = slot_bits(step_x, step_y, step_z);
+		idx = _mm256_xor_si256(idx, step_mask);
+
+		// POP, see State::Pop()
+		__m256i pop = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(idx, step_mask), zero), advance);
+		if (lane_bits(pop)) {
+			__m256i bits_x = _mm256_castps_si256(pos_x), bits_y = _mm256_castps_si256(pos_y),
+			        bits_z = _mm256_castps_si256(pos_z);
+			__m256i differing_bits = _mm256_or_si256(
+			    _mm256_or_si256(
+			        _mm256_and_si256(step_x,
+			                         _mm256_xor_si256(bits_x, _mm256_castps_si256(_mm256_add_ps(pos_x, scale_exp2)))),
+			        _mm256_and_si256(step_y,
+			                         _mm256_xor_si256(bits_y, _mm256_castps_si256(_mm256_add_ps(pos_y, scale_exp2))))),
+			    _mm256_and_si256(step_z,
+			                     _mm256_xor_si256(bits_z, _mm256_castps_si256(_mm256_add_ps(pos_z, scale_exp2)))));
+			__m256i pop_scale = find_msb(differing_bits);
+			scale = select(pop, pop_scale, scale);
+			// unsigned pop_scale >= kStackSize: the ray exits the octree
+			__m256i exit = _mm256_and_si256(
+			    pop, _mm256_or_si256(_mm256_cmpgt_epi32(zero, pop_scale),
+			                         _mm256_cmpgt_epi32(pop_scale, _mm256_set1_epi32(kStackSize - 1))));
+			finished |= lane_bits(exit);
+			pop = _mm256_andnot_si256(exit, pop);
+
+			if (lane_bits(pop)) {
+				// exp2f(scale - s_max)
+				__m256i exponent = _mm256_add_epi32(pop_scale, _mm256_set1_epi32(127 - kStackSize));
+				scale_exp2 = select(pop, _mm256_castsi256_ps(_mm256_slli_epi32(exponent, 23)), scale_exp2);
+				parent = _mm256_mask_i32gather_epi32(
+				    parent, (const int *)p.stack, _mm256_add_epi32(_mm256_slli_epi32(pop_scale, 3), lanes), pop, 4);
+
+				// 1 << scale, and the mask of the bits above it
+				__m256i bit = _mm256_sllv_epi32(one, pop_scale);
+				__m256i round_mask = _mm256_sub_epi32(zero, bit);
+				pos_x = select(pop, _mm256_castsi256_ps(_mm256_and_si256(bits_x, round_mask)), pos_x);
+				pos_y = select(pop, _mm256_castsi256_ps(_mm256_and_si256(bits_y, round_mask)), pos_y);
+				pos_z = select(pop, _mm256_castsi256_ps(_mm256_and_si256(bits_z, round_mask)), pos_z);
+				idx = select(pop,
+				             slot_bits(_mm256_cmpeq_epi32(_mm256_and_si256(bits_x, bit), bit),
+				                       _mm256_cmpeq_epi32(_mm256_and_si256(bits_y, bit), bit),
+				                       _mm256_cmpeq_epi32(_mm256_and_si256(bits_z, bit), bit)),
+				             idx);
+
+				h = select(pop, _mm256_setzero_ps(), h);
+				cur = _mm256_andnot_si256(pop, cur);
+			}
+		}
+		active &= ~finished;
+	}
+
+	_mm256_store_ps(p.pos[0], pos_x), _mm256_store_ps(p.pos[1], pos_y), _mm256_store_ps(p.pos[2], pos_z);
+	_mm256_store_ps(p.t_min, t_min), _mm256_store_ps(p.h, h), _mm256_store_ps(p.scale_exp2, scale_exp2);
+	_mm256_store_si256((__m256i *)p.scale, scale), _mm256_store_si256((__m256i *)p.parent, parent);
+	_mm256_store_si256((__m256i *)p.cur, cur), _mm256_store_si256((__m256i *)p.idx, idx);
+	_mm256_store_si256((__m256i *)p.iteration, iteration);
+	return active;
+}
+
+template <typename RayFunc>
+void CpuOctreeTracer::for_each_packet(const glm::vec3 *origins, const glm::vec3 *directions, size_t count,
+                                      const RayFunc &ray_func) const {
+	m_thread_pool->ParallelFor(count, kRayGrain, [&](size_t begin, size_t end) {
+		Packet packet{}; // unused lanes keep a valid (zero) parent
+		size_t lane_rays[kPacketSize];
+		uint32_t active = 0;
+		for (;;) {
+			// (re)fill the free lanes, a lane that finished early does not idle until the rest of the packet is done
+			for (uint32_t l = 0; l < kPacketSize && begin < end; ++l) {
+				if (active >> l & 1u)
+					continue;
+				State state;
+				state.Init(origins[begin], directions[begin]);
+				packet.SetLane(l, state);
+				lane_rays[l] = begin++;
+				active |= 1u << l;
+			}
+			if (!active)
+				break;
+			uint32_t finished = active & ~march_packet(&packet, active);
+			active &= ~finished;
+			for (uint32_t bits = finished; bits; bits &= bits - 1) {
+				uint32_t l = std::countr_zero(bits);
+				ray_func(lane_rays[l], packet.GetLane(l));
+			}
+		}
+	});
+}
+
+bool CpuOctreeTracer::use_packets() const {
+	static const bool kAVX2 = __builtin_cpu_supports("avx2");
+	return kAVX2 && !m_compact;
+}
+#endif
+
+void CpuOctreeTracer::RayMarchLeaf(const glm::vec3 *origins, const glm::vec3 *directions, size_t count, Hit *hits,
+                                   bool *results) const {
+#ifdef CPU_OCTREE_TRACER_AVX2
+	if (use_packets()) {
+		for_each_packet(origins, directions, count, [&](size_t i, const State &state) {
+			get_hit(origins[i], directions[i], state, hits + i);
+			results[i] = state.IsHit();
+		});
+		return;
+	}
+#endif
+	m_thread_pool->ParallelFor(count, kRayGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			results[i] = RayMarchLeaf(origins[i], directions[i], hits + i);
+	});
+}
+
+void CpuOctreeTracer::RayMarchOcclude(const glm::vec3 *origins, const glm::vec3 *directions, size_t count,
+                                      bool *results) const {
+#ifdef CPU_OCTREE_TRACER_AVX2
+	if (use_packets()) {
+		for_each_packet(origins, directions, count,
+		                [&](size_t i, const State &state) { results[i] = state.IsHit(); });
+		return;
+	}
+#endif
+	m_thread_pool->ParallelFor(count, kRayGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			results[i] = RayMarchOcclude(origins[i], directions[i]);
+	});
+}
@@ -0,0 +1,75 @@
+#ifndef CPU_OCTREE_TRACER_HPP
+#define CPU_OCTREE_TRACER_HPP
+
+#include "ThreadPool.hpp"
+
+#include <bit>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+// CPU port of the ESVO traversal in shader/octree.glsl over the same uOctree words (e.g. CpuOctreeBuilder::GetOctree()
+// or a buffer read back from the GPU). As in the shaders, the octree occupies [1, 2]^3.
+// The single-ray functions follow the GLSL statement by statement and serve as the reference. The batch functions split
+// the rays into chunks on the thread pool and trace each chunk in 8-wide AVX2 packets (the same float operations, so
+// the same hits) where the CPU has AVX2, otherwise with the single-ray functions. The compact encoding always takes
+// the single-ray path.
+// With compact = true the words are in the child-mask encoding of CompactOctree.
+class CpuOctreeTracer {
+public:
+	struct Hit {
+		glm::vec3 position, color, normal;
+		uint32_t iteration; // loop iterations of the traversal, like the o_iter output of Octree_RayMarchLeaf
+	};
+
+private:
+	std::shared_ptr<ThreadPool> m_thread_pool;
+	std::vector<uint32_t> m_octree;
+	bool m_compact{};
+
+	struct State;
+	// kCoarse stops at any node of the footprint size, lod (OctreeLOD words) at the ones that are full enough
+	template <bool kCoarse>
+	bool march(const glm::vec3 &o, const glm::vec3 &d, float orig_sz, float dir_sz, State *state,
+	           const uint32_t *lod = nullptr) const;
+	uint32_t fetch_child(uint32_t parent, uint32_t slot) const {
+		if (!m_compact)
+			return m_octree[parent + slot];
+		uint32_t mask = m_octree[parent];
+		return (mask >> slot & 1u) ? m_octree[parent + 1 + std::popcount(mask & ((1u << slot) - 1u))] : 0u;
+	}
+	static void get_hit(const glm::vec3 &o, const glm::vec3 &d, const State &state, Hit *hit);
+
+	// 8-wide AVX2 packets of the batch functions
+	static constexpr uint32_t kPacketSize = 8;
+	struct Packet;
+	uint32_t march_packet(Packet *packet, uint32_t active) const;
+	template <typename RayFunc>
+	void for_each_packet(const glm::vec3 *origins, const glm::vec3 *directions, size_t count,
+	                     const RayFunc &ray_func) const;
+	bool use_packets() const;
+
+public:
+	static std::shared_ptr<CpuOctreeTracer> Create(const std::shared_ptr<ThreadPool> &thread_pool,
+	                                               std::vector<uint32_t> octree, bool compact = false);
+
+	const std::vector<uint32_t> &GetOctree() const { return m_octree; }
+
+	// Octree_RayMarchLeaf
+	bool RayMarchLeaf(const glm::vec3 &o, const glm::vec3 &d, Hit *hit) const;
+	// Octree_RayMarchOcclude
+	bool RayMarchOcclude(const glm::vec3 &o, const glm::vec3 &d) const;
+	// Octree_RayMarchCoarse
+	bool RayMarchCoarse(const glm::vec3 &o, const glm::vec3 &d, float orig_sz, float dir_sz, float *t,
+	                    float *size) const;
+	// Octree_RayMarchLOD, lod are the OctreeLOD words of the octree (not of a compact one)
+	bool RayMarchLOD(const glm::vec3 &o, const glm::vec3 &d, float orig_sz, float dir_sz, const uint32_t *lod,
+	                 Hit *hit) const;
+
+	// results[i] tells whether ray i hit, hits[i] is filled either way (like the out parameters of the shader)
+	void RayMarchLeaf(const glm::vec3 *origins, const glm::vec3 *directions, size_t count, Hit *hits,
+	                  bool *results) const;
+	void RayMarchOcclude(const glm::vec3 *origins, const glm::vec3 *directions, size_t count, bool *results) const;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "CpuRayQuery.hpp"
+
+#include <memory>
+
+std::shared_ptr<CpuRayQuery> CpuRayQuery::Create(const std::shared_ptr<ThreadPool> &thread_pool,
+                                                 std::vector<uint32_t> octree) {
+	std::shared_ptr<CpuRayQuery> ret = std::make_shared<CpuRayQuery>();
+	ret->m_tracer = CpuOctreeTracer::Create(thread_pool, std::move(octree));
+	return ret;
+}
+
+void CpuRayQuery::Intersect(const glm::vec3 *origins, const glm::vec3 *directions, size_t count,
+                            RayQueryHit *hits) const {
+	std::vector<CpuOctreeTracer::Hit> tracer_hits(count);
+	std::unique_ptr<bool[]> results{new bool[count]};
+	m_tracer->RayMarchLeaf(origins, directions, count, tracer_hits.data(), results.get());
+
+	for (size_t i = 0; i < count; ++i) {
+		const CpuOctreeTracer::Hit &src = tracer_hits[i];
+		RayQueryHit &dst = hits[i];
+		if (results[i]) {
+			const glm::vec3 &o = origins[i], &d = directions[i];
+			dst = {src.position, glm::dot(src.position - o, d) / glm::dot(d, d), src.color, 1, src.normal,
+			       src.iteration};
+		} else
+			dst = {glm::vec3(0), 0.0f, glm::vec3(0), 0, glm::vec3(0), src.iteration};
+	}
+}
+
+void CpuRayQuery::Occlude(const glm::vec3 *origins, const glm::vec3 *directions, size_t count,
+                          uint32_t *occluded) const {
+	std::unique_ptr<bool[]> results{new bool[count]};
+	m_tracer->RayMarchOcclude(origins, directions, count, results.get());
+	for (size_t i = 0; i < count; ++i)
+		occluded[i] = results[i];
+}
@@ -0,0 +1,24 @@
+#ifndef CPU_RAY_QUERY_HPP
+#define CPU_RAY_QUERY_HPP
+
+#include "CpuOctreeTracer.hpp"
+#include "RayQuery.hpp"
+
+// Batch line-of-sight / visibility queries on the CPU, same interface as GpuRayQuery.
+// Rays are given in octree space ([1, 2]^3), directions need not be normalized.
+class CpuRayQuery {
+private:
+	std::shared_ptr<CpuOctreeTracer> m_tracer;
+
+public:
+	static std::shared_ptr<CpuRayQuery> Create(const std::shared_ptr<ThreadPool> &thread_pool,
+	                                           std::vector<uint32_t> octree);
+
+	const std::shared_ptr<CpuOctreeTracer> &GetTracerPtr() const { return m_tracer; }
+
+	void Intersect(const glm::vec3 *origins, const glm::vec3 *directions, size_t count, RayQueryHit *hits) const;
+	// occluded[i] is 1 when ray i hits any voxel
+	void Occlude(const glm::vec3 *origins, const glm::vec3 *directions, size_t count, uint32_t *occluded) const;
+};
+
+#endif
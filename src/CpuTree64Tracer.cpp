@@ -0,0 +1,234 @@
+#include "CpuTree64Tracer.hpp"
+
+#include <algorithm>
+#include <bit>
+
+constexpr uint32_t kStackSize = 23;
+constexpr float kEps = 3.552713678800501e-15f;
+constexpr size_t kRayGrain = 1024;
+// cells 0, 1, 4, 5, 16, 17, 20 and 21: the 2x2x2 group of cells of octant 0
+constexpr uint64_t kGroupMask = 0x330033u;
+
+inline static uint32_t float_bits(float x) { return std::bit_cast<uint32_t>(x); }
+inline static float bits_float(uint32_t x) { return std::bit_cast<float>(x); }
+// GLSL findMSB, 0xffffffff for 0
+inline static uint32_t find_msb(uint32_t x) { return 31u - (uint32_t)std::countl_zero(x); }
+// GLSL min(x, y) is y < x ? y : x
+inline static float min_f(float x, float y) { return y < x ? y : x; }
+inline static float max_f(float x, float y) { return x < y ? y : x; }
+// first cell of the 2x2x2 group of octant g
+inline static uint32_t group_cell(uint32_t g) {
+	return (g & 1u) * 2u + ((g >> 1u) & 1u) * 8u + ((g >> 2u) & 1u) * 32u;
+}
+
+std::shared_ptr<CpuTree64Tracer> CpuTree64Tracer::Create(const std::shared_ptr<ThreadPool> &thread_pool,
+                                                         std::vector<uint32_t> words) {
+	std::shared_ptr<CpuTree64Tracer> ret = std::make_shared<CpuTree64Tracer>();
+	ret->m_thread_pool = thread_pool;
+	ret->m_words = std::move(words);
+	return ret;
+}
+
+uint32_t CpuTree64Tracer::fetch_child(uint32_t node, uint32_t scale, uint32_t group, uint32_t slot) const {
+	uint64_t mask = m_words[node] | (uint64_t)m_words[node + 1] << 32u;
+	uint32_t child = m_words[node + 2], cell = group_cell(slot);
+	if ((scale & 1u) == 0u) {
+		// the octree node is the whole 64-tree node, the slot is a 2x2x2 group of its cells
+		if ((mask >> cell & kGroupMask) == 0u)
+			return 0u;
+		if ((child & 0x40000000u) == 0u) // the cells of the group are on the next octree level
+			return 0x80000000u | node;
+	} else {
+		// the octree node is the group of the 64-tree node, the slot is one of its cells
+		cell = group_cell(group) + (slot & 1u) + ((slot >> 1u) & 1u) * 4u + ((slot >> 2u) & 1u) * 16u;
+		if ((mask >> cell & 1u) == 0u)
+			return 0u;
+	}
+	uint32_t rank = std::popcount(mask & ((1ull << cell) - 1u));
+	return (child & 0x80000000u) ? m_words[(child & 0x3fffffffu) + rank]
+	                             : 0x80000000u | ((child & 0x3fffffffu) + rank * 3u);
+}
+
+template <bool kLeaf> bool CpuTree64Tracer::march(const glm::vec3 &o, glm::vec3 d, Hit *hit) const {
+	d.x = std::abs(d.x) >= kEps ? d.x : (d.x >= 0 ? kEps : -kEps);
+	d.y = std::abs(d.y) >= kEps ? d.y : (d.y >= 0 ? kEps : -kEps);
+	d.z = std::abs(d.z) >= kEps ? d.z : (d.z >= 0 ? kEps : -kEps);
+
+	// Precompute the coefficients of tx(x), ty(y), and tz(z).
+	// The octree is assumed to reside at coordinates [1, 2].
+	glm::vec3 t_coef = 1.0f / -glm::abs(d);
+	glm::vec3 t_bias = t_coef * o;
+
+	uint32_t oct_mask = 0u;
+	if (d.x > 0.0f)
+		oct_mask ^= 1u, t_bias.x = 3.0f * t_coef.x - t_bias.x;
+	if (d.y > 0.0f)
+		oct_mask ^= 2u, t_bias.y = 3.0f * t_coef.y - t_bias.y;
+	if (d.z > 0.0f)
+		oct_mask ^= 4u, t_bias.z = 3.0f * t_coef.z - t_bias.z;
+
+	// Initialize the active span of t-values.
+	float t_min = max_f(max_f(2.0f * t_coef.x - t_bias.x, 2.0f * t_coef.y - t_bias.y), 2.0f * t_coef.z - t_bias.z);
+	float t_max = min_f(min_f(t_coef.x - t_bias.x, t_coef.y - t_bias.y), t_coef.z - t_bias.z);
+	t_min = max_f(t_min, 0.0f);
+	float h = t_max;
+
+	uint32_t parent = 0u, cur = 0u, idx = 0u, iteration = 0u;
+	glm::vec3 pos = glm::vec3(1.0f);
+	if (1.5f * t_coef.x - t_bias.x > t_min)
+		idx ^= 1u, pos.x = 1.5f;
+	if (1.5f * t_coef.y - t_bias.y > t_min)
+		idx ^= 2u, pos.y = 1.5f;
+	if (1.5f * t_coef.z - t_bias.z > t_min)
+		idx ^= 4u, pos.z = 1.5f;
+
+	uint32_t scale = kStackSize - 1;
+	float scale_exp2 = 0.5f; // exp2( scale - STACK_SIZE )
+	uint32_t stack[kStackSize];
+
+	while (scale < kStackSize) {
+		++iteration;
+		if (cur == 0u) {
+			// octant of the 64-tree node that holds the node of an odd level, the position bits one level up
+			uint32_t group = ((float_bits(pos.x) >> (scale + 1u)) & 1u) |
+			                 ((float_bits(pos.y) >> (scale + 1u)) & 1u) << 1u |
+			                 ((float_bits(pos.z) >> (scale + 1u)) & 1u) << 2u;
+			cur = fetch_child(parent, scale, group ^ oct_mask, idx ^ oct_mask);
+		}
+		// Determine maximum t-value of the cube by evaluating
+		// tx(), ty(), and tz() at its corner.
+
+		glm::vec3 t_corner = pos * t_coef - t_bias;
+		float tc_max = min_f(min_f(t_corner.x, t_corner.y), t_corner.z);
+
+		if ((cur & 0x80000000u) != 0 && t_min <= t_max) {
+			// INTERSECT
+			float half_scale_exp2 = scale_exp2 * 0.5f;
+			glm::vec3 t_center = half_scale_exp2 * t_coef + t_corner;
+
+			if ((cur & 0x40000000u) != 0) // leaf node
+				break;
+
+			// PUSH
+			if (tc_max < h)
+				stack[scale] = parent;
+			h = tc_max;
+
+			parent = cur & 0x3fffffffu;
+
+			idx = 0u;
+			--scale;
+			scale_exp2 = half_scale_exp2;
+			if (t_center.x > t_min)
+				idx ^= 1u, pos.x += scale_exp2;
+			if (t_center.y > t_min)
+				idx ^= 2u, pos.y += scale_exp2;
+			if (t_center.z > t_min)
+				idx ^= 4u, pos.z += scale_exp2;
+
+			cur = 0;
+
+			continue;
+		}
+
+		// ADVANCE
+		uint32_t step_mask = 0u;
+		if (t_corner.x <= tc_max)
+			step_mask ^= 1u, pos.x -= scale_exp2;
+		if (t_corner.y <= tc_max)
+			step_mask ^= 2u, pos.y -= scale_exp2;
+		if (t_corner.z <= tc_max)
+			step_mask ^= 4u, pos.z -= scale_exp2;
+
+		// Update active t-span and flip bits of the child slot index.
+		t_min = tc_max;
+		idx ^= step_mask;
+
+		// Proceed with pop if the bit flips disagree with the ray direction.
+		if ((idx & step_mask) != 0) {
+			// POP
+			// Find the highest differing bit between the two positions.
+			uint32_t differing_bits = 0;
+			if ((step_mask & 1u) != 0)
+				differing_bits |= float_bits(pos.x) ^ float_bits(pos.x + scale_exp2);
+			if ((step_mask & 2u) != 0)
+				differing_bits |= float_bits(pos.y) ^ float_bits(pos.y + scale_exp2);
+			if ((step_mask & 4u) != 0)
+				differing_bits |= float_bits(pos.z) ^ float_bits(pos.z + scale_exp2);
+			scale = find_msb(differing_bits);
+			if (scale >= kStackSize)
+				break;
+			scale_exp2 = bits_float((scale - kStackSize + 127u) << 23u); // exp2f(scale - s_max)
+
+			// Restore parent voxel from the stack.
+			parent = stack[scale];
+
+			// Round cube position and extract child slot index.
+			uint32_t shx = float_bits(pos.x) >> scale;
+			uint32_t shy = float_bits(pos.y) >> scale;
+			uint32_t shz = float_bits(pos.z) >> scale;
+			pos.x = bits_float(shx << scale);
+			pos.y = bits_float(shy << scale);
+			pos.z = bits_float(shz << scale);
+			idx = (shx & 1u) | ((shy & 1u) << 1u) | ((shz & 1u) << 2u);
+
+			// Prevent same parent from being stored again and invalidate cached
+			// child descriptor.
+			h = 0.0f;
+			cur = 0;
+		}
+	}
+	if constexpr (kLeaf) {
+		glm::vec3 norm, t_corner = t_coef * (pos + scale_exp2) - t_bias;
+		if (t_corner.x > t_corner.y && t_corner.x > t_corner.z)
+			norm = glm::vec3(-1, 0, 0);
+		else if (t_corner.y > t_corner.z)
+			norm = glm::vec3(0, -1, 0);
+		else
+			norm = glm::vec3(0, 0, -1);
+		if ((oct_mask & 1u) == 0u)
+			norm.x = -norm.x;
+		if ((oct_mask & 2u) == 0u)
+			norm.y = -norm.y;
+		if ((oct_mask & 4u) == 0u)
+			norm.z = -norm.z;
+
+		// Undo mirroring of the coordinate system.
+		if ((oct_mask & 1u) != 0u)
+			pos.x = 3.0f - scale_exp2 - pos.x;
+		if ((oct_mask & 2u) != 0u)
+			pos.y = 3.0f - scale_exp2 - pos.y;
+		if ((oct_mask & 4u) != 0u)
+			pos.z = 3.0f - scale_exp2 - pos.z;
+
+		// Output results.
+		hit->position = glm::clamp(o + t_min * d, pos, pos + scale_exp2);
+		if (norm.x != 0)
+			hit->position.x = norm.x > 0 ? pos.x + scale_exp2 + kEps * 2 : pos.x - kEps;
+		if (norm.y != 0)
+			hit->position.y = norm.y > 0 ? pos.y + scale_exp2 + kEps * 2 : pos.y - kEps;
+		if (norm.z != 0)
+			hit->position.z = norm.z > 0 ? pos.z + scale_exp2 + kEps * 2 : pos.z - kEps;
+		hit->normal = norm;
+		hit->color = glm::vec3(cur & 0xffu, (cur >> 8u) & 0xffu, (cur >> 16u) & 0xffu) *
+		             0.00392156862745098f; // (...) / 255.0f
+		hit->iteration = iteration;
+	}
+	return scale < kStackSize && t_min <= t_max;
+}
+
+bool CpuTree64Tracer::RayMarchLeaf(const glm::vec3 &o, const glm::vec3 &d, Hit *hit) const {
+	return march<true>(o, d, hit);
+}
+
+bool CpuTree64Tracer::RayMarchOcclude(const glm::vec3 &o, const glm::vec3 &d) const {
+	return march<false>(o, d, nullptr);
+}
+
+void CpuTree64Tracer::RayMarchLeaf(const glm::vec3 *origins, const glm::vec3 *directions, size_t count, Hit *hits,
+                                   bool *results) const {
+	m_thread_pool->ParallelFor(count, kRayGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			results[i] = march<true>(origins[i], directions[i], hits + i);
+	});
+}
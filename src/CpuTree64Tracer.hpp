@@ -0,0 +1,41 @@
+#ifndef CPU_TREE64_TRACER_HPP
+#define CPU_TREE64_TRACER_HPP
+
+#include "CpuOctreeTracer.hpp"
+#include "ThreadPool.hpp"
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+// CPU port of shader/tree64.glsl over the words of a Tree64, the reference for the GLSL path and the CPU side of the
+// octree / 64-tree comparison in CpuOctreeTracerBench. The traversal is the ESVO loop of CpuOctreeTracer with every
+// 64-tree node standing in for two octree levels, so the results match CpuOctreeTracer bit for bit.
+class CpuTree64Tracer {
+public:
+	using Hit = CpuOctreeTracer::Hit;
+
+private:
+	std::shared_ptr<ThreadPool> m_thread_pool;
+	std::vector<uint32_t> m_words;
+
+	template <bool kLeaf> bool march(const glm::vec3 &o, glm::vec3 d, Hit *hit) const;
+	// the slot word of the octree node at scale (as in octree.glsl) below 64-tree node: a leaf word, 0 or a pointer to
+	// the 64-tree node holding the child's slots. The node of an odd scale is the octant group of node
+	uint32_t fetch_child(uint32_t node, uint32_t scale, uint32_t group, uint32_t slot) const;
+
+public:
+	static std::shared_ptr<CpuTree64Tracer> Create(const std::shared_ptr<ThreadPool> &thread_pool,
+	                                               std::vector<uint32_t> words);
+
+	// Tree64_RayMarchLeaf
+	bool RayMarchLeaf(const glm::vec3 &o, const glm::vec3 &d, Hit *hit) const;
+	// Tree64_RayMarchOcclude
+	bool RayMarchOcclude(const glm::vec3 &o, const glm::vec3 &d) const;
+
+	// results[i] tells whether ray i hit, hits[i] is only filled for hits
+	void RayMarchLeaf(const glm::vec3 *origins, const glm::vec3 *directions, size_t count, Hit *hits,
+	                  bool *results) const;
+};
+
+#endif
@@ -0,0 +1,274 @@
+#include "Denoiser.hpp"
+#include "ThreadPool.hpp"
+
+#include <cmath>
+#include <glm/glm.hpp>
+#include <spdlog/spdlog.h>
+
+inline static constexpr uint32_t group_8(uint32_t x) { return (x >> 3u) + ((x & 0x7u) ? 1u : 0u); }
+
+// push constants of denoise_atrous.comp
+struct DenoisePushConstants {
+	int32_t step;
+	float sigma_color, sigma_normal, sigma_albedo;
+	uint32_t first, last;
+};
+
+std::shared_ptr<Denoiser> Denoiser::Create(const std::shared_ptr<PathTracer> &path_tracer) {
+	std::shared_ptr<Denoiser> ret = std::make_shared<Denoiser>();
+	ret->m_path_tracer_ptr = path_tracer;
+
+	const std::shared_ptr<myvk::Device> &device = path_tracer->GetTargetDescriptorSetLayout()->GetDevicePtr();
+	ret->create_descriptors(device);
+	ret->create_pipeline(device);
+	return ret;
+}
+
+void Denoiser::create_descriptors(const std::shared_ptr<myvk::Device> &device) {
+	m_descriptor_pool = myvk::DescriptorPool::Create(device, 3, {{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 8}});
+	{
+		// input and output
+		std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+		for (uint32_t i = 0; i < bindings.size(); ++i) {
+			bindings[i] = {};
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+		m_descriptor_set_layout = myvk::DescriptorSetLayout::Create(device, bindings);
+	}
+	for (auto &descriptor_set : m_descriptor_sets)
+		descriptor_set = myvk::DescriptorSet::Create(m_descriptor_pool, m_descriptor_set_layout);
+	m_target_descriptor_set =
+	    myvk::DescriptorSet::Create(m_descriptor_pool, m_path_tracer_ptr->GetTargetDescriptorSetLayout());
+}
+
+void Denoiser::create_pipeline(const std::shared_ptr<myvk::Device> &device) {
+#ifdef SHADER_HAS_DENOISE_ATROUS_COMP
+	m_pipeline_layout = myvk::PipelineLayout::Create(
+	    device, {m_path_tracer_ptr->GetTargetDescriptorSetLayout(), m_descriptor_set_layout},
+	    {{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DenoisePushConstants)}});
+	{
+		constexpr uint32_t kDenoiseAtrousCompSpv[] = {
+#include "spirv/denoise_atrous.comp.u32"
+		};
+		std::shared_ptr<myvk::ShaderModule> denoise_shader_module =
+		    myvk::ShaderModule::Create(device, kDenoiseAtrousCompSpv, sizeof(kDenoiseAtrousCompSpv));
+		m_pipeline = myvk::ComputePipeline::Create(m_pipeline_layout, denoise_shader_module);
+	}
+#else
+	spdlog::warn("Denoiser: denoise_atrous.comp was left out (no glslc, stale SPIR-V), using the CPU");
+#endif
+}
+
+void Denoiser::Reset(const std::shared_ptr<myvk::CommandPool> &command_pool,
+                     const std::shared_ptr<myvk::Queue> &shared_queue) {
+	if (!IsGPUSupported())
+		return;
+
+	const std::shared_ptr<myvk::Device> &device = command_pool->GetDevicePtr();
+	for (uint32_t i = 0; i < 2; ++i) {
+		m_images[i] = myvk::Image::CreateTexture2D(
+		    device, {m_path_tracer_ptr->m_width, m_path_tracer_ptr->m_height}, 1, VK_FORMAT_R32G32B32A32_SFLOAT,
+		    VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+		    {command_pool->GetQueuePtr(), shared_queue});
+		m_image_views[i] = myvk::ImageView::Create(m_images[i], VK_IMAGE_VIEW_TYPE_2D);
+	}
+	for (uint32_t i = 0; i < 2; ++i) {
+		m_descriptor_sets[i]->UpdateStorageImage(m_image_views[i], 0);
+		m_descriptor_sets[i]->UpdateStorageImage(m_image_views[i ^ 1], 1);
+	}
+	m_target_descriptor_set->UpdateStorageImage(m_image_views[0], 0);
+	m_target_descriptor_set->UpdateStorageImage(m_path_tracer_ptr->GetAlbedoImageView(), 1);
+	m_target_descriptor_set->UpdateStorageImage(m_path_tracer_ptr->GetNormalImageView(), 2);
+	m_target_descriptor_set->UpdateStorageImage(m_path_tracer_ptr->GetStatisticsImageView(), 3);
+
+	std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(command_pool);
+	std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
+	command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	command_buffer->CmdPipelineBarrier(
+	    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, {}, {},
+	    {m_images[0]->GetMemoryBarrier(VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+	                                   VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL),
+	     m_images[1]->GetMemoryBarrier(VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+	                                   VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)});
+	command_buffer->CmdClearColorImage(m_images[0], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	command_buffer->CmdClearColorImage(m_images[1], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	command_buffer->CmdPipelineBarrier(
+	    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, {}, {},
+	    {m_images[0]->GetMemoryBarrier(VK_IMAGE_ASPECT_COLOR_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, 0,
+	                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL),
+	     m_images[1]->GetMemoryBarrier(VK_IMAGE_ASPECT_COLOR_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, 0,
+	                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL)});
+	command_buffer->End();
+
+	command_buffer->Submit(fence);
+	fence->Wait();
+}
+
+void Denoiser::CmdDenoise(const std::shared_ptr<myvk::CommandBuffer> &command_buffer) const {
+	const uint32_t kWidth = m_path_tracer_ptr->m_width, kHeight = m_path_tracer_ptr->m_height;
+
+	VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	command_buffer->CmdPipelineBarrier(
+	    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+	    VK_PIPELINE_STAGE_TRANSFER_BIT, {barrier}, {}, {});
+
+	VkImageCopy region = {};
+	region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	region.extent = {kWidth, kHeight, 1};
+	command_buffer->CmdCopy(m_path_tracer_ptr->GetColorImage(), m_images[0], {region}, VK_IMAGE_LAYOUT_GENERAL,
+	                        VK_IMAGE_LAYOUT_GENERAL);
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+	                                   {barrier}, {}, {});
+
+	command_buffer->CmdBindPipeline(m_pipeline);
+	const uint32_t kIterations = std::max(m_iterations, 1u);
+	for (uint32_t i = 0; i < kIterations; ++i) {
+		command_buffer->CmdBindDescriptorSets({m_path_tracer_ptr->GetTargetDescriptorSet(), m_descriptor_sets[i & 1u]},
+		                                      m_pipeline);
+		DenoisePushConstants push_constants = {1 << i,
+		                                       m_sigma_color * m_sigma_color / float(1u << i),
+		                                       m_sigma_normal,
+		                                       m_sigma_albedo * m_sigma_albedo,
+		                                       i == 0,
+		                                       i + 1 == kIterations};
+		command_buffer->CmdPushConstants(m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+		                                 sizeof(DenoisePushConstants), &push_constants);
+		command_buffer->CmdDispatch(group_8(kWidth), group_8(kHeight), 1);
+
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                                   {barrier}, {}, {});
+	}
+
+	if (kIterations & 1u) {
+		// odd iterations end in m_images[1]
+		command_buffer->CmdCopy(m_images[1], m_images[0], {region}, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                                   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                                   {barrier}, {}, {});
+	} else {
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		                                   {barrier}, {}, {});
+	}
+}
+
+std::vector<float> Denoiser::ExtractDenoisedImage(const std::shared_ptr<myvk::CommandPool> &command_pool) const {
+	const uint32_t kWidth = m_path_tracer_ptr->m_width, kHeight = m_path_tracer_ptr->m_height;
+	if (!IsGPUSupported()) {
+		std::vector<float> pixels;
+		DenoiseCPU(m_path_tracer_ptr->ExtractColorImage(command_pool),
+		           m_path_tracer_ptr->ExtractAlbedoImage(command_pool),
+		           m_path_tracer_ptr->ExtractNormalImage(command_pool), kWidth, kHeight, &pixels);
+		return pixels;
+	}
+
+	const uint32_t kSize = kWidth * kHeight;
+	std::shared_ptr<myvk::Buffer> staging_buffer =
+	    myvk::Buffer::Create(command_pool->GetDevicePtr(), kSize * 4 * sizeof(float),
+	                         VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+	                         VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+	std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(command_pool);
+	std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(command_pool->GetDevicePtr());
+	command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	CmdDenoise(command_buffer);
+	VkBufferImageCopy region = {};
+	region.imageExtent = {kWidth, kHeight, 1};
+	region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	command_buffer->CmdCopy(m_images[0], staging_buffer, {region}, VK_IMAGE_LAYOUT_GENERAL);
+	command_buffer->End();
+
+	command_buffer->Submit(fence);
+	fence->Wait();
+
+	auto *data = (float *)staging_buffer->GetMappedData();
+	std::vector<float> pixels(kSize * 3);
+	for (uint32_t i = 0; i < kSize; ++i) {
+		pixels[i * 3 + 0] = data[i * 4 + 0];
+		pixels[i * 3 + 1] = data[i * 4 + 1];
+		pixels[i * 3 + 2] = data[i * 4 + 2];
+	}
+	return pixels;
+}
+
+void Denoiser::DenoiseCPU(const std::vector<float> &color, const std::vector<float> &albedo,
+                          const std::vector<float> &normal, uint32_t width, uint32_t height,
+                          std::vector<float> *result) const {
+	constexpr float kKernel[3] = {3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+	const auto load = [](const std::vector<float> &image, uint32_t i) {
+		return glm::vec3{image[i * 3 + 0], image[i * 3 + 1], image[i * 3 + 2]};
+	};
+	const auto demodulator = [](const glm::vec3 &a) {
+		return glm::vec3{a.x < 1e-3f ? 1.0f : a.x, a.y < 1e-3f ? 1.0f : a.y, a.z < 1e-3f ? 1.0f : a.z};
+	};
+
+	const uint32_t kSize = width * height;
+	std::vector<glm::vec3> albedos(kSize), normals(kSize), input(kSize), output(kSize);
+	for (uint32_t i = 0; i < kSize; ++i) {
+		albedos[i] = load(albedo, i);
+		glm::vec3 n = load(normal, i);
+		normals[i] = glm::dot(n, n) > 1e-4f ? glm::normalize(n) : glm::vec3{0.0f};
+		input[i] = load(color, i) / demodulator(albedos[i]);
+	}
+
+	const std::shared_ptr<ThreadPool> &thread_pool = ThreadPool::GetDefault();
+	const uint32_t kIterations = std::max(m_iterations, 1u);
+	for (uint32_t it = 0; it < kIterations; ++it) {
+		const int kStep = 1 << it;
+		const float kSigmaColor = m_sigma_color * m_sigma_color / float(1u << it),
+		            kSigmaAlbedo = m_sigma_albedo * m_sigma_albedo;
+		thread_pool->ParallelFor(height, 16, [&](size_t row_begin, size_t row_end) {
+			for (int y = (int)row_begin; y < (int)row_end; ++y)
+				for (int x = 0; x < (int)width; ++x) {
+					const uint32_t kIndex = y * width + x;
+					const glm::vec3 &c = input[kIndex], &a = albedos[kIndex], &n = normals[kIndex];
+					float color_scale = 1.0f / (kSigmaColor * std::max(glm::dot(c, c), 1e-4f));
+
+					glm::vec3 sum{0.0f};
+					float weight_sum = 0.0f;
+					for (int dy = -2; dy <= 2; ++dy)
+						for (int dx = -2; dx <= 2; ++dx) {
+							int qx = x + dx * kStep, qy = y + dy * kStep;
+							if (qx < 0 || qy < 0 || qx >= (int)width || qy >= (int)height)
+								continue;
+							const uint32_t kQ = qy * width + qx;
+							glm::vec3 dc = c - input[kQ], da = a - albedos[kQ];
+							const glm::vec3 &q_normal = normals[kQ];
+							bool n_zero = n == glm::vec3{0.0f}, q_zero = q_normal == glm::vec3{0.0f};
+							float normal_weight =
+							    n_zero || q_zero ? float(n_zero && q_zero)
+							                     : std::pow(std::max(glm::dot(n, q_normal), 0.0f), m_sigma_normal);
+							float weight = kKernel[std::abs(dx)] * kKernel[std::abs(dy)] * normal_weight *
+							               std::exp(-glm::dot(dc, dc) * color_scale - glm::dot(da, da) / kSigmaAlbedo);
+							sum += input[kQ] * weight;
+							weight_sum += weight;
+						}
+					output[kIndex] = sum / weight_sum;
+				}
+		});
+		std::swap(input, output);
+	}
+
+	result->resize(kSize * 3);
+	for (uint32_t i = 0; i < kSize; ++i) {
+		glm::vec3 c = input[i] * demodulator(albedos[i]);
+		(*result)[i * 3 + 0] = c.x;
+		(*result)[i * 3 + 1] = c.y;
+		(*result)[i * 3 + 2] = c.z;
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef DENOISER_HPP
+#define DENOISER_HPP
+
+#include "PathTracer.hpp"
+#include "myvk/CommandBuffer.hpp"
+#include "myvk/ComputePipeline.hpp"
+#include "myvk/DescriptorSet.hpp"
+#include "myvk/Image.hpp"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+// Edge-avoiding à-trous wavelet filter over the color of a PathTracer, guided by its albedo and normal images.
+// Runs shader/denoise_atrous.comp when it was built, DenoiseCPU is the same filter on the CPU.
+class Denoiser {
+private:
+	std::shared_ptr<PathTracer> m_path_tracer_ptr;
+
+	// ping-pong images, the result always ends up in m_images[0]
+	std::array<std::shared_ptr<myvk::Image>, 2> m_images;
+	std::array<std::shared_ptr<myvk::ImageView>, 2> m_image_views;
+
+	std::shared_ptr<myvk::DescriptorPool> m_descriptor_pool;
+	std::shared_ptr<myvk::DescriptorSetLayout> m_descriptor_set_layout;
+	// {m_images[0] -> m_images[1]}, {m_images[1] -> m_images[0]}
+	std::array<std::shared_ptr<myvk::DescriptorSet>, 2> m_descriptor_sets;
+	// a copy of the target set of the PathTracer with the denoised color at binding 0
+	std::shared_ptr<myvk::DescriptorSet> m_target_descriptor_set;
+
+	std::shared_ptr<myvk::PipelineLayout> m_pipeline_layout;
+	std::shared_ptr<myvk::ComputePipeline> m_pipeline;
+
+	void create_descriptors(const std::shared_ptr<myvk::Device> &device);
+	void create_pipeline(const std::shared_ptr<myvk::Device> &device);
+
+public:
+	uint32_t m_iterations{kDefaultDenoiseIterations};
+	// color: relative color difference, normal: exponent of the normal similarity, albedo: albedo difference
+	float m_sigma_color{kDefaultDenoiseSigmaColor}, m_sigma_normal{kDefaultDenoiseSigmaNormal},
+	    m_sigma_albedo{kDefaultDenoiseSigmaAlbedo};
+
+	static std::shared_ptr<Denoiser> Create(const std::shared_ptr<PathTracer> &path_tracer);
+	const std::shared_ptr<PathTracer> &GetPathTracerPtr() const { return m_path_tracer_ptr; }
+
+	// false if denoise_atrous.comp was not built, only DenoiseCPU is available then
+	bool IsGPUSupported() const { return m_pipeline != nullptr; }
+
+	// after PathTracer::Reset, the images are accessible from the queue of command_pool and shared_queue
+	void Reset(const std::shared_ptr<myvk::CommandPool> &command_pool,
+	           const std::shared_ptr<myvk::Queue> &shared_queue);
+
+	// denoises the current color of the PathTracer into the target set of GetTargetDescriptorSet (GPU only)
+	void CmdDenoise(const std::shared_ptr<myvk::CommandBuffer> &command_buffer) const;
+
+	// same layout as PathTracer::GetTargetDescriptorSet
+	const std::shared_ptr<myvk::DescriptorSet> &GetTargetDescriptorSet() const { return m_target_descriptor_set; }
+
+	// rgb floats like PathTracer::ExtractColorImage, on the GPU if supported
+	std::vector<float> ExtractDenoisedImage(const std::shared_ptr<myvk::CommandPool> &command_pool) const;
+
+	// color, albedo and normal are rgb floats of width * height pixels
+	void DenoiseCPU(const std::vector<float> &color, const std::vector<float> &albedo,
+	                const std::vector<float> &normal, uint32_t width, uint32_t height,
+	                std::vector<float> *result) const;
+};
+
+#endif
@@ -0,0 +1,182 @@
+#include "FragmentDeduplicator.hpp"
+#include "myvk/CommandBuffer.hpp"
+#include "myvk/Fence.hpp"
+#include "myvk/ShaderModule.hpp"
+
+#include <spdlog/spdlog.h>
+
+// fragment_sort.glsl
+constexpr uint32_t kSortBlockSize = 128u * 16u, kSortDigitCount = 16u;
+constexpr uint32_t kMaxBlockCount = 65535u; // minimum maxComputeWorkGroupCount[0] guaranteed by Vulkan
+
+inline static constexpr uint32_t group_x_64(uint32_t x) { return (x >> 6u) + ((x & 0x3fu) ? 1u : 0u); }
+
+struct SortPushConstants {
+	uint32_t fragment_count, shift, block_count;
+};
+
+std::shared_ptr<FragmentDeduplicator> FragmentDeduplicator::Create(const std::shared_ptr<myvk::Device> &device,
+                                                                   uint32_t level) {
+	if (!IsSupported()) {
+		spdlog::error("FragmentDeduplicator: fragment_sort_*.comp and fragment_merge.comp were left out (no glslc, stale "
+		              "SPIR-V)");
+		return nullptr;
+	}
+	std::shared_ptr<FragmentDeduplicator> ret = std::make_shared<FragmentDeduplicator>();
+	ret->m_level = level;
+	ret->m_atomic_counter.Initialize(device);
+	ret->create_descriptors(device);
+	ret->create_pipeline(device);
+	return ret;
+}
+
+void FragmentDeduplicator::create_descriptors(const std::shared_ptr<myvk::Device> &device) {
+	m_descriptor_pool = myvk::DescriptorPool::Create(device, 2, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 8}});
+	{
+		// counter, source list, destination list and histogram
+		std::vector<VkDescriptorSetLayoutBinding> bindings(4);
+		for (uint32_t i = 0; i < bindings.size(); ++i) {
+			bindings[i] = {};
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+		m_descriptor_set_layout = myvk::DescriptorSetLayout::Create(device, bindings);
+	}
+	for (auto &descriptor_set : m_descriptor_sets) {
+		descriptor_set = myvk::DescriptorSet::Create(m_descriptor_pool, m_descriptor_set_layout);
+		descriptor_set->UpdateStorageBuffer(m_atomic_counter.GetBuffer(), 0);
+	}
+}
+
+void FragmentDeduplicator::create_pipeline(const std::shared_ptr<myvk::Device> &device) {
+#if defined(SHADER_HAS_FRAGMENT_SORT_COUNT_COMP) && defined(SHADER_HAS_FRAGMENT_SORT_SCAN_COMP) &&                     \
+    defined(SHADER_HAS_FRAGMENT_SORT_SCATTER_COMP) && defined(SHADER_HAS_FRAGMENT_MERGE_COMP)
+	m_pipeline_layout = myvk::PipelineLayout::Create(device, {m_descriptor_set_layout},
+	                                                 {{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SortPushConstants)}});
+	{
+		constexpr uint32_t kFragmentSortCountCompSpv[] = {
+#include "spirv/fragment_sort_count.comp.u32"
+		};
+		std::shared_ptr<myvk::ShaderModule> shader_module =
+		    myvk::ShaderModule::Create(device, kFragmentSortCountCompSpv, sizeof(kFragmentSortCountCompSpv));
+		m_count_pipeline = myvk::ComputePipeline::Create(m_pipeline_layout, shader_module);
+	}
+	{
+		constexpr uint32_t kFragmentSortScanCompSpv[] = {
+#include "spirv/fragment_sort_scan.comp.u32"
+		};
+		std::shared_ptr<myvk::ShaderModule> shader_module =
+		    myvk::ShaderModule::Create(device, kFragmentSortScanCompSpv, sizeof(kFragmentSortScanCompSpv));
+		m_scan_pipeline = myvk::ComputePipeline::Create(m_pipeline_layout, shader_module);
+	}
+	{
+		constexpr uint32_t kFragmentSortScatterCompSpv[] = {
+#include "spirv/fragment_sort_scatter.comp.u32"
+		};
+		std::shared_ptr<myvk::ShaderModule> shader_module =
+		    myvk::ShaderModule::Create(device, kFragmentSortScatterCompSpv, sizeof(kFragmentSortScatterCompSpv));
+		m_scatter_pipeline = myvk::ComputePipeline::Create(m_pipeline_layout, shader_module);
+	}
+	{
+		constexpr uint32_t kFragmentMergeCompSpv[] = {
+#include "spirv/fragment_merge.comp.u32"
+		};
+		std::shared_ptr<myvk::ShaderModule> shader_module =
+		    myvk::ShaderModule::Create(device, kFragmentMergeCompSpv, sizeof(kFragmentMergeCompSpv));
+		m_merge_pipeline = myvk::ComputePipeline::Create(m_pipeline_layout, shader_module);
+	}
+#endif
+}
+
+std::shared_ptr<myvk::Buffer> FragmentDeduplicator::Deduplicate(const std::shared_ptr<myvk::CommandPool> &command_pool,
+                                                                const std::shared_ptr<myvk::Buffer> &fragment_list,
+                                                                uint32_t fragment_count, uint32_t *merged_count) {
+	uint32_t block_count = (fragment_count + kSortBlockSize - 1u) / kSortBlockSize;
+	if (block_count > kMaxBlockCount) {
+		spdlog::error("FragmentDeduplicator: {} fragments exceed the {} that can be sorted", fragment_count,
+		              kMaxBlockCount * kSortBlockSize);
+		return nullptr;
+	}
+	*merged_count = fragment_count;
+	if (fragment_count == 0)
+		return fragment_list;
+
+	// digits of the key that are not always 0: x, y and the low 8 bits of z in the x word, the rest of z in the top 4
+	// bits of the y word (shift 32)
+	std::vector<uint32_t> shifts;
+	for (uint32_t shift = 0; shift < 32u; shift += 4u) {
+		auto overlaps = [shift](uint32_t begin, uint32_t end) { return shift < end && begin < shift + 4u; };
+		if (overlaps(0u, m_level) || overlaps(12u, 12u + m_level) || overlaps(24u, 24u + std::min(m_level, 8u)))
+			shifts.push_back(shift);
+	}
+	if (m_level > 8u)
+		shifts.push_back(32u);
+
+	std::shared_ptr<myvk::Device> device = command_pool->GetDevicePtr();
+	std::shared_ptr<myvk::Buffer> temp_list =
+	    myvk::Buffer::Create(device, fragment_count * sizeof(uint32_t) * 2, 0,
+	                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	std::shared_ptr<myvk::Buffer> histogram_buffer = myvk::Buffer::Create(
+	    device, kSortDigitCount * block_count * sizeof(uint32_t), 0, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	for (uint32_t i = 0; i < 2; ++i) {
+		m_descriptor_sets[i]->UpdateStorageBuffer(i ? temp_list : fragment_list, 1);
+		m_descriptor_sets[i]->UpdateStorageBuffer(i ? fragment_list : temp_list, 2);
+		m_descriptor_sets[i]->UpdateStorageBuffer(histogram_buffer, 3);
+	}
+	m_atomic_counter.Reset(command_pool, 0);
+
+	std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(command_pool);
+	command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	auto cmd_compute_barrier = [&command_buffer]() {
+		VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                                   {barrier}, {}, {});
+	};
+
+	// the sorted list alternates between the fragment list and the temporary one
+	for (uint32_t pass = 0; pass < shifts.size(); ++pass) {
+		SortPushConstants push_constants = {fragment_count, shifts[pass], block_count};
+		command_buffer->CmdBindDescriptorSets({m_descriptor_sets[pass & 1u]}, m_pipeline_layout,
+		                                      VK_PIPELINE_BIND_POINT_COMPUTE, {});
+		command_buffer->CmdPushConstants(m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SortPushConstants),
+		                                 &push_constants);
+		command_buffer->CmdBindPipeline(m_count_pipeline);
+		command_buffer->CmdDispatch(block_count, 1, 1);
+		cmd_compute_barrier();
+		command_buffer->CmdBindPipeline(m_scan_pipeline);
+		command_buffer->CmdDispatch(1, 1, 1);
+		cmd_compute_barrier();
+		command_buffer->CmdBindPipeline(m_scatter_pipeline);
+		command_buffer->CmdDispatch(block_count, 1, 1);
+		cmd_compute_barrier();
+	}
+	const uint32_t merge_set = shifts.size() & 1u;
+	command_buffer->CmdBindDescriptorSets({m_descriptor_sets[merge_set]}, m_pipeline_layout,
+	                                      VK_PIPELINE_BIND_POINT_COMPUTE, {});
+	command_buffer->CmdPushConstants(m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t),
+	                                 &fragment_count);
+	command_buffer->CmdBindPipeline(m_merge_pipeline);
+	command_buffer->CmdDispatch(group_x_64(fragment_count), 1, 1);
+	{
+		// the counter is read back, the merged list is read by the octree build
+		VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                                   {barrier}, {}, {});
+	}
+	command_buffer->End();
+
+	std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
+	command_buffer->Submit(fence);
+	fence->Wait();
+
+	*merged_count = m_atomic_counter.Read(command_pool);
+	// the merge pass writes the destination list of its descriptor set
+	return merge_set ? fragment_list : temp_list;
+}
@@ -0,0 +1,53 @@
+#ifndef FRAGMENT_DEDUPLICATOR_HPP
+#define FRAGMENT_DEDUPLICATOR_HPP
+
+#include "Counter.hpp"
+
+#include "myvk/Buffer.hpp"
+#include "myvk/CommandPool.hpp"
+#include "myvk/ComputePipeline.hpp"
+#include "myvk/DescriptorSet.hpp"
+
+#include <array>
+
+// Merges the voxel fragments of each voxel into one on the GPU: a radix sort of the fragment list by voxel
+// (fragment_sort_*.comp), then one fragment per run of equal voxels with the colors averaged as octree_tag_node.comp
+// would (fragment_merge.comp).
+class FragmentDeduplicator {
+private:
+	uint32_t m_level;
+
+	std::shared_ptr<myvk::PipelineLayout> m_pipeline_layout;
+	std::shared_ptr<myvk::ComputePipeline> m_count_pipeline, m_scan_pipeline, m_scatter_pipeline, m_merge_pipeline;
+
+	Counter m_atomic_counter;
+
+	std::shared_ptr<myvk::DescriptorPool> m_descriptor_pool;
+	std::shared_ptr<myvk::DescriptorSetLayout> m_descriptor_set_layout;
+	// [0] reads the fragment list and writes the temporary list, [1] the other way round
+	std::array<std::shared_ptr<myvk::DescriptorSet>, 2> m_descriptor_sets;
+
+	void create_descriptors(const std::shared_ptr<myvk::Device> &device);
+	void create_pipeline(const std::shared_ptr<myvk::Device> &device);
+
+public:
+	// false if the shaders were left out (shader/CMakeLists.txt)
+	static constexpr bool IsSupported() {
+#if defined(SHADER_HAS_FRAGMENT_SORT_COUNT_COMP) && defined(SHADER_HAS_FRAGMENT_SORT_SCAN_COMP) &&                   \
+    defined(SHADER_HAS_FRAGMENT_SORT_SCATTER_COMP) && defined(SHADER_HAS_FRAGMENT_MERGE_COMP)
+		return true;
+#else
+		return false;
+#endif
+	}
+	static std::shared_ptr<FragmentDeduplicator> Create(const std::shared_ptr<myvk::Device> &device, uint32_t level);
+
+	// Merges the fragment_count fragments of fragment_list (written by Voxelizer::CmdVoxelize, already executed) and
+	// waits for it. Returns the buffer holding the merged fragments, fragment_list itself or a temporary list of the
+	// same size, and their count in *merged_count. Returns nullptr if the list is too long to sort.
+	std::shared_ptr<myvk::Buffer> Deduplicate(const std::shared_ptr<myvk::CommandPool> &command_pool,
+	                                          const std::shared_ptr<myvk::Buffer> &fragment_list,
+	                                          uint32_t fragment_count, uint32_t *merged_count);
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "GpuRayQuery.hpp"
+#include "myvk/CommandBuffer.hpp"
+#include "myvk/Fence.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+inline static constexpr uint32_t group_x_64(uint32_t x) { return (x >> 6u) + ((x & 0x3fu) ? 1u : 0u); }
+
+constexpr uint32_t kMaxDispatchRays = 65535u * 64u; // minimum maxComputeWorkGroupCount[0] guaranteed by Vulkan
+
+std::shared_ptr<GpuRayQuery> GpuRayQuery::Create(const std::shared_ptr<Octree> &octree,
+                                                 const std::shared_ptr<myvk::CommandPool> &command_pool) {
+	std::shared_ptr<GpuRayQuery> ret = std::make_shared<GpuRayQuery>();
+	ret->m_octree_ptr = octree;
+	ret->m_command_pool = command_pool;
+
+	std::shared_ptr<myvk::Device> device = command_pool->GetDevicePtr();
+	ret->create_descriptors(device);
+	if (!ret->create_pipeline(device))
+		return nullptr;
+	return ret;
+}
+
+void GpuRayQuery::create_descriptors(const std::shared_ptr<myvk::Device> &device) {
+	m_descriptor_pool = myvk::DescriptorPool::Create(device, 1, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4}});
+	{
+		VkDescriptorSetLayoutBinding origin_binding = {};
+		origin_binding.binding = 0;
+		origin_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		origin_binding.descriptorCount = 1;
+		origin_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		VkDescriptorSetLayoutBinding direction_binding = {};
+		direction_binding.binding = 1;
+		direction_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		direction_binding.descriptorCount = 1;
+		direction_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		VkDescriptorSetLayoutBinding hit_binding = {};
+		hit_binding.binding = 2;
+		hit_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		hit_binding.descriptorCount = 1;
+		hit_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		VkDescriptorSetLayoutBinding occluded_binding = {};
+		occluded_binding.binding = 3;
+		occluded_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		occluded_binding.descriptorCount = 1;
+		occluded_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		m_descriptor_set_layout = myvk::DescriptorSetLayout::Create(
+		    device, {origin_binding, direction_binding, hit_binding, occluded_binding});
+	}
+	m_descriptor_set = myvk::DescriptorSet::Create(m_descriptor_pool, m_descriptor_set_layout);
+}
+
+bool GpuRayQuery::create_pipeline(const std::shared_ptr<myvk::Device> &device) {
+#ifdef SHADER_HAS_RAY_QUERY_COMP
+	m_pipeline_layout =
+	    myvk::PipelineLayout::Create(device, {m_octree_ptr->GetDescriptorSetLayout(), m_descriptor_set_layout},
+	                                 {{VK_SHADER_STAGE_COMPUTE_BIT, 0, 3 * sizeof(uint32_t)}});
+	{
+		constexpr uint32_t kRayQueryCompSpv[] = {
+#include "spirv/ray_query.comp.u32"
+		};
+		std::shared_ptr<myvk::ShaderModule> ray_query_shader_module =
+		    myvk::ShaderModule::Create(device, kRayQueryCompSpv, sizeof(kRayQueryCompSpv));
+		m_pipeline = myvk::ComputePipeline::Create(m_pipeline_layout, ray_query_shader_module);
+	}
+	return true;
+#else
+	spdlog::error("GpuRayQuery: ray_query.comp was left out (no glslc, stale SPIR-V)");
+	return false;
+#endif
+}
+
+void GpuRayQuery::reserve_buffers(size_t count) {
+	VkDeviceSize ray_size = count * sizeof(glm::vec3), result_size = count * sizeof(RayQueryHit);
+	if (m_origin_buffer && m_origin_buffer->GetSize() >= ray_size)
+		return;
+
+	std::shared_ptr<myvk::Device> device = m_command_pool->GetDevicePtr();
+	m_origin_buffer = myvk::Buffer::Create(
+	    device, ray_size, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+	    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	m_direction_buffer = myvk::Buffer::Create(
+	    device, ray_size, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+	    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	// hits and occlusion flags share the buffer, only one of them is written per batch
+	m_result_buffer = myvk::Buffer::Create(
+	    device, result_size, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+	    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+	m_descriptor_set->UpdateStorageBuffer(m_origin_buffer, 0);
+	m_descriptor_set->UpdateStorageBuffer(m_direction_buffer, 1);
+	m_descriptor_set->UpdateStorageBuffer(m_result_buffer, 2);
+	m_descriptor_set->UpdateStorageBuffer(m_result_buffer, 3);
+}
+
+void GpuRayQuery::run(const glm::vec3 *origins, const glm::vec3 *directions, size_t count, bool occlude) {
+	reserve_buffers(count);
+	std::copy(origins, origins + count, (glm::vec3 *)m_origin_buffer->GetMappedData());
+	std::copy(directions, directions + count, (glm::vec3 *)m_direction_buffer->GetMappedData());
+
+	std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(m_command_pool);
+	std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(m_command_pool->GetDevicePtr());
+	command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	command_buffer->CmdBindDescriptorSets({m_octree_ptr->GetDescriptorSet(), m_descriptor_set}, m_pipeline);
+	command_buffer->CmdBindPipeline(m_pipeline);
+	for (size_t offset = 0; offset < count; offset += kMaxDispatchRays) {
+		uint32_t push_constants[] = {(uint32_t)offset, (uint32_t)count, occlude ? 1u : 0u};
+		command_buffer->CmdPushConstants(m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants),
+		                                 push_constants);
+		command_buffer->CmdDispatch(group_x_64(std::min<size_t>(count - offset, kMaxDispatchRays)), 1, 1);
+	}
+	command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, {},
+	                                   {m_result_buffer->GetMemoryBarrier(VK_ACCESS_SHADER_WRITE_BIT,
+	                                                                      VK_ACCESS_HOST_READ_BIT)},
+	                                   {});
+	command_buffer->End();
+
+	command_buffer->Submit(fence);
+	fence->Wait();
+}
+
+void GpuRayQuery::Intersect(const glm::vec3 *origins, const glm::vec3 *directions, size_t count,
+                            RayQueryHit *hits) {
+	if (count == 0)
+		return;
+	run(origins, directions, count, false);
+	std::memcpy(hits, m_result_buffer->GetMappedData(), count * sizeof(RayQueryHit));
+}
+
+void GpuRayQuery::Occlude(const glm::vec3 *origins, const glm::vec3 *directions, size_t count, uint32_t *occluded) {
+	if (count == 0)
+		return;
+	run(origins, directions, count, true);
+	std::memcpy(occluded, m_result_buffer->GetMappedData(), count * sizeof(uint32_t));
+}
@@ -0,0 +1,42 @@
+#ifndef GPU_RAY_QUERY_HPP
+#define GPU_RAY_QUERY_HPP
+
+#include "Octree.hpp"
+#include "RayQuery.hpp"
+#include "myvk/CommandPool.hpp"
+#include "myvk/ComputePipeline.hpp"
+
+// Batch line-of-sight / visibility queries with Octree_RayMarchLeaf / Octree_RayMarchOcclude of octree.glsl in a
+// compute shader (ray_query.comp), same interface as CpuRayQuery. The octree must be owned by the pool's queue family.
+// Ray and result buffers are host visible and grow to the largest batch seen.
+class GpuRayQuery {
+private:
+	std::shared_ptr<Octree> m_octree_ptr;
+	std::shared_ptr<myvk::CommandPool> m_command_pool;
+
+	std::shared_ptr<myvk::Buffer> m_origin_buffer, m_direction_buffer, m_result_buffer;
+
+	std::shared_ptr<myvk::DescriptorPool> m_descriptor_pool;
+	std::shared_ptr<myvk::DescriptorSetLayout> m_descriptor_set_layout;
+	std::shared_ptr<myvk::DescriptorSet> m_descriptor_set;
+
+	std::shared_ptr<myvk::PipelineLayout> m_pipeline_layout;
+	std::shared_ptr<myvk::ComputePipeline> m_pipeline;
+
+	void create_descriptors(const std::shared_ptr<myvk::Device> &device);
+	bool create_pipeline(const std::shared_ptr<myvk::Device> &device);
+	void reserve_buffers(size_t count);
+
+	void run(const glm::vec3 *origins, const glm::vec3 *directions, size_t count, bool occlude);
+
+public:
+	// nullptr if the SPIR-V of ray_query.comp was not built
+	static std::shared_ptr<GpuRayQuery> Create(const std::shared_ptr<Octree> &octree,
+	                                           const std::shared_ptr<myvk::CommandPool> &command_pool);
+
+	void Intersect(const glm::vec3 *origins, const glm::vec3 *directions, size_t count, RayQueryHit *hits);
+	// occluded[i] is 1 when ray i hits any voxel
+	void Occlude(const glm::vec3 *origins, const glm::vec3 *directions, size_t count, uint32_t *occluded);
+};
+
+#endif
@@ -0,0 +1,309 @@
+#include "HeadlessRenderer.hpp"
+
+#include "myvk/CommandBuffer.hpp"
+#include "myvk/Fence.hpp"
+#include "myvk/QueueSelector.hpp"
+
+#include <chrono>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <thread>
+#include <tinyexr.h>
+
+bool HeadlessRenderer::initialize_vulkan() {
+	if (volkInitialize() != VK_SUCCESS) {
+		spdlog::error("Failed to load vulkan!");
+		return false;
+	}
+	// no surface extensions
+	m_instance = myvk::Instance::Create({});
+	if (!m_instance) {
+		spdlog::error("Failed to create instance!");
+		return false;
+	}
+
+	std::vector<std::shared_ptr<myvk::PhysicalDevice>> physical_devices = myvk::PhysicalDevice::Fetch(m_instance);
+	if (physical_devices.empty()) {
+		spdlog::error("Failed to find physical device with vulkan support!");
+		return false;
+	}
+	const auto &physical_device = physical_devices[0];
+	spdlog::info("Physical Device: {}", physical_device->GetProperties().vk10.deviceName);
+
+	std::vector<const char *> extensions;
+	if (physical_device->GetExtensionSupport(VK_EXT_CONSERVATIVE_RASTERIZATION_EXTENSION_NAME)) {
+		extensions.push_back(VK_EXT_CONSERVATIVE_RASTERIZATION_EXTENSION_NAME);
+		spdlog::info("EXT_conservative_rasterization supported");
+	} else {
+		spdlog::warn("EXT_conservative_rasterization not supported");
+	}
+
+	const auto queue_selector =
+	    [this](const myvk::Ptr<const myvk::PhysicalDevice> &physical_device) -> std::vector<myvk::QueueSelection> {
+		const auto &families = physical_device->GetQueueFamilyProperties();
+		// the voxelizer rasterizes on the loader queue and the path tracer dispatches on the main queue
+		std::optional<uint32_t> queue_family;
+		for (uint32_t i = 0; i < families.size(); ++i) {
+			VkQueueFlags flags = families[i].queueFlags;
+			if ((flags & VK_QUEUE_GRAPHICS_BIT) && (flags & VK_QUEUE_COMPUTE_BIT) && (flags & VK_QUEUE_TRANSFER_BIT)) {
+				queue_family = i;
+				break;
+			}
+		}
+		if (!queue_family.has_value())
+			return {};
+		return {
+		    myvk::QueueSelection{&m_main_queue, queue_family.value(), 0u},
+		    myvk::QueueSelection{&m_loader_queue, queue_family.value(), 1u},
+		};
+	};
+
+	auto features = physical_device->GetDefaultFeatures();
+	features.vk12.descriptorBindingPartiallyBound = VK_TRUE;
+	m_device = myvk::Device::Create(physical_device, queue_selector, features, extensions, kPipelineCacheFilename);
+	if (!m_device) {
+		spdlog::error("Failed to create logical device!");
+		return false;
+	}
+	spdlog::info("Pipeline cache {}", m_device->IsPipelineCacheLoaded() ? "loaded" : "not loaded, starting empty");
+	spdlog::info("Main Queue: ({}){}, Loader Queue: ({}){}", m_main_queue->GetFamilyIndex(),
+	             (void *)m_main_queue->GetHandle(), m_loader_queue->GetFamilyIndex(),
+	             (void *)m_loader_queue->GetHandle());
+
+	m_main_command_pool = myvk::CommandPool::Create(m_main_queue);
+	return true;
+}
+
+std::shared_ptr<HeadlessRenderer> HeadlessRenderer::Create() {
+	std::shared_ptr<HeadlessRenderer> ret = std::make_shared<HeadlessRenderer>();
+	if (!ret->initialize_vulkan())
+		return nullptr;
+
+	ret->m_lighting = Lighting::Create(EnvironmentMap::Create(ret->m_device));
+	ret->m_camera = Camera::Create(ret->m_device, kFrameCount + 1); // the path tracer uses the last camera buffer
+	ret->m_octree = Octree::Create(ret->m_device);
+	ret->m_path_tracer = PathTracer::Create(ret->m_octree, ret->m_camera, ret->m_lighting, ret->m_main_command_pool);
+	ret->m_denoiser = Denoiser::Create(ret->m_path_tracer);
+	return ret;
+}
+
+HeadlessRenderer::~HeadlessRenderer() {
+	if (m_device)
+		m_device->WaitIdle();
+}
+
+bool HeadlessRenderer::load(const char *filename, uint32_t octree_level, const OctreeLoadOptions &load_options) {
+	std::shared_ptr<LoaderThread> loader_thread = LoaderThread::Create(m_octree, m_loader_queue, m_main_queue);
+	loader_thread->Launch(filename, octree_level, load_options);
+	while (!loader_thread->TryJoin())
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	if (m_octree->Empty()) {
+		spdlog::error("Failed to load {}", filename);
+		return false;
+	}
+	return true;
+}
+
+uint32_t HeadlessRenderer::render(const HeadlessOptions &options) {
+	m_path_tracer->m_width = options.width;
+	m_path_tracer->m_height = options.height;
+	m_path_tracer->m_bounce = options.bounce;
+	bool wavefront = options.wavefront || options.tree64 || options.dag || options.compact;
+	m_path_tracer->m_mode = wavefront ? PathTracer::Modes::kWavefront : PathTracer::Modes::kMegakernel;
+	m_path_tracer->m_adaptive_threshold = options.adaptive_threshold;
+	m_path_tracer->m_adaptive_min_samples = options.adaptive_min_samples;
+	m_path_tracer->m_specialized_pipelines = options.specialized_pipelines;
+	m_path_tracer->m_tree64 = options.tree64;
+	m_path_tracer->m_dag = options.dag;
+	m_path_tracer->m_compact = options.compact;
+	m_path_tracer->m_lod = options.lod_spread > 0.0f;
+	m_path_tracer->m_lod_spread = options.lod_spread;
+	m_path_tracer->m_russian_roulette = options.roulette_min_bounce != 0;
+	if (options.roulette_min_bounce)
+		m_path_tracer->m_roulette_min_bounce = options.roulette_min_bounce;
+	m_path_tracer->Reset(m_main_command_pool, m_main_queue);
+	if (options.denoise_iterations)
+		m_denoiser->Reset(m_main_command_pool, m_main_queue);
+	if (options.tile_size)
+		return render_tiled(options);
+
+	std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(m_device);
+	std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(m_main_command_pool);
+	command_buffer->Begin();
+	m_path_tracer->CmdRender(command_buffer);
+	command_buffer->End();
+
+	auto begin = std::chrono::steady_clock::now();
+	const auto elapsed = [begin]() {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	};
+	uint32_t spp = 0, timed_spp = 0;
+	double last_report = 0.0;
+	PathTracer::KernelTimings timing_sum{};
+	while ((options.spp == 0 || spp < options.spp) && (options.time_limit <= 0.0 || elapsed() < options.time_limit)) {
+		fence->Reset();
+		command_buffer->Submit(fence);
+		fence->Wait();
+		++spp;
+
+		PathTracer::KernelTimings timings;
+		if (m_path_tracer->GetKernelTimings(&timings)) {
+			++timed_spp;
+			timing_sum.total_ms += timings.total_ms;
+			timing_sum.paths += timings.paths;
+			timing_sum.traversals += timings.traversals;
+			timing_sum.wavefront.generate_ms += timings.wavefront.generate_ms;
+			timing_sum.wavefront.extend_ms += timings.wavefront.extend_ms;
+			timing_sum.wavefront.shade_ms += timings.wavefront.shade_ms;
+			timing_sum.wavefront.shadow_ms += timings.wavefront.shadow_ms;
+			timing_sum.wavefront.paths += timings.wavefront.paths;
+			timing_sum.wavefront.extend_rays += timings.wavefront.extend_rays;
+			timing_sum.wavefront.shadow_rays += timings.wavefront.shadow_rays;
+		}
+
+		if (elapsed() - last_report >= 5.0) {
+			last_report = elapsed();
+			spdlog::info("{} spp, {:.1f} s", spp, last_report);
+		}
+	}
+	spdlog::info("Path tracing FINISHED: {} spp in {:.3f} s ({:.2f} spp/s)", spp, elapsed(), spp / elapsed());
+	log_timings(timing_sum, timed_spp);
+	return spp;
+}
+
+uint32_t HeadlessRenderer::render_tiled(const HeadlessOptions &options) {
+	TileScheduler tile_scheduler;
+	tile_scheduler.Reset(m_path_tracer->m_width, m_path_tracer->m_height, options.tile_size, options.tile_budget_ms);
+	spdlog::info("Tiled rendering: {} tiles of {}x{}, {:.1f} ms per submission", tile_scheduler.GetTiles().size(),
+	             tile_scheduler.GetTileSize(), tile_scheduler.GetTileSize(), options.tile_budget_ms);
+
+	std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(m_device);
+
+	auto begin = std::chrono::steady_clock::now();
+	const auto elapsed = [begin]() {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	};
+	uint32_t spp = 0, runs = 0;
+	double last_report = 0.0, gpu_ms = 0.0;
+	while ((options.spp == 0 || spp < options.spp) && (options.time_limit <= 0.0 || elapsed() < options.time_limit)) {
+		uint32_t first, last;
+		bool finish_sample = tile_scheduler.Next(&first, &last);
+
+		std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(m_main_command_pool);
+		command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		m_path_tracer->CmdRenderTiles(command_buffer, tile_scheduler.GetTiles().data() + first, last - first,
+		                              finish_sample);
+		command_buffer->End();
+
+		fence->Reset();
+		command_buffer->Submit(fence);
+		fence->Wait();
+		++runs;
+		if (finish_sample)
+			++spp;
+
+		PathTracer::KernelTimings timings;
+		if (m_path_tracer->GetKernelTimings(&timings)) {
+			tile_scheduler.Feedback(first, last, timings.total_ms);
+			gpu_ms += timings.total_ms;
+		}
+
+		if (elapsed() - last_report >= 5.0) {
+			last_report = elapsed();
+			spdlog::info("{} spp + {}/{} tiles, {:.1f} s", spp, finish_sample ? 0 : last,
+			             tile_scheduler.GetTiles().size(), last_report);
+		}
+	}
+	spdlog::info("Path tracing FINISHED: {} spp in {:.3f} s ({:.2f} spp/s)", spp, elapsed(), spp / elapsed());
+	if (spp)
+		spdlog::info("GPU time: {:.3f} ms/spp in {} submissions ({:.3f} ms each)", gpu_ms / spp, runs,
+		             gpu_ms / runs);
+	return spp;
+}
+
+void HeadlessRenderer::log_timings(const PathTracer::KernelTimings &timing_sum, uint32_t spp) const {
+	if (spp == 0)
+		return;
+	if (m_path_tracer->m_mode == PathTracer::Modes::kMegakernel) {
+		spdlog::info("Megakernel GPU time: {:.3f} ms/spp", timing_sum.total_ms / spp);
+		spdlog::info("Megakernel paths: {:.1f}% of the pixels per spp, {:.2f} traversals per path",
+		             100.0 * timing_sum.paths / spp / double(m_path_tracer->m_width * m_path_tracer->m_height),
+		             timing_sum.GetTraversalsPerSample());
+		return;
+	}
+	const WavefrontPathTracer::KernelTimings &wavefront = timing_sum.wavefront;
+	const auto mrays_per_second = [](uint64_t rays, double ms) { return ms > 0.0 ? rays / ms * 0.001 : 0.0; };
+	spdlog::info("Wavefront GPU time: {:.3f} ms/spp (generate {:.3f}, extend {:.3f}, shade {:.3f}, shadow {:.3f})",
+	             timing_sum.total_ms / spp, wavefront.generate_ms / spp, wavefront.extend_ms / spp,
+	             wavefront.shade_ms / spp, wavefront.shadow_ms / spp);
+	spdlog::info("Wavefront paths: {:.1f}% of the pixels per spp, {:.2f} traversals per path",
+	             100.0 * wavefront.paths / spp / double(m_path_tracer->m_width * m_path_tracer->m_height),
+	             timing_sum.GetTraversalsPerSample());
+	spdlog::info("Wavefront rays: {} extend + {} shadow per spp, {:.2f} Mrays/s (extend {:.2f}, shadow {:.2f})",
+	             wavefront.extend_rays / spp, wavefront.shadow_rays / spp,
+	             mrays_per_second(wavefront.extend_rays + wavefront.shadow_rays, timing_sum.total_ms),
+	             mrays_per_second(wavefront.extend_rays, wavefront.extend_ms),
+	             mrays_per_second(wavefront.shadow_rays, wavefront.shadow_ms));
+}
+
+bool HeadlessRenderer::save(const HeadlessOptions &options) const {
+	struct Target {
+		const char *name;
+		std::vector<float> (PathTracer::*extract)(const std::shared_ptr<myvk::CommandPool> &) const;
+	};
+	constexpr Target kTargets[] = {{"color", &PathTracer::ExtractColorImage},
+	                               {"albedo", &PathTracer::ExtractAlbedoImage},
+	                               {"normal", &PathTracer::ExtractNormalImage}};
+
+	bool success = true;
+	const auto save_exr = [this, &options, &success](const char *name, const std::vector<float> &pixels) {
+		std::string exr_name = options.output_prefix + "_" + name + ".exr";
+
+		char *err{nullptr};
+		if (SaveEXR(pixels.data(), m_path_tracer->m_width, m_path_tracer->m_height, 3, options.save_as_fp16,
+		            exr_name.c_str(), (const char **)&err) < 0) {
+			spdlog::error("{}", err);
+			success = false;
+		} else
+			spdlog::info("Saved EXR image to {}", exr_name);
+		free(err);
+	};
+	for (const Target &target : kTargets)
+		save_exr(target.name, ((*m_path_tracer).*target.extract)(m_main_command_pool));
+
+	if (options.denoise_iterations) {
+		m_denoiser->m_iterations = options.denoise_iterations;
+		save_exr("denoised", m_denoiser->ExtractDenoisedImage(m_main_command_pool));
+	}
+	return success;
+}
+
+bool HeadlessRenderer::Run(const char *filename, uint32_t octree_level, const OctreeLoadOptions &load_options,
+                           const HeadlessOptions &options) {
+	if (options.spp == 0 && options.time_limit <= 0.0) {
+		spdlog::error("Headless rendering needs a sample count or a time limit");
+		return false;
+	}
+	const uint32_t kMaxDimension = m_device->GetPhysicalDevicePtr()->GetProperties().vk10.limits.maxImageDimension2D;
+	if (options.width > kMaxDimension || options.height > kMaxDimension) {
+		spdlog::error("{}x{} exceeds the maximum image size {} of the device", options.width, options.height,
+		              kMaxDimension);
+		return false;
+	}
+
+	if (options.environment_map) {
+		m_lighting->GetEnvironmentMapPtr()->Reset(m_main_command_pool, options.environment_map);
+		if (m_lighting->GetEnvironmentMapPtr()->Empty())
+			return false;
+		m_lighting->m_light_type = Lighting::LightTypes::kEnvironmentMap;
+	}
+	m_camera->m_position = options.camera_position;
+	m_camera->m_yaw = options.camera_yaw;
+	m_camera->m_pitch = options.camera_pitch;
+
+	if (!load(filename, octree_level, load_options))
+		return false;
+	render(options);
+	return save(options);
+}
@@ -0,0 +1,77 @@
+#ifndef HEADLESS_RENDERER_HPP
+#define HEADLESS_RENDERER_HPP
+
+#include "Camera.hpp"
+#include "Config.hpp"
+#include "Denoiser.hpp"
+#include "Lighting.hpp"
+#include "LoaderThread.hpp"
+#include "Octree.hpp"
+#include "PathTracer.hpp"
+#include "TileScheduler.hpp"
+
+#include "myvk/CommandPool.hpp"
+#include "myvk/Device.hpp"
+#include "myvk/Instance.hpp"
+#include "myvk/Queue.hpp"
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+
+struct HeadlessOptions {
+	uint32_t width = kDefaultWidth, height = kDefaultHeight, bounce = kDefaultBounce;
+	uint32_t spp = 0;          // stop after this many samples per pixel, 0 for no limit
+	double time_limit = 0.0;   // stop after this many seconds of rendering, 0 for no limit
+	std::string output_prefix = "render"; // writes <prefix>_color.exr, <prefix>_albedo.exr, <prefix>_normal.exr
+	bool save_as_fp16 = false;
+	bool wavefront = false; // PathTracer::Modes::kWavefront
+	float adaptive_threshold = 0.0f; // adaptive sampling, 0 to disable
+	uint32_t adaptive_min_samples = kDefaultAdaptiveMinSamples;
+	uint32_t roulette_min_bounce = 0; // Russian roulette from this bounce on, 0 to disable
+	bool specialized_pipelines = true; // pipelines specialized for the light type and the bounce count
+	bool tree64 = false; // trace the 64-tree of the octree (implies wavefront, needs OctreeLoadOptions::tree64)
+	bool dag = false; // trace the DAG of the octree (implies wavefront, needs OctreeLoadOptions::dag)
+	bool compact = false; // trace the compact octree (implies wavefront, needs OctreeLoadOptions::compact)
+	float lod_spread = 0.0f; // LOD traversal of the later bounces (needs OctreeLoadOptions::lod)
+	uint32_t tile_size = 0; // runs of tiles of about tile_budget_ms GPU time (TileScheduler), 0 for whole samples
+	float tile_budget_ms = kPTDefaultTileBudgetMs;
+	uint32_t denoise_iterations = 0; // also writes <prefix>_denoised.exr (Denoiser), 0 to disable
+	const char *environment_map = nullptr;
+	glm::vec3 camera_position{1.5f};
+	float camera_yaw = 0.0f, camera_pitch = 0.0f;
+};
+
+// Loads a scene, builds the octree and path traces it without a window, surface or swapchain, so it also runs on
+// software implementations like lavapipe. Everything runs on one compute/graphics queue.
+class HeadlessRenderer {
+private:
+	std::shared_ptr<myvk::Instance> m_instance;
+	std::shared_ptr<myvk::Device> m_device;
+	std::shared_ptr<myvk::Queue> m_main_queue, m_loader_queue;
+	std::shared_ptr<myvk::CommandPool> m_main_command_pool;
+
+	std::shared_ptr<Camera> m_camera;
+	std::shared_ptr<Octree> m_octree;
+	std::shared_ptr<Lighting> m_lighting;
+	std::shared_ptr<PathTracer> m_path_tracer;
+	std::shared_ptr<Denoiser> m_denoiser;
+
+	bool initialize_vulkan();
+	bool load(const char *filename, uint32_t octree_level, const OctreeLoadOptions &load_options);
+	uint32_t render(const HeadlessOptions &options);
+	// for options.tile_size != 0
+	uint32_t render_tiled(const HeadlessOptions &options);
+	void log_timings(const PathTracer::KernelTimings &timing_sum, uint32_t spp) const;
+	bool save(const HeadlessOptions &options) const;
+
+public:
+	// nullptr if no suitable Vulkan device is found
+	static std::shared_ptr<HeadlessRenderer> Create();
+	~HeadlessRenderer();
+
+	bool Run(const char *filename, uint32_t octree_level, const OctreeLoadOptions &load_options,
+	         const HeadlessOptions &options);
+};
+
+#endif
@@ -1,6 +1,13 @@
 #include "LoaderThread.hpp"
 #include "VoxLoader.hpp"
 #include "VoxDataAdapter.hpp"
+#include "CompactOctree.hpp"
+#include "OctreeCache.hpp"
+#include "OctreeDAG.hpp"
+#include "OctreeLOD.hpp"
+#include "OctreeReorder.hpp"
+#include "Tree64.hpp"
+#include <chrono>
 #include <spdlog/spdlog.h>
 
 // 辅助函数：获取文件扩展名
@@ -28,12 +35,12 @@ std::shared_ptr<LoaderThread> LoaderThread::Create(const std::shared_ptr<Octree>
 	return ret;
 }
 
-void LoaderThread::Launch(const char *filename, uint32_t octree_level) {
+void LoaderThread::Launch(const char *filename, uint32_t octree_level, const OctreeLoadOptions &options) {
 	if (IsRunning())
 		return;
-	m_promise = std::promise<std::shared_ptr<OctreeBuilder>>();
+	m_promise = std::promise<LoadResult>();
 	m_future = m_promise.get_future();
-	m_thread = std::thread(&LoaderThread::thread_func, this, filename, octree_level);
+	m_thread = std::thread(&LoaderThread::thread_func, this, filename, octree_level, options);
 }
 
 bool LoaderThread::TryJoin() {
@@ -45,164 +52,358 @@ bool LoaderThread::TryJoin() {
 
 	m_thread.join();
 
-	std::shared_ptr<OctreeBuilder> builder = m_future.get();
-	if (builder) {
-		std::shared_ptr<myvk::CommandPool> loader_command_pool = myvk::CommandPool::Create(m_loader_queue);
+	LoadResult result = m_future.get();
+	if (result.octree) {
 		m_main_queue->WaitIdle();
-		m_octree_ptr->Update(loader_command_pool, builder);
+		m_octree_ptr->Update(result.octree, result.level, result.range);
+		m_octree_ptr->UpdateTree64(result.tree64, result.tree64_range);
+		m_octree_ptr->UpdateDAG(result.dag, result.dag_leaf_offsets, result.dag_range, result.dag_attributes,
+		                        result.dag_attribute_range);
+		m_octree_ptr->UpdateCompact(result.compact, result.compact_range);
+		m_octree_ptr->UpdateLOD(result.lod, result.lod_range);
 		spdlog::info("Octree range: {} ({} MB)", m_octree_ptr->GetRange(), m_octree_ptr->GetRange() / 1000000.0f);
 	}
 
 	return true;
 }
 
-void LoaderThread::thread_func(const char *filename, uint32_t octree_level) {
+std::shared_ptr<OctreeBuilder>
+LoaderThread::build_from_vox(const char *filename, uint32_t octree_level, const OctreeLoadOptions &options,
+                             const std::shared_ptr<myvk::CommandPool> &loader_command_pool) {
+	std::shared_ptr<myvk::Device> device = m_main_queue->GetDevicePtr();
+	spdlog::info("Processing .vox file: {}", filename);
+
+	// .vox文件处理路径：跳过场景和体素化，直接从体素数据构建
+	m_notification = "Loading .vox file";
+	auto vox_data = VoxLoader::LoadVox(filename);
+
+	if (!vox_data || vox_data->IsEmpty()) {
+		spdlog::error("Failed to load .vox file or file is empty");
+		return nullptr;
+	}
+	spdlog::info("Loaded .vox file with {} voxels", vox_data->GetVoxelCount());
+
+	// 创建VoxDataAdapter
+	m_notification = "Creating VoxDataAdapter";
+	auto vox_adapter = VoxDataAdapter::Create(*vox_data, device, loader_command_pool, octree_level,
+	                                          options.deduplicate_fragments);
+	if (!vox_adapter) {
+		spdlog::error("Failed to create VoxDataAdapter");
+		return nullptr;
+	}
+
+	// 使用VoxDataAdapter创建OctreeBuilder
+	m_notification = "Building Octree from .vox data";
+	std::shared_ptr<OctreeBuilder> builder =
+	    OctreeBuilder::Create(vox_adapter, loader_command_pool, options.build_mode);
+	if (!builder) {
+		spdlog::error("Failed to create OctreeBuilder from VoxDataAdapter");
+		return nullptr;
+	}
+
+	// 执行八叉树构建
+	auto begin = std::chrono::steady_clock::now();
+	if (!builder->Build(loader_command_pool)) {
+		spdlog::error("Failed to build Octree from .vox data");
+		return nullptr;
+	}
+
+	spdlog::info("Octree building from .vox FINISHED in {} ms ({})",
+	             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count(),
+	             kOctreeBuildModeNames[(int)builder->GetMode()]);
+	return builder;
+}
+
+std::shared_ptr<OctreeBuilder>
+LoaderThread::build_from_scene(const char *filename, uint32_t octree_level, const OctreeLoadOptions &options,
+                               const std::shared_ptr<myvk::CommandPool> &loader_command_pool) {
+	std::shared_ptr<myvk::Device> device = m_main_queue->GetDevicePtr();
+	spdlog::info("Processing OBJ file: {}", filename);
+
+	// 传统OBJ文件处理路径：场景 -> 体素化 -> 八叉树构建
+	std::shared_ptr<Scene> scene;
+	if (!(scene = Scene::Create(m_loader_queue, filename, &m_notification, options.use_cache))) {
+		spdlog::error("Failed to create Scene from OBJ file");
+		return nullptr;
+	}
+	std::shared_ptr<Voxelizer> voxelizer = Voxelizer::Create(scene, loader_command_pool, octree_level);
+
+	std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
+	std::shared_ptr<myvk::QueryPool> query_pool = myvk::QueryPool::Create(device, VK_QUERY_TYPE_TIMESTAMP, 2);
+	std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(loader_command_pool);
+	command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	command_buffer->CmdResetQueryPool(query_pool);
+
+	command_buffer->CmdWriteTimestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 0);
+	voxelizer->CmdVoxelize(command_buffer);
+	command_buffer->CmdWriteTimestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 1);
+
+	command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+	                                   {},
+	                                   {voxelizer->GetVoxelFragmentList()->GetMemoryBarrier(
+	                                       VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT)},
+	                                   {});
+
+	command_buffer->End();
+
+	m_notification = "Voxelizing and Building Octree";
+	spdlog::info("Voxelize and Octree building BEGIN");
+
+	command_buffer->Submit(fence);
+	fence->Wait();
+
+	double dedup_ms = 0.0;
+	if (options.deduplicate_fragments) {
+		auto dedup_begin = std::chrono::steady_clock::now();
+		if (!voxelizer->DeduplicateFragments(loader_command_pool))
+			spdlog::warn("Fragments not deduplicated");
+		dedup_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - dedup_begin).count();
+	}
+	// created after the deduplication, the fragment count is a specialization constant of the tag pass
+	std::shared_ptr<OctreeBuilder> builder = OctreeBuilder::Create(voxelizer, loader_command_pool, options.build_mode);
+
+	// both build modes submit and wait more than once (per level, or before sizing the octree), so they are timed on
+	// the host
+	auto build_begin = std::chrono::steady_clock::now();
+	if (!builder->Build(loader_command_pool)) {
+		spdlog::error("Failed to build Octree");
+		return nullptr;
+	}
+	double build_ms =
+	    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_begin).count();
+
+	// time measurement
+	uint64_t timestamps[2];
+	query_pool->GetResults64(timestamps, VK_QUERY_RESULT_WAIT_BIT);
+	double voxelize_ms = double(timestamps[1] - timestamps[0]) * 0.000001;
+	spdlog::info("Voxelize and Octree building FINISHED in {} ms (Voxelize "
+	             "{} ms, Deduplication {} ms, Octree building {} ms, {})",
+	             voxelize_ms + dedup_ms + build_ms, voxelize_ms, dedup_ms, build_ms,
+	             kOctreeBuildModeNames[(int)builder->GetMode()]);
+
+	return builder;
+}
+
+void LoaderThread::process_octree(LoadResult *result, const OctreeLoadOptions &options,
+                                  const std::shared_ptr<myvk::CommandPool> &loader_command_pool) const {
+	const std::shared_ptr<ThreadPool> &thread_pool = ThreadPool::GetDefault();
+	std::shared_ptr<myvk::Device> device = m_main_queue->GetDevicePtr();
+	std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
+
+	std::shared_ptr<myvk::Buffer> readback_buffer = myvk::Buffer::Create(
+	    device, result->range, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+	    VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(loader_command_pool);
+	command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                                   VK_PIPELINE_STAGE_TRANSFER_BIT, {},
+	                                   {result->octree->GetMemoryBarrier({0, result->range},
+	                                                                     VK_ACCESS_SHADER_WRITE_BIT |
+	                                                                         VK_ACCESS_TRANSFER_WRITE_BIT,
+	                                                                     VK_ACCESS_TRANSFER_READ_BIT)},
+	                                   {});
+	command_buffer->CmdCopy(result->octree, readback_buffer, {{0, 0, result->range}});
+	command_buffer->CmdPipelineBarrier(
+	    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, {},
+	    {readback_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT)}, {});
+	command_buffer->End();
+	command_buffer->Submit(fence);
+	fence->Wait();
+
+	// the words of the last successful pass
+	const uint32_t *words = (const uint32_t *)readback_buffer->GetMappedData();
+	VkDeviceSize range = result->range;
+
+	std::vector<uint32_t> reordered;
+	if (options.node_order != OctreeNodeOrder::kBuild) {
+		auto begin = std::chrono::steady_clock::now();
+		if (!(reordered = OctreeReorder::Reorder(thread_pool, words, range, options.node_order)).empty()) {
+			spdlog::info("Octree nodes reordered in {} ms ({})",
+			             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count(),
+			             kOctreeNodeOrderNames[(int)options.node_order]);
+			words = reordered.data();
+			range = reordered.size() * sizeof(uint32_t);
+		} else
+			spdlog::warn("Failed to reorder the octree nodes, keeping the build order");
+	}
+
+	const auto upload = [&](const uint32_t *data, VkDeviceSize size) {
+		std::shared_ptr<myvk::Buffer> staging_buffer = myvk::Buffer::CreateStaging(device, data, data + size / 4);
+		std::shared_ptr<myvk::Buffer> buffer =
+		    myvk::Buffer::Create(device, size, 0,
+		                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+		                             VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+		command_buffer = myvk::CommandBuffer::Create(loader_command_pool);
+		command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		command_buffer->CmdCopy(staging_buffer, buffer, {{0, 0, size}});
+		command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		                                   {},
+		                                   {buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT,
+		                                                             VK_ACCESS_SHADER_READ_BIT)},
+		                                   {});
+		command_buffer->End();
+		fence->Reset();
+		command_buffer->Submit(fence);
+		fence->Wait();
+		return buffer;
+	};
+
+	if (options.tree64) {
+		auto begin = std::chrono::steady_clock::now();
+		if (std::shared_ptr<Tree64> tree64 = Tree64::Build(words, range)) {
+			spdlog::info("64-tree built in {} ms: depth {}, {} nodes ({} MB)",
+			             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count(),
+			             tree64->GetDepth(), tree64->GetNodeCount(), tree64->GetRange() / 1000000.0);
+			result->tree64 = upload(tree64->GetWords().data(), tree64->GetRange());
+			result->tree64_range = tree64->GetRange();
+		} else
+			spdlog::warn("Failed to build the 64-tree");
+	}
+	if (options.dag) {
+		auto begin = std::chrono::steady_clock::now();
+		std::shared_ptr<OctreeDAG> dag = OctreeDAG::Build(thread_pool, words, range);
+		if (dag && !dag->GetAttributes().empty()) {
+			spdlog::info("Octree DAG built in {} ms: {} -> {} nodes ({} MB, {} MB with the leaf offsets and colors)",
+			             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count(),
+			             dag->GetSourceNodeCount(), dag->GetNodeCount(), dag->GetRange() / 1000000.0,
+			             (dag->GetRange() * 2 + dag->GetAttributes().size() * sizeof(uint32_t)) / 1000000.0);
+			result->dag_range = dag->GetRange();
+			result->dag = upload(dag->GetNodes().data(), result->dag_range);
+			result->dag_leaf_offsets = upload(dag->GetLeafOffsets().data(), result->dag_range);
+			result->dag_attribute_range = dag->GetAttributes().size() * sizeof(uint32_t);
+			result->dag_attributes = upload(dag->GetAttributes().data(), result->dag_attribute_range);
+		} else
+			spdlog::warn("Failed to build the octree DAG");
+	}
+	if (options.compact) {
+		auto begin = std::chrono::steady_clock::now();
+		if (std::shared_ptr<CompactOctree> compact = CompactOctree::Convert(thread_pool, words, range)) {
+			spdlog::info("Compact octree built in {} ms ({} MB)",
+			             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count(),
+			             compact->GetRange() / 1000000.0);
+			result->compact = upload(compact->GetWords().data(), compact->GetRange());
+			result->compact_range = compact->GetRange();
+		} else
+			spdlog::warn("Failed to build the compact octree");
+	}
+	if (options.lod) {
+		auto begin = std::chrono::steady_clock::now();
+		std::vector<uint32_t> lod = OctreeLOD::Build(thread_pool, words, range);
+		if (!lod.empty()) {
+			spdlog::info("Octree LOD built in {} ms ({} MB)",
+			             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count(),
+			             lod.size() * sizeof(uint32_t) / 1000000.0);
+			result->lod_range = lod.size() * sizeof(uint32_t);
+			result->lod = upload(lod.data(), result->lod_range);
+		} else
+			spdlog::warn("Failed to build the octree LOD");
+	}
+	if (words == readback_buffer->GetMappedData())
+		return;
+
+	result->octree = upload(words, range);
+	result->range = range;
+}
+
+void LoaderThread::transfer_octree_ownership(const std::shared_ptr<myvk::Buffer> &octree,
+                                             const std::shared_ptr<myvk::CommandPool> &loader_command_pool,
+                                             const std::shared_ptr<myvk::CommandPool> &main_command_pool) const {
+	std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(m_main_queue->GetDevicePtr());
+
+	// release on the loader queue, then acquire on the main queue
+	std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(loader_command_pool);
+	command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                                   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, {},
+	                                   {octree->GetMemoryBarrier(0, 0, m_loader_queue->GetFamilyIndex(),
+	                                                             m_main_queue->GetFamilyIndex())},
+	                                   {});
+	command_buffer->End();
+	command_buffer->Submit(fence);
+	fence->Wait();
+
+	command_buffer = myvk::CommandBuffer::Create(main_command_pool);
+	command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, {},
+	                                   {octree->GetMemoryBarrier(0, 0, m_loader_queue->GetFamilyIndex(),
+	                                                             m_main_queue->GetFamilyIndex())},
+	                                   {});
+	command_buffer->End();
+
+	fence->Reset();
+	command_buffer->Submit(fence);
+	fence->Wait();
+}
+
+void LoaderThread::thread_func(const char *filename, uint32_t octree_level, OctreeLoadOptions options) {
 	spdlog::info("Enter loader thread");
 	m_notification = "";
 
-	std::shared_ptr<myvk::Device> device = m_main_queue->GetDevicePtr();
 	std::shared_ptr<myvk::CommandPool> main_command_pool = myvk::CommandPool::Create(m_main_queue);
 	std::shared_ptr<myvk::CommandPool> loader_command_pool = myvk::CommandPool::Create(m_loader_queue);
 
-	// 检测文件类型并选择不同的处理路径
-	std::string extension = get_file_extension(filename);
-	std::shared_ptr<OctreeBuilder> builder = nullptr;
-	
-	if (extension == ".vox") {
-		spdlog::info("Processing .vox file: {}", filename);
-		
-		// .vox文件处理路径：跳过场景和体素化，直接从体素数据构建
-		m_notification = "Loading .vox file";
-		auto vox_data = VoxLoader::LoadVox(filename);
-		
-		if (vox_data && !vox_data->IsEmpty()) {
-			spdlog::info("Loaded .vox file with {} voxels", vox_data->GetVoxelCount());
-			
-			// 创建VoxDataAdapter
-			m_notification = "Creating VoxDataAdapter";
-			auto vox_adapter = VoxDataAdapter::Create(*vox_data, device, loader_command_pool, octree_level);
-			if (!vox_adapter) {
-				spdlog::error("Failed to create VoxDataAdapter");
-			} else {
-				// 使用VoxDataAdapter创建OctreeBuilder
-				m_notification = "Building Octree from .vox data";
-				builder = OctreeBuilder::Create(vox_adapter, loader_command_pool);
-				
-				if (builder) {
-					// 执行八叉树构建命令
-					std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
-					std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(loader_command_pool);
-					command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-					
-					m_notification = "Building Octree from .vox data";
-					builder->CmdBuild(command_buffer);
-					
-					if (m_main_queue->GetFamilyIndex() != m_loader_queue->GetFamilyIndex()) {
-						builder->CmdTransferOctreeOwnership(command_buffer, m_loader_queue->GetFamilyIndex(),
-						                                    m_main_queue->GetFamilyIndex(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-						                                    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
-					}
-					
-					command_buffer->End();
-					command_buffer->Submit(fence);
-					fence->Wait();
-					
-					spdlog::info("Octree building from .vox FINISHED");
-					
-					if (m_main_queue->GetFamilyIndex() != m_loader_queue->GetFamilyIndex()) {
-						command_buffer = myvk::CommandBuffer::Create(main_command_pool);
-						command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-						builder->CmdTransferOctreeOwnership(command_buffer, m_loader_queue->GetFamilyIndex(),
-						                                    m_main_queue->GetFamilyIndex());
-						command_buffer->End();
-						
-						fence->Reset();
-						command_buffer->Submit(fence);
-						fence->Wait();
-					}
-				} else {
-					spdlog::error("Failed to create OctreeBuilder from VoxDataAdapter");
-				}
-			}
-		} else {
-			spdlog::error("Failed to load .vox file or file is empty");
-		}
-	} else {
-		spdlog::info("Processing OBJ file: {}", filename);
-		
-		// 传统OBJ文件处理路径：场景 -> 体素化 -> 八叉树构建
-		std::shared_ptr<Scene> scene;
-		if ((scene = Scene::Create(m_loader_queue, filename, &m_notification))) {
-			std::shared_ptr<Voxelizer> voxelizer = Voxelizer::Create(scene, loader_command_pool, octree_level);
-			builder = OctreeBuilder::Create(voxelizer, loader_command_pool);
-
-			std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
-			std::shared_ptr<myvk::QueryPool> query_pool = myvk::QueryPool::Create(device, VK_QUERY_TYPE_TIMESTAMP, 4);
-			std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(loader_command_pool);
-			command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-			command_buffer->CmdResetQueryPool(query_pool);
-
-			command_buffer->CmdWriteTimestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 0);
-			voxelizer->CmdVoxelize(command_buffer);
-			command_buffer->CmdWriteTimestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 1);
-
-			command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			                                   {},
-			                                   {voxelizer->GetVoxelFragmentList()->GetMemoryBarrier(
-			                                       VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT)},
-			                                   {});
-
-			command_buffer->CmdWriteTimestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 2);
-			builder->CmdBuild(command_buffer);
-			command_buffer->CmdWriteTimestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 3);
-
-			if (m_main_queue->GetFamilyIndex() != m_loader_queue->GetFamilyIndex()) {
-				builder->CmdTransferOctreeOwnership(command_buffer, m_loader_queue->GetFamilyIndex(),
-				                                    m_main_queue->GetFamilyIndex(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-				                                    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
-			}
-
-			command_buffer->End();
+	LoadResult result{};
+	result.level = octree_level;
+	OctreeCacheOptions cache_options{};
+	cache_options.deduplicate_fragments = options.deduplicate_fragments;
+	cache_options.build_mode = (uint32_t)options.build_mode;
 
-			m_notification = "Voxelizing and Building Octree";
-			spdlog::info("Voxelize and Octree building BEGIN");
-
-			command_buffer->Submit(fence);
-			fence->Wait();
+	// 相同源文件（路径、修改时间）、层级和构建选项的八叉树已缓存时，直接上传缓存
+	if (options.use_cache) {
+		m_notification = "Loading Octree cache";
+		result.octree = OctreeCache::Read(filename, octree_level, cache_options, loader_command_pool,
+		                                  &result.range);
+	}
 
-			// time measurement
-			uint64_t timestamps[4];
-			query_pool->GetResults64(timestamps, VK_QUERY_RESULT_WAIT_BIT);
-			spdlog::info("Voxelize and Octree building FINISHED in {} ms (Voxelize "
-			             "{} ms, Octree building {} ms)",
-			             double(timestamps[3] - timestamps[0]) * 0.000001, double(timestamps[1] - timestamps[0]) * 0.000001,
-			             double(timestamps[3] - timestamps[2]) * 0.000001);
+	if (!result.octree) {
+		// 检测文件类型并选择不同的处理路径
+		std::string extension = get_file_extension(filename);
+		std::shared_ptr<OctreeBuilder> builder = extension == ".vox"
+		                                             ? build_from_vox(filename, octree_level, options, loader_command_pool)
+		                                             : build_from_scene(filename, octree_level, options,
+		                                                                loader_command_pool);
 
-			if (m_main_queue->GetFamilyIndex() != m_loader_queue->GetFamilyIndex()) {
-				command_buffer = myvk::CommandBuffer::Create(main_command_pool);
-				command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-				builder->CmdTransferOctreeOwnership(command_buffer, m_loader_queue->GetFamilyIndex(),
-				                                    m_main_queue->GetFamilyIndex());
-				command_buffer->End();
+		if (builder) {
+			spdlog::info("OctreeBuilder created successfully");
+			result.octree = builder->GetOctree();
+			result.range = builder->GetOctreeRange();
 
-				fence->Reset();
-				command_buffer->Submit(fence);
-				fence->Wait();
+			if (options.use_cache) {
+				m_notification = "Writing Octree cache";
+				OctreeCache::Write(filename, octree_level, cache_options, result.octree, result.range,
+				                   loader_command_pool);
 			}
 		} else {
-			spdlog::error("Failed to create Scene from OBJ file");
+			spdlog::error("Failed to create OctreeBuilder");
 		}
 	}
 
-	// 公共的处理逻辑：无论是.vox还是OBJ文件，都在这里处理结果
-	if (builder) {
-		spdlog::info("OctreeBuilder created successfully");
-		m_promise.set_value(builder);
-	} else {
-		spdlog::error("Failed to create OctreeBuilder");
-		m_promise.set_value(nullptr);
+	// the cache keeps the octree as built, the passes run on every load
+	if (result.octree &&
+	    (options.node_order != OctreeNodeOrder::kBuild || options.tree64 || options.dag || options.compact ||
+	     options.lod)) {
+		m_notification = "Post-processing octree";
+		process_octree(&result, options, loader_command_pool);
+	}
+
+	// 公共的处理逻辑：无论是缓存、.vox还是OBJ文件，都在这里处理结果
+	if (result.octree && m_main_queue->GetFamilyIndex() != m_loader_queue->GetFamilyIndex()) {
+		transfer_octree_ownership(result.octree, loader_command_pool, main_command_pool);
+		if (result.tree64)
+			transfer_octree_ownership(result.tree64, loader_command_pool, main_command_pool);
+		if (result.compact)
+			transfer_octree_ownership(result.compact, loader_command_pool, main_command_pool);
+		if (result.dag) {
+			transfer_octree_ownership(result.dag, loader_command_pool, main_command_pool);
+			transfer_octree_ownership(result.dag_leaf_offsets, loader_command_pool, main_command_pool);
+			transfer_octree_ownership(result.dag_attributes, loader_command_pool, main_command_pool);
+		}
+		if (result.lod)
+			transfer_octree_ownership(result.lod, loader_command_pool, main_command_pool);
 	}
+	m_promise.set_value(result);
 
 	spdlog::info("Quit loader thread");
 }
@@ -3,24 +3,61 @@
 
 #include "Octree.hpp"
 #include "OctreeBuilder.hpp"
+#include "OctreeReorder.hpp"
 #include "myvk/Queue.hpp"
 #include <atomic>
 #include <future>
 #include <memory>
 #include <thread>
 
+struct OctreeLoadOptions {
+	OctreeBuildMode build_mode = OctreeBuildMode::kLevelByLevel;
+	// merge the fragments of each voxel before building, on the GPU after voxelizing a mesh (FragmentDeduplicator), on
+	// the host before uploading a .vox scene
+	bool deduplicate_fragments = false;
+	// read and write the octree and mesh caches, false always rebuilds (e.g. for build timings) and writes no cache
+	bool use_cache = true;
+	// relayout the nodes after building (OctreeReorder)
+	OctreeNodeOrder node_order = OctreeNodeOrder::kBuild;
+	bool tree64 = false;  // also build a Tree64 of the final octree for the wavefront path tracer
+	bool dag = false;     // also build an OctreeDAG of the final octree for the wavefront path tracer
+	bool compact = false; // also convert the final octree to a CompactOctree for the wavefront path tracer
+	bool lod = false;     // also build the OctreeLOD colors of the final octree for the wavefront path tracer
+};
+
 class LoaderThread {
 private:
 	std::shared_ptr<Octree> m_octree_ptr;
 	std::shared_ptr<myvk::Queue> m_loader_queue, m_main_queue;
 
+	// octree buffer owned by the main queue family and its used range, the same for the optional 64-tree
+	struct LoadResult {
+		std::shared_ptr<myvk::Buffer> octree, tree64, compact, lod;
+		std::shared_ptr<myvk::Buffer> dag, dag_leaf_offsets, dag_attributes; // dag_range bytes for the first two
+		uint32_t level{};
+		VkDeviceSize range{}, tree64_range{}, compact_range{}, lod_range{}, dag_range{}, dag_attribute_range{};
+	};
+
 	std::thread m_thread;
-	std::promise<std::shared_ptr<OctreeBuilder>> m_promise;
-	std::future<std::shared_ptr<OctreeBuilder>> m_future;
+	std::promise<LoadResult> m_promise;
+	std::future<LoadResult> m_future;
 
 	std::atomic<const char *> m_notification;
 
-	void thread_func(const char *filename, uint32_t octree_level);
+	void thread_func(const char *filename, uint32_t octree_level, OctreeLoadOptions options);
+	std::shared_ptr<OctreeBuilder> build_from_vox(const char *filename, uint32_t octree_level,
+	                                              const OctreeLoadOptions &options,
+	                                              const std::shared_ptr<myvk::CommandPool> &loader_command_pool);
+	std::shared_ptr<OctreeBuilder> build_from_scene(const char *filename, uint32_t octree_level,
+	                                                const OctreeLoadOptions &options,
+	                                                const std::shared_ptr<myvk::CommandPool> &loader_command_pool);
+	// reorders the nodes of result->octree, then builds result->tree64, result->dag, result->compact and result->lod.
+	// A pass that fails is skipped
+	void process_octree(LoadResult *result, const OctreeLoadOptions &options,
+	                    const std::shared_ptr<myvk::CommandPool> &loader_command_pool) const;
+	void transfer_octree_ownership(const std::shared_ptr<myvk::Buffer> &octree,
+	                               const std::shared_ptr<myvk::CommandPool> &loader_command_pool,
+	                               const std::shared_ptr<myvk::CommandPool> &main_command_pool) const;
 
 public:
 	static std::shared_ptr<LoaderThread> Create(const std::shared_ptr<Octree> &octree,
@@ -32,7 +69,7 @@ public:
 
 	const char *GetNotification() const { return m_notification; }
 
-	void Launch(const char *filename, uint32_t octree_level);
+	void Launch(const char *filename, uint32_t octree_level, const OctreeLoadOptions &options = {});
 	bool TryJoin();
 
 	bool IsRunning() const { return m_thread.joinable(); }
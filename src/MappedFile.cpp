@@ -0,0 +1,94 @@
+#include "MappedFile.hpp"
+
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+std::shared_ptr<MappedFile> MappedFile::Create(const char *filename) {
+	std::shared_ptr<MappedFile> ret = std::make_shared<MappedFile>();
+
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                          FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		spdlog::error("MappedFile: Failed to open {}", filename);
+		return nullptr;
+	}
+	ret->m_file_handle = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		spdlog::error("MappedFile: Failed to get size of {}", filename);
+		return nullptr;
+	}
+	ret->m_size = size.QuadPart;
+	if (ret->m_size == 0)
+		return ret;
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		spdlog::error("MappedFile: Failed to map {}", filename);
+		return nullptr;
+	}
+	ret->m_mapping_handle = mapping;
+
+	ret->m_data = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (ret->m_data == nullptr) {
+		spdlog::error("MappedFile: Failed to map view of {}", filename);
+		return nullptr;
+	}
+	return ret;
+}
+
+MappedFile::~MappedFile() {
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping_handle)
+		CloseHandle(m_mapping_handle);
+	if (m_file_handle)
+		CloseHandle(m_file_handle);
+}
+#else
+std::shared_ptr<MappedFile> MappedFile::Create(const char *filename) {
+	std::shared_ptr<MappedFile> ret = std::make_shared<MappedFile>();
+
+	ret->m_fd = open(filename, O_RDONLY);
+	if (ret->m_fd == -1) {
+		spdlog::error("MappedFile: Failed to open {}", filename);
+		return nullptr;
+	}
+
+	struct stat st {};
+	if (fstat(ret->m_fd, &st) == -1) {
+		spdlog::error("MappedFile: Failed to get size of {}", filename);
+		return nullptr;
+	}
+	ret->m_size = st.st_size;
+	if (ret->m_size == 0)
+		return ret;
+
+	void *data = mmap(nullptr, ret->m_size, PROT_READ, MAP_PRIVATE, ret->m_fd, 0);
+	if (data == MAP_FAILED) {
+		spdlog::error("MappedFile: Failed to map {}", filename);
+		return nullptr;
+	}
+	// the whole file is consumed front to back by every reader
+	madvise(data, ret->m_size, MADV_SEQUENTIAL);
+	ret->m_data = (const uint8_t *)data;
+	return ret;
+}
+
+MappedFile::~MappedFile() {
+	if (m_data)
+		munmap((void *)m_data, m_size);
+	if (m_fd != -1)
+		close(m_fd);
+}
+#endif
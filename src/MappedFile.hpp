@@ -0,0 +1,27 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cinttypes>
+#include <cstddef>
+#include <memory>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+private:
+	const uint8_t *m_data{nullptr};
+	size_t m_size{0};
+#ifdef _WIN32
+	void *m_file_handle{nullptr}, *m_mapping_handle{nullptr};
+#else
+	int m_fd{-1};
+#endif
+
+public:
+	static std::shared_ptr<MappedFile> Create(const char *filename);
+	~MappedFile();
+
+	const uint8_t *GetData() const { return m_data; }
+	size_t GetSize() const { return m_size; }
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "MeshCache.hpp"
+
+#include "CacheKey.hpp"
+#include "Config.hpp"
+#include "MappedFile.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+
+constexpr uint32_t kMeshCacheMagic = 0x4d4f5653; // 'SVOM'
+constexpr uint32_t kMeshCacheVersion = 2;
+
+inline static constexpr size_t align_4(size_t x) { return (x + 3u) & ~(size_t)3u; }
+
+static bool write_padded(FILE *fp, const void *data, size_t size) {
+	static constexpr uint8_t kZeros[4] = {};
+	size_t padding = align_4(size) - size;
+	return fwrite(data, 1, size, fp) == size && fwrite(kZeros, 1, padding, fp) == padding;
+}
+
+bool MeshCache::Write(const char *source_filename, const std::vector<std::string> &texture_names,
+                      const std::vector<DrawCmd> &draw_commands, const std::vector<Vertex> &vertices,
+                      const std::vector<uint32_t> &indices) {
+	CacheKey key;
+	if (!CacheKey::Get(source_filename, &key)) {
+		spdlog::warn("Mesh cache: failed to stat {}", source_filename);
+		return false;
+	}
+	Header header{};
+	header.magic = kMeshCacheMagic;
+	header.version = kMeshCacheVersion;
+	header.source_path_length = key.source_path.size();
+	header.vertex_stride = sizeof(Vertex);
+	header.texture_count = texture_names.size();
+	header.draw_cmd_count = draw_commands.size();
+	header.vertex_count = vertices.size();
+	header.index_count = indices.size();
+	header.source_mtime = key.source_mtime;
+	header.dependency_hash = key.dependency_hash;
+
+	std::error_code ec;
+	std::filesystem::create_directories(kMeshCacheDirectory, ec);
+	std::string cache_filename = key.GetFilename(kMeshCacheDirectory, ".mesh");
+	// write to a temporary file first so that an interrupted write never leaves a valid-looking cache
+	std::string temp_filename = cache_filename + ".tmp";
+	FILE *fp = fopen(temp_filename.c_str(), "wb");
+	if (!fp) {
+		spdlog::warn("Mesh cache: failed to create {}", temp_filename);
+		return false;
+	}
+	bool success = fwrite(&header, sizeof(Header), 1, fp) == 1 &&
+	               write_padded(fp, key.source_path.data(), key.source_path.size());
+	for (const std::string &name : texture_names) {
+		uint32_t length = name.size();
+		success = success && fwrite(&length, sizeof(uint32_t), 1, fp) == 1 &&
+		          write_padded(fp, name.data(), name.size());
+	}
+	success = success &&
+	          fwrite(draw_commands.data(), sizeof(DrawCmd), draw_commands.size(), fp) == draw_commands.size() &&
+	          fwrite(vertices.data(), sizeof(Vertex), vertices.size(), fp) == vertices.size() &&
+	          fwrite(indices.data(), sizeof(uint32_t), indices.size(), fp) == indices.size();
+	success &= fclose(fp) == 0;
+
+	if (success)
+		std::filesystem::rename(temp_filename, cache_filename, ec);
+	if (!success || ec) {
+		spdlog::warn("Mesh cache: failed to write {}", cache_filename);
+		std::filesystem::remove(temp_filename, ec);
+		return false;
+	}
+	spdlog::info("Mesh cache written to {}", cache_filename);
+	return true;
+}
+
+std::shared_ptr<MeshCache> MeshCache::Read(const char *source_filename) {
+	CacheKey key;
+	if (!CacheKey::Get(source_filename, &key))
+		return nullptr;
+
+	std::string cache_filename = key.GetFilename(kMeshCacheDirectory, ".mesh");
+	if (!std::filesystem::exists(cache_filename))
+		return nullptr;
+	std::shared_ptr<MappedFile> mapped_file = MappedFile::Create(cache_filename.c_str());
+	if (!mapped_file)
+		return nullptr;
+
+	const uint8_t *data = mapped_file->GetData();
+	size_t size = mapped_file->GetSize(), offset = sizeof(Header);
+	// moves the offset over an aligned block, false if it would run past the end of the file
+	const auto consume = [size, &offset](size_t bytes) -> bool {
+		if (bytes > size - offset)
+			return false;
+		offset += align_4(bytes);
+		return offset <= size;
+	};
+
+	Header header;
+	if (size < sizeof(Header))
+		return nullptr;
+	std::memcpy(&header, data, sizeof(Header));
+	if (header.magic != kMeshCacheMagic || header.version != kMeshCacheVersion ||
+	    header.vertex_stride != sizeof(Vertex) || !consume(header.source_path_length) ||
+	    header.texture_count > (size - offset) / sizeof(uint32_t)) {
+		spdlog::warn("Mesh cache: {} is invalid or from an older version, reloading", cache_filename);
+		return nullptr;
+	}
+	if (header.source_mtime != key.source_mtime || header.dependency_hash != key.dependency_hash ||
+	    std::string((const char *)data + sizeof(Header), header.source_path_length) != key.source_path) {
+		spdlog::info("Mesh cache: {} is stale, reloading", cache_filename);
+		return nullptr;
+	}
+
+	std::shared_ptr<MeshCache> ret = std::make_shared<MeshCache>();
+	ret->m_texture_names.resize(header.texture_count);
+	bool valid = true;
+	for (std::string &name : ret->m_texture_names) {
+		uint32_t length;
+		if (!(valid = consume(sizeof(uint32_t))))
+			break;
+		std::memcpy(&length, data + offset - sizeof(uint32_t), sizeof(uint32_t));
+		size_t name_offset = offset;
+		if (!(valid = consume(length)))
+			break;
+		name.assign((const char *)data + name_offset, length);
+	}
+	size_t draw_cmd_offset = offset;
+	valid = valid && consume(header.draw_cmd_count * sizeof(DrawCmd)) &&
+	        header.vertex_count <= (size - offset) / sizeof(Vertex);
+	size_t vertex_offset = offset;
+	valid = valid && consume(header.vertex_count * sizeof(Vertex)) && (size - offset) % sizeof(uint32_t) == 0 &&
+	        header.index_count == (size - offset) / sizeof(uint32_t);
+	size_t index_offset = offset;
+	if (valid) {
+		ret->m_draw_commands.resize(header.draw_cmd_count);
+		std::memcpy(ret->m_draw_commands.data(), data + draw_cmd_offset, header.draw_cmd_count * sizeof(DrawCmd));
+		for (const DrawCmd &draw_cmd : ret->m_draw_commands)
+			valid &= (uint64_t)draw_cmd.first_index + draw_cmd.index_count <= header.index_count &&
+			         (draw_cmd.texture_id == UINT32_MAX || draw_cmd.texture_id < header.texture_count);
+	}
+	if (!valid) {
+		spdlog::warn("Mesh cache: {} is invalid or from an older version, reloading", cache_filename);
+		return nullptr;
+	}
+
+	ret->m_vertices = (const Vertex *)(data + vertex_offset);
+	ret->m_vertex_count = header.vertex_count;
+	ret->m_indices = (const uint32_t *)(data + index_offset);
+	ret->m_index_count = header.index_count;
+	ret->m_mapped_file = std::move(mapped_file);
+
+	spdlog::info("Mesh loaded from cache {} ({}/{} vertices)", cache_filename, ret->m_vertex_count,
+	             ret->m_index_count);
+	return ret;
+}
@@ -0,0 +1,57 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include "ObjLoader.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+// On-disk cache of an optimized Scene mesh, keyed by the path and the mtime of the OBJ file and the mtimes of its
+// material libraries and textures (CacheKey).
+// Layout: Header, source path, texture names (each as a length word followed by the characters, padded to 4 bytes),
+// then the draw commands, the vertices and the indices.
+class MeshCache {
+public:
+	using Vertex = ObjLoader::Vertex;
+	struct DrawCmd {
+		uint32_t texture_id, albedo; // texture_id indexes the texture names, UINT32_MAX for none
+		uint32_t index_count, first_index;
+	};
+
+private:
+	struct Header {
+		uint32_t magic, version;
+		uint32_t source_path_length, vertex_stride;
+		uint32_t texture_count, draw_cmd_count;
+		uint64_t vertex_count, index_count;
+		int64_t source_mtime;
+		uint64_t dependency_hash; // CacheKey::dependency_hash
+	};
+
+	std::shared_ptr<MappedFile> m_mapped_file;
+	std::vector<std::string> m_texture_names;
+	std::vector<DrawCmd> m_draw_commands;
+	const Vertex *m_vertices{};
+	const uint32_t *m_indices{};
+	size_t m_vertex_count{}, m_index_count{};
+
+public:
+	static bool Write(const char *source_filename, const std::vector<std::string> &texture_names,
+	                  const std::vector<DrawCmd> &draw_commands, const std::vector<Vertex> &vertices,
+	                  const std::vector<uint32_t> &indices);
+
+	// Maps the cache file, nullptr on cache miss. The vertex and index pointers stay valid while the object lives.
+	static std::shared_ptr<MeshCache> Read(const char *source_filename);
+
+	const std::vector<std::string> &GetTextureNames() const { return m_texture_names; }
+	const std::vector<DrawCmd> &GetDrawCommands() const { return m_draw_commands; }
+	const Vertex *GetVertices() const { return m_vertices; }
+	size_t GetVertexCount() const { return m_vertex_count; }
+	const uint32_t *GetIndices() const { return m_indices; }
+	size_t GetIndexCount() const { return m_index_count; }
+};
+
+#endif
@@ -0,0 +1,378 @@
+#include "ObjLoader.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <string_view>
+#include <unordered_map>
+
+static constexpr size_t kChunkSizeMin = 1u << 20u;
+static constexpr size_t kGatherGrain = 65536;
+static constexpr uint32_t kNoTexcoord = UINT32_MAX;
+
+inline static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline static const char *skip_space(const char *cur, const char *end) {
+	while (cur < end && is_space(*cur))
+		++cur;
+	return cur;
+}
+// the start of the whitespace that ends at cur
+inline static const char *skip_space_back(const char *begin, const char *cur) {
+	while (cur > begin && is_space(cur[-1]))
+		--cur;
+	return cur;
+}
+inline static const char *skip_token(const char *cur, const char *end) {
+	while (cur < end && !is_space(*cur))
+		++cur;
+	return cur;
+}
+// reads the next whitespace separated token, empty at the end of the line
+inline static std::string_view next_token(const char **cur, const char *end) {
+	const char *begin = skip_space(*cur, end);
+	*cur = skip_token(begin, end);
+	return {begin, (size_t)(*cur - begin)};
+}
+// a '#' after the keyword starts a trailing comment, e.g. "f 1 2 3 # quad 7"
+inline static const char *strip_comment(const char *cur, const char *end) {
+	const char *hash = (const char *)memchr(cur, '#', end - cur);
+	return hash ? hash : end;
+}
+inline static float next_float(const char **cur, const char *end) {
+	std::string_view token = next_token(cur, end);
+	if (!token.empty() && token.front() == '+')
+		token.remove_prefix(1);
+	float value = 0.0f;
+	std::from_chars(token.data(), token.data() + token.size(), value);
+	return value;
+}
+
+// a face corner "v", "v/vt", "v//vn" or "v/vt/vn", 0 for a missing index
+struct CornerRef {
+	int32_t v, vt;
+};
+inline static bool parse_corner(std::string_view token, CornerRef *ref) {
+	const char *cur = token.data(), *end = token.data() + token.size();
+	ref->v = ref->vt = 0;
+	auto [ptr, ec] = std::from_chars(cur, end, ref->v);
+	if (ec != std::errc{} || ref->v == 0)
+		return false;
+	if (ptr < end && *ptr == '/' && ptr + 1 < end && ptr[1] != '/')
+		std::from_chars(ptr + 1, end, ref->vt);
+	return true;
+}
+// OBJ indices are 1-based, negative ones count back from the vertices read so far
+inline static uint32_t resolve_index(int32_t index, size_t count) {
+	return index > 0 ? uint32_t(index - 1) : uint32_t((int64_t)count + index);
+}
+
+template <typename LineFunc> inline static void for_each_line(const char *begin, const char *end, LineFunc &&func) {
+	while (begin < end) {
+		const char *line_end = (const char *)memchr(begin, '\n', end - begin);
+		if (!line_end)
+			line_end = end;
+		const char *cur = begin;
+		std::string_view keyword = next_token(&cur, line_end);
+		if (!keyword.empty() && keyword.front() != '#')
+			func(keyword, cur, line_end);
+		begin = line_end + 1;
+	}
+}
+
+struct ObjLoader::Chunk {
+	const char *begin, *end;
+	size_t position_count{}, texcoord_count{};
+	size_t position_base{}, texcoord_base{};
+	// triangle corners between usemtl statements, the first segment continues the material of the previous chunk
+	struct Segment {
+		std::string_view material;
+		bool inherited;
+		size_t corner_count;
+		uint32_t material_id;
+		size_t first_corner;
+	};
+	std::vector<Segment> segments;
+	std::vector<std::string_view> mtllibs;
+};
+
+bool ObjLoader::load_materials(const std::string &filename, std::vector<Material> *materials) {
+	std::ifstream fin{filename};
+	if (!fin.is_open())
+		return false;
+	std::string line;
+	while (std::getline(fin, line)) {
+		const char *cur = line.data(), *end = line.data() + line.size();
+		std::string_view keyword = next_token(&cur, end);
+		if (keyword == "newmtl") {
+			materials->emplace_back();
+			materials->back().name = next_token(&cur, end);
+		} else if (materials->empty())
+			continue;
+		else if (keyword == "Kd") {
+			glm::vec3 &diffuse = materials->back().diffuse;
+			diffuse.x = next_float(&cur, end);
+			diffuse.y = next_float(&cur, end);
+			diffuse.z = next_float(&cur, end);
+		} else if (keyword == "map_Kd") {
+			// texture options come first, the filename is the last token
+			std::string_view texname;
+			for (std::string_view token; !(token = next_token(&cur, end)).empty();)
+				texname = token;
+			materials->back().diffuse_texname = texname;
+		}
+	}
+	return true;
+}
+
+std::shared_ptr<ObjLoader::ObjData> ObjLoader::LoadObj(const char *filename, const char *base_dir) {
+	std::shared_ptr<MappedFile> mapped_file = MappedFile::Create(filename);
+	if (!mapped_file) {
+		spdlog::error("Failed to open {}", filename);
+		return nullptr;
+	}
+	ThreadPool &pool = *ThreadPool::GetDefault();
+	const char *data = (const char *)mapped_file->GetData();
+	const size_t size = mapped_file->GetSize();
+
+	// split at line boundaries
+	std::vector<Chunk> chunks;
+	{
+		size_t chunk_size = std::max(kChunkSizeMin, size / (pool.GetThreadCount() * 8u + 1u));
+		for (size_t begin = 0; begin < size;) {
+			size_t end = std::min(begin + chunk_size, size);
+			const char *line_end = (const char *)memchr(data + end, '\n', size - end);
+			end = line_end ? line_end - data + 1 : size;
+			chunks.push_back({data + begin, data + end});
+			begin = end;
+		}
+	}
+
+	// pass 1: count vertices and triangle corners per material segment
+	pool.ParallelFor(chunks.size(), 1, [&chunks](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; ++c) {
+			Chunk &chunk = chunks[c];
+			chunk.segments.push_back({{}, true, 0});
+			for_each_line(chunk.begin, chunk.end, [&chunk](std::string_view keyword, const char *cur, const char *end) {
+				if (keyword == "v")
+					++chunk.position_count;
+				else if (keyword == "vt")
+					++chunk.texcoord_count;
+				else if (keyword == "f") {
+					end = strip_comment(cur, end);
+					size_t corner_count = 0;
+					while (!next_token(&cur, end).empty())
+						++corner_count;
+					if (corner_count >= 3)
+						chunk.segments.back().corner_count += (corner_count - 2) * 3;
+				} else if (keyword == "usemtl")
+					chunk.segments.push_back({next_token(&cur, end), false, 0});
+				else if (keyword == "mtllib")
+					for (std::string_view token; !(token = next_token(&cur, end)).empty();)
+						chunk.mtllibs.push_back(token);
+			});
+		}
+	});
+
+	std::shared_ptr<ObjData> ret = std::make_shared<ObjData>();
+
+	// materials
+	std::unordered_map<std::string, uint32_t> material_ids;
+	{
+		std::vector<std::string_view> mtllibs;
+		for (const Chunk &chunk : chunks)
+			for (std::string_view mtllib : chunk.mtllibs)
+				if (std::find(mtllibs.begin(), mtllibs.end(), mtllib) == mtllibs.end()) {
+					mtllibs.push_back(mtllib);
+					if (!load_materials(base_dir + std::string{mtllib}, &ret->materials))
+						spdlog::warn("Failed to load material library {}", mtllib);
+				}
+		for (uint32_t i = 0; i < ret->materials.size(); ++i)
+			material_ids.emplace(ret->materials[i].name, i);
+	}
+	// faces without a (known) material use a default one
+	const auto get_material_id = [&ret, &material_ids](std::string_view name) -> uint32_t {
+		auto it = material_ids.find(std::string{name});
+		if (it != material_ids.end())
+			return it->second;
+		if (!name.empty())
+			spdlog::warn("Material {} not found", name);
+		ret->materials.emplace_back().name = name;
+		uint32_t id = ret->materials.size() - 1;
+		material_ids.emplace(std::string{name}, id);
+		return id;
+	};
+
+	// resolve segment materials, vertex bases and the destination of every segment
+	size_t position_count = 0, texcoord_count = 0;
+	{
+		std::vector<size_t> material_corner_counts;
+		uint32_t current_material = UINT32_MAX;
+		for (Chunk &chunk : chunks) {
+			chunk.position_base = position_count;
+			chunk.texcoord_base = texcoord_count;
+			position_count += chunk.position_count;
+			texcoord_count += chunk.texcoord_count;
+			for (Chunk::Segment &segment : chunk.segments) {
+				if (!segment.inherited || (current_material == UINT32_MAX && segment.corner_count))
+					current_material = get_material_id(segment.material);
+				segment.material_id = current_material;
+				if (segment.corner_count) {
+					material_corner_counts.resize(ret->materials.size(), 0);
+					material_corner_counts[current_material] += segment.corner_count;
+				}
+			}
+		}
+		material_corner_counts.resize(ret->materials.size(), 0);
+
+		for (uint32_t i = 0; i < material_corner_counts.size(); ++i)
+			if (material_corner_counts[i])
+				ret->ranges.push_back({i, 0, material_corner_counts[i]});
+		std::stable_sort(ret->ranges.begin(), ret->ranges.end(), [](const MaterialRange &l, const MaterialRange &r) {
+			return l.vertex_count > r.vertex_count;
+		});
+		std::vector<size_t> material_cursors(material_corner_counts.size());
+		size_t corner_count = 0;
+		for (MaterialRange &range : ret->ranges) {
+			range.first_vertex = corner_count;
+			material_cursors[range.material_id] = corner_count;
+			corner_count += range.vertex_count;
+		}
+		for (Chunk &chunk : chunks)
+			for (Chunk::Segment &segment : chunk.segments)
+				if (segment.corner_count) {
+					segment.first_corner = material_cursors[segment.material_id];
+					material_cursors[segment.material_id] += segment.corner_count;
+				}
+		ret->vertices.resize(corner_count);
+	}
+	if (ret->vertices.empty()) {
+		spdlog::error("Empty mesh");
+		return nullptr;
+	}
+
+	// pass 2: parse vertices and write the resolved face references to their final slots
+	std::vector<glm::vec3> positions(position_count);
+	std::vector<glm::vec2> texcoords(texcoord_count);
+	std::vector<uint32_t> corner_positions(ret->vertices.size()), corner_texcoords(ret->vertices.size());
+	pool.ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+		std::vector<CornerRef> face;
+		for (size_t c = begin; c < end; ++c) {
+			const Chunk &chunk = chunks[c];
+			size_t position_cur = chunk.position_base, texcoord_cur = chunk.texcoord_base;
+			size_t segment_id = 0, corner_cur = chunk.segments[0].first_corner;
+			for_each_line(chunk.begin, chunk.end, [&](std::string_view keyword, const char *cur, const char *end) {
+				if (keyword == "v") {
+					glm::vec3 &position = positions[position_cur++];
+					position.x = next_float(&cur, end);
+					position.y = next_float(&cur, end);
+					position.z = next_float(&cur, end);
+				} else if (keyword == "vt") {
+					glm::vec2 &texcoord = texcoords[texcoord_cur++];
+					texcoord.x = next_float(&cur, end);
+					texcoord.y = next_float(&cur, end);
+				} else if (keyword == "f") {
+					end = strip_comment(cur, end);
+					face.clear();
+					for (std::string_view token; !(token = next_token(&cur, end)).empty();) {
+						face.emplace_back();
+						if (!parse_corner(token, &face.back()))
+							face.back() = {INT32_MIN, 0}; // rejected in pass 3
+					}
+					if (face.size() < 3)
+						return;
+					const auto write_corner = [&](const CornerRef &ref) {
+						corner_positions[corner_cur] = resolve_index(ref.v, position_cur);
+						corner_texcoords[corner_cur] = ref.vt ? resolve_index(ref.vt, texcoord_cur) : kNoTexcoord;
+						++corner_cur;
+					};
+					for (size_t i = 1; i + 1 < face.size(); ++i) {
+						write_corner(face[0]);
+						write_corner(face[i]);
+						write_corner(face[i + 1]);
+					}
+				} else if (keyword == "usemtl")
+					corner_cur = chunk.segments[++segment_id].first_corner;
+			});
+		}
+	});
+	mapped_file = nullptr;
+
+	// pass 3: gather the corners
+	std::vector<std::pair<glm::vec3, glm::vec3>> bounds((ret->vertices.size() + kGatherGrain - 1) / kGatherGrain,
+	                                                    {glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)});
+	std::atomic_bool index_error{false};
+	pool.ParallelFor(ret->vertices.size(), kGatherGrain, [&](size_t begin, size_t end) {
+		glm::vec3 pmin(FLT_MAX), pmax(-FLT_MAX);
+		for (size_t i = begin; i < end; ++i) {
+			Vertex &vertex = ret->vertices[i];
+			uint32_t p = corner_positions[i], t = corner_texcoords[i];
+			if (p >= position_count || (t != kNoTexcoord && t >= texcoord_count)) {
+				index_error = true;
+				vertex = {};
+				continue;
+			}
+			vertex.m_position = positions[p];
+			vertex.m_texcoord = t == kNoTexcoord ? glm::vec2(0.0f) : glm::vec2(texcoords[t].x, 1.0f - texcoords[t].y);
+			pmin = glm::min(vertex.m_position, pmin);
+			pmax = glm::max(vertex.m_position, pmax);
+		}
+		bounds[begin / kGatherGrain] = {pmin, pmax};
+	});
+	if (index_error) {
+		spdlog::error("Invalid face index in {}", filename);
+		return nullptr;
+	}
+	ret->min_position = glm::vec3(FLT_MAX);
+	ret->max_position = glm::vec3(-FLT_MAX);
+	for (const auto &bound : bounds) {
+		ret->min_position = glm::min(ret->min_position, bound.first);
+		ret->max_position = glm::max(ret->max_position, bound.second);
+	}
+
+	spdlog::info("OBJ parsed: {} positions, {} texcoords, {} triangles, {} materials ({} chunks)", position_count,
+	             texcoord_count, ret->vertices.size() / 3, ret->ranges.size(), chunks.size());
+	return ret;
+}
+
+std::vector<std::string> ObjLoader::GetDependencies(const char *filename, const char *base_dir) {
+	std::vector<std::string> ret;
+	std::shared_ptr<MappedFile> mapped_file = MappedFile::Create(filename);
+	if (!mapped_file)
+		return ret;
+
+	// only the mtllib lines are needed, search for the keyword instead of splitting the whole file into lines
+	const char *data = (const char *)mapped_file->GetData(), *data_end = data + mapped_file->GetSize();
+	std::string_view text{data, mapped_file->GetSize()};
+	std::vector<std::string_view> mtllibs;
+	for (size_t pos = text.find("mtllib"); pos != std::string_view::npos; pos = text.find("mtllib", pos + 1)) {
+		const char *line_begin = skip_space_back(data, data + pos), *cur = data + pos + 6;
+		if ((line_begin > data && line_begin[-1] != '\n') || (cur < data_end && !is_space(*cur)))
+			continue;
+		const char *line_end = (const char *)memchr(cur, '\n', data_end - cur);
+		for (std::string_view token; !(token = next_token(&cur, line_end ? line_end : data_end)).empty();)
+			if (std::find(mtllibs.begin(), mtllibs.end(), token) == mtllibs.end())
+				mtllibs.push_back(token);
+	}
+
+	std::vector<Material> materials;
+	for (std::string_view mtllib : mtllibs) {
+		ret.push_back(base_dir + std::string{mtllib});
+		load_materials(ret.back(), &materials);
+	}
+	// as Scene resolves the texture names
+	for (const Material &material : materials) {
+		if (material.diffuse_texname.empty())
+			continue;
+		std::string texture = base_dir + material.diffuse_texname;
+		std::replace(texture.begin() + strlen(base_dir), texture.end(), '\\', '/');
+		if (std::find(ret.begin(), ret.end(), texture) == ret.end())
+			ret.push_back(std::move(texture));
+	}
+	return ret;
+}
@@ -0,0 +1,49 @@
+#ifndef OBJ_LOADER_HPP
+#define OBJ_LOADER_HPP
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Multithreaded Wavefront OBJ loader over a memory-mapped file.
+// The file is split into chunks at line boundaries. A first parallel pass counts the vertices and the triangle corners
+// of every material in each chunk, a second one parses the chunks into the global position / texcoord arrays and
+// writes resolved v/vt references straight to the final slots, and a third one gathers the triangle corners into one
+// flat vertex array that holds the corners of each material contiguously.
+// Supported: v, vt, f (v, v/vt, v//vn, v/vt/vn, negative indices, polygons are fan triangulated), usemtl, mtllib
+// (newmtl, Kd, map_Kd). Everything else is ignored.
+class ObjLoader {
+public:
+	struct Vertex {
+		glm::vec3 m_position;
+		glm::vec2 m_texcoord; // v flipped, (0, 0) if the corner has no texcoord
+	};
+	struct Material {
+		std::string name;
+		glm::vec3 diffuse{0.6f};
+		std::string diffuse_texname;
+	};
+	struct MaterialRange {
+		uint32_t material_id;
+		size_t first_vertex, vertex_count;
+	};
+	struct ObjData {
+		std::vector<Material> materials;
+		std::vector<MaterialRange> ranges; // non-empty only, sorted by descending vertex count
+		std::vector<Vertex> vertices;      // triangle corners, in range order
+		glm::vec3 min_position, max_position;
+	};
+
+	static std::shared_ptr<ObjData> LoadObj(const char *filename, const char *base_dir);
+
+	// The files LoadObj reads besides filename: its material libraries and their diffuse textures, prefixed with
+	// base_dir (missing ones included)
+	static std::vector<std::string> GetDependencies(const char *filename, const char *base_dir);
+
+private:
+	struct Chunk;
+	static bool load_materials(const std::string &filename, std::vector<Material> *materials);
+};
+
+#endif
@@ -11,32 +11,105 @@ std::shared_ptr<Octree> Octree::Create(const std::shared_ptr<myvk::Device> &devi
 		octree_binding.descriptorCount = 1;
 		octree_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
-		ret->m_descriptor_set_layout = myvk::DescriptorSetLayout::Create(device, {octree_binding});
+		VkDescriptorSetLayoutBinding dag_leaf_offset_binding = octree_binding;
+		dag_leaf_offset_binding.binding = 1;
+		VkDescriptorSetLayoutBinding dag_attribute_binding = octree_binding;
+		dag_attribute_binding.binding = 2;
+		VkDescriptorSetLayoutBinding lod_binding = octree_binding;
+		lod_binding.binding = 3;
+
+		ret->m_descriptor_set_layout = myvk::DescriptorSetLayout::Create(
+		    device, {octree_binding, dag_leaf_offset_binding, dag_attribute_binding, lod_binding});
 	}
-	ret->m_descriptor_pool = myvk::DescriptorPool::Create(device, 1, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1}});
+	ret->m_descriptor_pool = myvk::DescriptorPool::Create(device, 4, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 16}});
 	ret->m_descriptor_set = myvk::DescriptorSet::Create(ret->m_descriptor_pool, ret->m_descriptor_set_layout);
+	ret->m_tree64_descriptor_set = myvk::DescriptorSet::Create(ret->m_descriptor_pool, ret->m_descriptor_set_layout);
+	ret->m_dag_descriptor_set = myvk::DescriptorSet::Create(ret->m_descriptor_pool, ret->m_descriptor_set_layout);
+	ret->m_compact_descriptor_set =
+	    myvk::DescriptorSet::Create(ret->m_descriptor_pool, ret->m_descriptor_set_layout);
+
+	ret->m_placeholder_buffer = myvk::Buffer::Create(device, sizeof(uint32_t), 0, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	for (const auto &descriptor_set : {ret->m_descriptor_set, ret->m_tree64_descriptor_set, ret->m_dag_descriptor_set,
+	                                   ret->m_compact_descriptor_set})
+		for (uint32_t binding = 1; binding <= 3; ++binding)
+			descriptor_set->UpdateStorageBuffer(ret->m_placeholder_buffer, binding);
 
 	return ret;
 }
 
-void Octree::Update(const std::shared_ptr<myvk::CommandPool> &command_pool,
-                    const std::shared_ptr<OctreeBuilder> &builder) {
-	uint32_t octree_range = builder->GetOctreeRange(command_pool);
-	m_buffer = builder->GetOctree();
-	m_level = builder->GetLevel();
-	m_range = octree_range;
+void Octree::Update(const std::shared_ptr<OctreeBuilder> &builder) {
+	Update(builder->GetOctree(), builder->GetLevel(), builder->GetOctreeRange());
+}
+
+void Octree::Update(const std::shared_ptr<myvk::Buffer> &buffer, uint32_t level, VkDeviceSize range) {
+	m_buffer = buffer;
+	m_level = level;
+	m_range = range;
 
-	uint32_t actual_range = octree_range;
+	VkDeviceSize actual_range = range;
 	if (m_buffer->GetSize() < actual_range) {
 		spdlog::error("Octree size exceed");
 		actual_range = m_buffer->GetSize();
 	}
 	m_descriptor_set->UpdateStorageBuffer(m_buffer, 0, 0, 0, actual_range);
 }
+
+void Octree::UpdateTree64(const std::shared_ptr<myvk::Buffer> &buffer, VkDeviceSize range) {
+	m_tree64_buffer = buffer;
+	m_tree64_range = buffer ? range : 0;
+	if (buffer)
+		m_tree64_descriptor_set->UpdateStorageBuffer(m_tree64_buffer, 0, 0, 0, range);
+}
+
+void Octree::UpdateDAG(const std::shared_ptr<myvk::Buffer> &buffer,
+                       const std::shared_ptr<myvk::Buffer> &leaf_offset_buffer, VkDeviceSize range,
+                       const std::shared_ptr<myvk::Buffer> &attribute_buffer, VkDeviceSize attribute_range) {
+	m_dag_buffer = buffer;
+	m_dag_leaf_offset_buffer = buffer ? leaf_offset_buffer : nullptr;
+	m_dag_attribute_buffer = buffer ? attribute_buffer : nullptr;
+	m_dag_range = buffer ? range : 0;
+	m_dag_attribute_range = buffer ? attribute_range : 0;
+	if (buffer) {
+		m_dag_descriptor_set->UpdateStorageBuffer(m_dag_buffer, 0, 0, 0, range);
+		m_dag_descriptor_set->UpdateStorageBuffer(m_dag_leaf_offset_buffer, 1, 0, 0, range);
+		m_dag_descriptor_set->UpdateStorageBuffer(m_dag_attribute_buffer, 2, 0, 0, attribute_range);
+	}
+}
+
+void Octree::UpdateCompact(const std::shared_ptr<myvk::Buffer> &buffer, VkDeviceSize range) {
+	m_compact_buffer = buffer;
+	m_compact_range = buffer ? range : 0;
+	if (buffer)
+		m_compact_descriptor_set->UpdateStorageBuffer(m_compact_buffer, 0, 0, 0, range);
+}
+
+void Octree::UpdateLOD(const std::shared_ptr<myvk::Buffer> &buffer, VkDeviceSize range) {
+	m_lod_buffer = buffer;
+	m_lod_range = buffer ? range : 0;
+	if (buffer)
+		m_descriptor_set->UpdateStorageBuffer(m_lod_buffer, 3, 0, 0, range);
+	else
+		m_descriptor_set->UpdateStorageBuffer(m_placeholder_buffer, 3);
+}
 void Octree::CmdTransferOwnership(const std::shared_ptr<myvk::CommandBuffer> &command_buffer, uint32_t src_queue_family,
                                   uint32_t dst_queue_family, VkPipelineStageFlags src_stage,
                                   VkPipelineStageFlags dst_stage) const {
-	command_buffer->CmdPipelineBarrier(
-	    src_stage, dst_stage, {}, {m_buffer->GetMemoryBarrier({0, m_range}, 0, 0, src_queue_family, dst_queue_family)},
-	    {});
+	std::vector<VkBufferMemoryBarrier> barriers = {
+	    m_buffer->GetMemoryBarrier({0, m_range}, 0, 0, src_queue_family, dst_queue_family)};
+	if (m_tree64_buffer)
+		barriers.push_back(
+		    m_tree64_buffer->GetMemoryBarrier({0, m_tree64_range}, 0, 0, src_queue_family, dst_queue_family));
+	if (m_dag_buffer) {
+		barriers.push_back(m_dag_buffer->GetMemoryBarrier({0, m_dag_range}, 0, 0, src_queue_family, dst_queue_family));
+		barriers.push_back(
+		    m_dag_leaf_offset_buffer->GetMemoryBarrier({0, m_dag_range}, 0, 0, src_queue_family, dst_queue_family));
+		barriers.push_back(m_dag_attribute_buffer->GetMemoryBarrier({0, m_dag_attribute_range}, 0, 0,
+		                                                            src_queue_family, dst_queue_family));
+	}
+	if (m_compact_buffer)
+		barriers.push_back(
+		    m_compact_buffer->GetMemoryBarrier({0, m_compact_range}, 0, 0, src_queue_family, dst_queue_family));
+	if (m_lod_buffer)
+		barriers.push_back(m_lod_buffer->GetMemoryBarrier({0, m_lod_range}, 0, 0, src_queue_family, dst_queue_family));
+	command_buffer->CmdPipelineBarrier(src_stage, dst_stage, {}, barriers, {});
 }
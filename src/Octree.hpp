@@ -13,19 +13,58 @@ private:
 	std::shared_ptr<myvk::DescriptorPool> m_descriptor_pool;
 	std::shared_ptr<myvk::DescriptorSetLayout> m_descriptor_set_layout;
 	std::shared_ptr<myvk::DescriptorSet> m_descriptor_set;
+	// optional Tree64 of the same scene, bound in place of the octree with the same layout
+	std::shared_ptr<myvk::Buffer> m_tree64_buffer;
+	VkDeviceSize m_tree64_range{};
+	std::shared_ptr<myvk::DescriptorSet> m_tree64_descriptor_set;
+	// optional OctreeDAG of the same scene, bound in place of the octree with the same layout: the DAG nodes at
+	// binding 0, its leaf offsets at binding 1 and its attributes at binding 2 (shader/dag.glsl)
+	std::shared_ptr<myvk::Buffer> m_dag_buffer, m_dag_leaf_offset_buffer, m_dag_attribute_buffer;
+	VkDeviceSize m_dag_range{}, m_dag_attribute_range{};
+	std::shared_ptr<myvk::DescriptorSet> m_dag_descriptor_set;
+	// optional CompactOctree of the same scene, bound in place of the octree with the same layout
+	std::shared_ptr<myvk::Buffer> m_compact_buffer;
+	VkDeviceSize m_compact_range{};
+	std::shared_ptr<myvk::DescriptorSet> m_compact_descriptor_set;
+	// optional OctreeLOD words at binding 3 (shader/octree.glsl with OCTREE_LOD). The bindings 1-3 of every set
+	// always hold a buffer, m_placeholder_buffer until one is loaded, since the wavefront kernels reference them
+	// whether they use them or not
+	std::shared_ptr<myvk::Buffer> m_lod_buffer, m_placeholder_buffer;
+	VkDeviceSize m_lod_range{};
 
 public:
 	static std::shared_ptr<Octree> Create(const std::shared_ptr<myvk::Device> &device);
 
-	void Update(const std::shared_ptr<myvk::CommandPool> &command_pool, const std::shared_ptr<OctreeBuilder> &builder);
+	void Update(const std::shared_ptr<OctreeBuilder> &builder);
+	void Update(const std::shared_ptr<myvk::Buffer> &buffer, uint32_t level, VkDeviceSize range);
+	// buffer = nullptr drops the 64-tree, e.g. when the next octree is loaded without one
+	void UpdateTree64(const std::shared_ptr<myvk::Buffer> &buffer, VkDeviceSize range);
 	bool Empty() const { return m_buffer == nullptr; }
+	bool HasTree64() const { return m_tree64_buffer != nullptr; }
+	// range: bytes of the nodes and of the leaf offsets (a word per node word), buffer = nullptr drops the DAG
+	void UpdateDAG(const std::shared_ptr<myvk::Buffer> &buffer, const std::shared_ptr<myvk::Buffer> &leaf_offset_buffer,
+	               VkDeviceSize range, const std::shared_ptr<myvk::Buffer> &attribute_buffer,
+	               VkDeviceSize attribute_range);
+	bool HasDAG() const { return m_dag_buffer != nullptr; }
+	// buffer = nullptr drops the compact encoding
+	void UpdateCompact(const std::shared_ptr<myvk::Buffer> &buffer, VkDeviceSize range);
+	bool HasCompact() const { return m_compact_buffer != nullptr; }
+	// buffer = nullptr drops the LOD words
+	void UpdateLOD(const std::shared_ptr<myvk::Buffer> &buffer, VkDeviceSize range);
+	bool HasLOD() const { return m_lod_buffer != nullptr; }
 
 	const std::shared_ptr<myvk::Buffer> &GetBuffer() const { return m_buffer; }
 	const std::shared_ptr<myvk::DescriptorSetLayout> &GetDescriptorSetLayout() const { return m_descriptor_set_layout; }
 	const std::shared_ptr<myvk::DescriptorSet> &GetDescriptorSet() const { return m_descriptor_set; }
+	const std::shared_ptr<myvk::DescriptorSet> &GetTree64DescriptorSet() const { return m_tree64_descriptor_set; }
+	const std::shared_ptr<myvk::DescriptorSet> &GetDAGDescriptorSet() const { return m_dag_descriptor_set; }
+	const std::shared_ptr<myvk::DescriptorSet> &GetCompactDescriptorSet() const { return m_compact_descriptor_set; }
 
 	uint32_t GetLevel() const { return m_level; }
 	VkDeviceSize GetRange() const { return m_range; }
+	VkDeviceSize GetTree64Range() const { return m_tree64_range; }
+	VkDeviceSize GetDAGRange() const { return m_dag_range; } // of the nodes only
+	VkDeviceSize GetCompactRange() const { return m_compact_range; }
 
 	void CmdTransferOwnership(const std::shared_ptr<myvk::CommandBuffer> &command_buffer, uint32_t src_queue_family,
 	                          uint32_t dst_queue_family,
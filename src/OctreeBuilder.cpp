@@ -1,40 +1,73 @@
 #include "OctreeBuilder.hpp"
 #include "Config.hpp"
+#include "myvk/CommandBuffer.hpp"
+#include "myvk/Fence.hpp"
 
 #include <spdlog/spdlog.h>
 
 inline static constexpr uint32_t group_x_64(uint32_t x) { return (x >> 6u) + ((x & 0x3fu) ? 1u : 0u); }
 
+// fragment_sort.glsl
+constexpr uint32_t kSortBlockSize = 128u * 16u, kSortDigitCount = 16u;
+constexpr uint32_t kMaxSortBlockCount = 65535u; // minimum maxComputeWorkGroupCount[0] guaranteed by Vulkan
+
+struct SortPushConstants {
+	uint32_t fragment_count, shift, block_count;
+};
+
 std::shared_ptr<OctreeBuilder> OctreeBuilder::Create(const std::shared_ptr<Voxelizer> &voxelizer,
-                                                     const std::shared_ptr<myvk::CommandPool> &command_pool) {
+                                                     const std::shared_ptr<myvk::CommandPool> &command_pool,
+                                                     OctreeBuildMode mode) {
 	std::shared_ptr<OctreeBuilder> ret = std::make_shared<OctreeBuilder>();
-
-	std::shared_ptr<myvk::Device> device = command_pool->GetDevicePtr();
 	ret->m_voxelizer_ptr = voxelizer;
-	ret->m_atomic_counter.Initialize(device);
-	ret->m_atomic_counter.Reset(command_pool, 0);
-
-	ret->create_buffers(device);
-	ret->create_descriptors(device);
-	ret->create_pipeline(device);
-
+	ret->initialize(command_pool, mode);
 	return ret;
 }
 
 std::shared_ptr<OctreeBuilder> OctreeBuilder::Create(const std::shared_ptr<VoxDataAdapter> &vox_adapter,
-                                                     const std::shared_ptr<myvk::CommandPool> &command_pool) {
+                                                     const std::shared_ptr<myvk::CommandPool> &command_pool,
+                                                     OctreeBuildMode mode) {
 	std::shared_ptr<OctreeBuilder> ret = std::make_shared<OctreeBuilder>();
+	ret->m_vox_adapter_ptr = vox_adapter;
+	ret->initialize(command_pool, mode);
+	return ret;
+}
 
+void OctreeBuilder::initialize(const std::shared_ptr<myvk::CommandPool> &command_pool, OctreeBuildMode mode) {
 	std::shared_ptr<myvk::Device> device = command_pool->GetDevicePtr();
-	ret->m_vox_adapter_ptr = vox_adapter;
-	ret->m_atomic_counter.Initialize(device);
-	ret->m_atomic_counter.Reset(command_pool, 0);
 
-	ret->create_buffers_from_vox(device);
-	ret->create_descriptors_from_vox(device);
-	ret->create_pipeline_from_vox(device);
+	if (mode == OctreeBuildMode::kSortBased && !IsSortBasedSupported()) {
+		spdlog::warn("OctreeBuilder: octree_sort_*.comp or fragment_sort_*.comp were left out (no glslc, stale SPIR-V), "
+		             "building level by level");
+		mode = OctreeBuildMode::kLevelByLevel;
+	}
+	m_mode = mode;
+
+	if (mode == OctreeBuildMode::kSortBased) {
+		// the octree buffer is created once its size is known
+		create_sort_descriptors(device);
+		create_sort_pipeline(device);
+		return;
+	}
 
-	return ret;
+	m_atomic_counter.Initialize(device);
+	m_atomic_counter.Reset(command_pool, 0);
+
+	create_buffers(device);
+	create_descriptors(device);
+	create_pipeline(device);
+}
+
+const std::shared_ptr<myvk::Buffer> &OctreeBuilder::get_fragment_list() const {
+	return m_voxelizer_ptr ? m_voxelizer_ptr->GetVoxelFragmentList() : m_vox_adapter_ptr->GetVoxelFragmentList();
+}
+
+uint32_t OctreeBuilder::get_fragment_count() const {
+	return m_voxelizer_ptr ? m_voxelizer_ptr->GetVoxelFragmentCount() : m_vox_adapter_ptr->GetVoxelFragmentCount();
+}
+
+uint32_t OctreeBuilder::get_voxel_resolution() const {
+	return m_voxelizer_ptr ? m_voxelizer_ptr->GetVoxelResolution() : m_vox_adapter_ptr->GetVoxelResolution();
 }
 
 void OctreeBuilder::create_buffers(const std::shared_ptr<myvk::Device> &device) {
@@ -54,15 +87,14 @@ void OctreeBuilder::create_buffers(const std::shared_ptr<myvk::Device> &device)
 		data[2] = 1; // uGroupZ
 	});
 
-	// Estimate octree buffer size
-	uint32_t octree_node_ratio = m_voxelizer_ptr->GetLevel() / 3;
-	uint32_t octree_entry_num =
-	    std::max(kOctreeNodeNumMin, m_voxelizer_ptr->GetVoxelFragmentCount() * octree_node_ratio);
-	octree_entry_num = std::min(octree_entry_num, kOctreeNodeNumMax);
+	// Initial octree buffer size, grown during the build if the estimation is too small
+	uint32_t octree_node_ratio = GetLevel() / 3;
+	uint64_t octree_entry_num = std::max<uint64_t>(kOctreeNodeNumMin, (uint64_t)get_fragment_count() * octree_node_ratio);
+	octree_entry_num = std::min<uint64_t>(octree_entry_num, kOctreeNodeNumMax);
 
-	m_octree_buffer =
-	    myvk::Buffer::Create(device, octree_entry_num * sizeof(uint32_t), 0, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-	spdlog::info("Octree buffer created with {} nodes ({} MB)", octree_entry_num,
+	m_octree_buffer = myvk::Buffer::Create(device, octree_entry_num * sizeof(uint32_t), 0,
+	                                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	spdlog::info("Octree scratch buffer created with {} entries ({} MB)", octree_entry_num,
 	             m_octree_buffer->GetSize() / 1000000.0);
 }
 
@@ -106,7 +138,7 @@ void OctreeBuilder::create_descriptors(const std::shared_ptr<myvk::Device> &devi
 	m_descriptor_set = myvk::DescriptorSet::Create(m_descriptor_pool, m_descriptor_set_layout);
 	m_descriptor_set->UpdateStorageBuffer(m_atomic_counter.GetBuffer(), 0);
 	m_descriptor_set->UpdateStorageBuffer(m_octree_buffer, 1);
-	m_descriptor_set->UpdateStorageBuffer(m_voxelizer_ptr->GetVoxelFragmentList(), 2);
+	m_descriptor_set->UpdateStorageBuffer(get_fragment_list(), 2);
 	m_descriptor_set->UpdateStorageBuffer(m_build_info_buffer, 3);
 	m_descriptor_set->UpdateStorageBuffer(m_indirect_buffer, 4);
 }
@@ -115,7 +147,7 @@ void OctreeBuilder::create_pipeline(const std::shared_ptr<myvk::Device> &device)
 	m_pipeline_layout = myvk::PipelineLayout::Create(device, {m_descriptor_set_layout}, {});
 
 	{
-		uint32_t spec_data[] = {m_voxelizer_ptr->GetVoxelResolution(), m_voxelizer_ptr->GetVoxelFragmentCount()};
+		uint32_t spec_data[] = {get_voxel_resolution(), get_fragment_count()};
 		VkSpecializationMapEntry spec_entries[] = {{0, 0, sizeof(uint32_t)}, {1, sizeof(uint32_t), sizeof(uint32_t)}};
 		VkSpecializationInfo spec_info = {2, spec_entries, 2 * sizeof(uint32_t), spec_data};
 		constexpr uint32_t kOctreeTagNodeCompSpv[] = {
@@ -155,166 +187,127 @@ void OctreeBuilder::create_pipeline(const std::shared_ptr<myvk::Device> &device)
 	}
 }
 
-void OctreeBuilder::create_buffers_from_vox(const std::shared_ptr<myvk::Device> &device) {
-	m_build_info_buffer = myvk::Buffer::Create(device, 2 * sizeof(uint32_t), 0,
-	                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
-	m_build_info_staging_buffer = myvk::Buffer::CreateStaging<uint32_t>(device, 2, [](uint32_t *data) {
-		data[0] = 0; // uAllocBegin
-		data[1] = 8; // uAllocNum
-	});
-
-	m_indirect_buffer = myvk::Buffer::Create(device, 3 * sizeof(uint32_t), 0,
-	                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
-	                                             VK_BUFFER_USAGE_TRANSFER_DST_BIT);
-	m_indirect_staging_buffer = myvk::Buffer::CreateStaging<uint32_t>(device, 3, [](uint32_t *data) {
-		data[0] = 1; // uGroupX
-		data[1] = 1; // uGroupY
-		data[2] = 1; // uGroupZ
-	});
-
-	// 基于VoxDataAdapter估算八叉树缓冲区大小
-	// .vox文件内存预估：参考OBJ流程，使用合理的倍数
-	uint32_t octree_node_ratio = m_vox_adapter_ptr->GetLevel() / 3;  // 比OBJ的level/3稍大
-	octree_node_ratio = std::max(8u, octree_node_ratio);  // 最小倍数保证
-	uint32_t octree_entry_num =
-	    std::max(kOctreeNodeNumMin, m_vox_adapter_ptr->GetVoxelFragmentCount() * octree_node_ratio);
-	octree_entry_num = std::min(octree_entry_num, kOctreeNodeNumMax);
-	
-	spdlog::info("VoxAdapter memory estimation: fragments={}, ratio={}, estimated_nodes={}",
-	             m_vox_adapter_ptr->GetVoxelFragmentCount(), octree_node_ratio, octree_entry_num);
-
-	m_octree_buffer =
-	    myvk::Buffer::Create(device, octree_entry_num * sizeof(uint32_t), 0, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-	spdlog::info("Octree buffer created from .vox with {} nodes ({} MB)", octree_entry_num,
-	             m_octree_buffer->GetSize() / 1000000.0);
-}
-
-void OctreeBuilder::create_descriptors_from_vox(const std::shared_ptr<myvk::Device> &device) {
-	m_descriptor_pool = myvk::DescriptorPool::Create(device, 1, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5}});
+void OctreeBuilder::create_sort_descriptors(const std::shared_ptr<myvk::Device> &device) {
+	m_sort_descriptor_pool = myvk::DescriptorPool::Create(device, 2, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 8}});
 	{
-		VkDescriptorSetLayoutBinding atomic_counter_binding = {};
-		atomic_counter_binding.binding = 0;
-		atomic_counter_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		atomic_counter_binding.descriptorCount = 1;
-		atomic_counter_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-		VkDescriptorSetLayoutBinding octree_binding = {};
-		octree_binding.binding = 1;
-		octree_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		octree_binding.descriptorCount = 1;
-		octree_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-		VkDescriptorSetLayoutBinding fragment_list_binding = {};
-		fragment_list_binding.binding = 2;
-		fragment_list_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		fragment_list_binding.descriptorCount = 1;
-		fragment_list_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-		VkDescriptorSetLayoutBinding build_info_binding = {};
-		build_info_binding.binding = 3;
-		build_info_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		build_info_binding.descriptorCount = 1;
-		build_info_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-		VkDescriptorSetLayoutBinding indirect_binding = {};
-		indirect_binding.binding = 4;
-		indirect_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		indirect_binding.descriptorCount = 1;
-		indirect_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-		m_descriptor_set_layout =
-		    myvk::DescriptorSetLayout::Create(device, {atomic_counter_binding, octree_binding, fragment_list_binding,
-		                                               build_info_binding, indirect_binding});
+		// source list, destination list, histogram and octree
+		std::vector<VkDescriptorSetLayoutBinding> bindings(4);
+		for (uint32_t i = 0; i < bindings.size(); ++i) {
+			bindings[i] = {};
+			bindings[i].binding = i + 1;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+		m_sort_descriptor_set_layout = myvk::DescriptorSetLayout::Create(device, bindings);
 	}
-	m_descriptor_set = myvk::DescriptorSet::Create(m_descriptor_pool, m_descriptor_set_layout);
-	m_descriptor_set->UpdateStorageBuffer(m_atomic_counter.GetBuffer(), 0);
-	m_descriptor_set->UpdateStorageBuffer(m_octree_buffer, 1);
-	m_descriptor_set->UpdateStorageBuffer(m_vox_adapter_ptr->GetVoxelFragmentList(), 2);
-	m_descriptor_set->UpdateStorageBuffer(m_build_info_buffer, 3);
-	m_descriptor_set->UpdateStorageBuffer(m_indirect_buffer, 4);
+	for (auto &descriptor_set : m_sort_descriptor_sets)
+		descriptor_set = myvk::DescriptorSet::Create(m_sort_descriptor_pool, m_sort_descriptor_set_layout);
 }
 
-void OctreeBuilder::create_pipeline_from_vox(const std::shared_ptr<myvk::Device> &device) {
-	m_pipeline_layout = myvk::PipelineLayout::Create(device, {m_descriptor_set_layout}, {});
+void OctreeBuilder::create_sort_pipeline(const std::shared_ptr<myvk::Device> &device) {
+#if defined(SHADER_HAS_OCTREE_SORT_KEY_COMP) && defined(SHADER_HAS_OCTREE_SORT_COUNT_COMP) &&                          \
+    defined(SHADER_HAS_OCTREE_SORT_WRITE_COMP) && defined(SHADER_HAS_FRAGMENT_SORT_COUNT_COMP) &&                      \
+    defined(SHADER_HAS_FRAGMENT_SORT_SCAN_COMP) && defined(SHADER_HAS_FRAGMENT_SORT_SCATTER_COMP)
+	m_sort_pipeline_layout = myvk::PipelineLayout::Create(device, {m_sort_descriptor_set_layout},
+	                                                      {{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SortPushConstants)}});
 
+	uint32_t level = GetLevel();
+	VkSpecializationMapEntry spec_entry = {0, 0, sizeof(uint32_t)};
+	VkSpecializationInfo spec_info = {1, &spec_entry, sizeof(uint32_t), &level};
 	{
-		uint32_t spec_data[] = {m_vox_adapter_ptr->GetVoxelResolution(), m_vox_adapter_ptr->GetVoxelFragmentCount()};
-		VkSpecializationMapEntry spec_entries[] = {{0, 0, sizeof(uint32_t)}, {1, sizeof(uint32_t), sizeof(uint32_t)}};
-		VkSpecializationInfo spec_info = {2, spec_entries, 2 * sizeof(uint32_t), spec_data};
-		constexpr uint32_t kOctreeTagNodeCompSpv[] = {
-#include "spirv/octree_tag_node.comp.u32"
+		constexpr uint32_t kOctreeSortKeyCompSpv[] = {
+#include "spirv/octree_sort_key.comp.u32"
 		};
-		std::shared_ptr<myvk::ShaderModule> octree_tag_node_shader_module =
-		    myvk::ShaderModule::Create(device, kOctreeTagNodeCompSpv, sizeof(kOctreeTagNodeCompSpv));
-		m_tag_node_pipeline =
-		    myvk::ComputePipeline::Create(m_pipeline_layout, octree_tag_node_shader_module, &spec_info);
+		std::shared_ptr<myvk::ShaderModule> shader_module =
+		    myvk::ShaderModule::Create(device, kOctreeSortKeyCompSpv, sizeof(kOctreeSortKeyCompSpv));
+		m_sort_key_pipeline = myvk::ComputePipeline::Create(m_sort_pipeline_layout, shader_module, &spec_info);
 	}
-
 	{
-		constexpr uint32_t kOctreeInitNodeCompSpv[] = {
-#include "spirv/octree_init_node.comp.u32"
+		constexpr uint32_t kFragmentSortCountCompSpv[] = {
+#include "spirv/fragment_sort_count.comp.u32"
 		};
-		std::shared_ptr<myvk::ShaderModule> octree_init_node_shader_module =
-		    myvk::ShaderModule::Create(device, kOctreeInitNodeCompSpv, sizeof(kOctreeInitNodeCompSpv));
-		m_init_node_pipeline = myvk::ComputePipeline::Create(m_pipeline_layout, octree_init_node_shader_module);
+		std::shared_ptr<myvk::ShaderModule> shader_module =
+		    myvk::ShaderModule::Create(device, kFragmentSortCountCompSpv, sizeof(kFragmentSortCountCompSpv));
+		m_sort_count_pipeline = myvk::ComputePipeline::Create(m_sort_pipeline_layout, shader_module);
 	}
-
 	{
-		constexpr uint32_t kOctreeAllocNodeCompSpv[] = {
-#include "spirv/octree_alloc_node.comp.u32"
+		constexpr uint32_t kFragmentSortScanCompSpv[] = {
+#include "spirv/fragment_sort_scan.comp.u32"
 		};
-		std::shared_ptr<myvk::ShaderModule> octree_alloc_node_shader_module =
-		    myvk::ShaderModule::Create(device, kOctreeAllocNodeCompSpv, sizeof(kOctreeAllocNodeCompSpv));
-		m_alloc_node_pipeline = myvk::ComputePipeline::Create(m_pipeline_layout, octree_alloc_node_shader_module);
+		std::shared_ptr<myvk::ShaderModule> shader_module =
+		    myvk::ShaderModule::Create(device, kFragmentSortScanCompSpv, sizeof(kFragmentSortScanCompSpv));
+		m_sort_scan_pipeline = myvk::ComputePipeline::Create(m_sort_pipeline_layout, shader_module);
 	}
-
 	{
-		constexpr uint32_t kOctreeModifyArgCompSpv[] = {
-#include "spirv/octree_modify_arg.comp.u32"
+		constexpr uint32_t kFragmentSortScatterCompSpv[] = {
+#include "spirv/fragment_sort_scatter.comp.u32"
 		};
-		std::shared_ptr<myvk::ShaderModule> octree_modify_arg_shader_module =
-		    myvk::ShaderModule::Create(device, kOctreeModifyArgCompSpv, sizeof(kOctreeModifyArgCompSpv));
-		m_modify_arg_pipeline = myvk::ComputePipeline::Create(m_pipeline_layout, octree_modify_arg_shader_module);
+		std::shared_ptr<myvk::ShaderModule> shader_module =
+		    myvk::ShaderModule::Create(device, kFragmentSortScatterCompSpv, sizeof(kFragmentSortScatterCompSpv));
+		m_sort_scatter_pipeline = myvk::ComputePipeline::Create(m_sort_pipeline_layout, shader_module);
+	}
+	{
+		constexpr uint32_t kOctreeSortCountCompSpv[] = {
+#include "spirv/octree_sort_count.comp.u32"
+		};
+		std::shared_ptr<myvk::ShaderModule> shader_module =
+		    myvk::ShaderModule::Create(device, kOctreeSortCountCompSpv, sizeof(kOctreeSortCountCompSpv));
+		m_sort_node_count_pipeline = myvk::ComputePipeline::Create(m_sort_pipeline_layout, shader_module, &spec_info);
 	}
+	{
+		constexpr uint32_t kOctreeSortWriteCompSpv[] = {
+#include "spirv/octree_sort_write.comp.u32"
+		};
+		std::shared_ptr<myvk::ShaderModule> shader_module =
+		    myvk::ShaderModule::Create(device, kOctreeSortWriteCompSpv, sizeof(kOctreeSortWriteCompSpv));
+		m_sort_write_pipeline = myvk::ComputePipeline::Create(m_sort_pipeline_layout, shader_module, &spec_info);
+	}
+#endif
 }
 
-void OctreeBuilder::CmdBuild(const std::shared_ptr<myvk::CommandBuffer> &command_buffer) const {
-	// transfers
-	{
-		command_buffer->CmdCopy(m_build_info_staging_buffer, m_build_info_buffer,
-		                        {{0, 0, m_build_info_buffer->GetSize()}});
-		command_buffer->CmdCopy(m_indirect_staging_buffer, m_indirect_buffer, {{0, 0, m_indirect_buffer->GetSize()}});
+bool OctreeBuilder::Build(const std::shared_ptr<myvk::CommandPool> &command_pool) {
+	return m_mode == OctreeBuildMode::kSortBased ? build_sort_based(command_pool) : build_level_by_level(command_pool);
+}
 
-		command_buffer->CmdPipelineBarrier(
-		    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, {},
-		    {m_build_info_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT,
-		                                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)},
-		    {});
+bool OctreeBuilder::build_level_by_level(const std::shared_ptr<myvk::CommandPool> &command_pool) {
+	std::shared_ptr<myvk::Device> device = command_pool->GetDevicePtr();
+	std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
 
-		command_buffer->CmdPipelineBarrier(
-		    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-		    {},
-		    {m_indirect_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT,
-		                                         VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)},
-		    {});
-	}
+	uint32_t octree_level = GetLevel();
+	uint32_t fragment_group_x = group_x_64(get_fragment_count());
+	uint32_t node_count = 1;
 
-	uint32_t fragment_count = 0;
-	uint32_t octree_level = 0;
-	
-	if (m_voxelizer_ptr) {
-		fragment_count = m_voxelizer_ptr->GetVoxelFragmentCount();
-		octree_level = m_voxelizer_ptr->GetLevel();
-	} else if (m_vox_adapter_ptr) {
-		fragment_count = m_vox_adapter_ptr->GetVoxelFragmentCount();
-		octree_level = m_vox_adapter_ptr->GetLevel();
-	}
-	
-	uint32_t fragment_group_x = group_x_64(fragment_count);
+	// one submission per level, so that the nodes allocated for the next level can be made room for before they are
+	// initialized
+	for (uint32_t i = 1; i <= octree_level; ++i) {
+		std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(command_pool);
+		command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
-	command_buffer->CmdBindDescriptorSets({m_descriptor_set}, m_pipeline_layout, VK_PIPELINE_BIND_POINT_COMPUTE, {});
+		if (i == 1) {
+			// transfers
+			command_buffer->CmdCopy(m_build_info_staging_buffer, m_build_info_buffer,
+			                        {{0, 0, m_build_info_buffer->GetSize()}});
+			command_buffer->CmdCopy(m_indirect_staging_buffer, m_indirect_buffer,
+			                        {{0, 0, m_indirect_buffer->GetSize()}});
+
+			command_buffer->CmdPipelineBarrier(
+			    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, {},
+			    {m_build_info_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT,
+			                                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)},
+			    {});
+
+			command_buffer->CmdPipelineBarrier(
+			    VK_PIPELINE_STAGE_TRANSFER_BIT,
+			    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, {},
+			    {m_indirect_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT,
+			                                         VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)},
+			    {});
+		}
+
+		command_buffer->CmdBindDescriptorSets({m_descriptor_set}, m_pipeline_layout, VK_PIPELINE_BIND_POINT_COMPUTE,
+		                                      {});
 
-	for (uint32_t i = 1; i <= octree_level; ++i) {
 		command_buffer->CmdBindPipeline(m_init_node_pipeline);
 		command_buffer->CmdDispatchIndirect(m_indirect_buffer);
 
@@ -356,12 +349,226 @@ void OctreeBuilder::CmdBuild(const std::shared_ptr<myvk::CommandBuffer> &command
 			    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, {},
 			    {m_build_info_buffer->GetMemoryBarrier(VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT)}, {});
 		}
+
+		command_buffer->End();
+		command_buffer->Submit(fence);
+		fence->Wait();
+		fence->Reset();
+
+		if (i != octree_level) {
+			// the counter now holds the number of nodes the next level's init and tag passes write to
+			node_count = m_atomic_counter.Read(command_pool) + 1u;
+			if (!grow_octree_buffer(command_pool, (VkDeviceSize)node_count * 8u * sizeof(uint32_t)))
+				return false;
+		}
 	}
+
+	m_octree_range = (VkDeviceSize)node_count * 8u * sizeof(uint32_t);
+	compact_octree_buffer(command_pool);
+	return true;
 }
 
-VkDeviceSize OctreeBuilder::GetOctreeRange(const std::shared_ptr<myvk::CommandPool> &command_pool) const {
-	return (m_atomic_counter.Read(command_pool) + 1u) * 8u * sizeof(uint32_t);
+bool OctreeBuilder::build_sort_based(const std::shared_ptr<myvk::CommandPool> &command_pool) {
+	std::shared_ptr<myvk::Device> device = command_pool->GetDevicePtr();
+	std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
+
+	const uint32_t level = GetLevel(), fragment_count = get_fragment_count();
+	const uint32_t block_count = std::max((fragment_count + kSortBlockSize - 1u) / kSortBlockSize, 1u);
+	if (block_count > kMaxSortBlockCount) {
+		spdlog::error("OctreeBuilder: {} fragments exceed the {} that can be sorted, build level by level",
+		              fragment_count, kMaxSortBlockCount * kSortBlockSize);
+		return false;
+	}
+
+	const std::shared_ptr<myvk::Buffer> &fragment_list = get_fragment_list();
+	std::shared_ptr<myvk::Buffer> temp_list = myvk::Buffer::Create(
+	    device, std::max(fragment_count, 1u) * sizeof(uint32_t) * 2, 0, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	std::shared_ptr<myvk::Buffer> histogram_buffer =
+	    myvk::Buffer::Create(device, kSortDigitCount * block_count * sizeof(uint32_t), 0,
+	                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	std::shared_ptr<myvk::Buffer> node_count_buffer = myvk::Buffer::Create(
+	    device, sizeof(uint32_t), VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+	    VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	for (uint32_t i = 0; i < 2; ++i) {
+		m_sort_descriptor_sets[i]->UpdateStorageBuffer(i ? temp_list : fragment_list, 1);
+		m_sort_descriptor_sets[i]->UpdateStorageBuffer(i ? fragment_list : temp_list, 2);
+		m_sort_descriptor_sets[i]->UpdateStorageBuffer(histogram_buffer, 3);
+	}
+
+	// the digits of the morton codes (3 bits per level), shift 32 for their top 4 bits in the y word
+	std::vector<uint32_t> shifts;
+	for (uint32_t shift = 0; shift < 32u && shift < 3u * level; shift += 4u)
+		shifts.push_back(shift);
+	if (3u * level > 32u)
+		shifts.push_back(32u);
+
+	std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(command_pool);
+	command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	auto cmd_compute_barrier = [&command_buffer]() {
+		VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                                   {barrier}, {}, {});
+	};
+	auto cmd_bind = [this, &command_buffer, fragment_count, block_count](uint32_t set, uint32_t shift) {
+		SortPushConstants push_constants = {fragment_count, shift, block_count};
+		command_buffer->CmdBindDescriptorSets({m_sort_descriptor_sets[set]}, m_sort_pipeline_layout,
+		                                      VK_PIPELINE_BIND_POINT_COMPUTE, {});
+		command_buffer->CmdPushConstants(m_sort_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+		                                 sizeof(SortPushConstants), &push_constants);
+	};
+
+	// the keys go to the temporary list, then the sorted list alternates between the fragment list and the temporary one
+	cmd_bind(0, 0);
+	command_buffer->CmdBindPipeline(m_sort_key_pipeline);
+	command_buffer->CmdDispatch(group_x_64(fragment_count), 1, 1);
+	cmd_compute_barrier();
+	for (uint32_t pass = 0; pass < shifts.size(); ++pass) {
+		cmd_bind((pass + 1u) & 1u, shifts[pass]);
+		command_buffer->CmdBindPipeline(m_sort_count_pipeline);
+		command_buffer->CmdDispatch(block_count, 1, 1);
+		cmd_compute_barrier();
+		command_buffer->CmdBindPipeline(m_sort_scan_pipeline);
+		command_buffer->CmdDispatch(1, 1, 1);
+		cmd_compute_barrier();
+		command_buffer->CmdBindPipeline(m_sort_scatter_pipeline);
+		command_buffer->CmdDispatch(block_count, 1, 1);
+		cmd_compute_barrier();
+	}
+	const uint32_t sorted_set = (shifts.size() + 1u) & 1u;
+
+	// nodes of every depth in every block, scanned into the numbers of their first nodes
+	cmd_bind(sorted_set, 0);
+	command_buffer->CmdBindPipeline(m_sort_node_count_pipeline);
+	command_buffer->CmdDispatch(block_count, 1, 1);
+	cmd_compute_barrier();
+	command_buffer->CmdBindPipeline(m_sort_scan_pipeline);
+	command_buffer->CmdDispatch(1, 1, 1);
+
+	// the scanned histogram at depth level is the node count
+	command_buffer->CmdPipelineBarrier(
+	    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, {},
+	    {histogram_buffer->GetMemoryBarrier(VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT)}, {});
+	command_buffer->CmdCopy(histogram_buffer, node_count_buffer,
+	                        {{(VkDeviceSize)level * block_count * sizeof(uint32_t), 0, sizeof(uint32_t)}});
+	command_buffer->CmdPipelineBarrier(
+	    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, {},
+	    {node_count_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT)}, {});
+	command_buffer->End();
+	command_buffer->Submit(fence);
+	fence->Wait();
+
+	// the root node always exists
+	uint32_t node_count = std::max(*(const uint32_t *)node_count_buffer->GetMappedData(), 1u);
+	m_octree_range = (VkDeviceSize)node_count * 8u * sizeof(uint32_t);
+	if ((uint64_t)node_count * 8u > kOctreeNodeNumMax) {
+		spdlog::error("Octree size exceed ({} MB required)", m_octree_range / 1000000.0);
+		return false;
+	}
+	m_octree_buffer = myvk::Buffer::Create(device, m_octree_range, 0,
+	                                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+	                                           VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	m_sort_descriptor_sets[sorted_set]->UpdateStorageBuffer(m_octree_buffer, 4);
+
+	// the write pass only sets the slots that are used
+	command_buffer = myvk::CommandBuffer::Create(command_pool);
+	command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	vkCmdFillBuffer(command_buffer->GetHandle(), m_octree_buffer->GetHandle(), 0, m_octree_range, 0u);
+	command_buffer->CmdPipelineBarrier(
+	    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, {},
+	    {m_octree_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_WRITE_BIT)}, {});
+	cmd_bind(sorted_set, 0);
+	command_buffer->CmdBindPipeline(m_sort_write_pipeline);
+	command_buffer->CmdDispatch(block_count, 1, 1);
+	command_buffer->CmdPipelineBarrier(
+	    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+	    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+	    {},
+	    {m_octree_buffer->GetMemoryBarrier(VK_ACCESS_SHADER_WRITE_BIT,
+	                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT)},
+	    {});
+	command_buffer->End();
+	fence->Reset();
+	command_buffer->Submit(fence);
+	fence->Wait();
+
+	spdlog::info("Octree built from {} fragments with {} sort passes: {} nodes ({} MB)", fragment_count,
+	             shifts.size(), node_count, m_octree_range / 1000000.0);
+	return true;
 }
+
+bool OctreeBuilder::grow_octree_buffer(const std::shared_ptr<myvk::CommandPool> &command_pool,
+                                       VkDeviceSize required_size) {
+	VkDeviceSize size = m_octree_buffer->GetSize();
+	if (required_size <= size)
+		return true;
+	constexpr VkDeviceSize kMaxSize = (VkDeviceSize)kOctreeNodeNumMax * sizeof(uint32_t);
+	if (required_size > kMaxSize) {
+		spdlog::error("Octree size exceed ({} MB required)", required_size / 1000000.0);
+		return false;
+	}
+	VkDeviceSize new_size = std::min(std::max(required_size, size * 2u), kMaxSize);
+
+	std::shared_ptr<myvk::Device> device = command_pool->GetDevicePtr();
+	std::shared_ptr<myvk::Buffer> new_buffer =
+	    myvk::Buffer::Create(device, new_size, 0,
+	                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+	                             VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	{
+		// the nodes beyond the old size are zeroed by the next init pass, only the built levels are copied
+		std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
+		std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(command_pool);
+		command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		command_buffer->CmdPipelineBarrier(
+		    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, {},
+		    {m_octree_buffer->GetMemoryBarrier(VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT)}, {});
+		command_buffer->CmdCopy(m_octree_buffer, new_buffer, {{0, 0, size}});
+		command_buffer->CmdPipelineBarrier(
+		    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, {},
+		    {new_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT,
+		                                  VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)},
+		    {});
+		command_buffer->End();
+		command_buffer->Submit(fence);
+		fence->Wait();
+	}
+	m_octree_buffer = new_buffer;
+	m_descriptor_set->UpdateStorageBuffer(m_octree_buffer, 1);
+
+	spdlog::info("Octree scratch buffer grown to {} MB", new_size / 1000000.0);
+	return true;
+}
+
+void OctreeBuilder::compact_octree_buffer(const std::shared_ptr<myvk::CommandPool> &command_pool) {
+	std::shared_ptr<myvk::Device> device = command_pool->GetDevicePtr();
+	std::shared_ptr<myvk::Buffer> octree_buffer =
+	    myvk::Buffer::Create(device, m_octree_range, 0,
+	                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+	                             VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	{
+		std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
+		std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(command_pool);
+		command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		command_buffer->CmdPipelineBarrier(
+		    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, {},
+		    {m_octree_buffer->GetMemoryBarrier({0, m_octree_range}, VK_ACCESS_SHADER_WRITE_BIT,
+		                                       VK_ACCESS_TRANSFER_READ_BIT)},
+		    {});
+		command_buffer->CmdCopy(m_octree_buffer, octree_buffer, {{0, 0, m_octree_range}});
+		command_buffer->CmdPipelineBarrier(
+		    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		    {}, {octree_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT)}, {});
+		command_buffer->End();
+		command_buffer->Submit(fence);
+		fence->Wait();
+	}
+	spdlog::info("Octree compacted from {} MB to {} MB", m_octree_buffer->GetSize() / 1000000.0,
+	             m_octree_range / 1000000.0);
+	// free the scratch buffer
+	m_octree_buffer = octree_buffer;
+}
+
 void OctreeBuilder::CmdTransferOctreeOwnership(const std::shared_ptr<myvk::CommandBuffer> &command_buffer,
                                                uint32_t src_queue_family, uint32_t dst_queue_family,
                                                VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage) const {
@@ -11,10 +11,19 @@
 #include "myvk/Framebuffer.hpp"
 #include "myvk/RenderPass.hpp"
 
+#include <array>
+
+enum class OctreeBuildMode {
+	kLevelByLevel, // tag, allocate and initialize one level per pass
+	kSortBased     // sort the fragments by morton code, then number and write the nodes of all levels at once
+};
+constexpr const char *kOctreeBuildModeNames[] = {"Level by Level", "Sort-based"};
+
 class OctreeBuilder {
 private:
 	std::shared_ptr<Voxelizer> m_voxelizer_ptr;
 	std::shared_ptr<VoxDataAdapter> m_vox_adapter_ptr;
+	OctreeBuildMode m_mode{OctreeBuildMode::kLevelByLevel};
 
 	std::shared_ptr<myvk::PipelineLayout> m_pipeline_layout;
 	std::shared_ptr<myvk::ComputePipeline> m_tag_node_pipeline, m_init_node_pipeline, m_alloc_node_pipeline,
@@ -22,7 +31,9 @@ private:
 
 	Counter m_atomic_counter;
 
+	// scratch octree buffer while building, the tightly sized octree afterwards
 	std::shared_ptr<myvk::Buffer> m_octree_buffer;
+	VkDeviceSize m_octree_range{};
 	std::shared_ptr<myvk::Buffer> m_build_info_buffer, m_build_info_staging_buffer;
 	std::shared_ptr<myvk::Buffer> m_indirect_buffer, m_indirect_staging_buffer;
 
@@ -30,21 +41,51 @@ private:
 	std::shared_ptr<myvk::DescriptorSetLayout> m_descriptor_set_layout;
 	std::shared_ptr<myvk::DescriptorSet> m_descriptor_set;
 
+	// kSortBased: source list, destination list, histogram (fragment_sort.glsl) and octree. [0] reads the fragment list
+	// and writes the temporary list, [1] the other way round
+	std::shared_ptr<myvk::PipelineLayout> m_sort_pipeline_layout;
+	std::shared_ptr<myvk::ComputePipeline> m_sort_key_pipeline, m_sort_count_pipeline, m_sort_scan_pipeline,
+	    m_sort_scatter_pipeline, m_sort_node_count_pipeline, m_sort_write_pipeline;
+	std::shared_ptr<myvk::DescriptorPool> m_sort_descriptor_pool;
+	std::shared_ptr<myvk::DescriptorSetLayout> m_sort_descriptor_set_layout;
+	std::array<std::shared_ptr<myvk::DescriptorSet>, 2> m_sort_descriptor_sets;
+
+	void initialize(const std::shared_ptr<myvk::CommandPool> &command_pool, OctreeBuildMode mode);
 	void create_buffers(const std::shared_ptr<myvk::Device> &device);
 	void create_descriptors(const std::shared_ptr<myvk::Device> &device);
 	void create_pipeline(const std::shared_ptr<myvk::Device> &device);
-	
-	// VoxDataAdapter支持方法
-	void create_buffers_from_vox(const std::shared_ptr<myvk::Device> &device);
-	void create_descriptors_from_vox(const std::shared_ptr<myvk::Device> &device);
-	void create_pipeline_from_vox(const std::shared_ptr<myvk::Device> &device);
+	void create_sort_descriptors(const std::shared_ptr<myvk::Device> &device);
+	void create_sort_pipeline(const std::shared_ptr<myvk::Device> &device);
+
+	const std::shared_ptr<myvk::Buffer> &get_fragment_list() const;
+	uint32_t get_fragment_count() const;
+	uint32_t get_voxel_resolution() const;
+
+	bool build_level_by_level(const std::shared_ptr<myvk::CommandPool> &command_pool);
+	bool build_sort_based(const std::shared_ptr<myvk::CommandPool> &command_pool);
+	bool grow_octree_buffer(const std::shared_ptr<myvk::CommandPool> &command_pool, VkDeviceSize required_size);
+	void compact_octree_buffer(const std::shared_ptr<myvk::CommandPool> &command_pool);
 
 public:
+	// false if the shaders of kSortBased were left out (shader/CMakeLists.txt), Create falls back to kLevelByLevel then
+	static constexpr bool IsSortBasedSupported() {
+#if defined(SHADER_HAS_OCTREE_SORT_KEY_COMP) && defined(SHADER_HAS_OCTREE_SORT_COUNT_COMP) &&                          \
+    defined(SHADER_HAS_OCTREE_SORT_WRITE_COMP) && defined(SHADER_HAS_FRAGMENT_SORT_COUNT_COMP) &&                      \
+    defined(SHADER_HAS_FRAGMENT_SORT_SCAN_COMP) && defined(SHADER_HAS_FRAGMENT_SORT_SCATTER_COMP)
+		return true;
+#else
+		return false;
+#endif
+	}
+
 	static std::shared_ptr<OctreeBuilder> Create(const std::shared_ptr<Voxelizer> &voxelizer,
-	                                              const std::shared_ptr<myvk::CommandPool> &command_pool);
+	                                              const std::shared_ptr<myvk::CommandPool> &command_pool,
+	                                              OctreeBuildMode mode = OctreeBuildMode::kLevelByLevel);
 	
 	static std::shared_ptr<OctreeBuilder> Create(const std::shared_ptr<VoxDataAdapter> &vox_adapter,
-	                                              const std::shared_ptr<myvk::CommandPool> &command_pool);
+	                                              const std::shared_ptr<myvk::CommandPool> &command_pool,
+	                                              OctreeBuildMode mode = OctreeBuildMode::kLevelByLevel);
+	OctreeBuildMode GetMode() const { return m_mode; }
 	const std::shared_ptr<Voxelizer> &GetVoxelizerPtr() const { return m_voxelizer_ptr; }
 	uint32_t GetLevel() const {
 		if (m_voxelizer_ptr) {
@@ -55,8 +96,15 @@ public:
 		return 0;
 	}
 
-	void CmdBuild(const std::shared_ptr<myvk::CommandBuffer> &command_buffer) const;
-	VkDeviceSize GetOctreeRange(const std::shared_ptr<myvk::CommandPool> &command_pool) const;
+	// Builds the octree (the fragment list must already be written) and waits for it, into a buffer of exactly
+	// GetOctreeRange() bytes.
+	// kLevelByLevel submits one pass per level and grows the scratch buffer whenever the nodes allocated for the next
+	// level would not fit, then copies the result.
+	// kSortBased overwrites the fragment list: a radix sort by morton code (fragment_sort_*.comp), a scan of the nodes
+	// every depth needs, then all levels are written in one pass (octree_sort_*.comp). The nodes are numbered depth by
+	// depth in morton order, so the words are those of CpuOctreeBuilder::Build.
+	bool Build(const std::shared_ptr<myvk::CommandPool> &command_pool);
+	VkDeviceSize GetOctreeRange() const { return m_octree_range; }
 	const std::shared_ptr<myvk::Buffer> &GetOctree() const { return m_octree_buffer; }
 
 	void CmdTransferOctreeOwnership(const std::shared_ptr<myvk::CommandBuffer> &command_buffer,
@@ -0,0 +1,158 @@
+#include "OctreeCache.hpp"
+
+#include "CacheKey.hpp"
+#include "Config.hpp"
+#include "MappedFile.hpp"
+#include "myvk/CommandBuffer.hpp"
+#include "myvk/Fence.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+
+constexpr uint32_t kOctreeCacheMagic = 0x434f5653; // 'SVOC'
+constexpr uint32_t kOctreeCacheVersion = 3;
+
+inline static constexpr size_t align_4(size_t x) { return (x + 3u) & ~(size_t)3u; }
+
+std::string OctreeCache::get_cache_filename(const CacheKey &key, uint32_t level, const OctreeCacheOptions &options) {
+	return key.GetFilename(kOctreeCacheDirectory,
+	                       "_" + std::to_string(level) + "_" + std::to_string(options.Pack()) + ".svo");
+}
+
+bool OctreeCache::Write(const char *source_filename, uint32_t level, const OctreeCacheOptions &options,
+                        const std::shared_ptr<myvk::Buffer> &octree, VkDeviceSize range,
+                        const std::shared_ptr<myvk::CommandPool> &command_pool) {
+	std::shared_ptr<myvk::Device> device = command_pool->GetDevicePtr();
+	std::shared_ptr<myvk::Buffer> readback_buffer = myvk::Buffer::Create(
+	    device, range, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+	    VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	{
+		std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
+		std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(command_pool);
+		command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		command_buffer->CmdPipelineBarrier(
+		    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, {},
+		    {octree->GetMemoryBarrier({0, range}, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT)}, {});
+		command_buffer->CmdCopy(octree, readback_buffer, {{0, 0, range}});
+		command_buffer->CmdPipelineBarrier(
+		    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, {},
+		    {readback_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT)}, {});
+		command_buffer->End();
+		command_buffer->Submit(fence);
+		fence->Wait();
+	}
+
+	return Write(source_filename, level, options, (const uint32_t *)readback_buffer->GetMappedData(), range);
+}
+
+bool OctreeCache::Write(const char *source_filename, uint32_t level, const OctreeCacheOptions &options,
+                        const uint32_t *octree, VkDeviceSize range) {
+	CacheKey key;
+	if (!CacheKey::Get(source_filename, &key)) {
+		spdlog::warn("Octree cache: failed to stat {}", source_filename);
+		return false;
+	}
+	const std::string &source_path = key.source_path;
+	Header header{};
+	header.magic = kOctreeCacheMagic;
+	header.version = kOctreeCacheVersion;
+	header.level = level;
+	header.build_options = options.Pack();
+	header.source_mtime = key.source_mtime;
+	header.dependency_hash = key.dependency_hash;
+	header.source_path_length = source_path.size();
+	header.node_count = range / (8 * sizeof(uint32_t));
+
+	std::error_code ec;
+	std::filesystem::create_directories(kOctreeCacheDirectory, ec);
+	std::string cache_filename = get_cache_filename(key, level, options);
+	// write to a temporary file first so that an interrupted write never leaves a valid-looking cache
+	std::string temp_filename = cache_filename + ".tmp";
+	FILE *fp = fopen(temp_filename.c_str(), "wb");
+	if (!fp) {
+		spdlog::warn("Octree cache: failed to create {}", temp_filename);
+		return false;
+	}
+	static constexpr uint8_t kZeros[4] = {};
+	bool success = fwrite(&header, sizeof(Header), 1, fp) == 1 &&
+	               fwrite(source_path.data(), 1, source_path.size(), fp) == source_path.size() &&
+	               fwrite(kZeros, 1, align_4(source_path.size()) - source_path.size(), fp) ==
+	                   align_4(source_path.size()) - source_path.size() &&
+	               fwrite(octree, 1, range, fp) == range;
+	success &= fclose(fp) == 0;
+
+	if (success)
+		std::filesystem::rename(temp_filename, cache_filename, ec);
+	if (!success || ec) {
+		spdlog::warn("Octree cache: failed to write {}", cache_filename);
+		std::filesystem::remove(temp_filename, ec);
+		return false;
+	}
+	spdlog::info("Octree cache written to {} ({} MB)", cache_filename, range / 1000000.0);
+	return true;
+}
+
+std::shared_ptr<myvk::Buffer> OctreeCache::Read(const char *source_filename, uint32_t level,
+                                                const OctreeCacheOptions &options,
+                                                const std::shared_ptr<myvk::CommandPool> &command_pool,
+                                                VkDeviceSize *range) {
+	CacheKey key;
+	if (!CacheKey::Get(source_filename, &key))
+		return nullptr;
+
+	std::string cache_filename = get_cache_filename(key, level, options);
+	if (!std::filesystem::exists(cache_filename))
+		return nullptr;
+	std::shared_ptr<MappedFile> mapped_file = MappedFile::Create(cache_filename.c_str());
+	if (!mapped_file)
+		return nullptr;
+
+	const uint8_t *data = mapped_file->GetData();
+	size_t size = mapped_file->GetSize();
+	Header header;
+	if (size < sizeof(Header))
+		return nullptr;
+	std::memcpy(&header, data, sizeof(Header));
+
+	size_t words_offset = sizeof(Header) + align_4(header.source_path_length);
+	if (header.magic != kOctreeCacheMagic || header.version != kOctreeCacheVersion || header.level != level ||
+	    header.build_options != options.Pack() || header.node_count == 0 ||
+	    header.source_path_length > size - sizeof(Header) || size < words_offset ||
+	    (size - words_offset) != header.node_count * 8 * sizeof(uint32_t)) {
+		spdlog::warn("Octree cache: {} is invalid or from an older version, rebuilding", cache_filename);
+		return nullptr;
+	}
+	if (header.source_mtime != key.source_mtime || header.dependency_hash != key.dependency_hash ||
+	    std::string((const char *)data + sizeof(Header), header.source_path_length) != key.source_path) {
+		spdlog::info("Octree cache: {} is stale, rebuilding", cache_filename);
+		return nullptr;
+	}
+
+	*range = header.node_count * 8 * sizeof(uint32_t);
+	std::shared_ptr<myvk::Device> device = command_pool->GetDevicePtr();
+	std::shared_ptr<myvk::Buffer> staging_buffer = myvk::Buffer::CreateStaging<uint8_t>(
+	    device, *range, [data, words_offset, range](uint8_t *mapped) { std::memcpy(mapped, data + words_offset, *range); });
+	mapped_file = nullptr;
+
+	std::shared_ptr<myvk::Buffer> octree =
+	    myvk::Buffer::Create(device, *range, 0,
+	                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+	                             VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	{
+		std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
+		std::shared_ptr<myvk::CommandBuffer> command_buffer = myvk::CommandBuffer::Create(command_pool);
+		command_buffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		command_buffer->CmdCopy(staging_buffer, octree, {{0, 0, *range}});
+		command_buffer->CmdPipelineBarrier(
+		    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		    {}, {octree->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT)}, {});
+		command_buffer->End();
+		command_buffer->Submit(fence);
+		fence->Wait();
+	}
+
+	spdlog::info("Octree loaded from cache {} ({} MB)", cache_filename, *range / 1000000.0);
+	return octree;
+}
@@ -0,0 +1,54 @@
+#ifndef OCTREE_CACHE_HPP
+#define OCTREE_CACHE_HPP
+
+#include "myvk/Buffer.hpp"
+#include "myvk/CommandPool.hpp"
+
+#include <string>
+
+struct CacheKey;
+
+// Build settings that can change the octree words, part of the cache key besides the source and the level. The
+// post-build passes of LoaderThread (node order, 64-tree, LOD colors) are not cached and not part of the key: the cache
+// keeps the octree as built and the passes run again on every load
+struct OctreeCacheOptions {
+	bool deduplicate_fragments = false;
+	uint32_t build_mode = 0; // (uint32_t)OctreeBuildMode
+
+	uint32_t Pack() const { return build_mode << 1u | (uint32_t)deduplicate_fragments; }
+};
+
+// On-disk .svo cache of a built octree, keyed by source path, source mtime (and those of the referenced files, see
+// CacheKey), octree level and build options.
+// Layout: Header, source path (padded to 4 bytes), then the raw uOctree words up to Octree::GetRange().
+class OctreeCache {
+private:
+	struct Header {
+		uint32_t magic, version;
+		uint32_t level, build_options; // OctreeCacheOptions::Pack()
+		uint32_t source_path_length, padding;
+		uint64_t node_count; // 8 words per node
+		int64_t source_mtime;
+		uint64_t dependency_hash; // CacheKey::dependency_hash
+	};
+
+	static std::string get_cache_filename(const CacheKey &key, uint32_t level, const OctreeCacheOptions &options);
+
+public:
+	// Reads back the first range bytes of octree (must be TRANSFER_SRC and owned by the pool's queue family)
+	static bool Write(const char *source_filename, uint32_t level, const OctreeCacheOptions &options,
+	                  const std::shared_ptr<myvk::Buffer> &octree, VkDeviceSize range,
+	                  const std::shared_ptr<myvk::CommandPool> &command_pool);
+
+	// Writes an octree that already lives in host memory (e.g. from CpuOctreeBuilder)
+	static bool Write(const char *source_filename, uint32_t level, const OctreeCacheOptions &options,
+	                  const uint32_t *octree, VkDeviceSize range);
+
+	// Returns a tightly sized device-local octree buffer owned by the pool's queue family, nullptr on cache miss
+	static std::shared_ptr<myvk::Buffer> Read(const char *source_filename, uint32_t level,
+	                                          const OctreeCacheOptions &options,
+	                                          const std::shared_ptr<myvk::CommandPool> &command_pool,
+	                                          VkDeviceSize *range);
+};
+
+#endif
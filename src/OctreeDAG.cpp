@@ -0,0 +1,184 @@
+#include "OctreeDAG.hpp"
+
+#include <array>
+#include <spdlog/spdlog.h>
+#include <unordered_map>
+
+constexpr size_t kNodeGrain = 4096;
+// the distinct nodes of a level are found per shard of the hash space in parallel
+constexpr uint32_t kShardBits = 6, kShardCount = 1u << kShardBits;
+
+// the slot words of a node, pointers replaced by the index of the child among the distinct nodes of the level below
+using NodeKey = std::array<uint32_t, 8>;
+
+inline static bool is_pointer(uint32_t word) { return (word & 0xC0000000u) == 0x80000000u; }
+inline static bool is_leaf(uint32_t word) { return (word & 0xC0000000u) == 0xC0000000u; }
+inline static uint32_t get_child(uint32_t word) { return (word & 0x3fffffffu) >> 3u; }
+
+inline static uint64_t hash_key(const NodeKey &key) {
+	uint64_t hash = 0x9e3779b97f4a7c15ull;
+	for (uint32_t word : key) {
+		hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+		hash ^= hash >> 32u;
+	}
+	return hash;
+}
+struct NodeKeyHash {
+	size_t operator()(const NodeKey &key) const { return (size_t)hash_key(key); }
+};
+
+std::shared_ptr<OctreeDAG> OctreeDAG::Build(const std::shared_ptr<ThreadPool> &thread_pool, const uint32_t *octree,
+                                            size_t range) {
+	const size_t kSourceNodeCount = range / (8 * sizeof(uint32_t));
+	if (kSourceNodeCount == 0)
+		return nullptr;
+
+	// source nodes of every level, top-down
+	std::vector<std::vector<uint32_t>> levels = {{0}};
+	for (;;) {
+		std::vector<uint32_t> next;
+		for (uint32_t node : levels.back())
+			for (uint32_t slot = 0; slot < 8; ++slot) {
+				uint32_t word = octree[node * 8 + slot];
+				if (!is_pointer(word))
+					continue;
+				uint32_t child = get_child(word);
+				if ((word & 7u) || child == 0 || child >= kSourceNodeCount) {
+					spdlog::error("OctreeDAG: invalid pointer {:#x} in node {}", word, node);
+					return nullptr;
+				}
+				next.push_back(child);
+			}
+		if (next.empty())
+			break;
+		levels.push_back(std::move(next));
+	}
+
+	const auto make_key = [octree](uint32_t node, const std::vector<uint32_t> &distinct_index) {
+		NodeKey key;
+		for (uint32_t slot = 0; slot < 8; ++slot) {
+			uint32_t word = octree[node * 8 + slot];
+			if (is_pointer(word))
+				word = 0x80000000u | distinct_index[get_child(word)];
+			else if (is_leaf(word))
+				word = 0xC0000000u;
+			else
+				word = 0u;
+			key[slot] = word;
+		}
+		return key;
+	};
+
+	// bottom-up: the distinct nodes of every level and the index of each source node among them
+	std::vector<uint32_t> distinct_index(kSourceNodeCount);
+	std::vector<std::vector<NodeKey>> distinct_nodes(levels.size());
+	for (size_t l = levels.size(); l-- > 0;) {
+		const std::vector<uint32_t> &nodes = levels[l];
+		std::vector<uint64_t> hashes(nodes.size());
+		thread_pool->ParallelFor(nodes.size(), kNodeGrain, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				hashes[i] = hash_key(make_key(nodes[i], distinct_index));
+		});
+
+		std::array<std::vector<uint32_t>, kShardCount> shard_members, shard_distinct;
+		for (uint32_t i = 0; i < nodes.size(); ++i)
+			shard_members[hashes[i] >> (64u - kShardBits)].push_back(i);
+		std::vector<uint32_t> shard_index(nodes.size());
+		thread_pool->ParallelFor(kShardCount, 1, [&](size_t begin, size_t end) {
+			for (size_t s = begin; s < end; ++s) {
+				std::unordered_map<NodeKey, uint32_t, NodeKeyHash> map;
+				map.reserve(shard_members[s].size());
+				for (uint32_t i : shard_members[s]) {
+					auto it = map.try_emplace(make_key(nodes[i], distinct_index), shard_distinct[s].size()).first;
+					if (it->second == shard_distinct[s].size())
+						shard_distinct[s].push_back(i);
+					shard_index[i] = it->second;
+				}
+			}
+		});
+
+		std::array<uint32_t, kShardCount> shard_base;
+		uint32_t distinct_count = 0;
+		for (uint32_t s = 0; s < kShardCount; ++s) {
+			shard_base[s] = distinct_count;
+			distinct_count += shard_distinct[s].size();
+		}
+		distinct_nodes[l].resize(distinct_count);
+		thread_pool->ParallelFor(kShardCount, 1, [&](size_t begin, size_t end) {
+			for (size_t s = begin; s < end; ++s)
+				for (uint32_t j = 0; j < shard_distinct[s].size(); ++j)
+					distinct_nodes[l][shard_base[s] + j] = make_key(nodes[shard_distinct[s][j]], distinct_index);
+		});
+		// the children of this level are done, so distinct_index can be overwritten for the nodes of this level
+		thread_pool->ParallelFor(nodes.size(), kNodeGrain, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				distinct_index[nodes[i]] = shard_base[hashes[i] >> (64u - kShardBits)] + shard_index[i];
+		});
+	}
+
+	// layout: level by level from the root, pointers become word offsets again
+	std::vector<size_t> level_base(levels.size() + 1, 0);
+	for (size_t l = 0; l < levels.size(); ++l)
+		level_base[l + 1] = level_base[l] + distinct_nodes[l].size();
+	if (level_base.back() * 8 > 0x3fffffffu) {
+		spdlog::error("OctreeDAG: {} nodes exceed the 30-bit pointers", level_base.back());
+		return nullptr;
+	}
+
+	std::shared_ptr<OctreeDAG> ret = std::make_shared<OctreeDAG>();
+	ret->m_source_node_count = kSourceNodeCount;
+	ret->m_nodes.resize(level_base.back() * 8);
+	for (size_t l = 0; l < levels.size(); ++l)
+		thread_pool->ParallelFor(distinct_nodes[l].size(), kNodeGrain, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				for (uint32_t slot = 0; slot < 8; ++slot) {
+					uint32_t word = distinct_nodes[l][i][slot];
+					if (is_pointer(word))
+						word = 0x80000000u | (uint32_t)((level_base[l + 1] + (word & 0x7fffffffu)) << 3u);
+					ret->m_nodes[(level_base[l] + i) * 8 + slot] = word;
+				}
+		});
+
+	// leaf counts of the distinct nodes bottom-up, the offsets are their exclusive prefix sums within each node
+	std::vector<std::vector<uint64_t>> leaf_counts(levels.size());
+	ret->m_leaf_offsets.resize(ret->m_nodes.size());
+	for (size_t l = levels.size(); l-- > 0;) {
+		leaf_counts[l].resize(distinct_nodes[l].size());
+		thread_pool->ParallelFor(distinct_nodes[l].size(), kNodeGrain, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				uint64_t count = 0;
+				for (uint32_t slot = 0; slot < 8; ++slot) {
+					uint32_t word = distinct_nodes[l][i][slot];
+					ret->m_leaf_offsets[(level_base[l] + i) * 8 + slot] = (uint32_t)count;
+					if (is_leaf(word))
+						++count;
+					else if (is_pointer(word))
+						count += leaf_counts[l + 1][word & 0x7fffffffu];
+				}
+				leaf_counts[l][i] = count;
+			}
+		});
+	}
+	if (leaf_counts[0][0] > UINT32_MAX) {
+		spdlog::error("OctreeDAG: {} leaves exceed the 32-bit attribute indices", leaf_counts[0][0]);
+		return nullptr;
+	}
+
+	// colors in depth-first slot order, the order in which the offsets count the leaves
+	ret->m_attributes.reserve(leaf_counts[0][0]);
+	std::vector<std::pair<uint32_t, uint32_t>> stack = {{0, 0}}; // node, next slot
+	while (!stack.empty()) {
+		auto [node, slot] = stack.back();
+		if (slot == 8) {
+			stack.pop_back();
+			continue;
+		}
+		++stack.back().second;
+		uint32_t word = octree[node * 8 + slot];
+		if (is_leaf(word))
+			ret->m_attributes.push_back(word & 0xffffffu);
+		else if (is_pointer(word))
+			stack.emplace_back(get_child(word), 0);
+	}
+	return ret;
+}
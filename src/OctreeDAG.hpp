@@ -0,0 +1,38 @@
+#ifndef OCTREE_DAG_HPP
+#define OCTREE_DAG_HPP
+
+#include "ThreadPool.hpp"
+
+#include <memory>
+#include <vector>
+
+// Sparse voxel DAG: a post-build pass that hashes the nodes of a built octree (uOctree words, e.g. from
+// OctreeBuilder or CpuOctreeBuilder) bottom-up, level by level, and keeps one copy of every distinct subtree.
+// Subtrees merge by geometry alone: the result uses the uOctree layout again with colorless leaf words (0xC0000000),
+// pointers may just be shared, and the colors move to an attribute stream in depth-first slot order of the octree.
+// GetLeafOffsets() holds, for every word, the number of leaves in the slots before it in its node, so the leaf index
+// of a hit is the sum of these offsets along the path. LoaderThread builds it with OctreeLoadOptions::dag, the
+// wavefront path tracer traces it with shader/dag.glsl (Octree::GetDAGDescriptorSet).
+class OctreeDAG {
+private:
+	std::vector<uint32_t> m_nodes, m_leaf_offsets, m_attributes;
+	size_t m_source_node_count{};
+
+public:
+	// octree holds range bytes of uOctree words with the root node at word 0. nullptr if a node is not reachable in
+	// the expected layout or the leaf count overflows
+	static std::shared_ptr<OctreeDAG> Build(const std::shared_ptr<ThreadPool> &thread_pool, const uint32_t *octree,
+	                                        size_t range);
+
+	// uOctree words, 8 per node, root first
+	const std::vector<uint32_t> &GetNodes() const { return m_nodes; }
+	size_t GetRange() const { return m_nodes.size() * sizeof(uint32_t); }
+	// one word per node word, and the packed rgb of every leaf
+	const std::vector<uint32_t> &GetLeafOffsets() const { return m_leaf_offsets; }
+	const std::vector<uint32_t> &GetAttributes() const { return m_attributes; }
+
+	size_t GetSourceNodeCount() const { return m_source_node_count; }
+	size_t GetNodeCount() const { return m_nodes.size() / 8; }
+};
+
+#endif
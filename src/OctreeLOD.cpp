@@ -0,0 +1,77 @@
+#include "OctreeLOD.hpp"
+
+#include <array>
+#include <spdlog/spdlog.h>
+
+constexpr size_t kNodeGrain = 4096;
+
+std::vector<uint32_t> OctreeLOD::Build(const std::shared_ptr<ThreadPool> &thread_pool, const uint32_t *octree,
+                                       size_t range) {
+	const size_t kNodeCount = range / (8 * sizeof(uint32_t));
+	if (kNodeCount == 0)
+		return {};
+
+	// reachable nodes of every level, top-down. All leaves are at the same depth, so the nodes shared by an
+	// OctreeDAG are found at the same level from every parent
+	std::vector<std::vector<uint32_t>> levels = {{0}};
+	std::vector<bool> visited(kNodeCount);
+	visited[0] = true;
+	for (;;) {
+		std::vector<uint32_t> next;
+		for (uint32_t node : levels.back())
+			for (uint32_t slot = 0; slot < 8; ++slot) {
+				uint32_t word = octree[node * 8 + slot];
+				if ((word & 0xC0000000u) != 0x80000000u)
+					continue;
+				uint32_t child = (word & 0x3fffffffu) >> 3u;
+				if ((word & 7u) || child == 0 || child >= kNodeCount) {
+					spdlog::error("OctreeLOD: invalid pointer {:#x} in node {}", word, node);
+					return {};
+				}
+				if (!visited[child])
+					visited[child] = true, next.push_back(child);
+			}
+		if (next.empty())
+			break;
+		levels.push_back(std::move(next));
+	}
+
+	// bottom-up: leaf count and color sums of every node, then its average
+	struct Sum {
+		uint64_t count;
+		std::array<uint64_t, 3> rgb;
+	};
+	std::vector<Sum> sums(kNodeCount);
+	std::vector<uint32_t> lod(kNodeCount);
+	for (size_t l = levels.size(); l-- > 0;) {
+		const std::vector<uint32_t> &nodes = levels[l];
+		thread_pool->ParallelFor(nodes.size(), kNodeGrain, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				uint32_t node = nodes[i], children = 0;
+				Sum sum{};
+				for (uint32_t slot = 0; slot < 8; ++slot) {
+					uint32_t word = octree[node * 8 + slot];
+					if ((word & 0xC0000000u) == 0xC0000000u) {
+						++sum.count;
+						for (uint32_t c = 0; c < 3; ++c)
+							sum.rgb[c] += (word >> (c * 8u)) & 0xffu;
+					} else if (word & 0x80000000u) {
+						const Sum &child = sums[(word & 0x3fffffffu) >> 3u];
+						sum.count += child.count;
+						for (uint32_t c = 0; c < 3; ++c)
+							sum.rgb[c] += child.rgb[c];
+					} else
+						continue;
+					++children;
+				}
+				sums[node] = sum;
+				uint32_t word = children << 24u;
+				if (sum.count)
+					for (uint32_t c = 0; c < 3; ++c)
+						word |= (uint32_t)((sum.rgb[c] + sum.count / 2) / sum.count) << (c * 8u);
+				lod[node] = word;
+			}
+		});
+	}
+	return lod;
+}
@@ -0,0 +1,22 @@
+#ifndef OCTREE_LOD_HPP
+#define OCTREE_LOD_HPP
+
+#include "ThreadPool.hpp"
+
+#include <memory>
+#include <vector>
+
+// Level-of-detail attributes of the interior nodes of an octree (uOctree words, also a reordered octree). The
+// interior slots of uOctree only hold pointers, so the averages are a separate stream with one word per node block,
+// indexed by the word offset of the block / 8: the box-filtered color of all leaves below the node in the low 24 bits
+// (r in the low byte, as in the leaf words) and the number of its non-empty slots (1-8) in the top byte.
+// Octree_RayMarchLOD of shader/octree.glsl (OCTREE_LOD) and CpuOctreeTracer::RayMarchLOD stop at a node once it covers
+// the footprint of the ray and is at least half full, and use these colors.
+class OctreeLOD {
+public:
+	// octree holds range bytes of uOctree words with the root node at word 0. Empty if a pointer is invalid
+	static std::vector<uint32_t> Build(const std::shared_ptr<ThreadPool> &thread_pool, const uint32_t *octree,
+	                                   size_t range);
+};
+
+#endif
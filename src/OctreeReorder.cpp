@@ -0,0 +1,122 @@
+#include "OctreeReorder.hpp"
+
+#include <spdlog/spdlog.h>
+
+constexpr size_t kNodeGrain = 4096;
+constexpr uint32_t kUnplaced = 0xffffffffu;
+
+namespace {
+struct Layout {
+	const uint32_t *octree;
+	std::vector<uint32_t> order, new_index; // new -> old, old -> new
+
+	void Place(uint32_t node) {
+		if (new_index[node] == kUnplaced) {
+			new_index[node] = order.size();
+			order.push_back(node);
+		}
+	}
+	template <typename Func> void ForEachChild(uint32_t node, Func &&func) const {
+		for (uint32_t slot = 0; slot < 8; ++slot) {
+			uint32_t word = octree[node * 8 + slot];
+			if ((word & 0xC0000000u) == 0x80000000u)
+				func((word & 0x3fffffffu) >> 3u);
+		}
+	}
+
+	void DepthFirst() {
+		std::vector<uint32_t> stack = {0}, children;
+		Place(0);
+		while (!stack.empty()) {
+			uint32_t node = stack.back();
+			stack.pop_back();
+			children.clear();
+			ForEachChild(node, [&](uint32_t child) {
+				if (new_index[child] == kUnplaced)
+					Place(child), children.push_back(child);
+			});
+			stack.insert(stack.end(), children.rbegin(), children.rend());
+		}
+	}
+
+	void Gather(uint32_t node, uint32_t depth, std::vector<uint32_t> *nodes) const {
+		if (depth == 0)
+			nodes->push_back(node);
+		else
+			ForEachChild(node, [&](uint32_t child) { Gather(child, depth - 1, nodes); });
+	}
+	// lays out the levels [0, height) of the subtree of node
+	void VanEmdeBoas(uint32_t node, uint32_t height) {
+		if (new_index[node] != kUnplaced) // shared subtree of a DAG, already placed
+			return;
+		if (height == 1) {
+			Place(node);
+			return;
+		}
+		uint32_t top = height / 2;
+		VanEmdeBoas(node, top);
+		std::vector<uint32_t> bottom_roots;
+		Gather(node, top, &bottom_roots);
+		for (uint32_t bottom_root : bottom_roots)
+			VanEmdeBoas(bottom_root, height - top);
+	}
+};
+} // namespace
+
+std::vector<uint32_t> OctreeReorder::Reorder(const std::shared_ptr<ThreadPool> &thread_pool, const uint32_t *octree,
+                                             size_t range, OctreeNodeOrder order) {
+	const size_t kNodeCount = range / (8 * sizeof(uint32_t));
+	if (kNodeCount == 0)
+		return {};
+
+	// validate the pointers and count the levels, so the traversals below can trust them
+	uint32_t height = 0;
+	{
+		std::vector<uint8_t> reached(kNodeCount);
+		std::vector<uint32_t> level = {0};
+		while (!level.empty()) {
+			++height;
+			std::vector<uint32_t> next;
+			for (uint32_t node : level)
+				for (uint32_t slot = 0; slot < 8; ++slot) {
+					uint32_t word = octree[node * 8 + slot];
+					if ((word & 0xC0000000u) != 0x80000000u)
+						continue;
+					uint32_t child = (word & 0x3fffffffu) >> 3u;
+					if ((word & 7u) || child == 0 || child >= kNodeCount) {
+						spdlog::error("OctreeReorder: invalid pointer {:#x} in node {}", word, node);
+						return {};
+					}
+					if (!reached[child])
+						reached[child] = 1, next.push_back(child);
+				}
+			level = std::move(next);
+		}
+	}
+
+	Layout layout{octree};
+	layout.order.reserve(kNodeCount);
+	layout.new_index.assign(kNodeCount, kUnplaced);
+	if (order == OctreeNodeOrder::kDepthFirst)
+		layout.DepthFirst();
+	else if (order == OctreeNodeOrder::kVanEmdeBoas)
+		layout.VanEmdeBoas(0, height);
+	else {
+		// breadth-first, which drops the unreachable nodes as well
+		layout.Place(0);
+		for (size_t i = 0; i < layout.order.size(); ++i)
+			layout.ForEachChild(layout.order[i], [&](uint32_t child) { layout.Place(child); });
+	}
+
+	std::vector<uint32_t> ret(layout.order.size() * 8);
+	thread_pool->ParallelFor(layout.order.size(), kNodeGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			for (uint32_t slot = 0; slot < 8; ++slot) {
+				uint32_t word = octree[layout.order[i] * 8 + slot];
+				if ((word & 0xC0000000u) == 0x80000000u)
+					word = 0x80000000u | (layout.new_index[(word & 0x3fffffffu) >> 3u] << 3u);
+				ret[i * 8 + slot] = word;
+			}
+	});
+	return ret;
+}
@@ -0,0 +1,27 @@
+#ifndef OCTREE_REORDER_HPP
+#define OCTREE_REORDER_HPP
+
+#include "ThreadPool.hpp"
+
+#include <memory>
+#include <vector>
+
+enum class OctreeNodeOrder {
+	kBuild,       // as allocated by the builder, breadth-first
+	kDepthFirst,  // depth-first, the children of a node follow each other before the walk descends into the first
+	kVanEmdeBoas, // recursive: the top half of the levels first, then every subtree hanging below it in one piece
+};
+constexpr const char *kOctreeNodeOrderNames[] = {"Build (Breadth-first)", "Depth-first", "van Emde Boas"};
+
+// Post-build relayout of the nodes of an octree (uOctree words, also an OctreeDAG) so that the nodes a ray descends
+// through lie close to each other. The octree allocators hand out nodes breadth-first, a descent therefore touches
+// one node per level spread over the whole buffer. Pointers are fixed up and unreachable nodes dropped, every tracer
+// walks the result unchanged.
+class OctreeReorder {
+public:
+	// octree holds range bytes of uOctree words with the root node at word 0. Empty if a pointer is invalid
+	static std::vector<uint32_t> Reorder(const std::shared_ptr<ThreadPool> &thread_pool, const uint32_t *octree,
+	                                     size_t range, OctreeNodeOrder order);
+};
+
+#endif
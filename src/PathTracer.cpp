@@ -2,6 +2,9 @@
 #include "Config.hpp"
 #include "Noise.inl"
 
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
 inline static constexpr uint32_t group_8(uint32_t x) { return (x >> 3u) + ((x & 0x7u) ? 1u : 0u); }
 
 void PathTracer::create_target_images(const std::shared_ptr<myvk::Device> &device,
@@ -16,9 +19,14 @@ void PathTracer::create_target_images(const std::shared_ptr<myvk::Device> &devic
 	    device, {m_width, m_height}, 1, VK_FORMAT_R8G8B8A8_SNORM,
 	    VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT, access_queue);
 
+	m_statistics_image = myvk::Image::CreateTexture2D(
+	    device, {m_width, m_height}, 1, VK_FORMAT_R32G32B32A32_SFLOAT,
+	    VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT, access_queue);
+
 	m_color_image_view = myvk::ImageView::Create(m_color_image, VK_IMAGE_VIEW_TYPE_2D);
 	m_albedo_image_view = myvk::ImageView::Create(m_albedo_image, VK_IMAGE_VIEW_TYPE_2D);
 	m_normal_image_view = myvk::ImageView::Create(m_normal_image, VK_IMAGE_VIEW_TYPE_2D);
+	m_statistics_image_view = myvk::ImageView::Create(m_statistics_image, VK_IMAGE_VIEW_TYPE_2D);
 }
 
 void PathTracer::create_noise_images(const std::shared_ptr<myvk::Device> &device) {
@@ -29,8 +37,10 @@ void PathTracer::create_noise_images(const std::shared_ptr<myvk::Device> &device
 }
 
 void PathTracer::create_descriptor(const std::shared_ptr<myvk::Device> &device) {
-	m_descriptor_pool = myvk::DescriptorPool::Create(
-	    device, 2, {{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3}, {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1}});
+	m_descriptor_pool = myvk::DescriptorPool::Create(device, 3,
+	                                                 {{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 4},
+	                                                  {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+	                                                  {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1}});
 	{
 		VkDescriptorSetLayoutBinding color_binding = {};
 		color_binding.binding = 0;
@@ -50,8 +60,14 @@ void PathTracer::create_descriptor(const std::shared_ptr<myvk::Device> &device)
 		normal_binding.descriptorCount = 1;
 		normal_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
-		m_target_descriptor_set_layout =
-		    myvk::DescriptorSetLayout::Create(device, {color_binding, albedo_binding, normal_binding});
+		VkDescriptorSetLayoutBinding statistics_binding = {};
+		statistics_binding.binding = 3;
+		statistics_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		statistics_binding.descriptorCount = 1;
+		statistics_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		m_target_descriptor_set_layout = myvk::DescriptorSetLayout::Create(
+		    device, {color_binding, albedo_binding, normal_binding, statistics_binding});
 	}
 
 	{
@@ -69,6 +85,28 @@ void PathTracer::create_descriptor(const std::shared_ptr<myvk::Device> &device)
 
 	m_noise_descriptor_set = myvk::DescriptorSet::Create(m_descriptor_pool, m_noise_descriptor_set_layout);
 	m_noise_descriptor_set->UpdateCombinedImageSampler(m_noise_sampler, m_noise_image_view, 0);
+
+	{
+		VkDescriptorSetLayoutBinding counter_binding = {};
+		counter_binding.binding = 0;
+		counter_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		counter_binding.descriptorCount = 1;
+		counter_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		m_counter_descriptor_set_layout = myvk::DescriptorSetLayout::Create(device, {counter_binding});
+	}
+	m_counter_buffer = myvk::Buffer::Create(device, 2 * sizeof(uint32_t), 0,
+	                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+	                                            VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	m_counter_init_buffer =
+	    myvk::Buffer::CreateStaging<uint32_t>(device, 2, [](auto *data) { std::fill(data, data + 2, 0u); });
+	for (auto &counter_readback_buffer : m_counter_readback_buffers)
+		counter_readback_buffer =
+		    myvk::Buffer::Create(device, 2 * sizeof(uint32_t),
+		                         VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+		                         VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	m_counter_descriptor_set = myvk::DescriptorSet::Create(m_descriptor_pool, m_counter_descriptor_set_layout);
+	m_counter_descriptor_set->UpdateStorageBuffer(m_counter_buffer, 0);
 }
 
 void PathTracer::create_pipeline(const std::shared_ptr<myvk::Device> &device) {
@@ -76,16 +114,32 @@ void PathTracer::create_pipeline(const std::shared_ptr<myvk::Device> &device) {
 	    device,
 	    {m_octree_ptr->GetDescriptorSetLayout(), m_camera_ptr->GetDescriptorSetLayout(),
 	     m_lighting_ptr->GetEnvironmentMapPtr()->GetDescriptorSetLayout(), m_sobol.GetDescriptorSetLayout(),
-	     m_target_descriptor_set_layout, m_noise_descriptor_set_layout},
-	    {{VK_SHADER_STAGE_COMPUTE_BIT, 0, 2 * sizeof(uint32_t) + 5 * sizeof(float)}});
+	     m_target_descriptor_set_layout, m_noise_descriptor_set_layout, m_counter_descriptor_set_layout},
+	    {{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants)}});
 	{
 		constexpr uint32_t kPathTracerCompSpv[] = {
 #include "spirv/path_tracer.comp.u32"
 		};
-		std::shared_ptr<myvk::ShaderModule> path_tracer_shader_module =
-		    myvk::ShaderModule::Create(device, kPathTracerCompSpv, sizeof(kPathTracerCompSpv));
-		m_pipeline = myvk::ComputePipeline::Create(m_pipeline_layout, path_tracer_shader_module);
+		m_shader_module = myvk::ShaderModule::Create(device, kPathTracerCompSpv, sizeof(kPathTracerCompSpv));
 	}
+	m_light_type_pipelines.fill(get_pipeline(kGenericLightType, 0));
+}
+
+const std::shared_ptr<myvk::ComputePipeline> &PathTracer::get_pipeline(uint32_t light_type, uint32_t bounce) {
+	auto it = m_pipelines.find({light_type, bounce});
+	if (it != m_pipelines.end())
+		return it->second;
+
+	// kLightType and kBounce of path_tracer.comp, the generic values are their defaults
+	uint32_t spec_data[] = {light_type, bounce};
+	VkSpecializationMapEntry spec_entries[] = {{0, 0, sizeof(uint32_t)}, {1, sizeof(uint32_t), sizeof(uint32_t)}};
+	VkSpecializationInfo spec_info = {2, spec_entries, sizeof(spec_data), spec_data};
+	// tiles are dispatched with a base workgroup, gl_GlobalInvocationID stays the pixel coordinate
+	VkComputePipelineCreateInfo create_info = {VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+	create_info.flags = VK_PIPELINE_CREATE_DISPATCH_BASE_BIT;
+	create_info.stage = m_shader_module->GetPipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT);
+	create_info.stage.pSpecializationInfo = &spec_info;
+	return m_pipelines[{light_type, bounce}] = myvk::ComputePipeline::Create(m_pipeline_layout, create_info);
 }
 
 void PathTracer::clear_target_images(const std::shared_ptr<myvk::CommandPool> &command_pool) {
@@ -99,11 +153,14 @@ void PathTracer::clear_target_images(const std::shared_ptr<myvk::CommandPool> &c
 	     m_albedo_image->GetMemoryBarrier(VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
 	                                      VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL),
 	     m_normal_image->GetMemoryBarrier(VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
-	                                      VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)});
+	                                      VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL),
+	     m_statistics_image->GetMemoryBarrier(VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+	                                          VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)});
 
 	command_buffer->CmdClearColorImage(m_color_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 	command_buffer->CmdClearColorImage(m_albedo_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 	command_buffer->CmdClearColorImage(m_normal_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	command_buffer->CmdClearColorImage(m_statistics_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
 	command_buffer->CmdPipelineBarrier(
 	    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, {}, {},
@@ -112,7 +169,9 @@ void PathTracer::clear_target_images(const std::shared_ptr<myvk::CommandPool> &c
 	     m_albedo_image->GetMemoryBarrier(VK_IMAGE_ASPECT_COLOR_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, 0,
 	                                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL),
 	     m_normal_image->GetMemoryBarrier(VK_IMAGE_ASPECT_COLOR_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, 0,
-	                                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL)});
+	                                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL),
+	     m_statistics_image->GetMemoryBarrier(VK_IMAGE_ASPECT_COLOR_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, 0,
+	                                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL)});
 	command_buffer->End();
 
 	command_buffer->Submit(fence);
@@ -169,6 +228,14 @@ std::shared_ptr<PathTracer> PathTracer::Create(const std::shared_ptr<Octree> &oc
 	ret->set_noise_image(command_pool);
 	ret->create_descriptor(command_pool->GetDevicePtr());
 	ret->create_pipeline(command_pool->GetDevicePtr());
+	for (auto &query_pool : ret->m_query_pools)
+		query_pool = myvk::QueryPool::Create(command_pool->GetDevicePtr(), VK_QUERY_TYPE_TIMESTAMP, 2);
+	ret->m_wavefront_ptr = WavefrontPathTracer::Create(
+	    command_pool->GetDevicePtr(),
+	    {octree->GetDescriptorSetLayout(), camera->GetDescriptorSetLayout(),
+	     lighting->GetEnvironmentMapPtr()->GetDescriptorSetLayout(), ret->m_sobol.GetDescriptorSetLayout(),
+	     ret->m_target_descriptor_set_layout, ret->m_noise_descriptor_set_layout},
+	    sizeof(PushConstants));
 
 	return ret;
 }
@@ -181,37 +248,176 @@ void PathTracer::Reset(const std::shared_ptr<myvk::CommandPool> &command_pool,
 		m_camera_ptr->UpdateFrameUniformBuffer(kFrameCount);
 		m_camera_ptr->m_aspect_ratio = tmp;
 	}
+	// path_tracer.comp reads the sample counter after the (bounce + 1) * 2 dimensions
 	m_sobol.Reset(command_pool, (m_bounce + 1) * 2);
 	create_target_images(command_pool->GetDevicePtr(), {command_pool->GetQueuePtr(), shared_queue});
 	clear_target_images(command_pool);
 	m_target_descriptor_set->UpdateStorageImage(m_color_image_view, 0);
 	m_target_descriptor_set->UpdateStorageImage(m_albedo_image_view, 1);
 	m_target_descriptor_set->UpdateStorageImage(m_normal_image_view, 2);
+	m_target_descriptor_set->UpdateStorageImage(m_statistics_image_view, 3);
+
+	if (m_mode == Modes::kWavefront && !m_wavefront_ptr) {
+		spdlog::error("Wavefront path tracer not available, falling back to the megakernel");
+		m_mode = Modes::kMegakernel;
+	}
+	m_render_mode = m_mode;
+	m_render_structure = WavefrontPathTracer::Structure::kOctree;
+	if (m_render_mode == Modes::kWavefront) {
+		if (m_tree64 && !m_octree_ptr->HasTree64())
+			spdlog::warn("The octree was loaded without a 64-tree");
+		if (m_dag && !m_octree_ptr->HasDAG())
+			spdlog::warn("The octree was loaded without a DAG");
+		if (m_compact && !m_octree_ptr->HasCompact())
+			spdlog::warn("The octree was loaded without a compact encoding");
+		if (m_tree64 && m_octree_ptr->HasTree64())
+			m_render_structure = WavefrontPathTracer::Structure::kTree64;
+		else if (m_dag && m_octree_ptr->HasDAG())
+			m_render_structure = WavefrontPathTracer::Structure::kDAG;
+		else if (m_compact && m_octree_ptr->HasCompact())
+			m_render_structure = WavefrontPathTracer::Structure::kCompact;
+	}
+	// the light type can change without a reset
+	for (uint32_t light_type = 0; light_type < kLightTypeCount; ++light_type)
+		m_light_type_pipelines[light_type] =
+		    m_specialized_pipelines ? get_pipeline(light_type, m_bounce) : get_pipeline(kGenericLightType, 0);
+	if (m_render_mode == Modes::kWavefront)
+		m_wavefront_ptr->Reset(command_pool->GetDevicePtr(), m_width, m_height, m_bounce, m_specialized_pipelines,
+		                       m_render_structure);
 }
 
-void PathTracer::CmdRender(const std::shared_ptr<myvk::CommandBuffer> &command_buffer) {
-	command_buffer->CmdBindDescriptorSets({m_octree_ptr->GetDescriptorSet(),
-	                                       m_camera_ptr->GetFrameDescriptorSet(kFrameCount),
-	                                       m_lighting_ptr->GetEnvironmentMapPtr()->GetDescriptorSet(),
-	                                       m_sobol.GetDescriptorSet(), m_target_descriptor_set, m_noise_descriptor_set},
-	                                      m_pipeline);
-
-	uint32_t uint_push_constants[] = {m_bounce, (uint32_t)m_lighting_ptr->GetFinalLightType()};
-	float float_push_constants[] = {
-	    m_lighting_ptr->m_sun_radiance.x, m_lighting_ptr->m_sun_radiance.y, m_lighting_ptr->m_sun_radiance.z,
-	    m_lighting_ptr->GetEnvironmentMapPtr()->m_rotation, m_lighting_ptr->GetEnvironmentMapPtr()->m_multiplier};
-
-	command_buffer->CmdPushConstants(m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint_push_constants),
-	                                 uint_push_constants);
-	command_buffer->CmdPushConstants(m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, sizeof(uint_push_constants),
-	                                 sizeof(float_push_constants), float_push_constants);
-	command_buffer->CmdBindPipeline(m_pipeline);
-	command_buffer->CmdDispatch(group_8(m_width), group_8(m_height), 1);
-
-	command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, {},
-	                                   {}, {});
-
-	m_sobol.CmdNext(command_buffer);
+const std::shared_ptr<myvk::DescriptorSet> &PathTracer::get_octree_descriptor_set() const {
+	switch (m_render_structure) {
+	case WavefrontPathTracer::Structure::kTree64:
+		return m_octree_ptr->GetTree64DescriptorSet();
+	case WavefrontPathTracer::Structure::kDAG:
+		return m_octree_ptr->GetDAGDescriptorSet();
+	case WavefrontPathTracer::Structure::kCompact:
+		return m_octree_ptr->GetCompactDescriptorSet();
+	default:
+		return m_octree_ptr->GetDescriptorSet();
+	}
+}
+
+void PathTracer::cmd_tile_barrier(const std::shared_ptr<myvk::CommandBuffer> &command_buffer) const {
+	// samples and tiles can follow each other in one command buffer or in submissions without a fence in between
+	VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT |
+	                        VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	command_buffer->CmdPipelineBarrier(
+	    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+	    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+	    {barrier}, {}, {});
+}
+
+void PathTracer::CmdRender(const std::shared_ptr<myvk::CommandBuffer> &command_buffer, uint32_t timing_slot) {
+	TileScheduler::Tile frame = {0, 0, m_width, m_height};
+	CmdRenderTiles(command_buffer, &frame, 1, true, timing_slot);
+}
+
+void PathTracer::CmdRenderTiles(const std::shared_ptr<myvk::CommandBuffer> &command_buffer,
+                                const TileScheduler::Tile *tiles, uint32_t tile_count, bool finish_sample,
+                                uint32_t timing_slot) {
+	cmd_tile_barrier(command_buffer);
+
+	const auto &query_pool = m_query_pools[timing_slot];
+	command_buffer->CmdResetQueryPool(query_pool);
+	command_buffer->CmdWriteTimestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 0);
+
+	std::vector<std::shared_ptr<myvk::DescriptorSet>> descriptor_sets = {
+	    get_octree_descriptor_set(),
+	    m_camera_ptr->GetFrameDescriptorSet(kFrameCount),
+	    m_lighting_ptr->GetEnvironmentMapPtr()->GetDescriptorSet(),
+	    m_sobol.GetDescriptorSet(),
+	    m_target_descriptor_set,
+	    m_noise_descriptor_set};
+
+	PushConstants push_constants = {
+	    m_bounce,
+	    (uint32_t)m_lighting_ptr->GetFinalLightType(),
+	    {m_lighting_ptr->m_sun_radiance.x, m_lighting_ptr->m_sun_radiance.y, m_lighting_ptr->m_sun_radiance.z},
+	    m_lighting_ptr->GetEnvironmentMapPtr()->m_rotation,
+	    m_lighting_ptr->GetEnvironmentMapPtr()->m_multiplier,
+	    m_russian_roulette ? std::min(m_roulette_min_bounce, m_bounce) : m_bounce,
+	    m_adaptive_min_samples,
+	    m_adaptive_threshold,
+	    m_lod && m_octree_ptr->HasLOD() && m_render_structure == WavefrontPathTracer::Structure::kOctree
+	        ? m_lod_spread
+	        : 0.0f};
+
+	if (m_render_mode == Modes::kWavefront) {
+		WavefrontPathTracer::SampleSettings settings = {push_constants.light_type};
+		// the tiles share the path states and queues
+		for (uint32_t i = 0; i < tile_count; ++i) {
+			if (i)
+				cmd_tile_barrier(command_buffer);
+			m_wavefront_ptr->CmdRender(command_buffer, descriptor_sets, &push_constants, sizeof(PushConstants),
+			                           tiles[i], settings, timing_slot);
+		}
+	} else {
+		const auto &counter_readback_buffer = m_counter_readback_buffers[timing_slot];
+		command_buffer->CmdCopy(m_counter_init_buffer, m_counter_buffer, {{0, 0, m_counter_buffer->GetSize()}});
+		command_buffer->CmdPipelineBarrier(
+		    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, {},
+		    {m_counter_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT,
+		                                        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)},
+		    {});
+
+		const auto &pipeline = m_light_type_pipelines[std::min(push_constants.light_type, kLightTypeCount - 1)];
+		descriptor_sets.push_back(m_counter_descriptor_set);
+		command_buffer->CmdBindDescriptorSets(descriptor_sets, pipeline);
+		command_buffer->CmdPushConstants(m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants),
+		                                 &push_constants);
+		command_buffer->CmdBindPipeline(pipeline);
+		// tiles are disjoint, no barrier in between
+		for (uint32_t i = 0; i < tile_count; ++i) {
+			const TileScheduler::Tile &tile = tiles[i];
+			uint32_t base_x = tile.x >> 3u, base_y = tile.y >> 3u;
+			command_buffer->CmdDispatchBase(base_x, base_y, 0, group_8(tile.x + tile.width) - base_x,
+			                                group_8(tile.y + tile.height) - base_y, 1);
+		}
+
+		command_buffer->CmdPipelineBarrier(
+		    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, {},
+		    {m_counter_buffer->GetMemoryBarrier(VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT)}, {});
+		command_buffer->CmdCopy(m_counter_buffer, counter_readback_buffer, {{0, 0, m_counter_buffer->GetSize()}});
+		command_buffer->CmdPipelineBarrier(
+		    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, {},
+		    {counter_readback_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT)}, {});
+	}
+
+	command_buffer->CmdWriteTimestamp(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, query_pool, 1);
+
+	if (finish_sample) {
+		command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                                   {}, {}, {});
+		m_sobol.CmdNext(command_buffer);
+	}
+}
+
+bool PathTracer::GetKernelTimings(KernelTimings *timings, uint32_t timing_slot) const {
+	*timings = {};
+	if (m_render_mode == Modes::kWavefront && !m_wavefront_ptr->GetKernelTimings(&timings->wavefront, timing_slot))
+		return false;
+
+	const auto &query_pool = m_query_pools[timing_slot];
+	uint64_t timestamps[2];
+	if (query_pool->GetResults64(timestamps, 0) != VK_SUCCESS)
+		return false;
+	timings->total_ms = double(timestamps[1] - timestamps[0]) *
+	                    query_pool->GetDevicePtr()->GetPhysicalDevicePtr()->GetProperties().vk10.limits.timestampPeriod *
+	                    0.000001;
+	if (m_render_mode == Modes::kWavefront) {
+		timings->paths = timings->wavefront.paths;
+		timings->traversals = timings->wavefront.extend_rays + timings->wavefront.shadow_rays;
+	} else {
+		// written by the same submission as the timestamps
+		const auto *counters = (const uint32_t *)m_counter_readback_buffers[timing_slot]->GetMappedData();
+		timings->paths = counters[0];
+		timings->traversals = counters[1];
+	}
+	return true;
 }
 
 void PathTracer::extract_target_image_to_buffer(const std::shared_ptr<myvk::CommandPool> &command_pool,
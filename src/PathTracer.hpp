@@ -6,12 +6,41 @@
 #include "Lighting.hpp"
 #include "Octree.hpp"
 #include "Sobol.hpp"
+#include "TileScheduler.hpp"
+#include "WavefrontPathTracer.hpp"
 #include "myvk/Image.hpp"
+#include "myvk/QueryPool.hpp"
 
+#include <array>
 #include <glm/glm.hpp>
+#include <map>
+#include <utility>
 
 class PathTracer {
+public:
+	enum class Modes { kMegakernel = 0, kWavefront };
+	// GPU time of the last finished CmdRender or CmdRenderTiles and its sampled pixels and octree traversals, the
+	// per-kernel split and the ray counts (of its last tile) are only known for kWavefront
+	struct KernelTimings {
+		double total_ms;
+		uint64_t paths, traversals;
+		WavefrontPathTracer::KernelTimings wavefront;
+		double GetTraversalsPerSample() const { return paths ? double(traversals) / double(paths) : 0.0; }
+	};
+
 private:
+	// push constants of path_tracer.comp
+	struct PushConstants {
+		uint32_t bounce, light_type;
+		float const_color[3], env_map_rotation, env_map_multiplier;
+		uint32_t roulette_bounce; // the bounce count disables the Russian roulette
+		uint32_t adaptive_min_samples;
+		float adaptive_threshold;
+		// the rays after the first diffuse bounce stop at the octree nodes whose size reaches lod_spread * distance
+		// and take their OctreeLOD color, 0 traces them to the leaves
+		float lod_spread;
+	};
+
 	std::shared_ptr<Octree> m_octree_ptr;
 	std::shared_ptr<Camera> m_camera_ptr;
 	std::shared_ptr<Lighting> m_lighting_ptr;
@@ -19,20 +48,42 @@ private:
 	Sobol m_sobol;
 	std::shared_ptr<myvk::Image> m_color_image, m_albedo_image, m_normal_image, m_noise_image;
 	std::shared_ptr<myvk::ImageView> m_color_image_view, m_albedo_image_view, m_normal_image_view, m_noise_image_view;
+	// per-pixel sample count and luminance moments of the adaptive sampling (shader/adaptive.glsl)
+	std::shared_ptr<myvk::Image> m_statistics_image;
+	std::shared_ptr<myvk::ImageView> m_statistics_image_view;
 	std::shared_ptr<myvk::Sampler> m_noise_sampler;
 
 	std::shared_ptr<myvk::DescriptorPool> m_descriptor_pool;
 	std::shared_ptr<myvk::DescriptorSetLayout> m_target_descriptor_set_layout, m_noise_descriptor_set_layout;
 	std::shared_ptr<myvk::DescriptorSet> m_target_descriptor_set, m_noise_descriptor_set;
+	// {paths, traversals} of path_tracer.comp, cleared from m_counter_init_buffer before every CmdRenderTiles
+	std::shared_ptr<myvk::Buffer> m_counter_buffer, m_counter_init_buffer;
+	std::array<std::shared_ptr<myvk::Buffer>, kPTMaxSubmissionsInFlight> m_counter_readback_buffers;
+	std::shared_ptr<myvk::DescriptorSetLayout> m_counter_descriptor_set_layout;
+	std::shared_ptr<myvk::DescriptorSet> m_counter_descriptor_set;
 
 	std::shared_ptr<myvk::PipelineLayout> m_pipeline_layout;
-	std::shared_ptr<myvk::ComputePipeline> m_pipeline;
-
+	std::shared_ptr<myvk::ShaderModule> m_shader_module;
+	// path_tracer.comp specialized by light type and bounce count, kGenericLightType and bounce count 0 read them from
+	// the push constants
+	static constexpr uint32_t kGenericLightType = 0xffffffffu, kLightTypeCount = 2;
+	std::map<std::pair<uint32_t, uint32_t>, std::shared_ptr<myvk::ComputePipeline>> m_pipelines;
+	std::array<std::shared_ptr<myvk::ComputePipeline>, kLightTypeCount> m_light_type_pipelines; // selected by Reset
+	std::array<std::shared_ptr<myvk::QueryPool>, kPTMaxSubmissionsInFlight> m_query_pools;
+
+	std::shared_ptr<WavefrontPathTracer> m_wavefront_ptr;
+	Modes m_render_mode{Modes::kMegakernel}; // mode of the last Reset
+	// m_tree64, m_dag or m_compact of the last Reset, the first of them the octree was loaded with
+	WavefrontPathTracer::Structure m_render_structure{WavefrontPathTracer::Structure::kOctree};
+
+	void cmd_tile_barrier(const std::shared_ptr<myvk::CommandBuffer> &command_buffer) const;
 	void create_target_images(const std::shared_ptr<myvk::Device> &device,
 	                          const std::vector<std::shared_ptr<myvk::Queue>> &access_queue);
 	void create_noise_images(const std::shared_ptr<myvk::Device> &device);
 	void create_descriptor(const std::shared_ptr<myvk::Device> &device);
 	void create_pipeline(const std::shared_ptr<myvk::Device> &device);
+	const std::shared_ptr<myvk::ComputePipeline> &get_pipeline(uint32_t light_type, uint32_t bounce);
+	const std::shared_ptr<myvk::DescriptorSet> &get_octree_descriptor_set() const; // of m_render_structure
 
 	void clear_target_images(const std::shared_ptr<myvk::CommandPool> &command_pool);
 	void set_noise_image(const std::shared_ptr<myvk::CommandPool> &command_pool);
@@ -44,6 +95,31 @@ private:
 public:
 	uint32_t m_width{kDefaultWidth}, m_height{kDefaultHeight};
 	uint32_t m_bounce;
+	Modes m_mode{Modes::kMegakernel}; // applied by Reset
+	// stop sampling pixels whose relative error is below m_adaptive_threshold after
+	// m_adaptive_min_samples samples, 0 to sample every pixel
+	float m_adaptive_threshold{0.0f};
+	uint32_t m_adaptive_min_samples{kDefaultAdaptiveMinSamples};
+	// terminate paths by their throughput from bounce m_roulette_min_bounce on
+	bool m_russian_roulette{false};
+	uint32_t m_roulette_min_bounce{kDefaultRouletteMinBounce};
+	// pipelines specialized for the light type and the bounce count, applied by Reset
+	bool m_specialized_pipelines{true};
+	// kWavefront only: trace the Tree64 of the octree (Octree::HasTree64) instead of the octree, applied by Reset
+	bool m_tree64{false};
+	// kWavefront only: trace the OctreeDAG of the octree (Octree::HasDAG) instead of the octree, applied by Reset.
+	// m_tree64 takes precedence
+	bool m_dag{false};
+	// kWavefront only: trace the CompactOctree of the octree (Octree::HasCompact) instead of the octree, applied by
+	// Reset. m_tree64 and m_dag take precedence
+	bool m_compact{false};
+	// the rays after the first diffuse bounce stop at the octree nodes of their footprint and use the LOD colors of
+	// the octree (Octree::HasLOD), only when tracing the octree itself
+	bool m_lod{false};
+	float m_lod_spread{kDefaultLODSpread};
+
+	bool IsWavefrontSupported() const { return m_wavefront_ptr != nullptr; }
+	Modes GetRenderMode() const { return m_render_mode; } // m_mode of the last Reset
 
 	static std::shared_ptr<PathTracer> Create(const std::shared_ptr<Octree> &octree,
 	                                          const std::shared_ptr<Camera> &camera,
@@ -56,11 +132,21 @@ public:
 	void Reset(const std::shared_ptr<myvk::CommandPool> &command_pool,
 	           const std::shared_ptr<myvk::Queue> &shared_queue);
 
-	void CmdRender(const std::shared_ptr<myvk::CommandBuffer> &command_buffer);
+	// records one sample, command buffers that can be in flight at the same time need different timing slots
+	// (< kPTMaxSubmissionsInFlight)
+	void CmdRender(const std::shared_ptr<myvk::CommandBuffer> &command_buffer, uint32_t timing_slot = 0);
+	// records a part of one sample, the next sample starts after a call with finish_sample (see TileScheduler)
+	void CmdRenderTiles(const std::shared_ptr<myvk::CommandBuffer> &command_buffer, const TileScheduler::Tile *tiles,
+	                    uint32_t tile_count, bool finish_sample, uint32_t timing_slot = 0);
+	// results of the last finished sample recorded with timing_slot, false if they are not available yet
+	bool GetKernelTimings(KernelTimings *timings, uint32_t timing_slot = 0) const;
 
 	const std::shared_ptr<myvk::Image> &GetColorImage() const { return m_color_image; }
 	const std::shared_ptr<myvk::Image> &GetAlbedoImage() const { return m_albedo_image; }
 	const std::shared_ptr<myvk::Image> &GetNormalImage() const { return m_normal_image; }
+	const std::shared_ptr<myvk::ImageView> &GetAlbedoImageView() const { return m_albedo_image_view; }
+	const std::shared_ptr<myvk::ImageView> &GetNormalImageView() const { return m_normal_image_view; }
+	const std::shared_ptr<myvk::ImageView> &GetStatisticsImageView() const { return m_statistics_image_view; }
 
 	const std::shared_ptr<myvk::DescriptorSetLayout> &GetTargetDescriptorSetLayout() const {
 		return m_target_descriptor_set_layout;
@@ -1,5 +1,7 @@
 #include "PathTracerThread.hpp"
 #include "Config.hpp"
+#include "TileScheduler.hpp"
+#include <algorithm>
 #include <spdlog/spdlog.h>
 
 std::shared_ptr<PathTracerThread> PathTracerThread::Create(const std::shared_ptr<PathTracerViewer> &path_tracer_viewer,
@@ -21,9 +23,10 @@ void PathTracerThread::Launch() {
 	m_pause = false;
 	m_spp = 0;
 	m_time = glfwGetTime();
+	m_timings = {};
 
 	m_path_tracer_viewer_ptr->GetPathTracerPtr()->Reset(myvk::CommandPool::Create(m_path_tracer_queue), m_main_queue);
-	m_path_tracer_viewer_ptr->Reset(myvk::CommandPool::Create(m_main_queue));
+	m_path_tracer_viewer_ptr->Reset(myvk::CommandPool::Create(m_main_queue), m_path_tracer_queue);
 
 	m_path_tracer_thread = std::thread(&PathTracerThread::path_tracer_thread_func, this);
 	m_viewer_thread = std::thread(&PathTracerThread::viewer_thread_func, this);
@@ -35,6 +38,11 @@ double PathTracerThread::GetRenderTime() const {
 	return glfwGetTime() - m_time;
 }
 
+PathTracer::KernelTimings PathTracerThread::GetKernelTimings() const {
+	std::lock_guard<std::mutex> lock{m_timings_mutex};
+	return m_timings;
+}
+
 void PathTracerThread::SetPause(bool pause) {
 	if (pause == m_pause)
 		return;
@@ -74,30 +82,109 @@ void PathTracerThread::path_tracer_thread_func() {
 	const std::shared_ptr<myvk::Device> &device = m_main_queue->GetDevicePtr();
 	const std::shared_ptr<PathTracer> &path_tracer = m_path_tracer_viewer_ptr->GetPathTracerPtr();
 
-	std::shared_ptr<myvk::CommandPool> pt_command_pool = myvk::CommandPool::Create(m_path_tracer_queue);
-
-	std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
+	const bool kTiled = m_tiled;
+	const uint32_t kSamplesPerSubmit = kTiled ? 1u : std::clamp(m_samples_per_submit, 1u, kPTMaxSamplesPerSubmit);
+	const uint32_t kSubmissionsInFlight = std::clamp(m_submissions_in_flight, 1u, kPTMaxSubmissionsInFlight);
+
+	// tiled command buffers are recorded again for every submission
+	std::shared_ptr<myvk::CommandPool> pt_command_pool = myvk::CommandPool::Create(
+	    m_path_tracer_queue, kTiled ? VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT : 0u);
+
+	// one command buffer per submission in flight, which also owns the timing slot of the same index
+	std::vector<std::shared_ptr<myvk::CommandBuffer>> pt_command_buffers =
+	    myvk::CommandBuffer::CreateMultiple(pt_command_pool, kSubmissionsInFlight);
+	if (!kTiled)
+		for (uint32_t slot = 0; slot < kSubmissionsInFlight; ++slot) {
+			pt_command_buffers[slot]->Begin();
+			for (uint32_t i = 0; i < kSamplesPerSubmit; ++i)
+				path_tracer->CmdRender(pt_command_buffers[slot], slot);
+			pt_command_buffers[slot]->End();
+		}
 
-	std::shared_ptr<myvk::CommandBuffer> pt_command_buffer = myvk::CommandBuffer::Create(pt_command_pool);
-	pt_command_buffer->Begin();
-	path_tracer->CmdRender(pt_command_buffer);
-	pt_command_buffer->End();
+	TileScheduler tile_scheduler;
+	if (kTiled)
+		tile_scheduler.Reset(path_tracer->m_width, path_tracer->m_height,
+		                     std::clamp(m_tile_size, kPTMinTileSize, kPTMaxTileSize),
+		                     std::clamp(m_tile_budget_ms, 1.0f, kPTMaxTileBudgetMs));
+
+	// per slot: the tiles of the submission and the SPP once it is finished
+	struct Submission {
+		uint32_t first_tile, last_tile, spp;
+	};
+	std::vector<Submission> submissions(kSubmissionsInFlight);
+
+	// submission n (counted from 1) signals n, so the semaphore value is the number of finished submissions
+	std::shared_ptr<myvk::TimelineSemaphore> semaphore = myvk::TimelineSemaphore::Create(device);
+	uint64_t submitted = 0, finished = 0;
+	uint32_t submitted_spp = 0;
+	const auto wait_finished = [&](uint64_t value) {
+		if (value <= finished)
+			return;
+		semaphore->Wait(value);
+		bool next_only = value == finished + 1;
+		finished = value;
+
+		// the slot of the last finished submission is not reused before the next submit
+		const uint32_t kSlot = (finished - 1) % kSubmissionsInFlight;
+		const Submission &submission = submissions[kSlot];
+		uint32_t prev_spp = m_spp;
+		m_spp = submission.spp;
+
+		PathTracer::KernelTimings timings;
+		bool update_interval = prev_spp == 0 || prev_spp / kPTResultUpdateInterval != m_spp / kPTResultUpdateInterval;
+		if (kTiled) {
+			if (path_tracer->GetKernelTimings(&timings, kSlot)) {
+				if (next_only)
+					tile_scheduler.Feedback(submission.first_tile, submission.last_tile, timings.total_ms);
+				if (update_interval) {
+					std::lock_guard<std::mutex> lock{m_timings_mutex};
+					m_timings = timings;
+				}
+			}
+			// show the progress of every tile run
+			UpdateViewer();
+		} else if (update_interval) {
+			if (path_tracer->GetKernelTimings(&timings, kSlot)) {
+				std::lock_guard<std::mutex> lock{m_timings_mutex};
+				m_timings = timings;
+			}
+			UpdateViewer();
+		}
+	};
 
 	acquire_resources();
 
 	while (m_run.load(std::memory_order_acquire)) {
-		fence->Reset();
-		pt_command_buffer->Submit(fence);
-		fence->Wait();
-
-		if ((m_spp++) % kPTResultUpdateInterval == 0)
-			UpdateViewer();
-
-		while (m_pause.load(std::memory_order_acquire)) {
-			spdlog::debug("m_pause_semaphore wait");
-			m_pause_semaphore.wait();
+		const uint32_t kSlot = submitted % kSubmissionsInFlight;
+		if (submitted >= kSubmissionsInFlight)
+			wait_finished(submitted - kSubmissionsInFlight + 1);
+
+		Submission &submission = submissions[kSlot];
+		if (kTiled) {
+			bool finish_sample = tile_scheduler.Next(&submission.first_tile, &submission.last_tile);
+			pt_command_buffers[kSlot]->Begin();
+			path_tracer->CmdRenderTiles(pt_command_buffers[kSlot],
+			                            tile_scheduler.GetTiles().data() + submission.first_tile,
+			                            submission.last_tile - submission.first_tile, finish_sample, kSlot);
+			pt_command_buffers[kSlot]->End();
+			submitted_spp += finish_sample ? 1u : 0u;
+		} else
+			submitted_spp += kSamplesPerSubmit;
+		submission.spp = submitted_spp;
+
+		pt_command_buffers[kSlot]->Submit(semaphore, submitted + 1);
+		++submitted;
+
+		if (m_pause.load(std::memory_order_acquire)) {
+			// drain the queue, so that the GPU is idle and the SPP is exact while paused
+			wait_finished(submitted);
+			while (m_pause.load(std::memory_order_acquire)) {
+				spdlog::debug("m_pause_semaphore wait");
+				m_pause_semaphore.wait();
+			}
 		}
 	}
+	wait_finished(submitted);
 
 	release_resources();
 
@@ -6,6 +6,7 @@
 #include <atomic>
 #include <binary_semaphore.hpp>
 #include <memory>
+#include <mutex>
 #include <thread>
 
 class PathTracerThread {
@@ -20,6 +21,9 @@ private:
 	uint32_t m_spp;
 	double m_time;
 
+	mutable std::mutex m_timings_mutex;
+	PathTracer::KernelTimings m_timings{};
+
 	void path_tracer_thread_func();
 	void viewer_thread_func();
 
@@ -41,8 +45,18 @@ public:
 
 	void UpdateViewer();
 
+	// applied by Launch: samples recorded into one command buffer and command buffers submitted ahead of the GPU
+	uint32_t m_samples_per_submit{1}, m_submissions_in_flight{1};
+	// applied by Launch: submit runs of tiles of about m_tile_budget_ms GPU time instead of whole samples
+	// (TileScheduler), m_samples_per_submit is ignored then
+	bool m_tiled{false};
+	uint32_t m_tile_size{kPTDefaultTileSize};
+	float m_tile_budget_ms{kPTDefaultTileBudgetMs};
+
 	uint32_t GetSPP() const { return m_spp; }
 	double GetRenderTime() const;
+	// GPU timings of a recent sample
+	PathTracer::KernelTimings GetKernelTimings() const;
 
 	bool IsPause() const { return m_pause; }
 	bool IsRunning() const { return m_path_tracer_thread.joinable() || m_viewer_thread.joinable(); }
@@ -45,17 +45,11 @@ void PathTracerViewer::create_render_pass(const std::shared_ptr<myvk::Device> &d
 	m_gen_render_pass = myvk::RenderPass::Create(device, render_pass_info);
 }
 
-void PathTracerViewer::create_gen_graphics_pipeline(const std::shared_ptr<myvk::Device> &device) {
-	m_gen_pipeline_layout = myvk::PipelineLayout::Create(device, {m_path_tracer_ptr->GetTargetDescriptorSetLayout()},
-	                                                     {{VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t)}});
-	constexpr uint32_t kPathTracerViewerGenFragSpirv[] = {
-#include "spirv/path_tracer_viewer_gen.frag.u32"
-	};
-
-	std::shared_ptr<myvk::ShaderModule> vert_shader_module, frag_shader_module;
-	vert_shader_module = myvk::ShaderModule::Create(device, kQuadVertSpv, sizeof(kQuadVertSpv));
-	frag_shader_module =
-	    myvk::ShaderModule::Create(device, kPathTracerViewerGenFragSpirv, sizeof(kPathTracerViewerGenFragSpirv));
+std::shared_ptr<myvk::GraphicsPipeline>
+PathTracerViewer::create_gen_graphics_pipeline(const std::shared_ptr<myvk::PipelineLayout> &pipeline_layout,
+                                               const std::shared_ptr<myvk::ShaderModule> &frag_shader_module) const {
+	std::shared_ptr<myvk::ShaderModule> vert_shader_module =
+	    myvk::ShaderModule::Create(pipeline_layout->GetDevicePtr(), kQuadVertSpv, sizeof(kQuadVertSpv));
 
 	std::vector<VkPipelineShaderStageCreateInfo> shader_stages = {
 	    vert_shader_module->GetPipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT),
@@ -71,8 +65,34 @@ void PathTracerViewer::create_gen_graphics_pipeline(const std::shared_ptr<myvk::
 	pipeline_state.m_color_blend_state.Enable(1, VK_FALSE);
 	pipeline_state.m_dynamic_state.Enable({VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR});
 
-	m_gen_graphics_pipeline =
-	    myvk::GraphicsPipeline::Create(m_gen_pipeline_layout, m_gen_render_pass, shader_stages, pipeline_state, 0);
+	return myvk::GraphicsPipeline::Create(pipeline_layout, m_gen_render_pass, shader_stages, pipeline_state, 0);
+}
+
+void PathTracerViewer::create_gen_graphics_pipelines(const std::shared_ptr<myvk::Device> &device) {
+	{
+		m_gen_pipeline_layout =
+		    myvk::PipelineLayout::Create(device, {m_path_tracer_ptr->GetTargetDescriptorSetLayout()},
+		                                 {{VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t)}});
+		constexpr uint32_t kPathTracerViewerGenFragSpirv[] = {
+#include "spirv/path_tracer_viewer_gen.frag.u32"
+		};
+		m_gen_graphics_pipeline = create_gen_graphics_pipeline(
+		    m_gen_pipeline_layout, myvk::ShaderModule::Create(device, kPathTracerViewerGenFragSpirv,
+		                                                      sizeof(kPathTracerViewerGenFragSpirv)));
+	}
+	{
+		// push constants: adaptive threshold and min samples
+		m_convergence_pipeline_layout =
+		    myvk::PipelineLayout::Create(device, {m_path_tracer_ptr->GetTargetDescriptorSetLayout()},
+		                                 {{VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(float) + sizeof(uint32_t)}});
+		constexpr uint32_t kPathTracerViewerConvergenceFragSpirv[] = {
+#include "spirv/path_tracer_viewer_convergence.frag.u32"
+		};
+		m_convergence_graphics_pipeline = create_gen_graphics_pipeline(
+		    m_convergence_pipeline_layout,
+		    myvk::ShaderModule::Create(device, kPathTracerViewerConvergenceFragSpirv,
+		                               sizeof(kPathTracerViewerConvergenceFragSpirv)));
+	}
 }
 
 void PathTracerViewer::create_descriptors(const std::shared_ptr<myvk::Device> &device) {
@@ -144,10 +164,11 @@ std::shared_ptr<PathTracerViewer> PathTracerViewer::Create(const std::shared_ptr
                                                            uint32_t subpass) {
 	std::shared_ptr<PathTracerViewer> ret = std::make_shared<PathTracerViewer>();
 	ret->m_path_tracer_ptr = path_tracer;
+	ret->m_denoiser_ptr = Denoiser::Create(path_tracer);
 
 	ret->m_sampler = myvk::Sampler::CreateClampToBorder(render_pass->GetDevicePtr(), VK_FILTER_NEAREST, {});
 	ret->create_render_pass(render_pass->GetDevicePtr());
-	ret->create_gen_graphics_pipeline(render_pass->GetDevicePtr());
+	ret->create_gen_graphics_pipelines(render_pass->GetDevicePtr());
 
 	ret->create_descriptors(render_pass->GetDevicePtr());
 	ret->create_main_graphics_pipeline(render_pass, subpass);
@@ -161,8 +182,10 @@ std::shared_ptr<PathTracerViewer> PathTracerViewer::Create(const std::shared_ptr
 	return ret;
 }
 
-void PathTracerViewer::Reset(const std::shared_ptr<myvk::CommandPool> &command_pool) {
+void PathTracerViewer::Reset(const std::shared_ptr<myvk::CommandPool> &command_pool,
+                             const std::shared_ptr<myvk::Queue> &shared_queue) {
 	m_view_type = ViewTypes::kColor;
+	m_denoiser_ptr->Reset(command_pool, shared_queue);
 
 	m_image = myvk::Image::CreateTexture2D(
 	    m_gen_render_pass->GetDevicePtr(), {m_path_tracer_ptr->m_width, m_path_tracer_ptr->m_height}, 1,
@@ -191,10 +214,18 @@ void PathTracerViewer::Reset(const std::shared_ptr<myvk::CommandPool> &command_p
 }
 
 void PathTracerViewer::CmdGenRenderPass(const std::shared_ptr<myvk::CommandBuffer> &command_buffer) const {
-	uint32_t view_type_u32 = (uint32_t)m_view_type;
+	bool convergence = m_view_type == ViewTypes::kConvergence;
+	bool denoised = m_view_type == ViewTypes::kDenoised && IsDenoisedViewSupported();
+	const auto &pipeline = convergence ? m_convergence_graphics_pipeline : m_gen_graphics_pipeline;
+
+	// the denoised color is shown as the color of a copy of the target set
+	if (denoised)
+		m_denoiser_ptr->CmdDenoise(command_buffer);
+
 	command_buffer->CmdBeginRenderPass(m_gen_render_pass, m_gen_framebuffer, {{{0.0f, 0.0f, 0.0f, 1.0f}}});
-	command_buffer->CmdBindPipeline(m_gen_graphics_pipeline);
-	command_buffer->CmdBindDescriptorSets({m_path_tracer_ptr->GetTargetDescriptorSet()}, m_gen_graphics_pipeline);
+	command_buffer->CmdBindPipeline(pipeline);
+	command_buffer->CmdBindDescriptorSets(
+	    {denoised ? m_denoiser_ptr->GetTargetDescriptorSet() : m_path_tracer_ptr->GetTargetDescriptorSet()}, pipeline);
 
 	VkRect2D scissor = {};
 	scissor.extent = {m_path_tracer_ptr->m_width, m_path_tracer_ptr->m_height};
@@ -204,8 +235,20 @@ void PathTracerViewer::CmdGenRenderPass(const std::shared_ptr<myvk::CommandBuffe
 	viewport.height = (float)m_path_tracer_ptr->m_height;
 	command_buffer->CmdSetViewport({viewport});
 
-	command_buffer->CmdPushConstants(m_gen_pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t),
-	                                 &view_type_u32);
+	if (convergence) {
+		struct {
+			float threshold;
+			uint32_t min_samples;
+		} push_constants = {m_path_tracer_ptr->m_adaptive_threshold, m_path_tracer_ptr->m_adaptive_min_samples};
+		command_buffer->CmdPushConstants(m_convergence_pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+		                                 sizeof(push_constants), &push_constants);
+	} else {
+		// kConvergence and kDenoised show the color of the bound set
+		uint32_t view_type_u32 =
+		    m_view_type == ViewTypes::kConvergence || m_view_type == ViewTypes::kDenoised ? 0u : (uint32_t)m_view_type;
+		command_buffer->CmdPushConstants(m_gen_pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t),
+		                                 &view_type_u32);
+	}
 	command_buffer->CmdDraw(3, 1, 0, 0);
 	command_buffer->CmdEndRenderPass();
 }
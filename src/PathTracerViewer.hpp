@@ -1,6 +1,7 @@
 #ifndef PATH_TRACER_VIEWER_HPP
 #define PATH_TRACER_VIEWER_HPP
 
+#include "Denoiser.hpp"
 #include "PathTracer.hpp"
 #include "myvk/Framebuffer.hpp"
 #include "myvk/GraphicsPipeline.hpp"
@@ -8,12 +9,15 @@
 
 class PathTracerViewer {
 public:
-	enum class ViewTypes { kColor = 0, kAlbedo, kNormal } m_view_type = ViewTypes::kColor;
+	// kConvergence shows the adaptive sampling state of the PathTracer, kDenoised the color filtered by
+	// the Denoiser on the GPU
+	enum class ViewTypes { kColor = 0, kAlbedo, kNormal, kConvergence, kDenoised } m_view_type = ViewTypes::kColor;
 
 private:
 	uint32_t m_width{kDefaultWidth}, m_height{kDefaultHeight};
 
 	std::shared_ptr<PathTracer> m_path_tracer_ptr;
+	std::shared_ptr<Denoiser> m_denoiser_ptr;
 
 	std::shared_ptr<myvk::Image> m_image;
 	std::shared_ptr<myvk::ImageView> m_image_view;
@@ -23,6 +27,8 @@ private:
 	std::shared_ptr<myvk::Framebuffer> m_gen_framebuffer;
 	std::shared_ptr<myvk::PipelineLayout> m_gen_pipeline_layout;
 	std::shared_ptr<myvk::GraphicsPipeline> m_gen_graphics_pipeline;
+	std::shared_ptr<myvk::PipelineLayout> m_convergence_pipeline_layout;
+	std::shared_ptr<myvk::GraphicsPipeline> m_convergence_graphics_pipeline;
 
 	std::shared_ptr<myvk::DescriptorPool> m_descriptor_pool;
 	std::shared_ptr<myvk::DescriptorSetLayout> m_descriptor_set_layout;
@@ -33,7 +39,10 @@ private:
 	std::shared_ptr<myvk::Buffer> m_texcoords_buffers[kFrameCount];
 
 	void create_render_pass(const std::shared_ptr<myvk::Device> &device);
-	void create_gen_graphics_pipeline(const std::shared_ptr<myvk::Device> &device);
+	std::shared_ptr<myvk::GraphicsPipeline>
+	create_gen_graphics_pipeline(const std::shared_ptr<myvk::PipelineLayout> &pipeline_layout,
+	                             const std::shared_ptr<myvk::ShaderModule> &frag_shader_module) const;
+	void create_gen_graphics_pipelines(const std::shared_ptr<myvk::Device> &device);
 	void create_descriptors(const std::shared_ptr<myvk::Device> &device);
 	void create_main_graphics_pipeline(const std::shared_ptr<myvk::RenderPass> &render_pass, uint32_t subpass);
 
@@ -42,14 +51,19 @@ public:
 	                                                const std::shared_ptr<myvk::RenderPass> &render_pass,
 	                                                uint32_t subpass);
 	const std::shared_ptr<PathTracer> &GetPathTracerPtr() const { return m_path_tracer_ptr; }
+	const std::shared_ptr<Denoiser> &GetDenoiserPtr() const { return m_denoiser_ptr; }
+	bool IsDenoisedViewSupported() const { return m_denoiser_ptr->IsGPUSupported(); }
 
 	void Resize(uint32_t width, uint32_t height) {
 		m_width = width;
 		m_height = height;
 	}
 
-	void Reset(const std::shared_ptr<myvk::CommandPool> &command_pool);
+	// after PathTracer::Reset, shared_queue can access the denoised image as well
+	void Reset(const std::shared_ptr<myvk::CommandPool> &command_pool,
+	           const std::shared_ptr<myvk::Queue> &shared_queue);
 
+	// also denoises for ViewTypes::kDenoised
 	void CmdGenRenderPass(const std::shared_ptr<myvk::CommandBuffer> &command_buffer) const;
 
 	void CmdDrawPipeline(const std::shared_ptr<myvk::CommandBuffer> &command_buffer, uint32_t current_frame) const;
@@ -0,0 +1,20 @@
+#ifndef RAY_QUERY_HPP
+#define RAY_QUERY_HPP
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Result of an intersection query of CpuRayQuery / GpuRayQuery, laid out like the Hit struct of ray_query.comp
+// (std430). For a hit, position == origin + t * direction up to the voxel boundary offset of Octree_RayMarchLeaf.
+// On a miss everything except iteration is zero.
+struct RayQueryHit {
+	glm::vec3 position;
+	float t;
+	glm::vec3 color;
+	uint32_t hit;
+	glm::vec3 normal;
+	uint32_t iteration;
+};
+static_assert(sizeof(RayQueryHit) == 48);
+
+#endif
@@ -1,7 +1,11 @@
 #include "Scene.hpp"
+#include "MeshCache.hpp"
+#include "ObjLoader.hpp"
+#include "ThreadPool.hpp"
 #include "myvk/ObjectTracker.hpp"
 
 #include <algorithm>
+#include <cstring>
 #include <future>
 #include <string>
 #include <thread>
@@ -9,18 +13,15 @@
 
 #include <meshoptimizer.h>
 #include <stb_image.h>
-#include <tiny_obj_loader.h>
 
 #include <spdlog/spdlog.h>
 
-struct Vertex {
-	glm::vec3 m_position;
-	glm::vec2 m_texcoord;
-};
+static constexpr size_t kNormalizeGrain = 65536;
+
 struct Scene::Mesh {
 	uint32_t m_texture_id;
 	glm::vec3 m_albedo;
-	std::vector<Vertex> m_vertices;
+	uint32_t m_first_vertex, m_vertex_count; // triangle corners in the flat vertex array
 };
 
 static std::string get_base_dir(const char *filename) {
@@ -34,179 +35,144 @@ static std::string get_base_dir(const char *filename) {
 }
 
 bool Scene::load_meshes(const char *filename, const char *base_dir, std::vector<Mesh> *meshes,
-                        std::vector<std::string> *texture_filenames) {
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::material_t> materials;
-	std::vector<tinyobj::shape_t> shapes;
-
-	std::string load_warnings, load_errors;
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &load_warnings, &load_errors, filename, base_dir)) {
-		spdlog::error("Failed to load {}", filename);
-		return false;
-	}
-	if (materials.empty()) {
-		spdlog::error("No material found");
-		return false;
-	}
-	if (!load_errors.empty()) {
-		spdlog::error("{}", load_errors.c_str());
+                        std::vector<Vertex> *vertices, std::vector<std::string> *texture_names) {
+	std::shared_ptr<ObjLoader::ObjData> obj_data = ObjLoader::LoadObj(filename, base_dir);
+	if (!obj_data)
 		return false;
-	}
-	if (!load_warnings.empty()) {
-		spdlog::warn("{}", load_warnings.c_str());
-	}
-
-	meshes->clear();
-	meshes->resize(materials.size());
-
-	glm::vec3 pmin(FLT_MAX), pmax(-FLT_MAX);
-	// Loop over shapes
-	for (const auto &shape : shapes) {
-		size_t index_offset = 0, face = 0;
-		// Loop over faces(polygon)
-		for (const auto &num_face_vertex : shape.mesh.num_face_vertices) {
-			int mat = shape.mesh.material_ids[face];
-			// Loop over triangles in the face.
-			for (size_t v = 0; v < num_face_vertex; ++v) {
-				tinyobj::index_t index = shape.mesh.indices[index_offset + v];
-
-				meshes->at(mat).m_vertices.emplace_back();
-				Vertex &vert = meshes->at(mat).m_vertices.back();
-				vert.m_position = {attrib.vertices[3 * index.vertex_index + 0],
-				                   attrib.vertices[3 * index.vertex_index + 1],
-				                   attrib.vertices[3 * index.vertex_index + 2]};
-				pmin = glm::min(vert.m_position, pmin);
-				pmax = glm::max(vert.m_position, pmax);
-
-				if (index.texcoord_index != -1)
-					vert.m_texcoord = {attrib.texcoords[2 * index.texcoord_index + 0],
-					                   1.0f - attrib.texcoords[2 * index.texcoord_index + 1]};
-			}
-			index_offset += num_face_vertex;
-			face++;
-		}
-	}
 
 	// normalize all the vertex to [-1, 1]
 	{
-		glm::vec3 extent3 = pmax - pmin;
+		glm::vec3 extent3 = obj_data->max_position - obj_data->min_position;
 		float extent = glm::max(extent3.x, glm::max(extent3.y, extent3.z)) * 0.5f;
 		float inv_extent = 1.0f / extent;
-		glm::vec3 center = (pmax + pmin) * 0.5f;
-		for (auto &i : *meshes)
-			for (auto &v : i.m_vertices)
-				v.m_position = (v.m_position - center) * inv_extent;
+		glm::vec3 center = (obj_data->max_position + obj_data->min_position) * 0.5f;
+		ThreadPool::GetDefault()->ParallelFor(obj_data->vertices.size(), kNormalizeGrain, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				obj_data->vertices[i].m_position = (obj_data->vertices[i].m_position - center) * inv_extent;
+		});
 	}
 
-	// set mesh material
+	// set mesh materials, the ranges are non-empty and sorted by vertex count
 	std::unordered_map<std::string, uint32_t> texture_name_map;
+	meshes->resize(obj_data->ranges.size());
 	for (uint32_t i = 0; i < meshes->size(); ++i) {
+		const ObjLoader::MaterialRange &range = obj_data->ranges[i];
+		const ObjLoader::Material &material = obj_data->materials[range.material_id];
 		Mesh &mesh = (*meshes)[i];
-		if (mesh.m_vertices.empty())
-			continue;
-		mesh.m_albedo = {materials[i].diffuse[0], materials[i].diffuse[1], materials[i].diffuse[2]};
-		const std::string &texture_name = materials[i].diffuse_texname;
-		if (!texture_name.empty() && texture_name_map.find(texture_name) == texture_name_map.end()) {
-			uint32_t idx = texture_name_map.size();
-			texture_name_map[texture_name] = idx;
-		} else if (texture_name.empty())
-			mesh.m_texture_id = UINT32_MAX;
-	}
+		mesh.m_albedo = material.diffuse;
+		mesh.m_first_vertex = range.first_vertex;
+		mesh.m_vertex_count = range.vertex_count;
 
-	// set mesh texture id
-	for (uint32_t i = 0; i < meshes->size(); ++i) {
-		Mesh &mesh = (*meshes)[i];
-		if (!mesh.m_vertices.empty() && mesh.m_texture_id != UINT32_MAX) {
-			mesh.m_texture_id = texture_name_map[materials[i].diffuse_texname];
+		const std::string &texture_name = material.diffuse_texname;
+		if (texture_name.empty()) {
+			mesh.m_texture_id = UINT32_MAX;
+			continue;
 		}
+		auto it = texture_name_map.find(texture_name);
+		if (it == texture_name_map.end())
+			it = texture_name_map.emplace(texture_name, (uint32_t)texture_name_map.size()).first;
+		mesh.m_texture_id = it->second;
 	}
+	*vertices = std::move(obj_data->vertices);
 
-	// cull empty meshes
-	{
-		uint32_t not_empty_cnt = meshes->size();
-		for (const Mesh &i : *meshes)
-			not_empty_cnt -= i.m_vertices.empty();
-		std::sort(meshes->begin(), meshes->end(),
-		          [](const Mesh &l, const Mesh &r) { return l.m_vertices.size() > r.m_vertices.size(); });
-		meshes->resize(not_empty_cnt);
-	}
-
-	if (meshes->empty()) {
-		spdlog::error("Empty mesh");
-		return false;
-	}
-
-	texture_filenames->resize(texture_name_map.size());
+	// relative to base_dir, so that the mesh cache stays valid when the file is opened through another path
+	texture_names->resize(texture_name_map.size());
 	for (auto &i : texture_name_map) {
 		std::string replaced = i.first;
 		std::replace(replaced.begin(), replaced.end(), '\\', '/');
-		(*texture_filenames)[i.second] = base_dir + std::move(replaced);
+		(*texture_names)[i.second] = std::move(replaced);
 	}
 
 	return true;
 }
 
-void Scene::load_buffers_and_draw_cmd(const std::shared_ptr<myvk::Queue> &graphics_queue,
-                                      const std::vector<Mesh> &meshes) {
-	m_draw_commands.clear();
+void Scene::optimize_meshes(const std::vector<Mesh> &meshes, std::vector<Vertex> &&naive_vertices,
+                            std::vector<Vertex> *vertices, std::vector<uint32_t> *indices) {
+	uint32_t index_count = naive_vertices.size();
+	indices->resize(index_count);
+
+	std::vector<unsigned int> remap(index_count);
+	uint32_t vertex_count = meshopt_generateVertexRemap(remap.data(), nullptr, index_count, naive_vertices.data(),
+	                                                    index_count, sizeof(Vertex));
+	vertices->resize(vertex_count);
+	meshopt_remapIndexBuffer(indices->data(), nullptr, index_count, remap.data());
+	meshopt_remapVertexBuffer(vertices->data(), naive_vertices.data(), index_count, sizeof(Vertex), remap.data());
+	naive_vertices.clear();
+	naive_vertices.shrink_to_fit();
+
+	for (uint32_t i = 0, c = 0; i < meshes.size(); ++i) {
+		uint32_t mesh_vert_cnt = meshes[i].m_vertex_count;
+		meshopt_optimizeVertexCache(indices->data() + c, indices->data() + c, mesh_vert_cnt, vertex_count);
+		meshopt_optimizeOverdraw(indices->data() + c, indices->data() + c, mesh_vert_cnt,
+		                         &(*vertices)[0].m_position.x, vertex_count, sizeof(Vertex), 1.05f);
+		c += mesh_vert_cnt;
+	}
+	meshopt_optimizeVertexFetch(vertices->data(), indices->data(), index_count, vertices->data(), vertex_count,
+	                            sizeof(Vertex));
+	spdlog::info("Mesh optimized ({}/{} vertices)", vertices->size(), index_count);
+}
 
-	// count vertices, set draw commands and vertex buffers
-	uint32_t index_count = 0;
-	std::vector<Vertex> naive_vertices;
-	{
-		for (const Mesh &mesh : meshes)
-			index_count += mesh.m_vertices.size();
-		naive_vertices.resize(index_count);
-		m_draw_commands.resize(meshes.size());
-		for (uint32_t i = 0, c = 0; i < meshes.size(); ++i) {
-			const Mesh &mesh = meshes[i];
-			m_draw_commands[i].m_push_constant.m_texture_id = mesh.m_texture_id;
-			m_draw_commands[i].m_push_constant.m_albedo = glm::packUnorm4x8(glm::vec4(mesh.m_albedo, 0.0f));
-			m_draw_commands[i].m_first_index = c;
-			m_draw_commands[i].m_index_count = mesh.m_vertices.size();
-
-			std::copy(mesh.m_vertices.begin(), mesh.m_vertices.end(), naive_vertices.begin() + c);
-			c += mesh.m_vertices.size();
-		}
+void Scene::load_buffers_and_draw_cmd(const std::shared_ptr<myvk::Queue> &graphics_queue,
+                                      const std::vector<Mesh> &meshes, std::vector<Vertex> &&naive_vertices,
+                                      const std::vector<std::string> &texture_names,
+                                      const char *cache_source_filename) {
+	// set draw commands, the vertices of the meshes are already contiguous
+	m_draw_commands.resize(meshes.size());
+	for (uint32_t i = 0; i < meshes.size(); ++i) {
+		const Mesh &mesh = meshes[i];
+		m_draw_commands[i].m_push_constant.m_texture_id = mesh.m_texture_id;
+		m_draw_commands[i].m_push_constant.m_albedo = glm::packUnorm4x8(glm::vec4(mesh.m_albedo, 0.0f));
+		m_draw_commands[i].m_first_index = mesh.m_first_vertex;
+		m_draw_commands[i].m_index_count = mesh.m_vertex_count;
 	}
 
 	// build index buffer and optimize meshes
 	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices(index_count);
-	{
-		std::vector<unsigned int> remap(index_count);
-		uint32_t vertex_count = meshopt_generateVertexRemap(remap.data(), nullptr, index_count, naive_vertices.data(),
-		                                                    index_count, sizeof(Vertex));
-		vertices.resize(vertex_count);
-		meshopt_remapIndexBuffer(indices.data(), nullptr, index_count, remap.data());
-		meshopt_remapVertexBuffer(vertices.data(), naive_vertices.data(), index_count, sizeof(Vertex), remap.data());
-		naive_vertices.clear();
-		naive_vertices.shrink_to_fit();
-
-		for (uint32_t i = 0, c = 0; i < meshes.size(); ++i) {
-			uint32_t mesh_vert_cnt = meshes[i].m_vertices.size();
-			meshopt_optimizeVertexCache(indices.data() + c, indices.data() + c, mesh_vert_cnt, vertex_count);
-			meshopt_optimizeOverdraw(indices.data() + c, indices.data() + c, mesh_vert_cnt, &vertices[0].m_position.x,
-			                         vertex_count, sizeof(Vertex), 1.05f);
-			c += mesh_vert_cnt;
+	std::vector<uint32_t> indices;
+	optimize_meshes(meshes, std::move(naive_vertices), &vertices, &indices);
+
+	create_buffers(graphics_queue, vertices.data(), vertices.size(), indices.data(), indices.size());
+
+	if (cache_source_filename) {
+		std::vector<MeshCache::DrawCmd> cache_draw_commands(m_draw_commands.size());
+		for (uint32_t i = 0; i < m_draw_commands.size(); ++i) {
+			const DrawCmd &draw_cmd = m_draw_commands[i];
+			cache_draw_commands[i] = {draw_cmd.m_push_constant.m_texture_id, draw_cmd.m_push_constant.m_albedo,
+			                          draw_cmd.m_index_count, draw_cmd.m_first_index};
 		}
-		meshopt_optimizeVertexFetch(vertices.data(), indices.data(), index_count, vertices.data(), vertex_count,
-		                            sizeof(Vertex));
+		MeshCache::Write(cache_source_filename, texture_names, cache_draw_commands, vertices, indices);
 	}
-	spdlog::info("Mesh optimized ({}/{} vertices)", vertices.size(), index_count);
+}
 
+void Scene::load_buffers_and_draw_cmd(const std::shared_ptr<myvk::Queue> &graphics_queue,
+                                      const MeshCache &mesh_cache) {
+	const std::vector<MeshCache::DrawCmd> &cache_draw_commands = mesh_cache.GetDrawCommands();
+	m_draw_commands.resize(cache_draw_commands.size());
+	for (uint32_t i = 0; i < cache_draw_commands.size(); ++i) {
+		const MeshCache::DrawCmd &draw_cmd = cache_draw_commands[i];
+		m_draw_commands[i].m_push_constant.m_texture_id = draw_cmd.texture_id;
+		m_draw_commands[i].m_push_constant.m_albedo = draw_cmd.albedo;
+		m_draw_commands[i].m_first_index = draw_cmd.first_index;
+		m_draw_commands[i].m_index_count = draw_cmd.index_count;
+	}
+
+	create_buffers(graphics_queue, mesh_cache.GetVertices(), mesh_cache.GetVertexCount(), mesh_cache.GetIndices(),
+	               mesh_cache.GetIndexCount());
+}
+
+void Scene::create_buffers(const std::shared_ptr<myvk::Queue> &graphics_queue, const Vertex *vertices,
+                           size_t vertex_count, const uint32_t *indices, size_t index_count) {
 	const std::shared_ptr<myvk::Device> &device = graphics_queue->GetDevicePtr();
-	uint32_t vertex_buffer_size = vertices.size() * sizeof(Vertex),
-	         index_buffer_size = indices.size() * sizeof(uint32_t);
+	uint32_t vertex_buffer_size = vertex_count * sizeof(Vertex), index_buffer_size = index_count * sizeof(uint32_t);
 	m_vertex_buffer = myvk::Buffer::Create(device, vertex_buffer_size, 0,
 	                                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
 	m_index_buffer = myvk::Buffer::Create(device, index_buffer_size, 0,
 	                                      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
 
-	std::shared_ptr<myvk::Buffer> vertex_staging_buffer =
-	    myvk::Buffer::CreateStaging(device, vertices.begin(), vertices.end());
-	std::shared_ptr<myvk::Buffer> index_staging_buffer =
-	    myvk::Buffer::CreateStaging(device, indices.begin(), indices.end());
+	std::shared_ptr<myvk::Buffer> vertex_staging_buffer = myvk::Buffer::CreateStaging<uint8_t>(
+	    device, vertex_buffer_size, [=](uint8_t *mapped) { std::memcpy(mapped, vertices, vertex_buffer_size); });
+	std::shared_ptr<myvk::Buffer> index_staging_buffer = myvk::Buffer::CreateStaging<uint8_t>(
+	    device, index_buffer_size, [=](uint8_t *mapped) { std::memcpy(mapped, indices, index_buffer_size); });
 
 	std::shared_ptr<myvk::Fence> fence = myvk::Fence::Create(device);
 	std::shared_ptr<myvk::CommandPool> command_pool = myvk::CommandPool::Create(graphics_queue);
@@ -385,25 +351,47 @@ void Scene::create_descriptors(const std::shared_ptr<myvk::Device> &device) {
 }
 
 std::shared_ptr<Scene> Scene::Create(const std::shared_ptr<myvk::Queue> &graphics_queue, const char *filename,
-                                     std::atomic<const char *> *notification_ptr) {
+                                     std::atomic<const char *> *notification_ptr, bool use_cache) {
 	std::shared_ptr<Scene> ret = std::make_shared<Scene>();
 
 	std::string base_dir = get_base_dir(filename);
 
-	std::vector<Mesh> meshes;
-	std::vector<std::string> texture_filenames;
+	std::vector<std::string> texture_names;
 
-	if (notification_ptr)
-		notification_ptr->store("Loading Mesh");
-	if (!load_meshes(filename, base_dir.c_str(), &meshes, &texture_filenames)) {
-		spdlog::error("Failed to load meshes");
-		return nullptr;
+	// the optimized buffers of an unchanged OBJ file are uploaded straight from the mapped cache
+	std::shared_ptr<MeshCache> mesh_cache;
+	if (use_cache) {
+		if (notification_ptr)
+			notification_ptr->store("Loading Mesh cache");
+		mesh_cache = MeshCache::Read(filename);
 	}
-	spdlog::info("Meshes loaded from {}", filename);
 
-	if (notification_ptr)
-		notification_ptr->store("Optimizing Mesh and Creating Buffers");
-	ret->load_buffers_and_draw_cmd(graphics_queue, meshes);
+	if (mesh_cache) {
+		ret->load_buffers_and_draw_cmd(graphics_queue, *mesh_cache);
+		texture_names = mesh_cache->GetTextureNames();
+		mesh_cache = nullptr;
+	} else {
+		std::vector<Mesh> meshes;
+		std::vector<Vertex> vertices;
+
+		if (notification_ptr)
+			notification_ptr->store("Loading Mesh");
+		if (!load_meshes(filename, base_dir.c_str(), &meshes, &vertices, &texture_names)) {
+			spdlog::error("Failed to load meshes");
+			return nullptr;
+		}
+		spdlog::info("Meshes loaded from {}", filename);
+
+		if (notification_ptr)
+			notification_ptr->store("Optimizing Mesh and Creating Buffers");
+		ret->load_buffers_and_draw_cmd(graphics_queue, meshes, std::move(vertices), texture_names,
+		                               use_cache ? filename : nullptr);
+	}
+
+	std::vector<std::string> texture_filenames(texture_names.size());
+	for (uint32_t i = 0; i < texture_names.size(); ++i)
+		texture_filenames[i] = base_dir + texture_names[i];
+
 	if (notification_ptr)
 		notification_ptr->store("Loading Textures");
 	ret->m_sampler =
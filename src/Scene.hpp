@@ -1,6 +1,8 @@
 #ifndef SCENE_HPP
 #define SCENE_HPP
 
+#include "MeshCache.hpp"
+#include "ObjLoader.hpp"
 #include "myvk/Buffer.hpp"
 #include "myvk/CommandBuffer.hpp"
 #include "myvk/DescriptorPool.hpp"
@@ -37,12 +39,23 @@ private:
 		uint32_t m_index_count, m_first_index;
 	};
 	struct Mesh;
+	using Vertex = ObjLoader::Vertex;
 	std::vector<DrawCmd> m_draw_commands;
 
 	static bool load_meshes(const char *filename, const char *base_dir, std::vector<Mesh> *meshes,
-	                        std::vector<std::string> *texture_filenames);
+	                        std::vector<Vertex> *vertices, std::vector<std::string> *texture_names);
 
-	void load_buffers_and_draw_cmd(const std::shared_ptr<myvk::Queue> &graphics_queue, const std::vector<Mesh> &meshes);
+	static void optimize_meshes(const std::vector<Mesh> &meshes, std::vector<Vertex> &&naive_vertices,
+	                            std::vector<Vertex> *vertices, std::vector<uint32_t> *indices);
+
+	void load_buffers_and_draw_cmd(const std::shared_ptr<myvk::Queue> &graphics_queue, const std::vector<Mesh> &meshes,
+	                               std::vector<Vertex> &&naive_vertices, const std::vector<std::string> &texture_names,
+	                               const char *cache_source_filename);
+
+	void load_buffers_and_draw_cmd(const std::shared_ptr<myvk::Queue> &graphics_queue, const MeshCache &mesh_cache);
+
+	void create_buffers(const std::shared_ptr<myvk::Queue> &graphics_queue, const Vertex *vertices,
+	                    size_t vertex_count, const uint32_t *indices, size_t index_count);
 
 	void load_textures(const std::shared_ptr<myvk::Queue> &graphics_queue,
 	                   const std::vector<std::string> &texture_filenames);
@@ -52,8 +65,9 @@ private:
 	void create_descriptors(const std::shared_ptr<myvk::Device> &device);
 
 public:
+	// With use_cache the optimized mesh is read from / written to the mesh cache
 	static std::shared_ptr<Scene> Create(const std::shared_ptr<myvk::Queue> &graphics_queue, const char *filename,
-	                                     std::atomic<const char *> *notification_ptr = nullptr);
+	                                     std::atomic<const char *> *notification_ptr = nullptr, bool use_cache = true);
 
 	static std::vector<VkVertexInputBindingDescription> GetVertexBindingDescriptions();
 
@@ -0,0 +1,92 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+std::shared_ptr<ThreadPool> ThreadPool::Create(uint32_t thread_count) {
+	std::shared_ptr<ThreadPool> ret = std::make_shared<ThreadPool>();
+	if (thread_count == 0)
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+	ret->m_workers.reserve(thread_count);
+	for (uint32_t i = 0; i < thread_count; ++i)
+		ret->m_workers.emplace_back(&ThreadPool::worker_func, ret.get());
+	return ret;
+}
+
+const std::shared_ptr<ThreadPool> &ThreadPool::GetDefault() {
+	static std::shared_ptr<ThreadPool> thread_pool = Create();
+	return thread_pool;
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_stop = true;
+	}
+	m_condition.notify_all();
+	for (auto &worker : m_workers)
+		worker.join();
+}
+
+void ThreadPool::worker_func() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock{m_mutex};
+			m_condition.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+			if (m_stop && m_tasks.empty())
+				return;
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+		}
+		task();
+	}
+}
+
+void ThreadPool::Push(std::function<void()> &&task) {
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_tasks.push(std::move(task));
+	}
+	m_condition.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &func) {
+	if (count == 0)
+		return;
+	grain = std::max<size_t>(grain, 1);
+	size_t chunk_count = (count + grain - 1) / grain;
+	if (chunk_count == 1) {
+		func(0, count);
+		return;
+	}
+
+	// helpers may start after every chunk is taken, so the shared state must outlive this call
+	struct State {
+		std::atomic_size_t next{0}, finished{0};
+		std::mutex mutex;
+		std::condition_variable condition;
+	};
+	std::shared_ptr<State> state = std::make_shared<State>();
+
+	auto run = [state, count, grain, chunk_count, &func]() {
+		size_t chunk;
+		while ((chunk = state->next.fetch_add(1)) < chunk_count) {
+			size_t begin = chunk * grain;
+			func(begin, std::min(begin + grain, count));
+			if (state->finished.fetch_add(1) + 1 == chunk_count) {
+				std::lock_guard<std::mutex> lock{state->mutex};
+				state->condition.notify_all();
+			}
+		}
+	};
+
+	size_t helper_count = std::min<size_t>(m_workers.size(), chunk_count - 1);
+	for (size_t i = 0; i < helper_count; ++i)
+		Push(run);
+	run();
+
+	std::unique_lock<std::mutex> lock{state->mutex};
+	state->condition.wait(lock, [&state, chunk_count] { return state->finished.load() == chunk_count; });
+}
@@ -0,0 +1,40 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed-size worker pool for CPU-side data-parallel work
+class ThreadPool {
+private:
+	std::vector<std::thread> m_workers;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stop{false};
+
+	void worker_func();
+
+public:
+	// thread_count == 0 uses std::thread::hardware_concurrency()
+	static std::shared_ptr<ThreadPool> Create(uint32_t thread_count = 0);
+	// process-wide pool of the loaders, builders and denoiser, created on first use
+	static const std::shared_ptr<ThreadPool> &GetDefault();
+	~ThreadPool();
+
+	uint32_t GetThreadCount() const { return m_workers.size(); }
+
+	void Push(std::function<void()> &&task);
+
+	// Calls func(begin, end) on chunks of at most grain items covering [0, count) and blocks until all of them
+	// are finished. The calling thread processes chunks as well, so nested calls from inside a task cannot deadlock.
+	void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &func);
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "TileScheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void TileScheduler::Reset(uint32_t width, uint32_t height, uint32_t tile_size, double budget_ms) {
+	tile_size = std::max((tile_size + 7u) & ~7u, 8u);
+	m_tile_size = tile_size;
+	m_budget_ms = budget_ms;
+	m_ms_per_pixel = 0.0;
+	m_next = 0;
+
+	const uint32_t kTileX = (width + tile_size - 1) / tile_size, kTileY = (height + tile_size - 1) / tile_size;
+	m_tiles.clear();
+	m_tiles.reserve(kTileX * kTileY);
+	for (uint32_t y = 0; y < kTileY; ++y)
+		for (uint32_t x = 0; x < kTileX; ++x)
+			m_tiles.push_back({x * tile_size, y * tile_size, std::min(tile_size, width - x * tile_size),
+			                   std::min(tile_size, height - y * tile_size)});
+
+	// spiral: square rings of tiles around the image centre, each ring in angular order
+	const auto ring_angle = [width, height, tile_size](const Tile &tile) {
+		double dx = tile.x + tile.width * 0.5 - width * 0.5, dy = tile.y + tile.height * 0.5 - height * 0.5;
+		return std::make_pair(std::round(std::max(std::abs(dx), std::abs(dy)) / tile_size), std::atan2(dy, dx));
+	};
+	std::stable_sort(m_tiles.begin(), m_tiles.end(),
+	                 [&ring_angle](const Tile &l, const Tile &r) { return ring_angle(l) < ring_angle(r); });
+}
+
+bool TileScheduler::Next(uint32_t *first, uint32_t *last) {
+	const auto kTileCount = (uint32_t)m_tiles.size();
+	*first = m_next;
+	*last = m_next + 1;
+	if (m_ms_per_pixel > 0.0) {
+		// add tiles while the estimated time stays within the budget, at least one
+		double ms = m_ms_per_pixel * double(GetPixelCount(*first, *last));
+		while (*last < kTileCount) {
+			double tile_ms = m_ms_per_pixel * double(GetPixelCount(*last, *last + 1));
+			if (ms + tile_ms > m_budget_ms)
+				break;
+			ms += tile_ms;
+			++*last;
+		}
+	}
+	m_next = *last < kTileCount ? *last : 0;
+	return *last == kTileCount;
+}
+
+void TileScheduler::Feedback(uint32_t first, uint32_t last, double ms) {
+	uint64_t pixels = GetPixelCount(first, last);
+	if (pixels == 0 || ms <= 0.0)
+		return;
+	double ms_per_pixel = ms / double(pixels);
+	// the cost varies over the image, smooth it over a few runs
+	m_ms_per_pixel = m_ms_per_pixel > 0.0 ? m_ms_per_pixel * 0.75 + ms_per_pixel * 0.25 : ms_per_pixel;
+}
+
+uint64_t TileScheduler::GetPixelCount(uint32_t first, uint32_t last) const {
+	uint64_t pixels = 0;
+	for (uint32_t i = first; i < last; ++i)
+		pixels += uint64_t(m_tiles[i].width) * m_tiles[i].height;
+	return pixels;
+}
@@ -0,0 +1,36 @@
+#ifndef TILE_SCHEDULER_HPP
+#define TILE_SCHEDULER_HPP
+
+#include <cinttypes>
+#include <vector>
+
+// Splits a frame into square tiles, ordered in a spiral from the centre of the image, and hands them out in runs
+// sized to a GPU time budget, so that a submission of the path tracer never occupies a (possibly shared) queue for
+// much longer than the budget. One pass over all tiles is one sample per pixel. The cost per pixel is learnt from the
+// measured time of the previous runs.
+class TileScheduler {
+public:
+	struct Tile {
+		uint32_t x, y, width, height;
+	};
+
+private:
+	std::vector<Tile> m_tiles;
+	uint32_t m_tile_size{}, m_next{};
+	double m_budget_ms{}, m_ms_per_pixel{};
+
+public:
+	// tile_size is rounded up to a multiple of the 8x8 workgroups of path_tracer.comp
+	void Reset(uint32_t width, uint32_t height, uint32_t tile_size, double budget_ms);
+
+	// the tiles [*first, *last) of the current pass for the next submission, returns true if they finish the pass
+	bool Next(uint32_t *first, uint32_t *last);
+	// GPU time of a submission of the tiles [first, last)
+	void Feedback(uint32_t first, uint32_t last, double ms);
+
+	const std::vector<Tile> &GetTiles() const { return m_tiles; }
+	uint32_t GetTileSize() const { return m_tile_size; }
+	uint64_t GetPixelCount(uint32_t first, uint32_t last) const;
+};
+
+#endif
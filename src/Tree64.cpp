@@ -0,0 +1,113 @@
+#include "Tree64.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <spdlog/spdlog.h>
+
+namespace {
+struct Builder {
+	const uint32_t *octree;
+	size_t node_count;
+	std::vector<uint32_t> words;
+	uint32_t depth = 0, leaf_depth = 0; // leaf_depth: octree level of the leaves, 0 until the first one is found
+	uint32_t built_nodes = 0;
+	bool failed = false;
+
+	// child block of a pointer word, node_count if it is invalid
+	size_t get_child(uint32_t word) const {
+		size_t child = (word & 0x3fffffffu) >> 3u;
+		return (word & 7u) || child == 0 || child >= node_count ? node_count : child;
+	}
+
+	// writes the node for the octree node block at words[offset], whose cells lie two octree levels below it
+	void Build(size_t block, size_t offset, uint32_t level) {
+		depth = std::max(depth, level + 1);
+		++built_nodes;
+		// cell -> interior octree block or leaf word
+		std::array<uint32_t, 64> cells{};
+		std::array<size_t, 64> cell_blocks{};
+		uint64_t mask = 0, leaf_mask = 0, group_leaf_mask = 0;
+		const auto set_cell = [&](uint32_t cell, uint32_t word) {
+			if ((word & 0xC0000000u) == 0xC0000000u) {
+				cells[cell] = word, leaf_mask |= 1ull << cell;
+			} else if ((word & 0xC0000000u) == 0x80000000u) {
+				if ((cell_blocks[cell] = get_child(word)) == node_count)
+					failed = true;
+			} else
+				return;
+			mask |= 1ull << cell;
+		};
+		for (uint32_t c = 0; c < 8; ++c) {
+			uint32_t word = octree[block * 8 + c];
+			uint32_t base_cell = (c & 1u) * 2u + ((c >> 1u) & 1u) * 8u + ((c >> 2u) & 1u) * 32u;
+			if ((word & 0xC0000000u) == 0xC0000000u) {
+				// a voxel one octree level below the node, it covers the 2x2x2 cells of its octant
+				for (uint32_t g = 0; g < 8; ++g)
+					set_cell(base_cell + (g & 1u) + ((g >> 1u) & 1u) * 4u + ((g >> 2u) & 1u) * 16u, word);
+				group_leaf_mask |= 0x330033ull << base_cell;
+			} else if ((word & 0xC0000000u) == 0x80000000u) {
+				size_t child = get_child(word);
+				if (child == node_count) {
+					failed = true;
+					return;
+				}
+				for (uint32_t g = 0; g < 8; ++g)
+					set_cell(base_cell + (g & 1u) + ((g >> 1u) & 1u) * 4u + ((g >> 2u) & 1u) * 16u,
+					         octree[child * 8 + g]);
+			}
+		}
+		if (failed)
+			return;
+		const uint32_t node_leaf_depth = level * 2u + (group_leaf_mask ? 1u : 2u);
+		if (leaf_mask && (leaf_mask != mask || (group_leaf_mask && group_leaf_mask != mask) ||
+		                  (leaf_depth && leaf_depth != node_leaf_depth))) {
+			spdlog::error("Tree64: the leaves of the octree are not all at the same depth");
+			failed = true;
+			return;
+		}
+		if (leaf_mask)
+			leaf_depth = node_leaf_depth;
+
+		uint32_t child_count = std::popcount(mask);
+		size_t child_offset = words.size();
+		words.resize(child_offset + (leaf_mask ? child_count : child_count * 3));
+		words[offset] = (uint32_t)mask;
+		words[offset + 1] = (uint32_t)(mask >> 32u);
+		words[offset + 2] =
+		    (uint32_t)child_offset | (leaf_mask ? 0x80000000u : 0u) | (group_leaf_mask ? 0x40000000u : 0u);
+		uint32_t rank = 0;
+		for (uint64_t bits = mask; bits; bits &= bits - 1, ++rank) {
+			uint32_t cell = std::countr_zero(bits);
+			if (leaf_mask)
+				words[child_offset + rank] = cells[cell];
+			else
+				Build(cell_blocks[cell], child_offset + rank * 3, level + 1);
+			if (failed)
+				return;
+		}
+	}
+};
+} // namespace
+
+std::shared_ptr<Tree64> Tree64::Build(const uint32_t *octree, size_t range) {
+	Builder builder{octree, range / (8 * sizeof(uint32_t))};
+	if (builder.node_count == 0)
+		return nullptr;
+	builder.words.resize(3);
+	builder.Build(0, 0, 0);
+	if (builder.failed) {
+		spdlog::error("Tree64: invalid octree");
+		return nullptr;
+	}
+	if (builder.words.size() > 0x3fffffffu) {
+		spdlog::error("Tree64: {} words exceed the 30-bit child offsets", builder.words.size());
+		return nullptr;
+	}
+
+	std::shared_ptr<Tree64> ret = std::make_shared<Tree64>();
+	ret->m_words = std::move(builder.words);
+	ret->m_depth = builder.depth;
+	ret->m_node_count = builder.built_nodes;
+	return ret;
+}
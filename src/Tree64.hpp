@@ -0,0 +1,32 @@
+#ifndef TREE64_HPP
+#define TREE64_HPP
+
+#include <memory>
+#include <vector>
+
+// 64-ary variant of the octree (a "64-tree"): every node splits its cube into 4x4x4 cells, so a tree covers two octree
+// levels per node and a level 12 scene is 6 nodes deep. Built from the uOctree words of an octree (e.g. from
+// OctreeBuilder or CpuOctreeBuilder) over the same [1, 2]^3 cube, traversed by shader/tree64.glsl and CpuTree64Tracer.
+// A node is three words: the occupancy mask of cells 0-31 and 32-63 (cell x + 4 * y + 16 * z), then the word offset
+// of its first child. The children of a node are packed in cell order, the child of cell i is number
+// bitCount(mask & ((1 << i) - 1)). With bit 31 of the third word set the cells are voxels and the children are leaf
+// words (as in uOctree), otherwise nodes. An odd octree level has no whole number of 4x4x4 steps, then every voxel
+// fills 2x2x2 cells of the last node level, which describes the same geometry, and bit 30 is set as well so that the
+// tracers still stop one octree level above the cells.
+class Tree64 {
+private:
+	std::vector<uint32_t> m_words;
+	uint32_t m_depth{}, m_node_count{};
+
+public:
+	// octree holds range bytes of uOctree words with the root node at word 0, nullptr if a pointer is invalid or the
+	// leaves are not all at the same depth
+	static std::shared_ptr<Tree64> Build(const uint32_t *octree, size_t range);
+
+	const std::vector<uint32_t> &GetWords() const { return m_words; }
+	size_t GetRange() const { return m_words.size() * sizeof(uint32_t); }
+	uint32_t GetDepth() const { return m_depth; } // node levels
+	uint32_t GetNodeCount() const { return m_node_count; }
+};
+
+#endif
@@ -23,16 +23,29 @@ void LoaderLoadSceneModal(const std::shared_ptr<LoaderThread> &loader_thread) {
 	                               ImGuiWindowFlags_NoMove)) {
 		static char name_buf[kFilenameBufSize];
 		static int octree_leve = 10;
+		static OctreeLoadOptions load_options{};
 
 		constexpr const char *kFilter[] = {"*.obj", "*.vox"};
 
 		ImGui::FileOpen("Scene Filename", "...", name_buf, kFilenameBufSize, "Scene Filename", 2, kFilter);
 		ImGui::DragInt("Octree Level", &octree_leve, 1, kOctreeLevelMin, kOctreeLevelMax);
+		int build_mode = (int)load_options.build_mode;
+		if (ImGui::Combo("Octree Build", &build_mode, kOctreeBuildModeNames, IM_ARRAYSIZE(kOctreeBuildModeNames)))
+			load_options.build_mode = (OctreeBuildMode)build_mode;
+		ImGui::Checkbox("Deduplicate Fragments", &load_options.deduplicate_fragments);
+		ImGui::Checkbox("Use Octree and Mesh Cache", &load_options.use_cache);
+		int node_order = (int)load_options.node_order;
+		if (ImGui::Combo("Node Order", &node_order, kOctreeNodeOrderNames, IM_ARRAYSIZE(kOctreeNodeOrderNames)))
+			load_options.node_order = (OctreeNodeOrder)node_order;
+		ImGui::Checkbox("Build 64-Tree", &load_options.tree64);
+		ImGui::Checkbox("Build DAG", &load_options.dag);
+		ImGui::Checkbox("Build Compact Octree", &load_options.compact);
+		ImGui::Checkbox("Build LOD Colors", &load_options.lod);
 
 		float button_width = (ImGui::GetWindowContentRegionWidth() - ImGui::GetStyle().ItemSpacing.x) * 0.5f;
 
 		if (ImGui::Button("Load", {button_width, 0})) {
-			loader_thread->Launch(name_buf, octree_leve);
+			loader_thread->Launch(name_buf, octree_leve, load_options);
 			ImGui::CloseCurrentPopup();
 		}
 		ImGui::SetItemDefaultFocus();
@@ -75,6 +75,33 @@ void PathTracerMenuItems(const std::shared_ptr<PathTracerThread> &path_tracer_th
 			path_tracer_viewer->m_view_type = PathTracerViewer::ViewTypes::kNormal;
 			path_tracer_thread->UpdateViewer();
 		}
+		if (ImGui::MenuItem("Convergence", nullptr,
+		                    path_tracer_viewer->m_view_type == PathTracerViewer::ViewTypes::kConvergence)) {
+			path_tracer_viewer->m_view_type = PathTracerViewer::ViewTypes::kConvergence;
+			path_tracer_thread->UpdateViewer();
+		}
+		if (ImGui::MenuItem("Denoised", nullptr,
+		                    path_tracer_viewer->m_view_type == PathTracerViewer::ViewTypes::kDenoised,
+		                    path_tracer_viewer->IsDenoisedViewSupported())) {
+			path_tracer_viewer->m_view_type = PathTracerViewer::ViewTypes::kDenoised;
+			path_tracer_thread->UpdateViewer();
+		}
+
+		ImGui::EndMenu();
+	}
+	if (ImGui::BeginMenu("Denoiser")) {
+		const auto &denoiser = path_tracer_viewer->GetDenoiserPtr();
+		bool changed = false;
+		int iterations = (int)denoiser->m_iterations;
+		if (ImGui::DragInt("Iterations", &iterations, 1, 1, kMaxDenoiseIterations)) {
+			denoiser->m_iterations = iterations;
+			changed = true;
+		}
+		changed |= ImGui::DragFloat("Sigma Color", &denoiser->m_sigma_color, 0.01f, 0.001f, 16.0f);
+		changed |= ImGui::DragFloat("Sigma Normal", &denoiser->m_sigma_normal, 1.0f, 0.0f, 256.0f);
+		changed |= ImGui::DragFloat("Sigma Albedo", &denoiser->m_sigma_albedo, 0.01f, 0.001f, 16.0f);
+		if (changed && path_tracer_viewer->m_view_type == PathTracerViewer::ViewTypes::kDenoised)
+			path_tracer_thread->UpdateViewer();
 
 		ImGui::EndMenu();
 	}
@@ -115,6 +142,35 @@ void PathTracerRightStatus(const std::shared_ptr<PathTracerThread> &path_tracer_
 		ImGui::EndTooltip();
 	}
 
+	{
+		PathTracer::KernelTimings timings = path_tracer_thread->GetKernelTimings();
+		sprintf(buf, ICON_FA_TACHOMETER_ALT " %.2f ms", timings.total_ms);
+		indent_w -= ImGui::CalcTextSize(buf).x + spacing;
+		ImGui::SameLine(indent_w);
+		ImGui::TextUnformatted(buf);
+
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::TextUnformatted(path_tracer_thread->m_tiled ? "GPU Time per Tile Run" : "GPU Time per Sample");
+			const auto &path_tracer = path_tracer_thread->GetPathTracerViewerPtr()->GetPathTracerPtr();
+			ImGui::Separator();
+			ImGui::Text("Traversals per Sample %.2f", timings.GetTraversalsPerSample());
+			if (path_tracer->m_adaptive_threshold > 0.0f)
+				ImGui::Text("Sampled Pixels %.1f%%",
+				            100.0 * timings.paths / double(path_tracer->m_width * path_tracer->m_height));
+			if (path_tracer->GetRenderMode() == PathTracer::Modes::kWavefront) {
+				const WavefrontPathTracer::KernelTimings &wavefront = timings.wavefront;
+				ImGui::Text("Generate %.2f ms", wavefront.generate_ms);
+				ImGui::Text("Extend %.2f ms (%.2f Mrays/s)", wavefront.extend_ms,
+				            wavefront.extend_ms > 0.0 ? wavefront.extend_rays / wavefront.extend_ms * 0.001 : 0.0);
+				ImGui::Text("Shade %.2f ms", wavefront.shade_ms);
+				ImGui::Text("Shadow %.2f ms (%.2f Mrays/s)", wavefront.shadow_ms,
+				            wavefront.shadow_ms > 0.0 ? wavefront.shadow_rays / wavefront.shadow_ms * 0.001 : 0.0);
+			}
+			ImGui::EndTooltip();
+		}
+	}
+
 	sprintf(buf, ICON_FA_STOPWATCH " %u sec", uint32_t(path_tracer_thread->GetRenderTime()));
 	indent_w -= ImGui::CalcTextSize(buf).x + spacing;
 	ImGui::SameLine(indent_w);
@@ -161,6 +217,104 @@ void PathTracerStartModal(const std::shared_ptr<PathTracerThread> &path_tracer_t
 		if (ImGui::DragInt("Bounce", &bounce, 1, kMinBounce, kMaxBounce))
 			path_tracer->m_bounce = bounce;
 
+		constexpr const char *kModes[] = {"Megakernel", "Wavefront"};
+		if (ImGui::BeginCombo("Mode", kModes[(int)path_tracer->m_mode])) {
+			for (int n = 0; n < IM_ARRAYSIZE(kModes); n++) {
+				bool is_selected = (int)path_tracer->m_mode == n;
+				auto mode = (PathTracer::Modes)n;
+				if (ImGui::Selectable(kModes[n], is_selected,
+				                      mode == PathTracer::Modes::kWavefront && !path_tracer->IsWavefrontSupported()
+				                          ? ImGuiSelectableFlags_Disabled
+				                          : 0))
+					path_tracer->m_mode = mode;
+				if (is_selected)
+					ImGui::SetItemDefaultFocus();
+			}
+			ImGui::EndCombo();
+		}
+		ImGui::Checkbox("Russian Roulette", &path_tracer->m_russian_roulette);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::TextUnformatted("Terminate paths with a low throughput early and reweight the others");
+			ImGui::EndTooltip();
+		}
+		int roulette_min_bounce = path_tracer->m_roulette_min_bounce;
+		if (path_tracer->m_russian_roulette &&
+		    ImGui::DragInt("Roulette Min Bounce", &roulette_min_bounce, 1, kMinRouletteBounce, kMaxBounce))
+			path_tracer->m_roulette_min_bounce = roulette_min_bounce;
+
+		ImGui::DragFloat("Adaptive Threshold", &path_tracer->m_adaptive_threshold, 0.001f, 0.0f, kMaxAdaptiveThreshold,
+		                 path_tracer->m_adaptive_threshold > 0.0f ? "%.3f" : "Off");
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::TextUnformatted("Stop sampling pixels below this relative error");
+			ImGui::EndTooltip();
+		}
+		int adaptive_min_samples = path_tracer->m_adaptive_min_samples;
+		if (path_tracer->m_adaptive_threshold > 0.0f &&
+		    ImGui::DragInt("Adaptive Min Samples", &adaptive_min_samples, 1, 1, kMaxAdaptiveMinSamples))
+			path_tracer->m_adaptive_min_samples = adaptive_min_samples;
+
+		ImGui::Checkbox("Specialized Pipelines", &path_tracer->m_specialized_pipelines);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::TextUnformatted("Kernels compiled for the light type and the bounce count");
+			ImGui::EndTooltip();
+		}
+
+		if (path_tracer->m_mode == PathTracer::Modes::kWavefront) {
+			if (path_tracer->GetOctreePtr()->HasTree64())
+				ImGui::Checkbox("Trace 64-Tree", &path_tracer->m_tree64);
+			else
+				ImGui::TextDisabled("Trace 64-Tree (load with \"Build 64-Tree\")");
+			if (path_tracer->GetOctreePtr()->HasDAG())
+				ImGui::Checkbox("Trace DAG", &path_tracer->m_dag);
+			else
+				ImGui::TextDisabled("Trace DAG (load with \"Build DAG\")");
+			if (path_tracer->GetOctreePtr()->HasCompact())
+				ImGui::Checkbox("Trace Compact Octree", &path_tracer->m_compact);
+			else
+				ImGui::TextDisabled("Trace Compact Octree (load with \"Build Compact Octree\")");
+		}
+
+		if (path_tracer->GetOctreePtr()->HasLOD()) {
+			ImGui::Checkbox("LOD Diffuse Bounces", &path_tracer->m_lod);
+			if (ImGui::IsItemHovered()) {
+				ImGui::BeginTooltip();
+				ImGui::TextUnformatted("Stop the rays after the first diffuse bounce at the octree nodes of their "
+				                       "footprint and use the average color of the node");
+				ImGui::EndTooltip();
+			}
+			if (path_tracer->m_lod)
+				ImGui::DragFloat("LOD Spread", &path_tracer->m_lod_spread, 0.001f, 0.0f, kMaxLODSpread, "%.3f");
+		} else
+			ImGui::TextDisabled("LOD Diffuse Bounces (load with \"Build LOD Colors\")");
+
+		ImGui::Checkbox("Tiled", &path_tracer_thread->m_tiled);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::TextUnformatted("Render in tiles from the centre, keeps the UI responsive at high resolutions");
+			ImGui::EndTooltip();
+		}
+		if (path_tracer_thread->m_tiled) {
+			int tile_size = path_tracer_thread->m_tile_size;
+			ImGui::PushMultiItemsWidths(2, ImGui::CalcItemWidth());
+			if (ImGui::DragInt("Tile Size", &tile_size, 8, kPTMinTileSize, kPTMaxTileSize))
+				path_tracer_thread->m_tile_size = tile_size;
+			ImGui::PopItemWidth();
+			ImGui::SameLine();
+			ImGui::DragFloat("Budget (ms)", &path_tracer_thread->m_tile_budget_ms, 0.1f, 1.0f, kPTMaxTileBudgetMs,
+			                 "%.1f");
+			ImGui::PopItemWidth();
+		} else {
+			int samples_per_submit = path_tracer_thread->m_samples_per_submit;
+			if (ImGui::DragInt("Samples per Submit", &samples_per_submit, 1, 1, kPTMaxSamplesPerSubmit))
+				path_tracer_thread->m_samples_per_submit = samples_per_submit;
+		}
+		int submissions_in_flight = path_tracer_thread->m_submissions_in_flight;
+		if (ImGui::DragInt("Submissions in Flight", &submissions_in_flight, 1, 1, kPTMaxSubmissionsInFlight))
+			path_tracer_thread->m_submissions_in_flight = submissions_in_flight;
+
 		float button_width = (ImGui::GetWindowContentRegionWidth() - ImGui::GetStyle().ItemSpacing.x) * 0.5f;
 
 		if (ImGui::Button("Start", {button_width, 0})) {
@@ -204,7 +358,7 @@ void PathTracerExportEXRModal(const std::shared_ptr<PathTracerThread> &path_trac
 	                               ImGuiWindowFlags_NoMove)) {
 		const auto &path_tracer = path_tracer_thread->GetPathTracerViewerPtr()->GetPathTracerPtr();
 
-		constexpr const char *kChannels[] = {"Color", "Albedo", "Normal"};
+		constexpr const char *kChannels[] = {"Color", "Albedo", "Normal", "Denoised"};
 		static const char *const *current_channel = kChannels + 0;
 		if (ImGui::BeginCombo("Channel", *current_channel)) {
 			for (int n = 0; n < IM_ARRAYSIZE(kChannels); n++) {
@@ -241,8 +395,11 @@ void PathTracerExportEXRModal(const std::shared_ptr<PathTracerThread> &path_trac
 						pixels = path_tracer->ExtractColorImage(command_pool);
 					else if (current_channel == kChannels + 1) // albedo
 						pixels = path_tracer->ExtractAlbedoImage(command_pool);
-					else // normal
+					else if (current_channel == kChannels + 2) // normal
 						pixels = path_tracer->ExtractNormalImage(command_pool);
+					else // denoised
+						pixels = path_tracer_thread->GetPathTracerViewerPtr()->GetDenoiserPtr()->ExtractDenoisedImage(
+						    command_pool);
 				}
 
 				//path_tracer_thread->SetPause(tmp_pause);
@@ -1,20 +1,20 @@
 #include "VoxDataAdapter.hpp"
 #include "Config.hpp"
+#include "CpuOctreeBuilder.hpp"
 #include "myvk/CommandBuffer.hpp"
 #include <spdlog/spdlog.h>
 #include <algorithm>
-#include <climits>
 
 std::shared_ptr<VoxDataAdapter> VoxDataAdapter::Create(const VoxLoader::VoxData &vox_data,
                                                       const std::shared_ptr<myvk::Device> &device,
                                                       const std::shared_ptr<myvk::CommandPool> &command_pool,
-                                                      uint32_t octree_level) {
+                                                      uint32_t octree_level, bool deduplicate_fragments) {
 	auto ret = std::make_shared<VoxDataAdapter>();
 	
 	ret->m_level = octree_level;
 	ret->m_voxel_resolution = 1u << octree_level;
 	
-	ret->create_fragment_list_from_vox_data(device, command_pool, vox_data);
+	ret->create_fragment_list_from_vox_data(device, command_pool, vox_data, deduplicate_fragments);
 	
 	spdlog::info("VoxDataAdapter created: level={}, resolution={}, fragments={}",
 	             ret->m_level, ret->m_voxel_resolution, ret->m_voxel_fragment_count);
@@ -22,25 +22,16 @@ std::shared_ptr<VoxDataAdapter> VoxDataAdapter::Create(const VoxLoader::VoxData
 	return ret;
 }
 
-void VoxDataAdapter::create_fragment_list_from_vox_data(const std::shared_ptr<myvk::Device> &device,
-                                                       const std::shared_ptr<myvk::CommandPool> &command_pool,
-                                                       const VoxLoader::VoxData &vox_data) {
-	// 计算有效体素数量
+std::vector<uint32_t> VoxDataAdapter::CreateFragmentData(const VoxLoader::VoxData &vox_data, uint32_t octree_level) {
+	const uint32_t voxel_resolution = 1u << octree_level;
 	std::vector<uint32_t> fragment_data;
-	m_voxel_fragment_count = 0;
-	
-	// 找到体素数据的边界（MagicaVoxel原始坐标）
-	int min_x = INT_MAX, min_y = INT_MAX, min_z = INT_MAX;
-	int max_x = INT_MIN, max_y = INT_MIN, max_z = INT_MIN;
+	uint32_t fragment_count = 0;
 	
-	for (const auto &voxel : vox_data.voxels) {
-		min_x = std::min<int>(min_x, static_cast<int>(voxel.position.x));
-		min_y = std::min<int>(min_y, static_cast<int>(voxel.position.y));
-		min_z = std::min<int>(min_z, static_cast<int>(voxel.position.z));
-		max_x = std::max<int>(max_x, static_cast<int>(voxel.position.x));
-		max_y = std::max<int>(max_y, static_cast<int>(voxel.position.y));
-		max_z = std::max<int>(max_z, static_cast<int>(voxel.position.z));
-	}
+	// 体素数据的世界空间边界（MagicaVoxel坐标，已烘焙场景图变换，可超出0~255）
+	int min_x = vox_data.min_position.x, min_y = vox_data.min_position.y, min_z = vox_data.min_position.z;
+	int max_x = min_x + vox_data.dimensions.x - 1;
+	int max_y = min_y + vox_data.dimensions.y - 1;
+	int max_z = min_z + vox_data.dimensions.z - 1;
 	
 	// 计算源数据尺寸（按MagicaVoxel坐标）
 	int size_x = max_x - min_x + 1;
@@ -48,20 +39,23 @@ void VoxDataAdapter::create_fragment_list_from_vox_data(const std::shared_ptr<my
 	int size_z = max_z - min_z + 1;
 	int max_size = std::max({size_x, size_y, size_z});
 	
-	// 使用保持密度的缩放：不要填满整个分辨率空间，保持原有密度
-	float voxel_scale = std::min(1.0f, static_cast<float>(m_voxel_resolution / 4) / max_size);
+	// 使用保持密度的缩放：不要填满整个分辨率空间，保持原有密度。
+	// 单模型文件保持原来的 1/4 分辨率上限；多模型世界可用整个分辨率，只有超出八叉树分辨率时才缩小
+	uint32_t scale_resolution = vox_data.instance_count > 1 ? voxel_resolution : voxel_resolution / 4;
+	float voxel_scale = std::min(1.0f, static_cast<float>(scale_resolution) / max_size);
 	
 	// 居中偏移（注意：要按照映射后的坐标轴计算偏移）
-	uint32_t offset_x = (m_voxel_resolution - static_cast<uint32_t>(size_x * voxel_scale)) / 2;
-	uint32_t offset_y = (m_voxel_resolution - static_cast<uint32_t>(size_z * voxel_scale)) / 2;  // Z->Y
-	uint32_t offset_z = (m_voxel_resolution - static_cast<uint32_t>(size_y * voxel_scale)) / 2;  // Y->Z
+	uint32_t offset_x = (voxel_resolution - static_cast<uint32_t>(size_x * voxel_scale)) / 2;
+	uint32_t offset_y = (voxel_resolution - static_cast<uint32_t>(size_z * voxel_scale)) / 2;  // Z->Y
+	uint32_t offset_z = (voxel_resolution - static_cast<uint32_t>(size_y * voxel_scale)) / 2;  // Y->Z
 	
 	spdlog::info("Vox data bounds: ({},{},{}) to ({},{},{}), size: {}x{}x{}, scale: {}, voxel count: {}",
 	             min_x, min_y, min_z, max_x, max_y, max_z, size_x, size_y, size_z, voxel_scale, vox_data.voxels.size());
 	spdlog::info("Target resolution: {}, offsets: ({},{},{})",
-	             m_voxel_resolution, offset_x, offset_y, offset_z);
+	             voxel_resolution, offset_x, offset_y, offset_z);
 	
 	// 转换体素到fragment格式 - 修复坐标系映射
+	fragment_data.reserve(vox_data.voxels.size() * 2);
 	for (const auto &voxel : vox_data.voxels) {
 		// MagicaVoxel: X(右), Y(后), Z(上) -> 渲染引擎: X(右), Y(上), Z(后)
 		// 需要交换Y和Z轴来修正方向
@@ -70,9 +64,9 @@ void VoxDataAdapter::create_fragment_list_from_vox_data(const std::shared_ptr<my
 		uint32_t z = static_cast<uint32_t>((voxel.position.y - min_y) * voxel_scale) + offset_z;  // Y->Z
 		
 		// 确保坐标在有效范围内
-		x = std::min(x, m_voxel_resolution - 1);
-		y = std::min(y, m_voxel_resolution - 1);
-		z = std::min(z, m_voxel_resolution - 1);
+		x = std::min(x, voxel_resolution - 1);
+		y = std::min(y, voxel_resolution - 1);
+		z = std::min(z, voxel_resolution - 1);
 		
 		// 获取颜色信息
 		uint32_t color_rgb = 0x000000; // 默认黑色 (无alpha)
@@ -91,12 +85,12 @@ void VoxDataAdapter::create_fragment_list_from_vox_data(const std::shared_ptr<my
 		fragment_data.push_back(fragment_x);
 		fragment_data.push_back(fragment_y);
 		
-		m_voxel_fragment_count++;
+		fragment_count++;
 		
 		// 添加调试输出前几个体素的信息
-		if (m_voxel_fragment_count <= 5) {
+		if (fragment_count <= 5) {
 			spdlog::info("Voxel {}: orig({},{},{}) -> scaled({},{},{}) -> fragments(0x{:08X}, 0x{:08X})",
-				m_voxel_fragment_count, voxel.position.x, voxel.position.y, voxel.position.z,
+				fragment_count, voxel.position.x, voxel.position.y, voxel.position.z,
 				x, y, z, fragment_x, fragment_y);
 		}
 	}
@@ -106,9 +100,25 @@ void VoxDataAdapter::create_fragment_list_from_vox_data(const std::shared_ptr<my
 		// 创建一个最小的缓冲区以避免错误
 		fragment_data.push_back(0);
 		fragment_data.push_back(0xFF000000);
-		m_voxel_fragment_count = 1;
 	}
 	
+	return fragment_data;
+}
+
+void VoxDataAdapter::create_fragment_list_from_vox_data(const std::shared_ptr<myvk::Device> &device,
+                                                       const std::shared_ptr<myvk::CommandPool> &command_pool,
+                                                       const VoxLoader::VoxData &vox_data,
+                                                       bool deduplicate_fragments) {
+	std::vector<uint32_t> fragment_data = CreateFragmentData(vox_data, m_level);
+	if (deduplicate_fragments) {
+		// 缩放后多个体素可能落入同一个八叉树叶节点：上传前在主机端合并
+		std::vector<glm::uvec2> fragments =
+		    CpuOctreeBuilder::Create(ThreadPool::GetDefault(), m_level)
+		        ->Deduplicate((const glm::uvec2 *)fragment_data.data(), fragment_data.size() / 2);
+		fragment_data.assign((const uint32_t *)fragments.data(), (const uint32_t *)(fragments.data() + fragments.size()));
+	}
+	m_voxel_fragment_count = fragment_data.size() / 2;
+	
 	// 创建Vulkan缓冲区
 	VkDeviceSize buffer_size = fragment_data.size() * sizeof(uint32_t);
 	
@@ -120,7 +130,8 @@ void VoxDataAdapter::create_fragment_list_from_vox_data(const std::shared_ptr<my
 	
 	// 创建设备本地存储缓冲区
 	m_voxel_fragment_list = myvk::Buffer::Create(device, buffer_size, 0,
-	                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+	                                               VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
 	
 	// 创建命令缓冲区并执行数据复制
 	auto command_buffer = myvk::CommandBuffer::Create(command_pool);
@@ -15,13 +15,16 @@ private:
 
 	void create_fragment_list_from_vox_data(const std::shared_ptr<myvk::Device> &device,
 	                                       const std::shared_ptr<myvk::CommandPool> &command_pool,
-	                                       const VoxLoader::VoxData &vox_data);
+	                                       const VoxLoader::VoxData &vox_data, bool deduplicate_fragments);
 
 public:
 	static std::shared_ptr<VoxDataAdapter> Create(const VoxLoader::VoxData &vox_data,
 	                                               const std::shared_ptr<myvk::Device> &device,
 	                                               const std::shared_ptr<myvk::CommandPool> &command_pool,
-	                                               uint32_t octree_level);
+	                                               uint32_t octree_level, bool deduplicate_fragments = false);
+
+	// 将体素转换为与Voxelizer相同的uvec2 fragment格式（按x, y交替存储），不需要Vulkan设备
+	static std::vector<uint32_t> CreateFragmentData(const VoxLoader::VoxData &vox_data, uint32_t octree_level);
 
 	uint32_t GetLevel() const { return m_level; }
 	uint32_t GetVoxelResolution() const { return m_voxel_resolution; }
@@ -1,8 +1,78 @@
 #include "VoxLoader.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
 #include <spdlog/spdlog.h>
+#include <atomic>
+#include <climits>
 #include <cstdio>
 #include <cstring>
 #include <algorithm>
+#include <mutex>
+#include <type_traits>
+
+// XYZI块中每个体素在文件中的排列(x, y, z, color_index)与VoxelData完全一致，
+// 因此内存映射路径可以直接整块拷贝
+static_assert(sizeof(VoxLoader::VoxelData) == 4 && std::is_trivially_copyable_v<VoxLoader::VoxelData>,
+              "VoxelData must match the on-disk XYZI record");
+static_assert(sizeof(glm::u8vec4) == 4, "Palette entry must match the on-disk RGBA record");
+
+// 场景图嵌套深度上限，防止损坏文件中的环
+static constexpr uint32_t kMaxSceneDepth = 64;
+// 烘焙时每个任务处理的体素数
+static constexpr size_t kBakeGrain = 65536;
+
+// 场景图块内容读取器（小端int32、STRING和DICT）
+struct SceneChunkReader {
+    const uint8_t* ptr;
+    const uint8_t* end;
+    
+    bool ReadInt(int32_t& value) {
+        if (end - ptr < 4) return false;
+        std::memcpy(&value, ptr, 4);
+        ptr += 4;
+        return true;
+    }
+    
+    bool ReadString(std::string& str) {
+        int32_t length;
+        if (!ReadInt(length) || length < 0 || end - ptr < length) return false;
+        str.assign(reinterpret_cast<const char*>(ptr), length);
+        ptr += length;
+        return true;
+    }
+    
+    bool ReadDict(std::unordered_map<std::string, std::string>& dict) {
+        int32_t pair_count;
+        if (!ReadInt(pair_count) || pair_count < 0) return false;
+        for (int32_t i = 0; i < pair_count; ++i) {
+            std::string key, value;
+            if (!ReadString(key) || !ReadString(value)) return false;
+            dict[std::move(key)] = std::move(value);
+        }
+        return true;
+    }
+};
+
+static bool is_hidden(const std::unordered_map<std::string, std::string>& dict) {
+    auto it = dict.find("_hidden");
+    return it != dict.end() && it->second == "1";
+}
+
+// _r: 第一、二行非零元素的列索引各占2位，bit4~6为三行的符号
+static glm::imat3 decode_rotation(uint8_t packed) {
+    uint32_t index0 = packed & 3u, index1 = (packed >> 2) & 3u;
+    if (index0 > 2 || index1 > 2 || index0 == index1) {
+        spdlog::warn("VoxLoader: Invalid rotation 0x{:02X}, using identity", packed);
+        return glm::imat3(1);
+    }
+    uint32_t index2 = 3 - index0 - index1;
+    
+    glm::imat3 rotation(0);  // glm按列存储：rotation[列][行]
+    rotation[index0][0] = (packed & 0x10u) ? -1 : 1;
+    rotation[index1][1] = (packed & 0x20u) ? -1 : 1;
+    rotation[index2][2] = (packed & 0x40u) ? -1 : 1;
+    return rotation;
+}
 
 // MagicaVoxel默认调色板（简化版）
 static const glm::u8vec4 DEFAULT_PALETTE[16] = {
@@ -24,12 +94,78 @@ static const glm::u8vec4 DEFAULT_PALETTE[16] = {
     glm::u8vec4(51, 0, 0, 255)       // 暗棕
 };
 
-std::shared_ptr<VoxLoader::VoxData> VoxLoader::LoadVox(const char* filename) {
+std::shared_ptr<VoxLoader::VoxData> VoxLoader::LoadVox(const char* filename, LoadMode mode) {
     if (!filename) {
         spdlog::error("VoxLoader: filename is null");
         return nullptr;
     }
     
+    if (mode == LoadMode::kStream) {
+        return LoadVoxStream(filename);
+    }
+    
+    auto mapped_file = MappedFile::Create(filename);
+    if (!mapped_file) {
+        spdlog::error("VoxLoader: Failed to map file {}", filename);
+        return nullptr;
+    }
+    
+    auto data = LoadVoxFromMemory(mapped_file->GetData(), mapped_file->GetSize());
+    if (!data) {
+        spdlog::error("VoxLoader: Failed to parse .vox file {}", filename);
+        return nullptr;
+    }
+    
+    spdlog::info("VoxLoader: Successfully loaded {} voxels from {}", 
+                 data->GetVoxelCount(), filename);
+    
+    return data;
+}
+
+std::shared_ptr<VoxLoader::VoxData> VoxLoader::LoadVoxFromMemory(const uint8_t* bytes, size_t size) {
+    const uint8_t* end = bytes + size;
+    
+    VoxHeader header;
+    if (size < sizeof(VoxHeader)) {
+        spdlog::error("VoxLoader: File too small for .vox header");
+        return nullptr;
+    }
+    std::memcpy(&header, bytes, sizeof(VoxHeader));
+    if (!CheckHeader(header)) {
+        return nullptr;
+    }
+    
+    // 读取主块
+    const uint8_t* ptr = bytes + sizeof(VoxHeader);
+    ChunkHeader main_header;
+    if (end - ptr < (ptrdiff_t)sizeof(ChunkHeader)) {
+        spdlog::error("VoxLoader: Missing MAIN chunk");
+        return nullptr;
+    }
+    std::memcpy(&main_header, ptr, sizeof(ChunkHeader));
+    ptr += sizeof(ChunkHeader);
+    if (main_header.id != CHUNK_MAIN ||
+        (uint64_t)main_header.content_size + main_header.child_size > (uint64_t)(end - ptr)) {
+        spdlog::error("VoxLoader: Invalid MAIN chunk");
+        return nullptr;
+    }
+    
+    const uint8_t* children_begin = ptr + main_header.content_size;
+    auto data = std::make_shared<VoxData>();
+    ParseContext context;
+    if (!ParseMainChunk(children_begin, children_begin + main_header.child_size, *data, context) ||
+        !DecodeModels(*data, context) || !BakeScene(*data, context)) {
+        return nullptr;
+    }
+    
+    if (data->palette.empty()) {
+        SetDefaultPalette(*data);
+    }
+    
+    return data;
+}
+
+std::shared_ptr<VoxLoader::VoxData> VoxLoader::LoadVoxStream(const char* filename) {
     FILE* file = fopen(filename, "rb");
     if (!file) {
         spdlog::error("VoxLoader: Failed to open file {}", filename);
@@ -55,7 +191,8 @@ std::shared_ptr<VoxLoader::VoxData> VoxLoader::LoadVox(const char* filename) {
             return nullptr;
         }
         
-        success = ParseMainChunk(file, main_header, *data);
+        ParseContext context;
+        success = ParseMainChunk(file, main_header, *data, context) && BakeScene(*data, context);
         
         if (success && data->palette.empty()) {
             SetDefaultPalette(*data);
@@ -92,6 +229,10 @@ bool VoxLoader::ReadHeader(FILE* file, VoxHeader& header) {
         return false;
     }
     
+    return CheckHeader(header);
+}
+
+bool VoxLoader::CheckHeader(const VoxHeader& header) {
     // 检查魔数和版本
     if (header.magic != VOX_MAGIC) {
         spdlog::error("VoxLoader: Invalid magic number: 0x{:08X}, expected 0x{:08X}", 
@@ -118,7 +259,7 @@ bool VoxLoader::ReadChunkHeader(FILE* file, ChunkHeader& chunk_header) {
     return fread(&chunk_header, sizeof(ChunkHeader), 1, file) == 1;
 }
 
-bool VoxLoader::ParseMainChunk(FILE* file, const ChunkHeader& main_header, VoxData& data) {
+bool VoxLoader::ParseMainChunk(FILE* file, const ChunkHeader& main_header, VoxData& data, ParseContext& context) {
     long main_start = ftell(file);
     long main_end = main_start + main_header.child_size;
     
@@ -152,6 +293,20 @@ bool VoxLoader::ParseMainChunk(FILE* file, const ChunkHeader& main_header, VoxDa
                 }
                 break;
                 
+            case CHUNK_NTRN:
+            case CHUNK_NGRP:
+            case CHUNK_NSHP:
+            case CHUNK_LAYR: {
+                // 场景图块很小，读入内存后与映射模式共用解析代码
+                std::vector<uint8_t> content(chunk_header.content_size);
+                if (fread(content.data(), 1, content.size(), file) != content.size() ||
+                    !ParseSceneChunk(chunk_header.id, content.data(), chunk_header.content_size, context)) {
+                    return false;
+                }
+                fseek(file, chunk_header.child_size, SEEK_CUR);
+                break;
+            }
+                
             default:
                 // 跳过未知块
                 fseek(file, chunk_header.content_size + chunk_header.child_size, SEEK_CUR);
@@ -181,7 +336,8 @@ bool VoxLoader::ParseSizeChunk(FILE* file, const ChunkHeader& size_header, VoxDa
         return false;
     }
     
-    data.dimensions = glm::ivec3(x, y, z);
+    // 每个SIZE块开始一个新模型，紧随其后的XYZI块属于该模型
+    data.models.push_back({glm::ivec3(x, y, z), {}});
     
     // 跳过SIZE块的其余内容
     if (size_header.content_size > 12) {
@@ -200,6 +356,11 @@ bool VoxLoader::ParseXyziChunk(FILE* file, const ChunkHeader& xyzi_header, VoxDa
         spdlog::error("VoxLoader: XYZI chunk too small");
         return false;
     }
+    if (data.models.empty()) {
+        spdlog::error("VoxLoader: XYZI chunk without preceding SIZE chunk");
+        return false;
+    }
+    std::vector<VoxelData>& voxels = data.models.back().voxels;
     
     uint32_t voxel_count;
     if (fread(&voxel_count, 4, 1, file) != 1) {
@@ -212,7 +373,7 @@ bool VoxLoader::ParseXyziChunk(FILE* file, const ChunkHeader& xyzi_header, VoxDa
         return false;
     }
     
-    data.voxels.reserve(voxel_count);
+    voxels.reserve(voxel_count);
     
     for (uint32_t i = 0; i < voxel_count; ++i) {
         uint8_t x, y, z, color_index;
@@ -227,7 +388,7 @@ bool VoxLoader::ParseXyziChunk(FILE* file, const ChunkHeader& xyzi_header, VoxDa
         VoxelData voxel;
         voxel.position = glm::u8vec3(x, y, z);
         voxel.color_index = color_index;
-        data.voxels.push_back(voxel);
+        voxels.push_back(voxel);
     }
     
     // 跳过XYZI块的其余内容
@@ -274,6 +435,339 @@ bool VoxLoader::ParseRgbaChunk(FILE* file, const ChunkHeader& rgba_header, VoxDa
     return true;
 }
 
+bool VoxLoader::ParseMainChunk(const uint8_t* begin, const uint8_t* end, VoxData& data, ParseContext& context) {
+    bool found_size = false, found_xyzi = false;
+    
+    const uint8_t* ptr = begin;
+    while (ptr < end) {
+        ChunkHeader chunk_header;
+        if (end - ptr < (ptrdiff_t)sizeof(ChunkHeader)) {
+            spdlog::error("VoxLoader: Truncated chunk header");
+            return false;
+        }
+        std::memcpy(&chunk_header, ptr, sizeof(ChunkHeader));
+        ptr += sizeof(ChunkHeader);
+        
+        // 统一检查块边界，之后的解析函数无需再做越界判断
+        uint64_t chunk_size = (uint64_t)chunk_header.content_size + chunk_header.child_size;
+        if (chunk_size > (uint64_t)(end - ptr)) {
+            spdlog::error("VoxLoader: Chunk 0x{:08X} exceeds MAIN chunk bounds", chunk_header.id);
+            return false;
+        }
+        
+        switch (chunk_header.id) {
+            case CHUNK_SIZE:
+                if (!ParseSizeChunk(ptr, chunk_header.content_size, data)) {
+                    return false;
+                }
+                found_size = true;
+                break;
+                
+            case CHUNK_XYZI:
+                // 只记录位置，所有块遍历完后在DecodeModels中并行解码
+                if (data.models.empty()) {
+                    spdlog::error("VoxLoader: XYZI chunk without preceding SIZE chunk");
+                    return false;
+                }
+                context.pending_xyzi.push_back({(uint32_t)data.models.size() - 1, ptr, chunk_header.content_size});
+                found_xyzi = true;
+                break;
+                
+            case CHUNK_RGBA:
+                if (!ParseRgbaChunk(ptr, chunk_header.content_size, data)) {
+                    return false;
+                }
+                break;
+                
+            case CHUNK_NTRN:
+            case CHUNK_NGRP:
+            case CHUNK_NSHP:
+            case CHUNK_LAYR:
+                if (!ParseSceneChunk(chunk_header.id, ptr, chunk_header.content_size, context)) {
+                    return false;
+                }
+                break;
+                
+            default:
+                // 跳过未知块
+                break;
+        }
+        
+        ptr += chunk_size;
+    }
+    
+    if (!found_size || !found_xyzi) {
+        spdlog::error("VoxLoader: Missing required SIZE or XYZI chunk");
+        return false;
+    }
+    
+    return true;
+}
+
+bool VoxLoader::ParseSizeChunk(const uint8_t* content, uint32_t content_size, VoxData& data) {
+    if (content_size < 12) {
+        spdlog::error("VoxLoader: SIZE chunk too small");
+        return false;
+    }
+    
+    uint32_t size[3];
+    std::memcpy(size, content, sizeof(size));
+    data.models.push_back({glm::ivec3(size[0], size[1], size[2]), {}});
+    
+    spdlog::debug("VoxLoader: Model dimensions: {}x{}x{}", size[0], size[1], size[2]);
+    return true;
+}
+
+bool VoxLoader::ParseXyziChunk(const uint8_t* content, uint32_t content_size, Model& model) {
+    if (content_size < 4) {
+        spdlog::error("VoxLoader: XYZI chunk too small");
+        return false;
+    }
+    
+    uint32_t voxel_count;
+    std::memcpy(&voxel_count, content, 4);
+    
+    if (content_size < 4 + (uint64_t)voxel_count * 4) {
+        spdlog::error("VoxLoader: XYZI chunk size mismatch");
+        return false;
+    }
+    
+    // 预分配后整块拷贝，不再逐体素push_back
+    model.voxels.resize(voxel_count);
+    std::memcpy(model.voxels.data(), content + 4, (size_t)voxel_count * sizeof(VoxelData));
+    
+    spdlog::debug("VoxLoader: Loaded {} voxels", voxel_count);
+    return true;
+}
+
+bool VoxLoader::ParseRgbaChunk(const uint8_t* content, uint32_t content_size, VoxData& data) {
+    if (content_size < 1024) { // 256 colors * 4 bytes
+        spdlog::error("VoxLoader: RGBA chunk too small");
+        return false;
+    }
+    
+    data.palette.resize(256);
+    std::memcpy(data.palette.data(), content, 1024);
+    
+    spdlog::debug("VoxLoader: Loaded custom palette");
+    return true;
+}
+
+bool VoxLoader::ParseSceneChunk(uint32_t id, const uint8_t* content, uint32_t content_size, ParseContext& context) {
+    SceneChunkReader reader{content, content + content_size};
+    std::unordered_map<std::string, std::string> attributes;
+    
+    if (id == CHUNK_LAYR) {
+        int32_t layer_id;
+        if (!reader.ReadInt(layer_id) || !reader.ReadDict(attributes)) {
+            spdlog::error("VoxLoader: Invalid LAYR chunk");
+            return false;
+        }
+        context.layer_hidden[layer_id] = is_hidden(attributes);
+        return true;
+    }
+    
+    int32_t node_id;
+    if (!reader.ReadInt(node_id) || !reader.ReadDict(attributes)) {
+        spdlog::error("VoxLoader: Invalid scene node chunk 0x{:08X}", id);
+        return false;
+    }
+    
+    SceneNode node;
+    node.hidden = is_hidden(attributes);
+    bool success = true;
+    
+    if (id == CHUNK_NTRN) {
+        // nTRN: 子节点ID, 保留ID(-1), 层ID, 帧数, 每帧一个DICT（只使用第0帧）
+        int32_t child_id, reserved_id, frame_count;
+        node.type = SceneNode::Type::kTransform;
+        success = reader.ReadInt(child_id) && reader.ReadInt(reserved_id) && reader.ReadInt(node.layer_id) &&
+                  reader.ReadInt(frame_count);
+        if (success) {
+            node.children.push_back(child_id);
+            std::unordered_map<std::string, std::string> frame;
+            if (frame_count > 0 && (success = reader.ReadDict(frame))) {
+                auto rotation_it = frame.find("_r");
+                if (rotation_it != frame.end()) {
+                    node.rotation = decode_rotation((uint8_t)std::atoi(rotation_it->second.c_str()));
+                }
+                auto translation_it = frame.find("_t");
+                if (translation_it != frame.end()) {
+                    glm::ivec3& t = node.translation;
+                    success = std::sscanf(translation_it->second.c_str(), "%d %d %d", &t.x, &t.y, &t.z) == 3;
+                }
+            }
+        }
+    } else if (id == CHUNK_NGRP) {
+        // nGRP: 子节点数, 子节点ID列表
+        int32_t child_count;
+        node.type = SceneNode::Type::kGroup;
+        success = reader.ReadInt(child_count) && child_count >= 0;
+        for (int32_t i = 0; success && i < child_count; ++i) {
+            int32_t child_id;
+            success = reader.ReadInt(child_id);
+            node.children.push_back(child_id);
+        }
+    } else {
+        // nSHP: 模型数, 每个模型一个ID和一个DICT
+        int32_t model_count;
+        node.type = SceneNode::Type::kShape;
+        success = reader.ReadInt(model_count) && model_count >= 0;
+        for (int32_t i = 0; success && i < model_count; ++i) {
+            int32_t model_id;
+            std::unordered_map<std::string, std::string> model_attributes;
+            success = reader.ReadInt(model_id) && reader.ReadDict(model_attributes);
+            node.model_ids.push_back(model_id);
+        }
+    }
+    
+    if (!success) {
+        spdlog::error("VoxLoader: Invalid scene node {} in chunk 0x{:08X}", node_id, id);
+        return false;
+    }
+    
+    context.nodes[node_id] = std::move(node);
+    return true;
+}
+
+bool VoxLoader::DecodeModels(VoxData& data, ParseContext& context) {
+    std::atomic_bool success{true};
+    
+    // 每个模型的XYZI块相互独立，按块并行解码
+    ThreadPool::GetDefault()->ParallelFor(context.pending_xyzi.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const auto& pending = context.pending_xyzi[i];
+            if (!ParseXyziChunk(pending.content, pending.content_size, data.models[pending.model_index])) {
+                success = false;
+            }
+        }
+    });
+    context.pending_xyzi.clear();
+    
+    return success;
+}
+
+void VoxLoader::CollectInstances(const ParseContext& context, int32_t node_id, const glm::imat3& rotation,
+                                 const glm::ivec3& translation, uint32_t depth, uint32_t model_count,
+                                 std::vector<Instance>& instances) {
+    auto it = context.nodes.find(node_id);
+    if (depth > kMaxSceneDepth || it == context.nodes.end()) {
+        spdlog::warn("VoxLoader: Skipping missing or too deeply nested scene node {}", node_id);
+        return;
+    }
+    const SceneNode& node = it->second;
+    if (node.hidden) {
+        return;
+    }
+    
+    switch (node.type) {
+        case SceneNode::Type::kTransform: {
+            auto layer_it = context.layer_hidden.find(node.layer_id);
+            if (layer_it != context.layer_hidden.end() && layer_it->second) {
+                return;
+            }
+            // 父变换作用在子变换之后：R = Rp * Rc, t = Rp * tc + tp
+            glm::imat3 child_rotation = rotation * node.rotation;
+            glm::ivec3 child_translation = rotation * node.translation + translation;
+            for (int32_t child_id : node.children) {
+                CollectInstances(context, child_id, child_rotation, child_translation, depth + 1, model_count, instances);
+            }
+            break;
+        }
+        case SceneNode::Type::kGroup:
+            for (int32_t child_id : node.children) {
+                CollectInstances(context, child_id, rotation, translation, depth + 1, model_count, instances);
+            }
+            break;
+        case SceneNode::Type::kShape:
+            for (int32_t model_id : node.model_ids) {
+                if (model_id >= 0 && (uint32_t)model_id < model_count) {
+                    instances.push_back({(uint32_t)model_id, rotation, translation, true});
+                } else {
+                    spdlog::warn("VoxLoader: Shape node {} references invalid model {}", node_id, model_id);
+                }
+            }
+            break;
+    }
+}
+
+bool VoxLoader::BakeScene(VoxData& data, const ParseContext& context) {
+    std::vector<Instance> instances;
+    if (context.nodes.count(0)) {
+        CollectInstances(context, 0, glm::imat3(1), glm::ivec3(0), 0, data.models.size(), instances);
+    } else {
+        // 没有场景图（旧版本文件）：所有模型直接使用局部坐标
+        for (uint32_t i = 0; i < data.models.size(); ++i) {
+            instances.push_back({i, glm::imat3(1), glm::ivec3(0), false});
+        }
+    }
+    data.instance_count = instances.size();
+    
+    // 为每个实例分配输出区间，并切分成固定大小的任务
+    struct BakeTask {
+        uint32_t instance_index;
+        size_t src_begin, src_end, dst_begin;
+    };
+    std::vector<BakeTask> tasks;
+    std::vector<glm::ivec3> instance_bases(instances.size());
+    size_t total_count = 0;
+    for (uint32_t i = 0; i < instances.size(); ++i) {
+        const Instance& instance = instances[i];
+        const Model& model = data.models[instance.model_index];
+        
+        // MagicaVoxel把模型中心（尺寸的一半向下取整）放在平移位置上；在两倍坐标下推导可得
+        // world = R * v + (R * (1 - size) + parity - 1) / 2 + t，其中parity为旋转后尺寸的奇偶，分子恒为偶数
+        if (instance.centered) {
+            glm::ivec3 rotated_size = glm::abs(instance.rotation * model.dimensions);
+            glm::ivec3 numerator = instance.rotation * (glm::ivec3(1) - model.dimensions) + (rotated_size & 1) - 1;
+            instance_bases[i] = numerator / 2 + instance.translation;
+        } else {
+            instance_bases[i] = instance.translation;
+        }
+        
+        size_t count = model.voxels.size();
+        for (size_t begin = 0; begin < count; begin += kBakeGrain) {
+            tasks.push_back({i, begin, std::min(begin + kBakeGrain, count), total_count + begin});
+        }
+        total_count += count;
+    }
+    
+    data.voxels.resize(total_count);
+    
+    glm::ivec3 world_min(INT_MAX), world_max(INT_MIN);
+    std::mutex bounds_mutex;
+    ThreadPool::GetDefault()->ParallelFor(tasks.size(), 1, [&](size_t begin, size_t end) {
+        glm::ivec3 local_min(INT_MAX), local_max(INT_MIN);
+        for (size_t t = begin; t < end; ++t) {
+            const BakeTask& task = tasks[t];
+            const Instance& instance = instances[task.instance_index];
+            const glm::ivec3& base = instance_bases[task.instance_index];
+            const VoxelData* src = data.models[instance.model_index].voxels.data();
+            WorldVoxel* dst = data.voxels.data() + task.dst_begin;
+            
+            for (size_t i = task.src_begin; i < task.src_end; ++i, ++dst) {
+                dst->position = instance.rotation * glm::ivec3(src[i].position) + base;
+                dst->color_index = src[i].color_index;
+                local_min = glm::min(local_min, dst->position);
+                local_max = glm::max(local_max, dst->position);
+            }
+        }
+        std::lock_guard<std::mutex> lock{bounds_mutex};
+        world_min = glm::min(world_min, local_min);
+        world_max = glm::max(world_max, local_max);
+    });
+    
+    if (total_count) {
+        data.min_position = world_min;
+        data.dimensions = world_max - world_min + 1;
+    }
+    
+    spdlog::info("VoxLoader: {} models, {} instances baked into {} voxels, world bounds ({},{},{}) size {}x{}x{}",
+                 data.models.size(), data.instance_count, total_count, data.min_position.x, data.min_position.y,
+                 data.min_position.z, data.dimensions.x, data.dimensions.y, data.dimensions.z);
+    return true;
+}
+
 void VoxLoader::SetDefaultPalette(VoxData& data) {
     data.palette.resize(256);
     
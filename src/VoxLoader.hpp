@@ -2,30 +2,48 @@
 #define VOXLOADER_HPP
 
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_integer.hpp>
+#include <cstdio>
+#include <unordered_map>
 #include <memory>
 #include <vector>
 #include <string>
 
 /**
  * VoxLoader - MagicaVoxel .vox文件加载器
- * 支持解析.vox格式文件并提供体素数据
+ * 支持解析.vox格式文件（包括nTRN/nGRP/nSHP/LAYR场景图）并提供世界空间体素数据
  */
 class VoxLoader {
 public:
-    // 体素数据结构
+    // 体素数据结构（XYZI块中的原始记录，模型局部坐标）
     struct VoxelData {
         glm::u8vec3 position;  // 体素位置 (x, y, z)
         uint8_t color_index;   // 调色板颜色索引
     };
 
+    // 烘焙场景图变换后的世界空间体素（MagicaVoxel坐标系，Z向上）
+    struct WorldVoxel {
+        glm::ivec3 position;   // 世界空间位置，不受8位限制
+        uint8_t color_index;   // 调色板颜色索引
+    };
+
+    // 单个模型（一对SIZE/XYZI块）
+    struct Model {
+        glm::ivec3 dimensions;                    // 模型尺寸
+        std::vector<VoxelData> voxels;           // 模型局部体素
+    };
+
     // .vox文件数据结构
     struct VoxData {
-        glm::ivec3 dimensions;                    // 模型尺寸 (width, height, depth)
-        std::vector<VoxelData> voxels;           // 体素数据数组
+        glm::ivec3 dimensions;                    // 世界空间包围盒尺寸 (width, height, depth)
+        glm::ivec3 min_position;                  // 世界空间包围盒最小角
+        std::vector<Model> models;               // 文件中的全部模型
+        uint32_t instance_count;                 // 场景图中可见的模型实例数量
+        std::vector<WorldVoxel> voxels;          // 所有实例烘焙到世界空间后的体素
         std::vector<glm::u8vec4> palette;        // 调色板 (RGBA)
         std::string name;                        // 模型名称（如果有）
         
-        VoxData() : dimensions(0, 0, 0) {}
+        VoxData() : dimensions(0, 0, 0), min_position(0, 0, 0), instance_count(0) {}
         
         // 便利方法：检查是否为空
         bool IsEmpty() const { return voxels.empty(); }
@@ -34,12 +52,27 @@ public:
         size_t GetVoxelCount() const { return voxels.size(); }
     };
 
+    // 文件读取方式
+    enum class LoadMode {
+        kStream,  // 逐字段fread
+        kMapped   // 内存映射，直接从映射字节批量解码
+    };
+
     /**
      * 加载.vox文件
      * @param filename .vox文件路径
+     * @param mode 读取方式，默认使用内存映射
+     * @return 解析后的体素数据，失败返回nullptr
+     */
+    static std::shared_ptr<VoxData> LoadVox(const char* filename, LoadMode mode = LoadMode::kMapped);
+
+    /**
+     * 从内存中解析完整的.vox文件内容
+     * @param bytes 文件内容起始地址
+     * @param size 文件内容字节数
      * @return 解析后的体素数据，失败返回nullptr
      */
-    static std::shared_ptr<VoxData> LoadVox(const char* filename);
+    static std::shared_ptr<VoxData> LoadVoxFromMemory(const uint8_t* bytes, size_t size);
 
     /**
      * 检查文件是否为有效的.vox格式
@@ -58,6 +91,10 @@ private:
     static constexpr uint32_t CHUNK_SIZE = 0x455A4953;  // 'SIZE'
     static constexpr uint32_t CHUNK_XYZI = 0x495A5958;  // 'XYZI'
     static constexpr uint32_t CHUNK_RGBA = 0x41424752;  // 'RGBA'
+    static constexpr uint32_t CHUNK_NTRN = 0x4E52546E;  // 'nTRN'
+    static constexpr uint32_t CHUNK_NGRP = 0x5052476E;  // 'nGRP'
+    static constexpr uint32_t CHUNK_NSHP = 0x5048536E;  // 'nSHP'
+    static constexpr uint32_t CHUNK_LAYR = 0x5259414C;  // 'LAYR'
 
     // 内部数据结构
     struct VoxHeader {
@@ -71,13 +108,63 @@ private:
         uint32_t child_size;   // 子块大小
     };
 
+    // 场景图节点
+    struct SceneNode {
+        enum class Type { kTransform, kGroup, kShape } type;
+        bool hidden = false;
+        int32_t layer_id = -1;
+        glm::imat3 rotation{1};              // 仅变换节点
+        glm::ivec3 translation{0};           // 仅变换节点
+        std::vector<int32_t> children;       // 变换节点只有一个子节点
+        std::vector<int32_t> model_ids;      // 仅形状节点
+    };
+
+    // 解析过程中的临时状态
+    struct ParseContext {
+        std::unordered_map<int32_t, SceneNode> nodes;
+        std::unordered_map<int32_t, bool> layer_hidden;
+        // 映射模式下延迟解码的XYZI块 (模型索引, 内容, 内容大小)
+        struct PendingXyzi {
+            uint32_t model_index;
+            const uint8_t* content;
+            uint32_t content_size;
+        };
+        std::vector<PendingXyzi> pending_xyzi;
+    };
+
+    // 一个模型实例：世界坐标 = rotation * (局部坐标 - 模型中心) + translation
+    struct Instance {
+        uint32_t model_index;
+        glm::imat3 rotation;
+        glm::ivec3 translation;
+        bool centered;  // 无场景图的旧文件直接使用局部坐标
+    };
+
     // 内部解析方法
+    static std::shared_ptr<VoxData> LoadVoxStream(const char* filename);
+    static bool CheckHeader(const VoxHeader& header);
     static bool ReadHeader(FILE* file, VoxHeader& header);
     static bool ReadChunkHeader(FILE* file, ChunkHeader& chunk_header);
-    static bool ParseMainChunk(FILE* file, const ChunkHeader& main_header, VoxData& data);
+    static bool ParseMainChunk(FILE* file, const ChunkHeader& main_header, VoxData& data, ParseContext& context);
     static bool ParseSizeChunk(FILE* file, const ChunkHeader& size_header, VoxData& data);
     static bool ParseXyziChunk(FILE* file, const ChunkHeader& xyzi_header, VoxData& data);
     static bool ParseRgbaChunk(FILE* file, const ChunkHeader& rgba_header, VoxData& data);
+
+    // 内存映射解析方法：块边界在ParseMainChunk中统一检查
+    static bool ParseMainChunk(const uint8_t* begin, const uint8_t* end, VoxData& data, ParseContext& context);
+    static bool ParseSizeChunk(const uint8_t* content, uint32_t content_size, VoxData& data);
+    static bool ParseXyziChunk(const uint8_t* content, uint32_t content_size, Model& model);
+    static bool ParseRgbaChunk(const uint8_t* content, uint32_t content_size, VoxData& data);
+
+    // 场景图解析（两种读取方式共用）
+    static bool ParseSceneChunk(uint32_t id, const uint8_t* content, uint32_t content_size, ParseContext& context);
+
+    // 并行解码延迟的XYZI块，并将所有实例的变换烘焙为世界空间体素
+    static bool DecodeModels(VoxData& data, ParseContext& context);
+    static bool BakeScene(VoxData& data, const ParseContext& context);
+    static void CollectInstances(const ParseContext& context, int32_t node_id, const glm::imat3& rotation,
+                                 const glm::ivec3& translation, uint32_t depth, uint32_t model_count,
+                                 std::vector<Instance>& instances);
     
     // 辅助方法
     static void SetDefaultPalette(VoxData& data);
@@ -1,4 +1,5 @@
 #include "Voxelizer.hpp"
+#include "FragmentDeduplicator.hpp"
 #include "myvk/ShaderModule.hpp"
 #include <spdlog/spdlog.h>
 
@@ -157,7 +158,7 @@ void Voxelizer::count_and_create_fragment_list(const std::shared_ptr<myvk::Comma
 
 	m_voxel_fragment_list =
 	    myvk::Buffer::Create(command_pool->GetDevicePtr(), m_voxel_fragment_count * sizeof(uint32_t) * 2, 0,
-	                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
 	m_descriptor_set->UpdateStorageBuffer(m_voxel_fragment_list, 1);
 
 	spdlog::info("Voxel fragment list created with {} voxels ({} MB)", m_voxel_fragment_count,
@@ -177,3 +178,22 @@ void Voxelizer::CmdVoxelize(const std::shared_ptr<myvk::CommandBuffer> &command_
 	}
 	command_buffer->CmdEndRenderPass();
 }
+
+bool Voxelizer::DeduplicateFragments(const std::shared_ptr<myvk::CommandPool> &command_pool) {
+	std::shared_ptr<FragmentDeduplicator> deduplicator =
+	    FragmentDeduplicator::Create(command_pool->GetDevicePtr(), m_level);
+	if (!deduplicator)
+		return false;
+	uint32_t fragment_count;
+	std::shared_ptr<myvk::Buffer> fragment_list =
+	    deduplicator->Deduplicate(command_pool, m_voxel_fragment_list, m_voxel_fragment_count, &fragment_count);
+	if (!fragment_list)
+		return false;
+
+	spdlog::info("Fragments deduplicated: {} -> {} ({:.2f}x)", m_voxel_fragment_count, fragment_count,
+	             fragment_count ? (double)m_voxel_fragment_count / (double)fragment_count : 1.0);
+	m_voxel_fragment_count = fragment_count;
+	m_voxel_fragment_list = fragment_list;
+	m_descriptor_set->UpdateStorageBuffer(m_voxel_fragment_list, 1);
+	return true;
+}
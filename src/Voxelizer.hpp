@@ -47,6 +47,10 @@ public:
 	uint32_t GetLevel() const { return m_level; }
 
 	void CmdVoxelize(const std::shared_ptr<myvk::CommandBuffer> &command_buffer) const;
+	// Merges the fragments of each voxel into one on the GPU (FragmentDeduplicator) and shrinks the fragment count,
+	// must run after the voxelization has been executed and before the OctreeBuilder is created. Returns false (and
+	// keeps the fragments) if the shaders are not available.
+	bool DeduplicateFragments(const std::shared_ptr<myvk::CommandPool> &command_pool);
 	uint32_t GetVoxelResolution() const { return m_voxel_resolution; }
 	uint32_t GetVoxelFragmentCount() const { return m_voxel_fragment_count; }
 	const std::shared_ptr<myvk::Buffer> &GetVoxelFragmentList() const { return m_voxel_fragment_list; }
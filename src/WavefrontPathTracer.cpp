@@ -0,0 +1,281 @@
+#include "WavefrontPathTracer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <spdlog/spdlog.h>
+
+inline static constexpr uint32_t group_x_64(uint32_t x) { return (x >> 6u) + ((x & 0x3fu) ? 1u : 0u); }
+
+// keep in sync with shader/wavefront.glsl
+constexpr uint32_t kPathSize = 5 * 4 * sizeof(float), kShadowRaySize = 2 * 4 * sizeof(float);
+constexpr uint32_t kExtendQueue = 0, kShadeQueue = 1, kShadowQueue = 2, kQueueCount = 3;
+constexpr uint32_t kRowGroups = 4096;
+// pipeline log suffixes of WavefrontPathTracer::Structure
+constexpr const char *kStructureStrs[] = {"", " on the 64-tree", " on the DAG", " on the compact octree"};
+
+struct QueueCounter {
+	uint32_t count, group_x, group_y, group_z;
+};
+// appended to the push constants of path_tracer.comp
+struct WavefrontPushConstants {
+	uint32_t level;
+	TileScheduler::Tile tile;
+};
+
+// timestamp queries: start, generate, then extend, shade and shadow of every bounce
+inline static constexpr uint32_t extend_query(uint32_t level) { return 2 + level * 3; }
+
+std::shared_ptr<WavefrontPathTracer>
+WavefrontPathTracer::Create(const std::shared_ptr<myvk::Device> &device,
+                            const std::vector<std::shared_ptr<myvk::DescriptorSetLayout>> &path_tracer_layouts,
+                            uint32_t push_constant_size) {
+	std::shared_ptr<WavefrontPathTracer> ret = std::make_shared<WavefrontPathTracer>();
+	ret->m_timestamp_period = device->GetPhysicalDevicePtr()->GetProperties().vk10.limits.timestampPeriod;
+	ret->create_descriptor(device);
+	if (!ret->create_pipelines(device, path_tracer_layouts, push_constant_size))
+		return nullptr;
+	return ret;
+}
+
+void WavefrontPathTracer::create_descriptor(const std::shared_ptr<myvk::Device> &device) {
+	m_descriptor_pool = myvk::DescriptorPool::Create(device, 1, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4}});
+	{
+		// paths, shadow rays, queues and queue counters
+		std::vector<VkDescriptorSetLayoutBinding> bindings(4);
+		for (uint32_t i = 0; i < bindings.size(); ++i) {
+			bindings[i] = {};
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+		m_descriptor_set_layout = myvk::DescriptorSetLayout::Create(device, bindings);
+	}
+	m_descriptor_set = myvk::DescriptorSet::Create(m_descriptor_pool, m_descriptor_set_layout);
+}
+
+bool WavefrontPathTracer::create_pipelines(
+    const std::shared_ptr<myvk::Device> &device,
+    const std::vector<std::shared_ptr<myvk::DescriptorSetLayout>> &path_tracer_layouts, uint32_t push_constant_size) {
+#if defined(SHADER_HAS_WAVEFRONT_GENERATE_COMP) && defined(SHADER_HAS_WAVEFRONT_EXTEND_COMP) &&                     \
+    defined(SHADER_HAS_WAVEFRONT_SHADE_COMP) && defined(SHADER_HAS_WAVEFRONT_SHADOW_COMP)
+	std::vector<std::shared_ptr<myvk::DescriptorSetLayout>> layouts = path_tracer_layouts;
+	layouts.push_back(m_descriptor_set_layout);
+	m_pipeline_layout = myvk::PipelineLayout::Create(
+	    device, layouts,
+	    {{VK_SHADER_STAGE_COMPUTE_BIT, 0, push_constant_size + (uint32_t)sizeof(WavefrontPushConstants)}});
+	{
+		constexpr uint32_t kWavefrontGenerateCompSpv[] = {
+#include "spirv/wavefront_generate.comp.u32"
+		};
+		std::shared_ptr<myvk::ShaderModule> generate_shader_module =
+		    myvk::ShaderModule::Create(device, kWavefrontGenerateCompSpv, sizeof(kWavefrontGenerateCompSpv));
+		m_generate_pipeline = myvk::ComputePipeline::Create(m_pipeline_layout, generate_shader_module);
+	}
+	{
+		constexpr uint32_t kWavefrontExtendCompSpv[] = {
+#include "spirv/wavefront_extend.comp.u32"
+		};
+		m_extend_shader_module =
+		    myvk::ShaderModule::Create(device, kWavefrontExtendCompSpv, sizeof(kWavefrontExtendCompSpv));
+	}
+	{
+		constexpr uint32_t kWavefrontShadeCompSpv[] = {
+#include "spirv/wavefront_shade.comp.u32"
+		};
+		m_shade_shader_module =
+		    myvk::ShaderModule::Create(device, kWavefrontShadeCompSpv, sizeof(kWavefrontShadeCompSpv));
+	}
+	{
+		constexpr uint32_t kWavefrontShadowCompSpv[] = {
+#include "spirv/wavefront_shadow.comp.u32"
+		};
+		m_shadow_shader_module =
+		    myvk::ShaderModule::Create(device, kWavefrontShadowCompSpv, sizeof(kWavefrontShadowCompSpv));
+	}
+	get_variant(kGenericLightType, 0, Structure::kOctree);
+	return true;
+#else
+	spdlog::warn("WavefrontPathTracer: wavefront_*.comp were left out (no glslc, stale SPIR-V)");
+	return false;
+#endif
+}
+
+const WavefrontPathTracer::Variant &WavefrontPathTracer::get_variant(uint32_t light_type, uint32_t bounce,
+                                                                     Structure structure) {
+	auto it = m_variants.find({light_type, bounce, structure});
+	if (it != m_variants.end())
+		return it->second;
+
+	auto begin = std::chrono::steady_clock::now();
+	// kLightType, kBounce, kTree64, kDAG and kCompact of shader/wavefront.glsl, the generic values are their defaults
+	uint32_t spec_data[] = {light_type, bounce, structure == Structure::kTree64, structure == Structure::kDAG,
+	                        structure == Structure::kCompact};
+	VkSpecializationMapEntry spec_entries[] = {{0, 0, sizeof(uint32_t)},
+	                                           {1, sizeof(uint32_t), sizeof(uint32_t)},
+	                                           {2, 2 * sizeof(uint32_t), sizeof(uint32_t)},
+	                                           {3, 3 * sizeof(uint32_t), sizeof(uint32_t)},
+	                                           {4, 4 * sizeof(uint32_t), sizeof(uint32_t)}};
+	VkSpecializationInfo spec_info = {5, spec_entries, sizeof(spec_data), spec_data};
+	const Variant &variant = m_variants[{light_type, bounce, structure}] = {
+	    myvk::ComputePipeline::Create(m_pipeline_layout, m_extend_shader_module, &spec_info),
+	    myvk::ComputePipeline::Create(m_pipeline_layout, m_shade_shader_module, &spec_info),
+	    myvk::ComputePipeline::Create(m_pipeline_layout, m_shadow_shader_module, &spec_info)};
+	if (light_type == kGenericLightType)
+		spdlog::info("Generic wavefront pipelines{} created in {} ms", kStructureStrs[(int)structure],
+		             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+	else
+		spdlog::info("Wavefront pipelines for light type {} and {} bounces{} created in {} ms", light_type, bounce,
+		             kStructureStrs[(int)structure],
+		             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+	return variant;
+}
+
+void WavefrontPathTracer::Reset(const std::shared_ptr<myvk::Device> &device, uint32_t width, uint32_t height,
+                                uint32_t bounce, bool specialized, Structure structure) {
+	m_width = width;
+	m_height = height;
+	m_bounce = bounce;
+	// the light type can change without a reset
+	for (uint32_t light_type = 0; light_type < kLightTypeCount; ++light_type)
+		m_light_type_variants[light_type] = specialized ? &get_variant(light_type, bounce, structure)
+		                                                : &get_variant(kGenericLightType, 0, structure);
+	const uint32_t kPathCount = width * height;
+
+	m_path_buffer = myvk::Buffer::Create(device, (VkDeviceSize)kPathCount * kPathSize, 0,
+	                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	m_shadow_ray_buffer = myvk::Buffer::Create(device, (VkDeviceSize)kPathCount * kShadowRaySize, 0,
+	                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	m_queue_buffer = myvk::Buffer::Create(device, (VkDeviceSize)kPathCount * kQueueCount * sizeof(uint32_t), 0,
+	                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+	const uint32_t kCounterCount = bounce * kQueueCount;
+	m_counter_buffer = myvk::Buffer::Create(device, kCounterCount * sizeof(QueueCounter), 0,
+	                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+	                                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	m_counter_init_buffer = myvk::Buffer::CreateStaging<QueueCounter>(
+	    device, kCounterCount,
+	    [kCounterCount](auto *data) { std::fill(data, data + kCounterCount, QueueCounter{0, 0, 0, 1}); });
+	for (uint32_t slot = 0; slot < kPTMaxSubmissionsInFlight; ++slot) {
+		m_counter_readback_buffers[slot] =
+		    myvk::Buffer::Create(device, kCounterCount * sizeof(QueueCounter),
+		                         VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+		                         VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		m_query_pools[slot] = myvk::QueryPool::Create(device, VK_QUERY_TYPE_TIMESTAMP, extend_query(bounce));
+	}
+
+	m_descriptor_set->UpdateStorageBuffer(m_path_buffer, 0);
+	m_descriptor_set->UpdateStorageBuffer(m_shadow_ray_buffer, 1);
+	m_descriptor_set->UpdateStorageBuffer(m_queue_buffer, 2);
+	m_descriptor_set->UpdateStorageBuffer(m_counter_buffer, 3);
+}
+
+void WavefrontPathTracer::cmd_dispatch_queue(const std::shared_ptr<myvk::CommandBuffer> &command_buffer,
+                                             const std::shared_ptr<myvk::ComputePipeline> &pipeline, uint32_t queue,
+                                             uint32_t level, const std::shared_ptr<myvk::QueryPool> &query_pool,
+                                             uint32_t query) const {
+	command_buffer->CmdBindPipeline(pipeline);
+	command_buffer->CmdDispatchIndirect(m_counter_buffer, (level * kQueueCount + queue) * sizeof(QueueCounter));
+	command_buffer->CmdWriteTimestamp(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, query_pool, query);
+
+	VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+	                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+	                                   {barrier}, {}, {});
+}
+
+void WavefrontPathTracer::CmdRender(const std::shared_ptr<myvk::CommandBuffer> &command_buffer,
+                                    const std::vector<std::shared_ptr<myvk::DescriptorSet>> &path_tracer_sets,
+                                    const void *push_constants, uint32_t push_constant_size,
+                                    const TileScheduler::Tile &tile, const SampleSettings &settings,
+                                    uint32_t timing_slot) const {
+	const Variant &variant = *m_light_type_variants[std::min(settings.light_type, kLightTypeCount - 1)];
+	const auto &query_pool = m_query_pools[timing_slot];
+	const auto &counter_readback_buffer = m_counter_readback_buffers[timing_slot];
+
+	command_buffer->CmdResetQueryPool(query_pool);
+	command_buffer->CmdWriteTimestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 0);
+
+	command_buffer->CmdCopy(m_counter_init_buffer, m_counter_buffer, {{0, 0, m_counter_buffer->GetSize()}});
+	command_buffer->CmdPipelineBarrier(
+	    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, {},
+	    {m_counter_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT,
+	                                        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+	                                            VK_ACCESS_INDIRECT_COMMAND_READ_BIT)},
+	    {});
+
+	std::vector<std::shared_ptr<myvk::DescriptorSet>> sets = path_tracer_sets;
+	sets.push_back(m_descriptor_set);
+	command_buffer->CmdBindDescriptorSets(sets, m_generate_pipeline);
+	command_buffer->CmdPushConstants(m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, push_constant_size,
+	                                 push_constants);
+	WavefrontPushConstants wavefront_push_constants = {0, tile};
+	command_buffer->CmdPushConstants(m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, push_constant_size,
+	                                 sizeof(WavefrontPushConstants), &wavefront_push_constants);
+
+	{
+		uint32_t groups = group_x_64(tile.width * tile.height);
+		command_buffer->CmdBindPipeline(m_generate_pipeline);
+		command_buffer->CmdDispatch(std::min(groups, kRowGroups), (groups + kRowGroups - 1) / kRowGroups, 1);
+		command_buffer->CmdWriteTimestamp(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, query_pool, 1);
+
+		VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		command_buffer->CmdPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                                   {barrier}, {}, {});
+	}
+
+	for (uint32_t level = 0; level < m_bounce; ++level) {
+		command_buffer->CmdPushConstants(m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, push_constant_size,
+		                                 sizeof(uint32_t), &level);
+		cmd_dispatch_queue(command_buffer, variant.extend, kExtendQueue, level, query_pool, extend_query(level));
+		if (level + 1 < m_bounce) {
+			cmd_dispatch_queue(command_buffer, variant.shade, kShadeQueue, level, query_pool,
+			                   extend_query(level) + 1);
+			cmd_dispatch_queue(command_buffer, variant.shadow, kShadowQueue, level, query_pool,
+			                   extend_query(level) + 2);
+		} else {
+			// the last hits are not shaded, keep the query layout of the other bounces
+			command_buffer->CmdWriteTimestamp(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, query_pool,
+			                                  extend_query(level) + 1);
+			command_buffer->CmdWriteTimestamp(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, query_pool,
+			                                  extend_query(level) + 2);
+		}
+	}
+
+	command_buffer->CmdPipelineBarrier(
+	    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, {},
+	    {m_counter_buffer->GetMemoryBarrier(VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT)}, {});
+	command_buffer->CmdCopy(m_counter_buffer, counter_readback_buffer, {{0, 0, m_counter_buffer->GetSize()}});
+	command_buffer->CmdPipelineBarrier(
+	    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, {},
+	    {counter_readback_buffer->GetMemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT)}, {});
+}
+
+bool WavefrontPathTracer::GetKernelTimings(KernelTimings *timings, uint32_t timing_slot) const {
+	const auto &query_pool = m_query_pools[timing_slot];
+	if (!query_pool)
+		return false;
+	std::vector<uint64_t> timestamps(query_pool->GetCount());
+	if (query_pool->GetResults64(timestamps.data(), 0) != VK_SUCCESS)
+		return false;
+
+	const auto elapsed_ms = [this, &timestamps](uint32_t query) {
+		return double(timestamps[query] - timestamps[query - 1]) * m_timestamp_period * 0.000001;
+	};
+	*timings = {};
+	timings->generate_ms = elapsed_ms(1);
+	const auto *counters = (const QueueCounter *)m_counter_readback_buffers[timing_slot]->GetMappedData();
+	timings->paths = counters[kExtendQueue].count;
+	for (uint32_t level = 0; level < m_bounce; ++level) {
+		timings->extend_ms += elapsed_ms(extend_query(level));
+		timings->shade_ms += elapsed_ms(extend_query(level) + 1);
+		timings->shadow_ms += elapsed_ms(extend_query(level) + 2);
+		timings->extend_rays += counters[level * kQueueCount + kExtendQueue].count;
+		timings->shadow_rays += counters[level * kQueueCount + kShadowQueue].count;
+	}
+	return true;
+}
@@ -0,0 +1,104 @@
+#ifndef WAVEFRONT_PATH_TRACER_HPP
+#define WAVEFRONT_PATH_TRACER_HPP
+
+#include "Config.hpp"
+#include "TileScheduler.hpp"
+#include "myvk/Buffer.hpp"
+#include "myvk/CommandBuffer.hpp"
+#include "myvk/ComputePipeline.hpp"
+#include "myvk/DescriptorSet.hpp"
+#include "myvk/QueryPool.hpp"
+
+#include <array>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+// Wavefront variant of path_tracer.comp, used by PathTracer in PathTracer::Modes::kWavefront. Instead of one
+// invocation running the whole bounce loop, every bounce runs separate kernels over compacted queues of path indices:
+// wavefront_generate.comp -> (wavefront_extend.comp -> wavefront_shade.comp -> wavefront_shadow.comp) * bounce.
+// Each queue counter doubles as the indirect dispatch arguments of its consumer, so only live paths are launched.
+// Every kernel is timed with timestamp queries and the queue counters are read back for the ray counts.
+// With adaptive sampling, wavefront_generate.comp only starts paths for the pixels that have not converged yet, judged
+// by the statistics image of the target set (shader/adaptive.glsl). Russian roulette ends dark paths early, so the
+// later bounces trace fewer rays.
+// The extend and shade kernels are specialized for the light type and the bounce count (Variant). The variants are
+// cached by both, so changing the settings between resets only creates the pipelines of new combinations.
+// Set 0 can hold another structure of the same scene instead of the octree (Structure), the extend and shadow kernels
+// of the variant trace it with shader/tree64.glsl, shader/dag.glsl or shader/compact.glsl.
+class WavefrontPathTracer {
+public:
+	// the structure bound at set 0 of CmdRender: the octree, Octree::GetTree64DescriptorSet,
+	// Octree::GetDAGDescriptorSet or Octree::GetCompactDescriptorSet
+	enum class Structure { kOctree, kTree64, kDAG, kCompact };
+	struct SampleSettings {
+		uint32_t light_type; // Lighting::LightTypes, selects the pipeline variant
+	};
+	struct KernelTimings {
+		double generate_ms, extend_ms, shade_ms, shadow_ms;
+		uint64_t paths, extend_rays, shadow_rays; // paths: pixels sampled by the last sample
+	};
+
+private:
+	std::shared_ptr<myvk::Buffer> m_path_buffer, m_shadow_ray_buffer, m_queue_buffer;
+	// per bounce and queue: {count, group_x, group_y, group_z}, cleared from m_counter_init_buffer every sample
+	std::shared_ptr<myvk::Buffer> m_counter_buffer, m_counter_init_buffer;
+	// per timing slot
+	std::array<std::shared_ptr<myvk::Buffer>, kPTMaxSubmissionsInFlight> m_counter_readback_buffers;
+	std::array<std::shared_ptr<myvk::QueryPool>, kPTMaxSubmissionsInFlight> m_query_pools;
+	uint32_t m_width{}, m_height{}, m_bounce{};
+	float m_timestamp_period{};
+
+	std::shared_ptr<myvk::DescriptorPool> m_descriptor_pool;
+	std::shared_ptr<myvk::DescriptorSetLayout> m_descriptor_set_layout;
+	std::shared_ptr<myvk::DescriptorSet> m_descriptor_set;
+
+	struct Variant {
+		std::shared_ptr<myvk::ComputePipeline> extend, shade, shadow;
+	};
+	static constexpr uint32_t kLightTypeCount = 2;
+
+	std::shared_ptr<myvk::PipelineLayout> m_pipeline_layout;
+	std::shared_ptr<myvk::ComputePipeline> m_generate_pipeline;
+	std::shared_ptr<myvk::ShaderModule> m_extend_shader_module, m_shade_shader_module, m_shadow_shader_module;
+	// light type kGenericLightType and bounce count 0 read them from the push constants
+	static constexpr uint32_t kGenericLightType = 0xffffffffu;
+	std::map<std::tuple<uint32_t, uint32_t, Structure>, Variant> m_variants; // by light type, bounce count and structure
+	std::array<const Variant *, kLightTypeCount> m_light_type_variants{}; // selected by Reset
+
+	void create_descriptor(const std::shared_ptr<myvk::Device> &device);
+	bool create_pipelines(const std::shared_ptr<myvk::Device> &device,
+	                      const std::vector<std::shared_ptr<myvk::DescriptorSetLayout>> &path_tracer_layouts,
+	                      uint32_t push_constant_size);
+	const Variant &get_variant(uint32_t light_type, uint32_t bounce, Structure structure);
+
+	void cmd_dispatch_queue(const std::shared_ptr<myvk::CommandBuffer> &command_buffer,
+	                        const std::shared_ptr<myvk::ComputePipeline> &pipeline, uint32_t queue, uint32_t level,
+	                        const std::shared_ptr<myvk::QueryPool> &query_pool, uint32_t query) const;
+
+public:
+	// path_tracer_layouts are the sets 0-5 of path_tracer.comp, push_constant_size the size of its push constants.
+	// nullptr if the SPIR-V of the wavefront kernels was not built
+	static std::shared_ptr<WavefrontPathTracer>
+	Create(const std::shared_ptr<myvk::Device> &device,
+	       const std::vector<std::shared_ptr<myvk::DescriptorSetLayout>> &path_tracer_layouts,
+	       uint32_t push_constant_size);
+
+	// specialized: use the pipeline variants of bounce, otherwise the generic kernels. structure: the one bound at
+	// path_tracer_sets[0] of CmdRender
+	void Reset(const std::shared_ptr<myvk::Device> &device, uint32_t width, uint32_t height, uint32_t bounce,
+	           bool specialized = true, Structure structure = Structure::kOctree);
+
+	// Samples the pixels of tile. push_constants are the ones of path_tracer.comp, the bounce index and the tile are
+	// appended. The Sobol sequence needs (bounce + 1) * 2 dimensions, as for path_tracer.comp.
+	void CmdRender(const std::shared_ptr<myvk::CommandBuffer> &command_buffer,
+	               const std::vector<std::shared_ptr<myvk::DescriptorSet>> &path_tracer_sets,
+	               const void *push_constants, uint32_t push_constant_size, const TileScheduler::Tile &tile,
+	               const SampleSettings &settings, uint32_t timing_slot) const;
+
+	// results of the last finished CmdRender with timing_slot, false if they are not available yet
+	bool GetKernelTimings(KernelTimings *timings, uint32_t timing_slot) const;
+};
+
+#endif
@@ -1,12 +1,44 @@
 #include "Application.hpp"
 #include "Config.hpp"
+#include "HeadlessRenderer.hpp"
 
+#include <algorithm>
 #include <spdlog/sinks/ringbuffer_sink.h>
 #include <spdlog/spdlog.h>
 
 constexpr const char *kHelpStr = "AdamYuan's GPU Sparse Voxel Octree (Driven by Vulkan)\n"
                                  "\t-obj [WAVEFRONT OBJ FILENAME]\n"
-                                 "\t-lvl [OCTREE LEVEL (%u <= lvl <= %u)]\n";
+                                 "\t-lvl [OCTREE LEVEL (%u <= lvl <= %u)]\n"
+                                 "\t-sort (sort-based octree building)\n"
+                                 "\t-dedup (merge the voxel fragments of each voxel before building)\n"
+                                 "\t-nocache (always reload the mesh and rebuild the octree)\n"
+                                 "\t-dfs, -veb (lay the octree nodes out depth-first or in van Emde Boas order)\n"
+                                 "\t-tree64 (also build a 64-tree, -headless traces it, implies -wavefront)\n"
+                                 "\t-dag (also build a DAG of identical subtrees, -headless traces it, implies -wavefront)\n"
+                                 "\t-compact (also build a child-mask octree, -headless traces it, implies -wavefront)\n"
+                                 "\t-lod [SPREAD] (also build LOD colors, -headless uses them)\n"
+                                 "\t-headless (render without a window and write EXR files, needs -obj, -lvl and -spp or -time)\n"
+                                 "\t\t-spp [SAMPLES PER PIXEL]\n"
+                                 "\t\t-time [TIME LIMIT IN SECONDS]\n"
+                                 "\t\t-size [WIDTH] [HEIGHT] (up to %ux%u)\n"
+                                 "\t\t-bounce [BOUNCE (%u <= bounce <= %u)]\n"
+                                 "\t\t-cam [X] [Y] [Z] [YAW] [PITCH]\n"
+                                 "\t\t-env [ENVIRONMENT MAP FILENAME]\n"
+                                 "\t\t-out [OUTPUT PREFIX] (writes <prefix>_color.exr, _albedo.exr, _normal.exr)\n"
+                                 "\t\t-fp16 (save EXR files as FP16)\n"
+                                 "\t\t-wavefront (wavefront path tracer with ray queues instead of the megakernel)\n"
+                                 "\t\t-tile [TILE SIZE] (submit runs of tiles from the centre instead of whole samples)\n"
+                                 "\t\t-budget [GPU MILLISECONDS PER TILE RUN]\n"
+                                 "\t\t-adaptive [RELATIVE ERROR THRESHOLD] (adaptive sampling)\n"
+                                 "\t\t-adaptivemin [MIN SAMPLES PER PIXEL BEFORE ADAPTIVE SAMPLING]\n"
+                                 "\t\t-nospecialize (generic path tracer pipelines, to compare with the specialized ones)\n"
+                                 "\t\t-roulette [MIN BOUNCE] (Russian roulette)\n"
+                                 "\t\t-denoise [ITERATIONS (1 <= iterations <= %u)] (also writes _denoised.exr)\n";
+
+static void print_help() {
+	printf(kHelpStr, kOctreeLevelMin, kOctreeLevelMax, kMaxHeadlessWidth, kMaxHeadlessHeight, kMinBounce, kMaxBounce,
+	       kMaxDenoiseIterations);
+}
 
 int main(int argc, char **argv) {
 #ifndef NDEBUG
@@ -18,24 +50,99 @@ int main(int argc, char **argv) {
 	++argv;
 	char **filename = nullptr;
 	uint32_t octree_level = 0;
+	OctreeLoadOptions load_options{};
+	bool headless = false;
+	HeadlessOptions headless_options{};
 	for (int i = 0; i < argc; ++i) {
 		if (i + 1 < argc && strcmp(argv[i], "-obj") == 0)
 			filename = argv + i + 1, ++i;
 		else if (i + 1 < argc && strcmp(argv[i], "-lvl") == 0)
 			octree_level = std::stoi(argv[i + 1]), ++i;
+		else if (strcmp(argv[i], "-sort") == 0)
+			load_options.build_mode = OctreeBuildMode::kSortBased;
+		else if (strcmp(argv[i], "-dedup") == 0)
+			load_options.deduplicate_fragments = true;
+		else if (strcmp(argv[i], "-nocache") == 0)
+			load_options.use_cache = false;
+		else if (strcmp(argv[i], "-dfs") == 0)
+			load_options.node_order = OctreeNodeOrder::kDepthFirst;
+		else if (strcmp(argv[i], "-veb") == 0)
+			load_options.node_order = OctreeNodeOrder::kVanEmdeBoas;
+		else if (strcmp(argv[i], "-tree64") == 0)
+			load_options.tree64 = headless_options.tree64 = true;
+		else if (strcmp(argv[i], "-dag") == 0)
+			load_options.dag = headless_options.dag = true;
+		else if (strcmp(argv[i], "-compact") == 0)
+			load_options.compact = headless_options.compact = true;
+		else if (i + 1 < argc && strcmp(argv[i], "-lod") == 0) {
+			load_options.lod = true;
+			headless_options.lod_spread = std::clamp(std::stof(argv[i + 1]), 0.0f, kMaxLODSpread), ++i;
+		}
+		else if (strcmp(argv[i], "-headless") == 0)
+			headless = true;
+		else if (i + 1 < argc && strcmp(argv[i], "-spp") == 0)
+			headless_options.spp = std::stoul(argv[i + 1]), ++i;
+		else if (i + 1 < argc && strcmp(argv[i], "-time") == 0)
+			headless_options.time_limit = std::stod(argv[i + 1]), ++i;
+		else if (i + 2 < argc && strcmp(argv[i], "-size") == 0) {
+			headless_options.width = std::clamp(std::stoi(argv[i + 1]), (int)kMinWidth, (int)kMaxHeadlessWidth);
+			headless_options.height = std::clamp(std::stoi(argv[i + 2]), (int)kMinHeight, (int)kMaxHeadlessHeight);
+			i += 2;
+		} else if (i + 1 < argc && strcmp(argv[i], "-bounce") == 0)
+			headless_options.bounce = std::clamp(std::stoi(argv[i + 1]), (int)kMinBounce, (int)kMaxBounce), ++i;
+		else if (i + 5 < argc && strcmp(argv[i], "-cam") == 0) {
+			headless_options.camera_position = {std::stof(argv[i + 1]), std::stof(argv[i + 2]),
+			                                    std::stof(argv[i + 3])};
+			headless_options.camera_yaw = std::stof(argv[i + 4]);
+			headless_options.camera_pitch = std::stof(argv[i + 5]);
+			i += 5;
+		} else if (i + 1 < argc && strcmp(argv[i], "-env") == 0)
+			headless_options.environment_map = argv[i + 1], ++i;
+		else if (i + 1 < argc && strcmp(argv[i], "-out") == 0)
+			headless_options.output_prefix = argv[i + 1], ++i;
+		else if (strcmp(argv[i], "-fp16") == 0)
+			headless_options.save_as_fp16 = true;
+		else if (strcmp(argv[i], "-wavefront") == 0)
+			headless_options.wavefront = true;
+		else if (i + 1 < argc && strcmp(argv[i], "-tile") == 0)
+			headless_options.tile_size = std::clamp(std::stoi(argv[i + 1]), (int)kPTMinTileSize, (int)kPTMaxTileSize),
+			++i;
+		else if (i + 1 < argc && strcmp(argv[i], "-budget") == 0)
+			headless_options.tile_budget_ms = std::clamp(std::stof(argv[i + 1]), 1.0f, kPTMaxTileBudgetMs), ++i;
+		else if (i + 1 < argc && strcmp(argv[i], "-adaptive") == 0)
+			headless_options.adaptive_threshold = std::clamp(std::stof(argv[i + 1]), 0.0f, kMaxAdaptiveThreshold), ++i;
+		else if (i + 1 < argc && strcmp(argv[i], "-adaptivemin") == 0)
+			headless_options.adaptive_min_samples =
+			    std::clamp(std::stoi(argv[i + 1]), 1, (int)kMaxAdaptiveMinSamples), ++i;
+		else if (strcmp(argv[i], "-nospecialize") == 0)
+			headless_options.specialized_pipelines = false;
+		else if (i + 1 < argc && strcmp(argv[i], "-roulette") == 0)
+			headless_options.roulette_min_bounce =
+			    std::clamp(std::stoi(argv[i + 1]), (int)kMinRouletteBounce, (int)kMaxBounce), ++i;
+		else if (i + 1 < argc && strcmp(argv[i], "-denoise") == 0)
+			headless_options.denoise_iterations =
+			    std::clamp(std::stoi(argv[i + 1]), 1, (int)kMaxDenoiseIterations), ++i;
 		else {
-			printf(kHelpStr, kOctreeLevelMin, kOctreeLevelMax);
+			print_help();
 			return EXIT_FAILURE;
 		}
 	}
-	if ((filename != nullptr) != (kOctreeLevelMin <= octree_level && octree_level <= kOctreeLevelMax)) {
-		printf(kHelpStr, kOctreeLevelMin, kOctreeLevelMax);
+	if ((filename != nullptr) != (kOctreeLevelMin <= octree_level && octree_level <= kOctreeLevelMax) ||
+	    (headless && (!filename || (headless_options.spp == 0 && headless_options.time_limit <= 0.0)))) {
+		print_help();
 		return EXIT_FAILURE;
 	}
 
+	if (headless) {
+		std::shared_ptr<HeadlessRenderer> renderer = HeadlessRenderer::Create();
+		if (!renderer)
+			return EXIT_FAILURE;
+		return renderer->Run(*filename, octree_level, load_options, headless_options) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
 	Application app{};
 	if (filename)
-		app.Load(*filename, octree_level);
+		app.Load(*filename, octree_level, load_options);
 	app.Run();
 
 	return EXIT_SUCCESS;